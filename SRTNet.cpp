@@ -9,8 +9,18 @@
 
 #include "SRTNet.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <limits>
 #include <optional>
 
+#include "SRTNetCallbackExecutor.h"
+#include "SRTNetConflation.h"
+#include "SRTNetConnectionCounters.h"
+#include "SRTNetCrypto.h"
+#include "SRTNetTrace.h"
 #include "SRTNetInternal.h"
 
 namespace {
@@ -68,6 +78,42 @@ private:
     uint16_t mPort;
 };
 
+/// @return The IP address of \p address without the port, empty if not an IPv4 or IPv6 address
+std::string ipAddressOf(const sockaddr* address) {
+    char buffer[INET6_ADDRSTRLEN] = {};
+    if (address->sa_family == AF_INET) {
+        inet_ntop(AF_INET, &reinterpret_cast<const sockaddr_in*>(address)->sin_addr, buffer, sizeof(buffer));
+    } else if (address->sa_family == AF_INET6) {
+        inet_ntop(AF_INET6, &reinterpret_cast<const sockaddr_in6*>(address)->sin6_addr, buffer, sizeof(buffer));
+    }
+    return buffer;
+}
+
+// A capacity probe message starts with kProbeMagic, the message type and three values, in network byte order
+constexpr char kProbeMagic[8] = {'S', 'R', 'T', 'N', 'P', 'R', 'B', '1'};
+constexpr size_t kProbeHeaderSize = sizeof(kProbeMagic) + 4 * sizeof(uint32_t);
+// Train messages carry their index and the number of messages in the train, the result carries the available
+// bandwidth in kbit/s, the RTT in us and the share of messages lost in parts per million
+enum ProbeMessageType : uint32_t { probeTrain = 1, probeResult = 2 };
+
+void writeProbeHeader(uint8_t* message, ProbeMessageType type, const uint32_t (&values)[3]) {
+    memcpy(message, kProbeMagic, sizeof(kProbeMagic));
+    uint32_t fields[4] = {htonl(type), htonl(values[0]), htonl(values[1]), htonl(values[2])};
+    memcpy(message + sizeof(kProbeMagic), fields, sizeof(fields));
+}
+
+bool readProbeHeader(const uint8_t* message, size_t size, ProbeMessageType type, uint32_t (&values)[3]) {
+    if (size < kProbeHeaderSize || memcmp(message, kProbeMagic, sizeof(kProbeMagic)) != 0) {
+        return false;
+    }
+    uint32_t fields[4];
+    memcpy(fields, message + sizeof(kProbeMagic), sizeof(fields));
+    for (size_t i = 0; i < 3; ++i) {
+        values[i] = ntohl(fields[i + 1]);
+    }
+    return ntohl(fields[0]) == type;
+}
+
 } // namespace
 
 SRT_LOG_HANDLER_FN* SRTNet::gLogHandler = defaultLogHandler;
@@ -80,18 +126,25 @@ SRTNet::~SRTNet() {
 }
 
 void SRTNet::closeAllClientSockets() {
-    std::lock_guard<std::mutex> lock(mClientListMtx);
-    for (auto& client : mClientList) {
-        SRTSOCKET socket = client.first;
-        int result = srt_close(socket);
-        if (clientDisconnected) {
-            clientDisconnected(client.second, socket);
+    std::map<SRTSOCKET, std::shared_ptr<NetworkConnection>> disconnectedClients;
+    {
+        std::lock_guard<std::mutex> lock(mClientListMtx);
+        for (auto& client : mClientList) {
+            SRTSOCKET socket = client.first;
+            rememberPeerRtt(socket);
+            if (srt_close(socket) == SRT_ERROR) {
+                SRT_LOGGER(true, LOGG_ERROR, "srt_close failed: " << srt_getlasterror_str());
+            }
         }
-        if (result == SRT_ERROR) {
-            SRT_LOGGER(true, LOGG_ERROR, "srt_close failed: " << srt_getlasterror_str());
+        disconnectedClients.swap(mClientList);
+        mSlowLaneSockets.clear();
+    }
+    // Like all callbacks, called without holding the lock
+    if (clientDisconnected) {
+        for (auto& client : disconnectedClients) {
+            clientDisconnected(client.second, client.first);
         }
     }
-    mClientList.clear();
 }
 
 bool SRTNet::startServer(const std::string& ip,
@@ -103,7 +156,8 @@ bool SRTNet::startServer(const std::string& ip,
                          int32_t peerIdleTimeout,
                          const std::string& psk,
                          bool singleClient,
-                         std::shared_ptr<NetworkConnection> ctx) {
+                         std::shared_ptr<NetworkConnection> ctx,
+                         bool singleThread) {
     std::lock_guard<std::mutex> lock(mNetMtx);
 
     SocketAddress socketAddress(ip, port);
@@ -132,6 +186,7 @@ bool SRTNet::startServer(const std::string& ip,
     mConfiguration.mMtu = mtu;
     mConfiguration.mPeerIdleTimeout = peerIdleTimeout;
     mConfiguration.mPsk = psk;
+    mConfiguration.mSingleThread = singleThread && !singleClient;
 
     if (!createServerSocket()) {
         mContext = SRT_INVALID_SOCK;
@@ -139,11 +194,33 @@ bool SRTNet::startServer(const std::string& ip,
         return false;
     }
 
+    if (mConfiguration.mSingleThread) {
+        // The server socket is polled together with the clients, add it here so a server that can't accept clients
+        // fails to start instead of looking started
+        mPollID = srt_epoll_create();
+        srt_epoll_set(mPollID, SRT_EPOLL_ENABLE_EMPTY);
+        const int events = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+        if (srt_epoll_add_usock(mPollID, mContext, &events) == SRT_ERROR) {
+            SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_add_usock error: " << srt_getlasterror_str());
+            srt_epoll_release(mPollID);
+            mPollID = 0;
+            srt_close(mContext);
+            mContext = SRT_INVALID_SOCK;
+            return false;
+        }
+    }
+
     mServerActive = true;
     mCurrentMode = Mode::server;
 
+    if (mConfiguration.mProbeMessages > 0) {
+        mProbeThread = std::thread(&SRTNet::capacityProbeWorker, this);
+    }
+
     if (singleClient) {
         mWorkerThread = std::thread(&SRTNet::serverSingleClientWorker, this);
+    } else if (mConfiguration.mSingleThread) {
+        mWorkerThread = std::thread(&SRTNet::serverSingleThreadWorker, this);
     } else {
         mWorkerThread = std::thread(&SRTNet::waitForSRTClient, this, singleClient);
     }
@@ -168,29 +245,55 @@ void SRTNet::serverSingleClientWorker() {
     }
 }
 
-void SRTNet::serverEventHandler(bool singleClient) {
+void SRTNet::serverEventHandler(bool singleClient, bool slowLane) {
     SRT_EPOLL_EVENT ready[MAX_WORKERS];
+    uint8_t msg[MAX_WORKERS][2048];
+    SRT_MSGCTRL msgCtrl[MAX_WORKERS];
+    int results[MAX_WORKERS];
+    bool decrypted[MAX_WORKERS];
+    size_t plainSizes[MAX_WORKERS];
+    SRTNET_TRACE_THREAD_NAME(slowLane ? "serverSlowLane" : "serverEventHandler");
+    const bool timeCallbacks = !singleClient && mConfiguration.mSlowLaneThreshold.count() > 0 && !mCallbackExecutor;
 
     while (mServerActive) {
-        int ret = srt_epoll_uwait(mPollID, &ready[0], MAX_WORKERS, kEpollTimeoutMs);
+        const int pollId = slowLane ? mSlowLanePollID : mPollID;
+        int ret = srt_epoll_uwait(pollId, &ready[0], MAX_WORKERS, kEpollTimeoutMs);
+        if (ret > 0) {
+            SRTNET_TRACE_INSTANT("epollWakeup", ret);
+        }
 
-        if (ret == -1 && mPollID != 0) {
+        if (ret == -1 && pollId != 0) {
             // If error and mPollId has not been reset by us, log error message
             SRT_LOGGER(true, LOGG_ERROR, "epoll error: " << srt_getlasterror_str());
             continue;
         }
-        // Handle all ready sockets
-        for (int i = 0; i < ret; i++) {
-            uint8_t msg[2048];
-            SRT_MSGCTRL thisMSGCTRL = srt_msgctrl_default;
-            SRTSOCKET thisSocket = ready[i].fd;
 
-            int result = SRT_ERROR;
+        // Read one message from each ready socket
+        for (int i = 0; i < ret; i++) {
+            SRTNET_TRACE_SCOPE("recvmsg");
+            msgCtrl[i] = srt_msgctrl_default;
+            results[i] = SRT_ERROR;
             if (ready[i].events & SRT_EPOLL_IN) {
-                result = srt_recvmsg2(thisSocket, reinterpret_cast<char*>(msg), sizeof(msg), &thisMSGCTRL);
+                results[i] = srt_recvmsg2(ready[i].fd, reinterpret_cast<char*>(msg[i]), sizeof(msg[i]), &msgCtrl[i]);
             }
+        }
 
-            std::lock_guard<std::mutex> lock(mClientListMtx);
+        // Decrypt the messages in parallel, they are still passed to the user in order below
+        if (mCipher && ret > 0) {
+            SRTNET_TRACE_SCOPE("decrypt");
+            auto decrypt = [&](size_t i, size_t) {
+                decrypted[i] = results[i] > 0 && mCipher->decrypt(msg[i], results[i], plainSizes[i]);
+            };
+            // Passed by reference, since a std::function holding the lambda itself would allocate
+            mCryptoPool->parallelFor(ret, std::ref(decrypt));
+        }
+
+        // Handle all ready sockets
+        for (int i = 0; i < ret; i++) {
+            SRTSOCKET thisSocket = ready[i].fd;
+            int result = results[i];
+
+            std::unique_lock<std::mutex> lock(mClientListMtx);
             auto iterator = mClientList.find(thisSocket);
             if (iterator == mClientList.end()) {
                 continue; // This client has already been removed by closeAllClientSockets()
@@ -201,22 +304,105 @@ void SRTNet::serverEventHandler(bool singleClient) {
                 SRT_LOGGER(true, LOG_DEBUG, "Connection to client was broken, removing client: " << thisSocket);
                 auto ctx = iterator->second;
                 mClientList.erase(iterator->first);
-                srt_epoll_remove_usock(mPollID, thisSocket);
+                mLastMsgNo.erase(thisSocket);
+                mProbeMessagesToDrop.erase(thisSocket);
+                mSlowLaneSockets.erase(thisSocket);
+                if (mConnectionCounters) {
+                    mConnectionCounters->remove(thisSocket);
+                }
+                if (mConflation) {
+                    mConflation->remove(thisSocket);
+                }
+                srt_epoll_remove_usock(pollId, thisSocket);
+                rememberPeerRtt(thisSocket);
                 srt_close(thisSocket);
-                if (clientDisconnected) {
-                    clientDisconnected(ctx, thisSocket);
+                if (mCallbackExecutor) {
+                    auto connection = callbackConnection(thisSocket, ctx);
+                    mCallbackConnections.erase(thisSocket);
+                    mCallbackExecutor->close(connection, [this, ctx, thisSocket]() mutable {
+                        if (clientDisconnected) {
+                            SRTNET_TRACE_CALLBACK_SCOPE("clientDisconnected");
+                            clientDisconnected(ctx, thisSocket);
+                        }
+                    });
+                } else if (clientDisconnected) {
+                    // Like all callbacks, called without holding the lock
+                    lock.unlock();
+                    const auto callbackStart = std::chrono::steady_clock::now();
+                    {
+                        SRTNET_TRACE_CALLBACK_SCOPE("clientDisconnected");
+                        clientDisconnected(ctx, thisSocket);
+                    }
+                    if (timeCallbacks) {
+                        updateSlowLane(thisSocket, slowLane, std::chrono::steady_clock::now() - callbackStart);
+                    }
                 }
 
                 // Client connection was broken, continue to next client
                 continue;
             }
 
-            // Pass the received data to the user
-            if (receivedDataNoCopy) {
-                receivedDataNoCopy(msg, result, thisMSGCTRL, iterator->second, thisSocket);
-            } else if (receivedData) {
-                auto pointer = std::make_unique<std::vector<uint8_t>>(msg, msg + result);
-                receivedData(pointer, thisMSGCTRL, iterator->second, thisSocket);
+            if (!mProbeMessagesToDrop.empty() && dropProbeMessage(thisSocket, msg[i], result)) {
+                continue;
+            }
+            if (mConnectionCounters) {
+                mConnectionCounters->countReceived(thisSocket, result, srt_time_now());
+            }
+            int32_t firstMissing = 0;
+            const int32_t missing = checkForLossGap(thisSocket, msgCtrl[i], firstMissing);
+
+            uint8_t* payload = msg[i];
+            size_t payloadSize = result;
+            bool deliver = true;
+            if (mCipher) {
+                if (decrypted[i]) {
+                    payload += SRTNetAeadCipher::kHeaderSize;
+                    payloadSize = plainSizes[i];
+                } else {
+                    SRT_LOGGER(true, LOGG_WARN, "Dropping message from " << thisSocket << " that failed to decrypt");
+                    deliver = false;
+                }
+            }
+            if (deliver && mConflation && conflateMessage(thisSocket, payload, payloadSize)) {
+                deliver = false;
+            }
+
+            if (mCallbackExecutor) {
+                if (missing > 0) {
+                    reportLossGap(thisSocket, iterator->second, firstMissing, missing, true);
+                }
+                if (deliver && !mCallbackExecutor->post(callbackConnection(thisSocket, iterator->second), payload,
+                                                        payloadSize, msgCtrl[i])) {
+                    SRT_LOGGER(true, LOGG_WARN, "Dropping message from " << thisSocket << ", callback queue is full");
+                }
+                continue;
+            }
+            if (missing == 0 && !deliver) {
+                continue;
+            }
+
+            // Call the callbacks without holding the lock, so a slow callback doesn't hold up accepting clients or the
+            // slow lane, and the callbacks may call getActiveClients
+            std::shared_ptr<NetworkConnection> ctx = iterator->second;
+            lock.unlock();
+            std::chrono::steady_clock::time_point callbackStart;
+            if (timeCallbacks) {
+                callbackStart = std::chrono::steady_clock::now();
+            }
+            if (missing > 0) {
+                reportLossGap(thisSocket, ctx, firstMissing, missing, false);
+            }
+            if (deliver) {
+                SRTNET_TRACE_CALLBACK_SCOPE("receivedData");
+                if (receivedDataNoCopy) {
+                    receivedDataNoCopy(payload, payloadSize, msgCtrl[i], ctx, thisSocket);
+                } else if (receivedData) {
+                    auto pointer = std::make_unique<std::vector<uint8_t>>(payload, payload + payloadSize);
+                    receivedData(pointer, msgCtrl[i], ctx, thisSocket);
+                }
+            }
+            if (timeCallbacks) {
+                updateSlowLane(thisSocket, slowLane, std::chrono::steady_clock::now() - callbackStart);
             }
         }
 
@@ -227,15 +413,205 @@ void SRTNet::serverEventHandler(bool singleClient) {
             }
         }
     }
-    SRT_LOGGER(true, LOGG_NOTIFY, "serverEventHandler exit");
+    SRT_LOGGER(true, LOGG_NOTIFY, (slowLane ? "serverSlowLane exit" : "serverEventHandler exit"));
 
-    if (mPollID != 0) {
+    if (!slowLane && mPollID != 0) {
         // May have been released already by stop() function
         srt_epoll_release(mPollID);
     }
 }
 
+void SRTNet::serverSingleThreadWorker() {
+    // startServer already added the server socket to mPollID
+    closeAllClientSockets();
+
+    SRT_LOGGER(true, LOGG_NOTIFY, "SRT Server wait for clients at port: " << getLocallyBoundPort());
+
+    SRT_EPOLL_EVENT ready[MAX_WORKERS];
+    SRTNET_TRACE_THREAD_NAME("serverSingleThreadWorker");
+    while (mServerActive) {
+        int ret = srt_epoll_uwait(mPollID, &ready[0], MAX_WORKERS, kEpollTimeoutMs);
+        if (ret == -1) {
+            SRT_LOGGER(true, LOGG_ERROR, "epoll error: " << srt_getlasterror_str());
+            continue;
+        }
+        if (ret > 0) {
+            SRTNET_TRACE_INSTANT("epollWakeup", ret);
+        }
+
+        for (int i = 0; i < ret; i++) {
+            SRTSOCKET thisSocket = ready[i].fd;
+            if (thisSocket == mContext) {
+                acceptPendingClients();
+                continue;
+            }
+
+            // This thread is the only one modifying mClientList, so no lock is needed for the lookup
+            auto iterator = mClientList.find(thisSocket);
+            if (iterator == mClientList.end()) {
+                continue;
+            }
+            receiveFromClient(thisSocket, iterator->second);
+        }
+    }
+    SRT_LOGGER(true, LOGG_NOTIFY, "serverSingleThreadWorker exit");
+}
+
+void SRTNet::acceptPendingClients() {
+    const int events = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+    struct sockaddr_storage theirAddr;
+    while (mServerActive) {
+        int addrSize = sizeof(theirAddr);
+        memset(&theirAddr, 0, addrSize);
+        SRTSOCKET newSocketCandidate = srt_accept(mContext, reinterpret_cast<sockaddr*>(&theirAddr), &addrSize);
+        if (newSocketCandidate == SRT_INVALID_SOCK) {
+            // No more pending clients in the accept queue
+            break;
+        }
+
+        SRT_LOGGER(true, LOGG_NOTIFY, "Client connected: " << newSocketCandidate);
+        SRTNET_TRACE_INSTANT("accept", newSocketCandidate);
+
+        ConnectionInformation connectionInformation = getConnectionInformation(newSocketCandidate);
+        std::shared_ptr<NetworkConnection> ctx;
+        {
+            SRTNET_TRACE_CALLBACK_SCOPE("clientConnected");
+            ctx = clientConnected(*reinterpret_cast<sockaddr*>(&theirAddr), newSocketCandidate, mConnectionContext,
+                                  connectionInformation);
+        }
+        if (!ctx) {
+            // No ctx in return from clientConnected callback means client was rejected by user.
+            rememberPeerRtt(newSocketCandidate);
+            srt_close(newSocketCandidate);
+            continue;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(mClientListMtx);
+            mClientList[newSocketCandidate] = ctx;
+            if (mConfiguration.mProbeMessages > 0) {
+                mProbeMessagesToDrop[newSocketCandidate] = mConfiguration.mProbeMessages;
+            }
+        }
+        if (mConfiguration.mProbeMessages > 0) {
+            startCapacityProbe(newSocketCandidate);
+        }
+        addConnectionCounters(newSocketCandidate);
+        int result = srt_epoll_add_usock(mPollID, newSocketCandidate, &events);
+        if (result == SRT_ERROR) {
+            SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_add_usock error: " << srt_getlasterror_str());
+        }
+    }
+}
+
+bool SRTNet::receiveFromClient(SRTSOCKET socket, std::shared_ptr<NetworkConnection>& ctx) {
+    uint8_t msg[2048];
+    for (int messages = 0; messages < kMaxMessagesPerWakeup; ++messages) {
+        SRT_MSGCTRL thisMSGCTRL = srt_msgctrl_default;
+        int result = srt_recvmsg2(socket, reinterpret_cast<char*>(msg), sizeof(msg), &thisMSGCTRL);
+        if (result == SRT_ERROR && srt_getlasterror(nullptr) == SRT_EASYNCRCV) {
+            // No more messages to read right now
+            return true;
+        }
+
+        if (result <= 0) {
+            // 0 means connection was broken, -1 (SRT_ERROR) means error, and we treat it the same way
+            SRT_LOGGER(true, LOG_DEBUG, "Connection to client was broken, removing client: " << socket);
+            auto disconnectedCtx = ctx;
+            {
+                std::lock_guard<std::mutex> lock(mClientListMtx);
+                mClientList.erase(socket);
+                mProbeMessagesToDrop.erase(socket);
+            }
+            mLastMsgNo.erase(socket);
+            if (mConnectionCounters) {
+                mConnectionCounters->remove(socket);
+            }
+            if (mConflation) {
+                mConflation->remove(socket);
+            }
+            srt_epoll_remove_usock(mPollID, socket);
+            rememberPeerRtt(socket);
+            srt_close(socket);
+            if (mCallbackExecutor) {
+                auto connection = callbackConnection(socket, disconnectedCtx);
+                mCallbackConnections.erase(socket);
+                mCallbackExecutor->close(connection, [this, disconnectedCtx, socket]() mutable {
+                    if (clientDisconnected) {
+                        SRTNET_TRACE_CALLBACK_SCOPE("clientDisconnected");
+                        clientDisconnected(disconnectedCtx, socket);
+                    }
+                });
+            } else if (clientDisconnected) {
+                SRTNET_TRACE_CALLBACK_SCOPE("clientDisconnected");
+                clientDisconnected(disconnectedCtx, socket);
+            }
+            return false;
+        }
+
+        if (!mProbeMessagesToDrop.empty() && dropProbeMessage(socket, msg, result)) {
+            continue;
+        }
+        if (mConnectionCounters) {
+            mConnectionCounters->countReceived(socket, result, srt_time_now());
+        }
+        int32_t firstMissing = 0;
+        const int32_t missing = checkForLossGap(socket, thisMSGCTRL, firstMissing);
+        if (missing > 0) {
+            reportLossGap(socket, ctx, firstMissing, missing, mCallbackExecutor != nullptr);
+        }
+
+        uint8_t* payload = msg;
+        size_t payloadSize = result;
+        if (!decryptReceivedMessage(payload, payloadSize)) {
+            continue;
+        }
+        if (mConflation && conflateMessage(socket, payload, payloadSize)) {
+            continue;
+        }
+
+        if (mCallbackExecutor) {
+            if (!mCallbackExecutor->post(callbackConnection(socket, ctx), payload, payloadSize, thisMSGCTRL)) {
+                SRT_LOGGER(true, LOGG_WARN, "Dropping message from " << socket << ", callback queue is full");
+            }
+            continue;
+        }
+
+        // Pass the received data to the user
+        SRTNET_TRACE_CALLBACK_SCOPE("receivedData");
+        if (receivedDataNoCopy) {
+            receivedDataNoCopy(payload, payloadSize, thisMSGCTRL, ctx, socket);
+        } else if (receivedData) {
+            auto pointer = std::make_unique<std::vector<uint8_t>>(payload, payload + payloadSize);
+            receivedData(pointer, thisMSGCTRL, ctx, socket);
+        }
+    }
+    return true;
+}
+
 SRTNet::ClientConnectStatus SRTNet::clientConnectToServer() {
+    ClientConnectStatus status = clientConnectToHost(mConfiguration.mRemoteHost, mConfiguration.mRemotePort);
+    if (status != failToConnect || mConfiguration.mRedirectBackends.empty()) {
+        return status;
+    }
+
+    // A front door rejects the caller with the index of the backend to connect to instead
+    int rejectReason = srt_getrejectreason(mContext);
+    if (rejectReason < kRejectRedirect ||
+        rejectReason >= kRejectRedirect + static_cast<int>(mConfiguration.mRedirectBackends.size())) {
+        return status;
+    }
+    const Backend& backend = mConfiguration.mRedirectBackends[rejectReason - kRejectRedirect];
+    SRT_LOGGER(true, LOGG_NOTIFY, "Redirected to " << backend.mHost << ":" << backend.mPort);
+    status = clientConnectToHost(backend.mHost, backend.mPort);
+    if (status != success) {
+        SRT_LOGGER(true, LOGG_WARN, "Failed to connect to the redirect target " << backend.mHost << ":" <<
+                                        backend.mPort);
+    }
+    return status;
+}
+
+SRTNet::ClientConnectStatus SRTNet::clientConnectToHost(const std::string& host, uint16_t port) {
     // Get all remote addresses for connection
     struct addrinfo hints = {};
     struct addrinfo* resolvedAddresses;
@@ -243,12 +619,11 @@ SRTNet::ClientConnectStatus SRTNet::clientConnectToServer() {
     hints.ai_protocol = IPPROTO_UDP;
     hints.ai_family = AF_UNSPEC;
     std::stringstream portAsString;
-    portAsString << mConfiguration.mRemotePort;
-    int result = getaddrinfo(mConfiguration.mRemoteHost.c_str(), portAsString.str().c_str(), &hints, &resolvedAddresses);
+    portAsString << port;
+    int result = getaddrinfo(host.c_str(), portAsString.str().c_str(), &hints, &resolvedAddresses);
     if (result) {
         SRT_LOGGER(true, LOGG_ERROR,
-                   "Failed getting the IP target for > " <<
-                       mConfiguration.mRemoteHost << ":" << mConfiguration.mRemotePort << " Errno: " << result);
+                   "Failed getting the IP target for > " << host << ":" << port << " Errno: " << result);
         return failToResolveAddress;
     }
 
@@ -258,9 +633,12 @@ SRTNet::ClientConnectStatus SRTNet::clientConnectToServer() {
         result = srt_connect(mContext, reinterpret_cast<sockaddr*>(resolvedAddress->ai_addr),
                              resolvedAddress->ai_addrlen);
         if (result != SRT_ERROR) {
+            ConnectionInformation connectionInformation = getConnectionInformation(mContext);
+            // The train is sent by the client worker, not to block startClient or reconnecting with a full send buffer
+            mProbeTrainPending = mConfiguration.mProbeMessages > 0;
+            addConnectionCounters(mContext);
             mClientConnected = true;
             if (connectedToServer) {
-                ConnectionInformation connectionInformation = getConnectionInformation(mContext);
                 connectedToServer(mConnectionContext, mContext, connectionInformation);
             }
             // Break for-loop on first successful connect call
@@ -276,7 +654,13 @@ bool SRTNet::waitForSRTClient(bool singleClient) {
     mPollID = srt_epoll_create();
     srt_epoll_set(mPollID, SRT_EPOLL_ENABLE_EMPTY);
     if (!singleClient) {
-        mEventThread = std::thread(&SRTNet::serverEventHandler, this, singleClient);
+        // The slow lane is set up first, since the event thread moves clients to it
+        if (mConfiguration.mSlowLaneThreshold.count() > 0 && !mCallbackExecutor) {
+            mSlowLanePollID = srt_epoll_create();
+            srt_epoll_set(mSlowLanePollID, SRT_EPOLL_ENABLE_EMPTY);
+            mSlowLaneThread = std::thread(&SRTNet::serverEventHandler, this, false, true);
+        }
+        mEventThread = std::thread(&SRTNet::serverEventHandler, this, singleClient, false);
     }
 
     closeAllClientSockets();
@@ -288,6 +672,7 @@ bool SRTNet::waitForSRTClient(bool singleClient) {
         SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_add_usock error: " << srt_getlasterror_str());
     }
     SRT_EPOLL_EVENT ready[1];
+    SRTNET_TRACE_THREAD_NAME("waitForSRTClient");
 
     struct sockaddr_storage theirAddr;
     int addrSize = sizeof(theirAddr);
@@ -310,6 +695,7 @@ bool SRTNet::waitForSRTClient(bool singleClient) {
         }
 
         SRT_LOGGER(true, LOGG_NOTIFY, "SRT Server wait for client at port: " << getLocallyBoundPort());
+        SRTNET_TRACE_SCOPE("accept");
         SRTSOCKET newSocketCandidate = srt_accept(mContext, reinterpret_cast<sockaddr*>(&theirAddr), &addrSize);
         if (newSocketCandidate == -1) {
             continue;
@@ -318,16 +704,29 @@ bool SRTNet::waitForSRTClient(bool singleClient) {
         SRT_LOGGER(true, LOGG_NOTIFY, "Client connected: " << newSocketCandidate);
 
         ConnectionInformation connectionInformation = getConnectionInformation(newSocketCandidate);
-        auto ctx = clientConnected(*reinterpret_cast<sockaddr*>(&theirAddr), newSocketCandidate, mConnectionContext, connectionInformation);
+        std::shared_ptr<NetworkConnection> ctx;
+        {
+            SRTNET_TRACE_CALLBACK_SCOPE("clientConnected");
+            ctx = clientConnected(*reinterpret_cast<sockaddr*>(&theirAddr), newSocketCandidate, mConnectionContext, connectionInformation);
+        }
 
         if (!ctx) {
             // No ctx in return from clientConnected callback means client was rejected by user.
+            rememberPeerRtt(newSocketCandidate);
             close(newSocketCandidate);
             continue;
         }
 
+        if (mConfiguration.mProbeMessages > 0) {
+            // Started before taking the client list lock, the probe only looks at the statistics of the socket
+            startCapacityProbe(newSocketCandidate);
+        }
         std::lock_guard<std::mutex> lock(mClientListMtx);
         mClientList[newSocketCandidate] = ctx;
+        if (mConfiguration.mProbeMessages > 0) {
+            mProbeMessagesToDrop[newSocketCandidate] = mConfiguration.mProbeMessages;
+        }
+        addConnectionCounters(newSocketCandidate);
         result = srt_epoll_add_usock(mPollID, newSocketCandidate, &events);
         if (result == SRT_ERROR) {
             SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_add_usock error: " << srt_getlasterror_str());
@@ -361,6 +760,13 @@ std::vector<std::pair<SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>>> SR
     return clients;
 }
 
+void SRTNet::getActiveClients(std::vector<std::pair<SRTSOCKET, std::shared_ptr<NetworkConnection>>>& clients) const {
+    std::lock_guard<std::mutex> lock(mClientListMtx);
+
+    clients.clear();
+    std::copy(mClientList.begin(), mClientList.end(), std::back_inserter(clients));
+}
+
 std::vector<SRTSOCKET> SRTNet::getActiveClientSockets() const {
     std::lock_guard<std::mutex> lock(mClientListMtx);
 
@@ -372,6 +778,15 @@ std::vector<SRTSOCKET> SRTNet::getActiveClientSockets() const {
     return clientSockets;
 }
 
+void SRTNet::getActiveClientSockets(std::vector<SRTSOCKET>& clientSockets) const {
+    std::lock_guard<std::mutex> lock(mClientListMtx);
+
+    clientSockets.clear();
+    for (const auto& [socket, networkConnection] : mClientList) {
+        clientSockets.push_back(socket);
+    }
+}
+
 bool SRTNet::startClient(const std::string& host,
                          uint16_t port,
                          int reorder,
@@ -467,7 +882,9 @@ bool SRTNet::createServerSocket() {
     }
 
     int32_t yes = 1;
-    int result = srt_setsockflag(mContext, SRTO_RCVSYN, &yes, sizeof(yes));
+    // In single thread mode the server socket is polled together with the client sockets, so accept must not block
+    int32_t blockingAccept = mConfiguration.mSingleThread ? 0 : 1;
+    int result = srt_setsockflag(mContext, SRTO_RCVSYN, &blockingAccept, sizeof(blockingAccept));
     if (result == SRT_ERROR) {
         SRT_LOGGER(true, LOGG_ERROR, "srt_setsockflag SRTO_RCVSYN: " << srt_getlasterror_str());
         return false;
@@ -518,6 +935,10 @@ bool SRTNet::createServerSocket() {
         return false;
     }
 
+    if (!applyNetworkOptions(mContext)) {
+        return false;
+    }
+
     SocketAddress socketAddress(mConfiguration.mLocalHost, mConfiguration.mLocalPort);
     if (!socketAddress.isIPv4() && !socketAddress.isIPv6()) {
         SRT_LOGGER(true, LOGG_ERROR, "Failed to parse socket address");
@@ -553,6 +974,14 @@ bool SRTNet::createServerSocket() {
         }
     }
 
+    result = srt_listen_callback(mContext, &SRTNet::listenCallback, this);
+    if (result == SRT_ERROR) {
+        SRT_LOGGER(true, LOGG_ERROR, "srt_listen_callback: " << srt_getlasterror_str());
+        srt_close(mContext);
+        mContext = SRT_INVALID_SOCK;
+        return false;
+    }
+
     result = srt_listen(mContext, 2);
     if (result == SRT_ERROR) {
         SRT_LOGGER(true, LOGG_ERROR, "srt_listen: " << srt_getlasterror_str());
@@ -570,6 +999,144 @@ bool SRTNet::createServerSocket() {
     return true;
 }
 
+int SRTNet::listenCallback(void* opaque, SRTSOCKET newSocket, int, const sockaddr* peer, const char* streamId) {
+    return static_cast<SRTNet*>(opaque)->configureIncomingConnection(newSocket, peer, streamId);
+}
+
+int SRTNet::configureIncomingConnection(SRTSOCKET newSocket, const sockaddr* peer, const char* streamId) {
+    if (!mConfiguration.mFrontDoorBackends.empty()) {
+        size_t backend = selectBackend(streamId);
+        SRT_LOGGER(true, LOG_DEBUG, "Redirecting caller to " << mConfiguration.mFrontDoorBackends[backend].mHost << ":"
+                                                             << mConfiguration.mFrontDoorBackends[backend].mPort);
+        srt_setrejectreason(newSocket, kRejectRedirect + static_cast<int>(backend));
+        return -1;
+    }
+
+    if (!mConfiguration.mStreamNetworkOptions.empty() && streamId != nullptr) {
+        // The rules are sorted on prefix, so the last match is the longest one
+        const NetworkOptions* required = nullptr;
+        for (const auto& [prefix, options] : mConfiguration.mStreamNetworkOptions) {
+            if (strncmp(streamId, prefix.c_str(), prefix.size()) == 0) {
+                required = &options;
+            }
+        }
+        if (required != nullptr && *required != mConfiguration.mNetworkOptions) {
+            SRT_LOGGER(true, LOGG_WARN, "Rejecting stream " << streamId << " that requires other network options");
+            srt_setrejectreason(newSocket, SRT_REJX_UNACCEPTABLE);
+            return -1;
+        }
+    }
+
+    if (mConfiguration.mAdaptiveLatencyMultiplier <= 0.0) {
+        return 0;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    SelectedLatency selected{mConfiguration.mLatency, -1.0, now};
+    {
+        std::lock_guard<std::mutex> lock(mPeerRttMtx);
+        // Expire the entries of connections that failed the handshake after the listen callback and were never
+        // accepted, oldest first. An entry already taken at accept, or renewed by a repeated handshake, is left alone.
+        while (!mSelectedLatencyOrder.empty() && now - mSelectedLatencyOrder.front().first > kSelectedLatencyExpiry) {
+            auto [time, socket] = mSelectedLatencyOrder.front();
+            mSelectedLatencyOrder.pop_front();
+            auto expired = mSelectedLatency.find(socket);
+            if (expired != mSelectedLatency.end() && expired->second.mSelected == time) {
+                mSelectedLatency.erase(expired);
+            }
+        }
+
+        auto iterator = mPeerRtt.find(ipAddressOf(peer));
+        if (iterator != mPeerRtt.end()) {
+            selected.mRtt = iterator->second;
+            double latency = std::round(mConfiguration.mAdaptiveLatencyMultiplier * selected.mRtt);
+            latency = std::clamp(latency, static_cast<double>(mConfiguration.mAdaptiveLatencyMin),
+                                 static_cast<double>(mConfiguration.mAdaptiveLatencyMax));
+            selected.mLatency = static_cast<int32_t>(latency);
+        }
+        // The listen callback may be called again for the same socket if the handshake is repeated
+        mSelectedLatency[newSocket] = selected;
+        mSelectedLatencyOrder.emplace_back(now, newSocket);
+    }
+
+    if (srt_setsockflag(newSocket, SRTO_RCVLATENCY, &selected.mLatency, sizeof(selected.mLatency)) == SRT_ERROR ||
+        srt_setsockflag(newSocket, SRTO_PEERLATENCY, &selected.mLatency, sizeof(selected.mLatency)) == SRT_ERROR) {
+        SRT_LOGGER(true, LOGG_ERROR, "Failed to set the latency of an incoming connection: " << srt_getlasterror_str());
+    }
+    return 0;
+}
+
+size_t SRTNet::selectBackend(const char* streamId) {
+    const std::vector<Backend>& backends = mConfiguration.mFrontDoorBackends;
+    if (mConfiguration.mRedirectPolicy == RedirectPolicy::streamIdHash) {
+        return std::hash<std::string>{}(streamId != nullptr ? streamId : "") % backends.size();
+    }
+
+    const size_t first = mNextBackend++ % backends.size();
+    size_t selected = first;
+    size_t lowestLoad = std::numeric_limits<size_t>::max();
+    for (size_t i = 0; i < backends.size(); ++i) {
+        size_t index = (first + i) % backends.size();
+        size_t load = backends[index].mLoad ? backends[index].mLoad() : 0;
+        if (load < lowestLoad) {
+            lowestLoad = load;
+            selected = index;
+        }
+    }
+    return selected;
+}
+
+void SRTNet::rememberPeerRtt(SRTSOCKET socket) {
+    if (mConfiguration.mAdaptiveLatencyMultiplier <= 0.0) {
+        return;
+    }
+
+    // Only connections that have carried data have measured the RTT, otherwise SRT reports its initial guess
+    SRT_TRACEBSTATS stats;
+    sockaddr_storage peer{};
+    int peerSize = sizeof(peer);
+    if (srt_bistats(socket, &stats, 0, 1) == SRT_ERROR || (stats.pktRecvTotal == 0 && stats.pktSentTotal == 0) ||
+        srt_getpeername(socket, reinterpret_cast<sockaddr*>(&peer), &peerSize) == SRT_ERROR) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mPeerRttMtx);
+    std::string key = ipAddressOf(reinterpret_cast<sockaddr*>(&peer));
+    if (mPeerRtt.size() >= kMaxPeerRttEntries && mPeerRtt.find(key) == mPeerRtt.end()) {
+        // Bound the memory used when many different peers connect, forgetting one of them is harmless
+        mPeerRtt.erase(mPeerRtt.begin());
+    }
+    mPeerRtt[key] = stats.msRTT;
+}
+
+bool SRTNet::applyNetworkOptions(SRTSOCKET socket) {
+    const NetworkOptions& options = mConfiguration.mNetworkOptions;
+    if (options.mDscp >= 0) {
+        // The DSCP is the upper six bits of the TOS byte (IPv4) or traffic class (IPv6)
+        int32_t tos = options.mDscp << 2;
+        if (srt_setsockflag(socket, SRTO_IPTOS, &tos, sizeof(tos)) == SRT_ERROR) {
+            SRT_LOGGER(true, LOGG_ERROR, "srt_setsockflag SRTO_IPTOS: " << srt_getlasterror_str());
+            return false;
+        }
+    }
+
+    if (options.mTtl > 0) {
+        if (srt_setsockflag(socket, SRTO_IPTTL, &options.mTtl, sizeof(options.mTtl)) == SRT_ERROR) {
+            SRT_LOGGER(true, LOGG_ERROR, "srt_setsockflag SRTO_IPTTL: " << srt_getlasterror_str());
+            return false;
+        }
+    }
+
+    if (!options.mInterface.empty()) {
+        if (srt_setsockflag(socket, SRTO_BINDTODEVICE, options.mInterface.c_str(), options.mInterface.length()) ==
+            SRT_ERROR) {
+            SRT_LOGGER(true, LOGG_ERROR, "srt_setsockflag SRTO_BINDTODEVICE: " << srt_getlasterror_str());
+            return false;
+        }
+    }
+    return true;
+}
+
 bool SRTNet::createClientSocket() {
     const int32_t yes = 1;
 
@@ -648,6 +1215,10 @@ bool SRTNet::createClientSocket() {
         return false;
     }
 
+    if (!applyNetworkOptions(mContext)) {
+        return false;
+    }
+
     if (!mConfiguration.mLocalHost.empty() || mConfiguration.mLocalPort != 0) {
         // Set local interface to bind to
 
@@ -707,11 +1278,16 @@ void SRTNet::clientWorker() {
     SRT_EPOLL_EVENT ready[1];
     uint8_t msg[2048];
     SRT_MSGCTRL thisMSGCTRL = srt_msgctrl_default;
+    SRTNET_TRACE_THREAD_NAME("clientWorker");
 
     while (mClientActive) {
         if (!mClientConnected) {
             // Try to connect to the server
-            ClientConnectStatus status = clientConnectToServer();
+            ClientConnectStatus status;
+            {
+                SRTNET_TRACE_SCOPE("connect");
+                status = clientConnectToServer();
+            }
             if (status == failToConnect) {
                 // Failed to connect caller/client, try again.
                 int rejectReason = srt_getrejectreason(mContext);
@@ -744,6 +1320,10 @@ void SRTNet::clientWorker() {
 
             SRT_LOGGER(true, LOGG_NOTIFY, "Connected to SRT Server");
         }
+        if (mProbeTrainPending) {
+            mProbeTrainPending = false;
+            sendCapacityProbe();
+        }
 
         int ret = srt_epoll_uwait(clientSocketPollId, ready, 1, kEpollTimeoutMs);
         if (ret == 0) {
@@ -759,6 +1339,7 @@ void SRTNet::clientWorker() {
             SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_uwait got event on unknown socket");
             break;
         }
+        SRTNET_TRACE_INSTANT("epollWakeup", ret);
 
         result = SRT_ERROR;
 
@@ -769,8 +1350,18 @@ void SRTNet::clientWorker() {
         if (result <= 0) {
             // 0 means connection was broken, -1 (SRT_ERROR) means error, and we treat it the same way
             mClientConnected = false;
+            SRTNET_TRACE_INSTANT("disconnected", mContext);
 
             SRTSOCKET context = mContext;
+            mLastMsgNo.erase(context);
+            mProbeTrainPending = false;
+            mAwaitingProbeResult = false;
+            if (mConnectionCounters) {
+                mConnectionCounters->remove(context);
+            }
+            if (mConflation) {
+                mConflation->remove(context);
+            }
             if (mClientActive) {
                 srt_epoll_remove_usock(clientSocketPollId, mContext);
                 SRT_LOGGER(true, LOG_DEBUG, "Client got disconnected from server: " << srt_getlasterror_str());
@@ -787,15 +1378,38 @@ void SRTNet::clientWorker() {
                 }
             }
             if (clientDisconnected) {
+                SRTNET_TRACE_CALLBACK_SCOPE("clientDisconnected");
                 clientDisconnected(mClientContext, context);
             }
             continue;
         }
 
+        if (mAwaitingProbeResult && receiveCapacityProbeResult(msg, result)) {
+            continue;
+        }
+        if (mConnectionCounters) {
+            mConnectionCounters->countReceived(mContext, result, srt_time_now());
+        }
+        int32_t firstMissing = 0;
+        const int32_t missing = checkForLossGap(mContext, thisMSGCTRL, firstMissing);
+        if (missing > 0) {
+            reportLossGap(mContext, mClientContext, firstMissing, missing, false);
+        }
+
+        uint8_t* payload = msg;
+        size_t payloadSize = result;
+        if (!decryptReceivedMessage(payload, payloadSize)) {
+            continue;
+        }
+        if (mConflation && conflateMessage(mContext, payload, payloadSize)) {
+            continue;
+        }
+
+        SRTNET_TRACE_CALLBACK_SCOPE("receivedData");
         if (receivedDataNoCopy) {
-            receivedDataNoCopy(msg, result, thisMSGCTRL, mClientContext, mContext);
+            receivedDataNoCopy(payload, payloadSize, thisMSGCTRL, mClientContext, mContext);
         } else if (receivedData) {
-            auto data = std::make_unique<std::vector<uint8_t>>(msg, msg + result);
+            auto data = std::make_unique<std::vector<uint8_t>>(payload, payload + payloadSize);
             receivedData(data, thisMSGCTRL, mClientContext, mContext);
         }
     }
@@ -839,17 +1453,85 @@ void SRTNet::setLogHandler(SRT_LOG_HANDLER_FN* handler, int loglevel) {
 
 
 bool SRTNet::sendData(const uint8_t* data, size_t len, SRT_MSGCTRL* msgCtrl, SRTSOCKET targetSystem) {
-    int result;
-
-    if (mCurrentMode == Mode::client && mContext != SRT_INVALID_SOCK && mClientActive && mClientConnected) {
-        result = srt_sendmsg2(mContext, reinterpret_cast<const char*>(data), len, msgCtrl);
-    } else if (mCurrentMode == Mode::server && targetSystem && mServerActive) {
-        result = srt_sendmsg2(targetSystem, reinterpret_cast<const char*>(data), len, msgCtrl);
-    } else {
+    SRTNET_TRACE_SCOPE("sendData");
+    SRTSOCKET socket = getSendSocket(targetSystem);
+    if (socket == SRT_INVALID_SOCK) {
         SRT_LOGGER(true, LOGG_WARN, "Can't send data, the client is not active.");
         return false;
     }
 
+    if (mCipher) {
+        uint8_t encrypted[2048];
+        if (len + SRTNetAeadCipher::kOverhead > sizeof(encrypted) || !mCipher->encrypt(data, len, encrypted)) {
+            SRT_LOGGER(true, LOGG_ERROR, "Failed to encrypt message of size " << len);
+            return false;
+        }
+        return sendMessage(socket, encrypted, len + SRTNetAeadCipher::kOverhead, msgCtrl);
+    }
+
+    return sendMessage(socket, data, len, msgCtrl);
+}
+
+size_t SRTNet::sendDataBatch(const uint8_t* const* data,
+                             const size_t* sizes,
+                             size_t count,
+                             SRT_MSGCTRL* msgCtrls,
+                             SRTSOCKET targetSystem) {
+    SRTSOCKET socket = getSendSocket(targetSystem);
+    if (socket == SRT_INVALID_SOCK) {
+        SRT_LOGGER(true, LOGG_WARN, "Can't send data, the client is not active.");
+        return 0;
+    }
+
+    const size_t kSlotSize = 2048;
+    // Kept by the thread between batches, so only a batch larger than any before it allocates
+    thread_local std::vector<uint8_t> encrypted;
+    thread_local std::vector<char> encryptedOk;
+    if (mCipher) {
+        // Encrypt all messages in parallel into one slot each, then send them in order
+        if (encrypted.size() < count * kSlotSize) {
+            encrypted.resize(count * kSlotSize);
+            encryptedOk.resize(count);
+        }
+        auto encrypt = [&](size_t index, size_t) {
+            encryptedOk[index] = sizes[index] + SRTNetAeadCipher::kOverhead <= kSlotSize &&
+                                 mCipher->encrypt(data[index], sizes[index], &encrypted[index * kSlotSize]);
+        };
+        mCryptoPool->parallelFor(count, std::ref(encrypt));
+    }
+
+    for (size_t index = 0; index < count; ++index) {
+        SRT_MSGCTRL defaultMsgCtrl = srt_msgctrl_default;
+        SRT_MSGCTRL* msgCtrl = msgCtrls ? &msgCtrls[index] : &defaultMsgCtrl;
+        bool sent;
+        if (mCipher) {
+            if (!encryptedOk[index]) {
+                SRT_LOGGER(true, LOGG_ERROR, "Failed to encrypt message of size " << sizes[index]);
+                return index;
+            }
+            sent = sendMessage(socket, &encrypted[index * kSlotSize], sizes[index] + SRTNetAeadCipher::kOverhead,
+                               msgCtrl);
+        } else {
+            sent = sendMessage(socket, data[index], sizes[index], msgCtrl);
+        }
+        if (!sent) {
+            return index;
+        }
+    }
+    return count;
+}
+
+SRTSOCKET SRTNet::getSendSocket(SRTSOCKET targetSystem) const {
+    if (mCurrentMode == Mode::client && mContext != SRT_INVALID_SOCK && mClientActive && mClientConnected) {
+        return mContext;
+    } else if (mCurrentMode == Mode::server && targetSystem && mServerActive) {
+        return targetSystem;
+    }
+    return SRT_INVALID_SOCK;
+}
+
+bool SRTNet::sendMessage(SRTSOCKET socket, const uint8_t* data, size_t len, SRT_MSGCTRL* msgCtrl) {
+    int result = srt_sendmsg2(socket, reinterpret_cast<const char*>(data), len, msgCtrl);
     if (result == SRT_ERROR) {
         SRT_LOGGER(true, LOGG_ERROR, "srt_sendmsg2 failed: " << srt_getlasterror_str());
         return false;
@@ -860,6 +1542,46 @@ bool SRTNet::sendData(const uint8_t* data, size_t len, SRT_MSGCTRL* msgCtrl, SRT
         return false;
     }
 
+    if (mConnectionCounters) {
+        mConnectionCounters->countSent(socket, len, srt_time_now());
+    }
+    return true;
+}
+
+bool SRTNet::decryptReceivedMessage(uint8_t*& data, size_t& size) {
+    if (!mCipher) {
+        return true;
+    }
+    size_t plainSize = 0;
+    if (!mCipher->decrypt(data, size, plainSize)) {
+        SRT_LOGGER(true, LOGG_WARN, "Dropping message of size " << size << " that failed to decrypt");
+        return false;
+    }
+    data += SRTNetAeadCipher::kHeaderSize;
+    size = plainSize;
+    return true;
+}
+
+bool SRTNet::setApplicationEncryption(const std::vector<uint8_t>& key, size_t workerThreads) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "Application layer encryption must be set before starting");
+        return false;
+    }
+
+    if (key.empty()) {
+        mCipher.reset();
+        mCryptoPool.reset();
+        return true;
+    }
+
+    std::unique_ptr<SRTNetAeadCipher> cipher = SRTNetAeadCipher::create(key);
+    if (!cipher) {
+        SRT_LOGGER(true, LOGG_ERROR, "Unsupported application layer encryption key of " << key.size() << " bytes");
+        return false;
+    }
+    mCipher = std::move(cipher);
+    mCryptoPool = std::make_unique<SRTNetWorkerPool>(workerThreads);
     return true;
 }
 
@@ -875,6 +1597,24 @@ bool SRTNet::stop() {
         if (mEventThread.joinable()) {
             mEventThread.join();
         }
+        if (mSlowLaneThread.joinable()) {
+            mSlowLaneThread.join();
+        }
+        if (mProbeThread.joinable()) {
+            {
+                std::lock_guard<std::mutex> probeLock(mProbeMtx);
+                mCapacityProbes.clear();
+            }
+            mProbeCondition.notify_all();
+            mProbeThread.join();
+        }
+        mLastMsgNo.clear();
+
+        // Let the callbacks of the messages already received run before the clients are disconnected below
+        if (mCallbackExecutor) {
+            mCallbackExecutor->drain();
+        }
+        mCallbackConnections.clear();
 
         // Lock the mutex before manipulating the server context/socket
         std::unique_lock<std::mutex> lock(mNetMtx);
@@ -889,9 +1629,23 @@ bool SRTNet::stop() {
         }
         // By closing the client sockets, any blocking recv calls will return
         closeAllClientSockets();
+        {
+            std::lock_guard<std::mutex> clientListLock(mClientListMtx);
+            mProbeMessagesToDrop.clear();
+        }
+        if (mConnectionCounters) {
+            mConnectionCounters->clear();
+        }
+        if (mConflation) {
+            mConflation->clear();
+        }
         // Release the epoll id to "break" the event threads poll call earlier than the 1 second timeout.
         srt_epoll_release(mPollID);
         mPollID = 0;
+        if (mSlowLanePollID != 0) {
+            srt_epoll_release(mSlowLanePollID);
+            mSlowLanePollID = 0;
+        }
 
         SRT_LOGGER(true, LOGG_NOTIFY, "Server stopped");
         mCurrentMode = Mode::unknown;
@@ -902,6 +1656,9 @@ bool SRTNet::stop() {
         if (mWorkerThread.joinable()) {
             mWorkerThread.join();
         }
+        mLastMsgNo.clear();
+        mProbeTrainPending = false;
+        mAwaitingProbeResult = false;
 
         std::lock_guard<std::mutex> lock(mNetMtx);
         if (mContext != SRT_INVALID_SOCK) {
@@ -913,6 +1670,12 @@ bool SRTNet::stop() {
             }
         }
         mClientConnected = false;
+        if (mConnectionCounters) {
+            mConnectionCounters->clear();
+        }
+        if (mConflation) {
+            mConflation->clear();
+        }
 
         SRT_LOGGER(true, LOGG_NOTIFY, "Client stopped");
         mCurrentMode = Mode::unknown;
@@ -922,6 +1685,569 @@ bool SRTNet::stop() {
     return true;
 }
 
+bool SRTNet::setCallbackExecutor(size_t workerThreads, size_t maxQueuedMessages) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "The callback executor must be set before the server is started");
+        return false;
+    }
+    if (workerThreads == 0) {
+        mCallbackExecutor.reset();
+        return true;
+    }
+    if (mConfiguration.mSlowLaneThreshold.count() > 0) {
+        SRT_LOGGER(true, LOGG_ERROR, "The callback executor can't be used together with the slow lane");
+        return false;
+    }
+    if (maxQueuedMessages == 0) {
+        SRT_LOGGER(true, LOGG_ERROR, "The callback queue must hold at least one message");
+        return false;
+    }
+    mCallbackExecutor = std::make_unique<SRTNetCallbackExecutor>(
+        workerThreads, maxQueuedMessages,
+        [this](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, std::shared_ptr<NetworkConnection>& ctx,
+               SRTSOCKET socket) {
+            SRTNET_TRACE_CALLBACK_SCOPE("receivedData");
+            if (receivedDataNoCopy) {
+                receivedDataNoCopy(data, size, msgCtrl, ctx, socket);
+            } else if (receivedData) {
+                auto pointer = std::make_unique<std::vector<uint8_t>>(data, data + size);
+                receivedData(pointer, msgCtrl, ctx, socket);
+            }
+        });
+    return true;
+}
+
+bool SRTNet::setConnectionCounters(size_t maxConnections) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "The connection counters must be set before the server or client is started");
+        return false;
+    }
+    if (maxConnections == 0) {
+        mConnectionCounters.reset();
+        return true;
+    }
+    mConnectionCounters = std::make_unique<SRTNetConnectionCounters>(maxConnections);
+    return true;
+}
+
+bool SRTNet::getConnectionCounters(ConnectionCounters& counters, SRTSOCKET targetSystem) const {
+    SRTSOCKET socket = getSendSocket(targetSystem);
+    return mConnectionCounters && socket != SRT_INVALID_SOCK &&
+           mConnectionCounters->get(socket, counters, srt_time_now());
+}
+
+void SRTNet::getAllConnectionCounters(std::vector<std::pair<SRTSOCKET, ConnectionCounters>>& counters) const {
+    counters.clear();
+    if (mConnectionCounters) {
+        mConnectionCounters->getAll(counters, srt_time_now());
+    }
+}
+
+void SRTNet::addConnectionCounters(SRTSOCKET socket) {
+    if (mConnectionCounters && !mConnectionCounters->add(socket)) {
+        SRT_LOGGER(true, LOGG_WARN, "Not counting connection " << socket << ", too many connections are counted");
+    }
+}
+
+bool SRTNet::setConflation(size_t maxKeys, ConflationKey key, size_t maxMessageSize) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "Conflation must be set before the server or client is started");
+        return false;
+    }
+    if (maxKeys == 0) {
+        mConflation.reset();
+        mConfiguration.mConflationKey = nullptr;
+        return true;
+    }
+    if (maxMessageSize == 0) {
+        SRT_LOGGER(true, LOGG_ERROR, "A conflated message must hold at least one byte");
+        return false;
+    }
+    mConflation = std::make_unique<SRTNetConflation>(maxKeys, maxMessageSize);
+    mConfiguration.mConflationKey = std::move(key);
+    return true;
+}
+
+bool SRTNet::getLatestMessage(std::vector<uint8_t>& message, uint64_t key, SRTSOCKET targetSystem) const {
+    SRTSOCKET socket = getSendSocket(targetSystem);
+    return mConflation && socket != SRT_INVALID_SOCK && mConflation->load(socket, key, message);
+}
+
+uint64_t SRTNet::getConflatedMessages(SRTSOCKET targetSystem) const {
+    SRTSOCKET socket = getSendSocket(targetSystem);
+    return mConflation && socket != SRT_INVALID_SOCK ? mConflation->conflated(socket) : 0;
+}
+
+bool SRTNet::conflateMessage(SRTSOCKET socket, const uint8_t* data, size_t size) {
+    uint64_t key = 0;
+    if (mConfiguration.mConflationKey && !mConfiguration.mConflationKey(data, size, socket, key)) {
+        return false;
+    }
+    return mConflation->store(socket, key, data, size);
+}
+
+bool SRTNet::setStaleMessageShedding(std::chrono::microseconds maxDelay, std::chrono::microseconds handlerBudget) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "Stale message shedding must be set before the server is started");
+        return false;
+    }
+    if (!mCallbackExecutor) {
+        SRT_LOGGER(true, LOGG_ERROR, "Stale message shedding needs the callback executor");
+        return false;
+    }
+    if (maxDelay.count() < 0 || handlerBudget.count() < 0 || handlerBudget > maxDelay) {
+        SRT_LOGGER(true, LOGG_ERROR, "Invalid stale message shedding settings");
+        return false;
+    }
+    mCallbackExecutor->setShedding(
+        maxDelay, handlerBudget,
+        [this](std::shared_ptr<NetworkConnection>& ctx, SRTSOCKET socket, uint64_t droppedMessages) {
+            SRTNET_TRACE_INSTANT("staleMessagesDropped", droppedMessages);
+            if (staleMessagesDropped) {
+                SRTNET_TRACE_CALLBACK_SCOPE("staleMessagesDropped");
+                staleMessagesDropped(ctx, socket, droppedMessages);
+            }
+        });
+    return true;
+}
+
+bool SRTNet::setSlowLane(std::chrono::microseconds callbackThreshold, std::chrono::milliseconds coolDown) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "The slow lane must be set before the server is started");
+        return false;
+    }
+    if (callbackThreshold.count() < 0 || coolDown.count() < 0) {
+        SRT_LOGGER(true, LOGG_ERROR, "Invalid slow lane settings");
+        return false;
+    }
+    if (callbackThreshold.count() > 0 && mCallbackExecutor) {
+        SRT_LOGGER(true, LOGG_ERROR, "The slow lane can't be used together with the callback executor");
+        return false;
+    }
+    mConfiguration.mSlowLaneThreshold = callbackThreshold;
+    mConfiguration.mSlowLaneCoolDown = coolDown;
+    return true;
+}
+
+bool SRTNet::hasSlowLane() const {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    return mConfiguration.mSlowLaneThreshold.count() > 0;
+}
+
+std::vector<SRTSOCKET> SRTNet::getSlowLaneSockets() const {
+    std::lock_guard<std::mutex> lock(mClientListMtx);
+    std::vector<SRTSOCKET> sockets;
+    sockets.reserve(mSlowLaneSockets.size());
+    for (const auto& [socket, lastSlowCallback] : mSlowLaneSockets) {
+        sockets.push_back(socket);
+    }
+    return sockets;
+}
+
+void SRTNet::updateSlowLane(SRTSOCKET socket, bool slowLane, std::chrono::steady_clock::duration callbackDuration) {
+    const bool slowCallback = callbackDuration > mConfiguration.mSlowLaneThreshold;
+    if (!slowLane && !slowCallback) {
+        return;
+    }
+    const auto now = std::chrono::steady_clock::now();
+    const int events = SRT_EPOLL_IN | SRT_EPOLL_ERR;
+
+    std::lock_guard<std::mutex> lock(mClientListMtx);
+    if (mClientList.find(socket) == mClientList.end()) {
+        // Disconnected, or the callback was clientDisconnected, so there is no client to move
+        if (slowCallback) {
+            auto took = std::chrono::duration_cast<std::chrono::microseconds>(callbackDuration);
+            SRT_LOGGER(true, LOGG_WARN, "Slow callback of disconnected client " << socket << " took " << took.count()
+                                                                                << " us");
+        }
+        return;
+    }
+    if (!slowLane) {
+        // The socket is only polled by one lane at a time, so its callbacks stay in order
+        srt_epoll_remove_usock(mPollID, socket);
+        if (srt_epoll_add_usock(mSlowLanePollID, socket, &events) == SRT_ERROR) {
+            SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_add_usock error: " << srt_getlasterror_str());
+            srt_epoll_add_usock(mPollID, socket, &events);
+            return;
+        }
+        mSlowLaneSockets[socket] = now;
+        auto took = std::chrono::duration_cast<std::chrono::microseconds>(callbackDuration);
+        SRT_LOGGER(true, LOGG_NOTIFY,
+                   "Moving client " << socket << " to the slow lane, its callback took " << took.count() << " us");
+        return;
+    }
+
+    auto iterator = mSlowLaneSockets.find(socket);
+    if (iterator == mSlowLaneSockets.end()) {
+        return;
+    }
+    if (slowCallback) {
+        iterator->second = now;
+        return;
+    }
+    if (now - iterator->second < mConfiguration.mSlowLaneCoolDown) {
+        return;
+    }
+    srt_epoll_remove_usock(mSlowLanePollID, socket);
+    if (srt_epoll_add_usock(mPollID, socket, &events) == SRT_ERROR) {
+        SRT_LOGGER(true, LOGG_ERROR, "srt_epoll_add_usock error: " << srt_getlasterror_str());
+        srt_epoll_add_usock(mSlowLanePollID, socket, &events);
+        return;
+    }
+    mSlowLaneSockets.erase(iterator);
+    SRT_LOGGER(true, LOGG_NOTIFY, "Moving client " << socket << " back from the slow lane");
+}
+
+uint64_t SRTNet::getStaleMessagesDropped() const {
+    return mCallbackExecutor ? mCallbackExecutor->getShedMessages() : 0;
+}
+
+int32_t SRTNet::getMissingMessages(int32_t previousMsgNo, int32_t msgNo) {
+    if (previousMsgNo < 1 || previousMsgNo > kMaxMsgNo || msgNo < 1 || msgNo > kMaxMsgNo) {
+        return 0;
+    }
+    // The number of steps forward from the previous message number, which wraps from kMaxMsgNo to 1
+    int32_t distance = msgNo - previousMsgNo;
+    if (distance <= 0) {
+        distance += kMaxMsgNo;
+    }
+    // A message more than half the message numbers ahead is taken to be an older message rather than a huge gap
+    if (distance > kMaxMsgNo / 2) {
+        return 0;
+    }
+    return distance - 1;
+}
+
+bool SRTNet::setCapacityProbe(size_t messages) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "The capacity probe must be set before the server or client is started");
+        return false;
+    }
+    if (messages == 1) {
+        SRT_LOGGER(true, LOGG_ERROR, "A probe train needs at least 2 messages");
+        return false;
+    }
+    mConfiguration.mProbeMessages = messages;
+    return true;
+}
+
+void SRTNet::sendCapacityProbe() {
+    const uint32_t count = static_cast<uint32_t>(mConfiguration.mProbeMessages);
+    uint8_t message[kProbeMessageSize] = {};
+    for (uint32_t index = 0; index < count; ++index) {
+        writeProbeHeader(message, probeTrain, {index, count, 0});
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        if (!sendMessage(mContext, message, sizeof(message), &msgCtrl)) {
+            SRT_LOGGER(true, LOGG_WARN, "Failed to send the capacity probe train");
+            return;
+        }
+    }
+
+    // The result is delivered after the latency of the connection, like any other message
+    int32_t latency = 0;
+    int latencySize = sizeof(latency);
+    srt_getsockflag(mContext, SRTO_RCVLATENCY, &latency, &latencySize);
+    mAwaitingProbeResult = true;
+    mProbeResultDeadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(latency) + kProbeTimeout +
+                           kConnectionTimeout;
+}
+
+bool SRTNet::receiveCapacityProbeResult(const uint8_t* data, size_t size) {
+    uint32_t values[3];
+    if (!readProbeHeader(data, size, probeResult, values)) {
+        if (std::chrono::steady_clock::now() > mProbeResultDeadline) {
+            SRT_LOGGER(true, LOGG_WARN,
+                       "No capacity probe result from the server, is the probe enabled on the server?");
+            mAwaitingProbeResult = false;
+        }
+        return false;
+    }
+    mAwaitingProbeResult = false;
+
+    CapacityProbeResult result;
+    result.mBandwidth = static_cast<int64_t>(values[0]) * 1000;
+    result.mRtt = values[1] / 1000.0;
+    result.mLoss = values[2] / 1000000.0;
+    SRT_LOGGER(true, LOGG_NOTIFY, "Capacity probe: " << result.mBandwidth << " bit/s available, RTT " << result.mRtt
+                                                      << " ms, loss " << result.mLoss);
+    if (capacityProbed) {
+        SRTNET_TRACE_CALLBACK_SCOPE("capacityProbed");
+        capacityProbed(mClientContext, mContext, result);
+    }
+    return true;
+}
+
+void SRTNet::startCapacityProbe(SRTSOCKET socket) {
+    // The client sends the train as soon as it is connected, so all data packets of a new connection are counted, even
+    // those that arrived before it was accepted
+    CapacityProbe probe;
+    probe.mSocket = socket;
+    probe.mLastChange = std::chrono::steady_clock::now();
+    {
+        std::lock_guard<std::mutex> lock(mProbeMtx);
+        mCapacityProbes.push_back(probe);
+    }
+    mProbeCondition.notify_one();
+}
+
+void SRTNet::capacityProbeWorker() {
+    SRTNET_TRACE_THREAD_NAME("capacityProbe");
+    std::vector<CapacityProbe> finished;
+    std::unique_lock<std::mutex> lock(mProbeMtx);
+    while (mServerActive) {
+        if (mCapacityProbes.empty()) {
+            mProbeCondition.wait(lock, [this]() { return !mServerActive || !mCapacityProbes.empty(); });
+            continue;
+        }
+
+        // The packets are counted as they arrive from the network, long before SRT delivers them at their playout
+        // time, by looking at the statistics of every probed connection at a short interval
+        lock.unlock();
+        std::this_thread::sleep_for(kProbePollInterval);
+        lock.lock();
+        const auto now = std::chrono::steady_clock::now();
+        for (auto probe = mCapacityProbes.begin(); probe != mCapacityProbes.end();) {
+            if (updateCapacityProbe(*probe, now)) {
+                finished.push_back(*probe);
+                probe = mCapacityProbes.erase(probe);
+            } else {
+                ++probe;
+            }
+        }
+
+        if (!finished.empty()) {
+            lock.unlock();
+            for (const CapacityProbe& probe : finished) {
+                finishCapacityProbe(probe);
+            }
+            finished.clear();
+            lock.lock();
+        }
+    }
+}
+
+bool SRTNet::updateCapacityProbe(CapacityProbe& probe, std::chrono::steady_clock::time_point now) {
+    SRT_TRACEBSTATS stats;
+    if (srt_bistats(probe.mSocket, &stats, 0, 1) == SRT_ERROR) {
+        // The client was rejected or has disconnected
+        probe.mReceived = 0;
+        return true;
+    }
+    const int64_t received = stats.pktRecvTotal;
+    if (received == probe.mReceived) {
+        return now - probe.mLastChange >= kProbeTimeout;
+    }
+
+    // The dispersion is the time from the first look that finds packets of the train to the look that finds the last
+    probe.mLastArrival = now;
+    probe.mLastChange = now;
+    if (probe.mReceived == 0) {
+        probe.mFirstArrival = now;
+        probe.mReceivedAtFirstArrival = received;
+    }
+    probe.mReceived = received;
+    return received >= static_cast<int64_t>(mConfiguration.mProbeMessages);
+}
+
+void SRTNet::finishCapacityProbe(const CapacityProbe& probe) {
+    SRT_TRACEBSTATS stats;
+    if (probe.mReceived == 0 || srt_bistats(probe.mSocket, &stats, 0, 1) == SRT_ERROR) {
+        if (probe.mReceived == 0) {
+            SRT_LOGGER(true, LOGG_WARN,
+                       "No capacity probe train from " << probe.mSocket << ", is the probe enabled on the client?");
+        }
+        return;
+    }
+
+    // A train arriving within one look gives a lower bound of the bandwidth
+    const double count = static_cast<double>(mConfiguration.mProbeMessages);
+    const double dispersion = std::max(std::chrono::duration<double>(probe.mLastArrival - probe.mFirstArrival).count(),
+                                       std::chrono::duration<double>(kProbePollInterval).count());
+    // SRT header, UDP header and IPv4 header
+    const double bitsPerPacket = (kProbeMessageSize + 16 + 8 + 20) * 8.0;
+    const double packets = static_cast<double>(std::max<int64_t>(probe.mReceived - probe.mReceivedAtFirstArrival, 1));
+    const double loss = std::clamp(static_cast<double>(stats.pktRcvLossTotal) / count, 0.0, 1.0);
+    CapacityProbeResult result;
+    result.mBandwidth = static_cast<int64_t>(packets * bitsPerPacket / dispersion * (1.0 - loss));
+    result.mRtt = stats.msRTT;
+    result.mLoss = loss;
+
+    uint8_t message[kProbeHeaderSize];
+    writeProbeHeader(message,
+                     probeResult,
+                     {static_cast<uint32_t>(std::min<int64_t>(result.mBandwidth / 1000,
+                                                              std::numeric_limits<uint32_t>::max())),
+                      static_cast<uint32_t>(std::max(stats.msRTT, 0.0) * 1000),
+                      static_cast<uint32_t>(loss * 1000000)});
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    if (!sendMessage(probe.mSocket, message, sizeof(message), &msgCtrl)) {
+        SRT_LOGGER(true, LOGG_WARN, "Failed to send the capacity probe result to " << probe.mSocket);
+    }
+
+    std::shared_ptr<NetworkConnection> ctx;
+    {
+        std::lock_guard<std::mutex> lock(mClientListMtx);
+        auto iterator = mClientList.find(probe.mSocket);
+        if (iterator == mClientList.end()) {
+            return;
+        }
+        ctx = iterator->second;
+    }
+    if (capacityProbed) {
+        SRTNET_TRACE_CALLBACK_SCOPE("capacityProbed");
+        capacityProbed(ctx, probe.mSocket, result);
+    }
+}
+
+bool SRTNet::dropProbeMessage(SRTSOCKET socket, const uint8_t* data, size_t size) {
+    auto iterator = mProbeMessagesToDrop.find(socket);
+    if (iterator == mProbeMessagesToDrop.end()) {
+        return false;
+    }
+    uint32_t values[3];
+    if (!readProbeHeader(data, size, probeTrain, values)) {
+        // The train is over, some of its messages were lost
+        mProbeMessagesToDrop.erase(iterator);
+        return false;
+    }
+    if (--iterator->second == 0) {
+        mProbeMessagesToDrop.erase(iterator);
+    }
+    return true;
+}
+
+int32_t SRTNet::checkForLossGap(SRTSOCKET socket, const SRT_MSGCTRL& msgCtrl, int32_t& firstMissing) {
+    if (msgCtrl.msgno < 1) {
+        return 0;
+    }
+    // Unlike emplace, try_emplace does not allocate a node when the connection is already known
+    auto [iterator, inserted] = mLastMsgNo.try_emplace(socket, msgCtrl.msgno);
+    if (inserted) {
+        // Nothing is known about what was lost before the first message of a connection
+        return 0;
+    }
+
+    const int32_t previousMsgNo = iterator->second;
+    const int32_t expectedMsgNo = previousMsgNo == kMaxMsgNo ? 1 : previousMsgNo + 1;
+    const int32_t missing = getMissingMessages(previousMsgNo, msgCtrl.msgno);
+    if (missing == 0 && msgCtrl.msgno != expectedMsgNo) {
+        // A duplicate or older message, keep waiting for the message after the previous one
+        return 0;
+    }
+    iterator->second = msgCtrl.msgno;
+    if (missing == 0 || !lossGap) {
+        return 0;
+    }
+    SRTNET_TRACE_INSTANT("lossGap", missing);
+    firstMissing = expectedMsgNo;
+    return missing;
+}
+
+std::shared_ptr<SRTNetCallbackConnection>& SRTNet::callbackConnection(SRTSOCKET socket,
+                                                                      const std::shared_ptr<NetworkConnection>& ctx) {
+    std::shared_ptr<SRTNetCallbackConnection>& connection = mCallbackConnections[socket];
+    if (!connection) {
+        connection = mCallbackExecutor->open(socket, ctx);
+    }
+    return connection;
+}
+
+void SRTNet::reportLossGap(SRTSOCKET socket,
+                           std::shared_ptr<NetworkConnection>& ctx,
+                           int32_t firstMissing,
+                           int32_t count,
+                           bool viaCallbackExecutor) {
+    if (viaCallbackExecutor) {
+        auto task = [this, ctx, socket, firstMissing, count]() mutable {
+            SRTNET_TRACE_CALLBACK_SCOPE("lossGap");
+            lossGap(ctx, socket, firstMissing, count);
+        };
+        mCallbackExecutor->postTask(callbackConnection(socket, ctx), std::move(task));
+        return;
+    }
+    SRTNET_TRACE_CALLBACK_SCOPE("lossGap");
+    lossGap(ctx, socket, firstMissing, count);
+}
+
+bool SRTNet::setAdaptiveLatency(double rttMultiplier, int32_t minLatency, int32_t maxLatency) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "Adaptive latency must be set before the server is started");
+        return false;
+    }
+    if (rttMultiplier < 0.0 || minLatency < 0 || maxLatency < minLatency) {
+        SRT_LOGGER(true, LOGG_ERROR, "Invalid adaptive latency settings");
+        return false;
+    }
+    mConfiguration.mAdaptiveLatencyMultiplier = rttMultiplier;
+    mConfiguration.mAdaptiveLatencyMin = minLatency;
+    mConfiguration.mAdaptiveLatencyMax = maxLatency;
+    return true;
+}
+
+bool SRTNet::setNetworkOptions(const NetworkOptions& options) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "Network options must be set before the server or client is started");
+        return false;
+    }
+    if (options.mDscp < -1 || options.mDscp > 63 || options.mTtl < -1 || options.mTtl == 0 || options.mTtl > 255) {
+        SRT_LOGGER(true, LOGG_ERROR, "Invalid network options");
+        return false;
+    }
+    mConfiguration.mNetworkOptions = options;
+    return true;
+}
+
+bool SRTNet::setStreamNetworkOptions(const std::string& streamIdPrefix, const NetworkOptions& options) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "Stream network options must be set before the server is started");
+        return false;
+    }
+    if (options.mDscp < -1 || options.mDscp > 63 || options.mTtl < -1 || options.mTtl == 0 || options.mTtl > 255) {
+        SRT_LOGGER(true, LOGG_ERROR, "Invalid network options");
+        return false;
+    }
+    mConfiguration.mStreamNetworkOptions[streamIdPrefix] = options;
+    return true;
+}
+
+bool SRTNet::setFrontDoor(const std::vector<Backend>& backends, RedirectPolicy policy) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "The front door must be set before the server is started");
+        return false;
+    }
+    if (backends.empty() || backends.size() > kMaxRedirectBackends) {
+        SRT_LOGGER(true, LOGG_ERROR, "A front door needs 1 to " << kMaxRedirectBackends << " backends");
+        return false;
+    }
+    mConfiguration.mFrontDoorBackends = backends;
+    mConfiguration.mRedirectPolicy = policy;
+    return true;
+}
+
+bool SRTNet::setRedirectBackends(const std::vector<Backend>& backends) {
+    std::lock_guard<std::mutex> lock(mNetMtx);
+    if (mCurrentMode != Mode::unknown) {
+        SRT_LOGGER(true, LOGG_ERROR, "The redirect backends must be set before the client is started");
+        return false;
+    }
+    if (backends.size() > kMaxRedirectBackends) {
+        SRT_LOGGER(true, LOGG_ERROR, "At most " << kMaxRedirectBackends << " redirect backends are supported");
+        return false;
+    }
+    mConfiguration.mRedirectBackends = backends;
+    return true;
+}
+
 bool SRTNet::getStatistics(SRT_TRACEBSTATS* currentStats, int clear, int instantaneous, SRTSOCKET targetSystem) {
     std::lock_guard<std::mutex> lock(mNetMtx);
     if (mCurrentMode == Mode::client && mClientActive && mContext != SRT_INVALID_SOCK) {
@@ -973,10 +2299,9 @@ SRTNet::ConnectionInformation SRTNet::getConnectionInformation(SRTSOCKET socket)
     int clientSrtVersionSize = sizeof(clientSrtVersion);
     if (SRT_ERROR != srt_getsockflag(socket, SRTO_PEERVERSION, &clientSrtVersion, &clientSrtVersionSize)) {
         // The SRT version is stored as an int (little endian), like 0x00XXYYZZ, where XX is major, YY is minor, and ZZ is patch version
-        connectionInformation.mPeerSrtVersion =
-            std::to_string(static_cast<int32_t>(clientSrtVersion[2])) + "." +
-            std::to_string(static_cast<int32_t>(clientSrtVersion[1])) + "." +
-            std::to_string(static_cast<int32_t>(clientSrtVersion[0]));
+        char version[16];
+        snprintf(version, sizeof(version), "%d.%d.%d", clientSrtVersion[2], clientSrtVersion[1], clientSrtVersion[0]);
+        connectionInformation.mPeerSrtVersion = version;
     } else {
         SRT_LOGGER(true, LOGG_ERROR, "Failed to get peer SRT version from the new connection: " << srt_getlasterror_str());
     }
@@ -989,5 +2314,34 @@ SRTNet::ConnectionInformation SRTNet::getConnectionInformation(SRTSOCKET socket)
         SRT_LOGGER(true, LOGG_ERROR, "Failed to get peer latency from the new connection: " << srt_getlasterror_str());
     }
 
+    int32_t receiveLatency = 0;
+    int receiveLatencySize = sizeof(receiveLatency);
+    if (SRT_ERROR != srt_getsockflag(socket, SRTO_RCVLATENCY, &receiveLatency, &receiveLatencySize)) {
+        connectionInformation.mReceiveLatency = receiveLatency;
+    }
+
+    int32_t tos = 0;
+    int tosSize = sizeof(tos);
+    if (SRT_ERROR != srt_getsockflag(socket, SRTO_IPTOS, &tos, &tosSize)) {
+        connectionInformation.mDscp = tos >> 2;
+    }
+
+    int32_t ttl = 0;
+    int ttlSize = sizeof(ttl);
+    if (SRT_ERROR != srt_getsockflag(socket, SRTO_IPTTL, &ttl, &ttlSize)) {
+        connectionInformation.mTtl = ttl;
+    }
+
+    {
+        // The entry is no longer needed once the socket is accepted, whether the connection is then kept or rejected
+        std::lock_guard<std::mutex> lock(mPeerRttMtx);
+        auto iterator = mSelectedLatency.find(socket);
+        if (iterator != mSelectedLatency.end()) {
+            connectionInformation.mSelectedLatency = iterator->second.mLatency;
+            connectionInformation.mEstimatedRtt = iterator->second.mRtt;
+            mSelectedLatency.erase(iterator);
+        }
+    }
+
     return connectionInformation;
 }
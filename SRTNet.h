@@ -11,7 +11,10 @@
 
 #include <any>
 #include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdlib>
+#include <deque>
 #include <functional>
 #include <iostream>
 #include <map>
@@ -37,6 +40,13 @@
 
 #define MAX_WORKERS 5 // Max number of connections to deal with each epoll
 
+class SRTNetAeadCipher;
+class SRTNetCallbackExecutor;
+struct SRTNetCallbackConnection;
+class SRTNetConflation;
+class SRTNetConnectionCounters;
+class SRTNetWorkerPool;
+
 namespace SRTNetClearStats {
 enum SRTNetClearStats : int { no, yes };
 }
@@ -61,8 +71,81 @@ public:
     struct ConnectionInformation {
         std::string mPeerSrtVersion = "n/a"; // The SRT version of the peer
         int32_t mNegotiatedLatency = -1;     // The latency that was negotiated with the peer
+        int32_t mReceiveLatency = -1;        // The latency this end applies to the data it receives
+        int32_t mSelectedLatency = -1;       // The latency picked by adaptive latency selection, -1 if not used
+        double mEstimatedRtt = -1.0;         // The RTT (ms) the selected latency is based on, -1 if unknown
+        int32_t mDscp = -1;                  // The DSCP code point of the packets sent on the connection
+        int32_t mTtl = -1;                   // The IP TTL (IPv4) or hop limit (IPv6) of the packets sent
+    };
+
+    /**
+     * @brief The result of the capacity probe of a connection, see setCapacityProbe.
+     */
+    struct CapacityProbeResult {
+        int64_t mBandwidth = -1; // Available bandwidth (bit/s) client to server
+        double mRtt = -1.0;      // The RTT (ms) at the end of the capacity probe
+        double mLoss = -1.0;     // The share of the probe messages lost
+    };
+
+    /**
+     * @brief IP level options of the UDP socket used for a connection, set with setNetworkOptions.
+     */
+    struct NetworkOptions {
+        int32_t mDscp = -1;     // DSCP code point 0-63, for example 46 (EF) for low latency traffic, -1 for the default
+        int32_t mTtl = -1;      // IP TTL (IPv4) or hop limit (IPv6) 1-255, -1 for the default
+        std::string mInterface; // Network interface to send and receive on, like "eth1", empty for any. Linux only.
+
+        bool operator==(const NetworkOptions& other) const {
+            return mDscp == other.mDscp && mTtl == other.mTtl && mInterface == other.mInterface;
+        }
+        bool operator!=(const NetworkOptions& other) const {
+            return !(*this == other);
+        }
+    };
+
+    /**
+     * @brief Counters of a connection kept by this wrapper, see setConnectionCounters. The bytes are counted as
+     * carried by SRT, including the overhead of application layer encryption.
+     */
+    struct ConnectionCounters {
+        uint64_t mMessagesReceived = 0;
+        uint64_t mBytesReceived = 0;
+        uint64_t mMessagesSent = 0;
+        uint64_t mBytesSent = 0;
+        int64_t mLastActivity = 0;         // srt_time_now() of the last message received or sent, 0 if none yet
+        double mReceiveBitsPerSecond = 0;  // Moving average of the received bitrate
+        double mSendBitsPerSecond = 0;     // Moving average of the sent bitrate
+    };
+
+    /**
+     * @brief Picks the key a received message is conflated under, see setConflation. Called on the thread reading
+     * from SRT for every message.
+     * @param key set to the key of the message
+     * @return true to conflate the message, false to deliver it to the callbacks as usual.
+     */
+    using ConflationKey = std::function<bool(const uint8_t* data, size_t size, SRTSOCKET socket, uint64_t& key)>;
+
+    /**
+     * @brief A server a front door redirects callers to, set with setFrontDoor and setRedirectBackends.
+     */
+    struct Backend {
+        std::string mHost;
+        uint16_t mPort = 0;
+        std::function<size_t()> mLoad; // The load of the server, like its number of clients. Used by the front door.
     };
 
+    /**
+     * @brief How a front door picks the backend to redirect a caller to.
+     */
+    enum class RedirectPolicy {
+        leastLoaded, // The backend with the lowest load, backends with the same load are picked in turn
+        streamIdHash // A backend picked from a hash of the stream ID, so a stream always ends up at the same backend
+    };
+
+    // The reject reason of a redirected caller is kRejectRedirect + the index of the backend
+    static constexpr int kRejectRedirect = SRT_REJC_USERDEFINED + 500;
+    static constexpr size_t kMaxRedirectBackends = 500;
+
     /**
      *
      * @brief Constructor that can set a log prefix which will be added to the start of all log messages from this
@@ -89,6 +172,9 @@ public:
      * @param singleClient set to true to accept just one client connection at the time to the server, otherwise the
      * server will keep waiting and accepting more incoming client connections
      * @param ctx optional context used only in the clientConnected callback
+     * @param singleThread set to true to accept and receive from all clients on one single thread, with the server
+     * socket in non-blocking mode registered in the same epoll as the client sockets. Only applies when singleClient
+     * is false.
      * @return true if server was able to start
      */
     bool startServer(const std::string& localIP,
@@ -100,7 +186,8 @@ public:
                      int32_t peerIdleTimeout = 5000,
                      const std::string& psk = "",
                      bool singleClient = false,
-                     std::shared_ptr<NetworkConnection> ctx = {});
+                     std::shared_ptr<NetworkConnection> ctx = {},
+                     bool singleThread = false);
 
     /**
      *
@@ -198,6 +285,285 @@ public:
      */
     bool sendData(const uint8_t* data, size_t size, SRT_MSGCTRL* msgCtrl, SRTSOCKET targetSystem = 0);
 
+    /**
+     *
+     * Send a batch of messages. When application layer encryption is enabled, the messages are encrypted in parallel
+     * on the crypto worker pool and then sent in order.
+     *
+     * @param data array of pointers to the data of each message
+     * @param sizes array of the size of each message
+     * @param count number of messages in the batch
+     * @param msgCtrls array of SRT_MSGCTRL structs, one per message, or nullptr to use srt_msgctrl_default
+     * @param targetSystem the target sending the data to (used in server mode only)
+     * @return the number of messages, from the start of the batch, that were sent.
+     */
+    size_t sendDataBatch(const uint8_t* const* data,
+                         const size_t* sizes,
+                         size_t count,
+                         SRT_MSGCTRL* msgCtrls,
+                         SRTSOCKET targetSystem = 0);
+
+    /**
+     *
+     * Enable application layer AES-GCM encryption of all messages, on top of (or instead of) the SRT encryption set up
+     * with the PSK. SRT encrypts on its single sending and receiving threads, while this encryption runs on the threads
+     * calling sendData, and batches are spread over a pool of worker threads. Both peers must use the same key, which
+     * only serves to derive a subkey per sender, see SRTNetAeadCipher. Every message grows with 36 bytes, so the
+     * largest message that can be sent shrinks accordingly. Must be called before startServer or startClient.
+     *
+     * @param key 16 bytes for AES-128-GCM, 32 bytes for AES-256-GCM, or empty to disable application layer encryption
+     * @param workerThreads number of worker threads, in addition to the calling thread, used to encrypt batches passed
+     * to sendDataBatch and to decrypt messages received from several clients at once
+     * @return true if the key was accepted.
+     */
+    bool setApplicationEncryption(const std::vector<uint8_t>& key, size_t workerThreads);
+
+    /**
+     *
+     * Run the receivedData, receivedDataNoCopy and clientDisconnected callbacks of a server on a pool of worker
+     * threads instead of on the thread reading from SRT, so clients with expensive callbacks don't hold up the reading
+     * of the other clients. The callbacks of one client are still called one at a time and in order, with
+     * clientDisconnected called after the last message of the client, while the callbacks of different clients run in
+     * parallel. Each received message is copied once to be queued. Must be called before startServer.
+     *
+     * @param workerThreads number of worker threads, 0 to call the callbacks on the reading thread
+     * @param maxQueuedMessages max number of messages queued per client, messages received while the queue of the
+     * client is full are dropped so a stuck callback can't stall the reading thread
+     * @return true if the settings were accepted.
+     */
+    bool setCallbackExecutor(size_t workerThreads, size_t maxQueuedMessages = 1024);
+
+    /**
+     *
+     * Drop received messages that have waited so long in the callback queues of the callback executor that they would
+     * be handled too late to be of use, for live video where a late frame is no better than a lost one. The TSBPD time
+     * of a message is its srctime plus the receive latency of the connection, and a message is dropped when the time
+     * since then plus \p handlerBudget exceeds \p maxDelay, including the time it waited to be read from SRT. The
+     * staleMessagesDropped callback is called with the number of dropped messages before the next message of the
+     * client is passed on. Must be called after setCallbackExecutor and before startServer.
+     *
+     * @param maxDelay how late after its TSBPD time a message may be passed to the receivedData callback
+     * @param handlerBudget the time the receivedData callback needs to handle one message
+     * @return true if the settings were accepted.
+     */
+    bool setStaleMessageShedding(std::chrono::microseconds maxDelay,
+                                 std::chrono::microseconds handlerBudget = std::chrono::microseconds(0));
+
+    /**
+     *
+     * @brief Get the number of messages dropped by stale message shedding
+     * @return The number of messages dropped since the server was configured
+     */
+    uint64_t getStaleMessagesDropped() const;
+
+    /**
+     *
+     * Move clients with a slow receivedData or receivedDataNoCopy callback to a slow lane, a second reading thread
+     * polling its own epoll, so that a client whose callback now and then takes long doesn't delay the messages of all
+     * other clients. The reading threads time every callback. A client is moved to the slow lane as soon as one of its
+     * callbacks takes longer than \p callbackThreshold, and back once its callbacks have stayed below it for
+     * \p coolDown. The callbacks of one client are still called one at a time and in order, but the callbacks of a
+     * client in the slow lane run at the same time as those of the other clients, so with a slow lane every callback
+     * may be called from two threads at the same time. State the callbacks share between clients must be thread safe,
+     * which rules out feeding all clients into one SRTNetPipeline source or one SRTNetIntegrityReceiver. Only used by a
+     * server accepting several clients on its own thread and calling the callbacks on the reading thread, so neither in
+     * single thread mode nor together with setCallbackExecutor. Must be called before startServer.
+     *
+     * @param callbackThreshold callbacks taking longer move the client to the slow lane, 0 to disable the slow lane
+     * @param coolDown how long the callbacks of a client in the slow lane must stay fast before it is moved back
+     * @return true if the settings were accepted.
+     */
+    bool setSlowLane(std::chrono::microseconds callbackThreshold,
+                     std::chrono::milliseconds coolDown = std::chrono::milliseconds(1000));
+
+    /**
+     *
+     * @brief Get the sockets of the clients currently in the slow lane
+     */
+    std::vector<SRTSOCKET> getSlowLaneSockets() const;
+
+    /**
+     *
+     * @brief Check if a slow lane is set, see setSlowLane
+     * @return true if the callbacks may be called from two threads at the same time
+     */
+    bool hasSlowLane() const;
+
+    /// The largest SRT message number, the message number after it is 1
+    static constexpr int32_t kMaxMsgNo = 0x03FFFFFF;
+
+    /**
+     *
+     * @brief Get the number of messages missing between two received messages, from their message numbers
+     * @param previousMsgNo the message number of the previous message
+     * @param msgNo the message number of the message received after it
+     * @return The number of messages missing in between, 0 if there are none or if \p msgNo is not after
+     * \p previousMsgNo
+     */
+    static int32_t getMissingMessages(int32_t previousMsgNo, int32_t msgNo);
+
+    /**
+     *
+     * Let the server pick the latency of each incoming connection from the round trip time to the peer, instead of
+     * using the same latency for all connections. When a client connects, the latency proposed for the connection is
+     * set to \p rttMultiplier times the RTT to the peer, limited to [\p minLatency, \p maxLatency]. SRT does not expose
+     * the RTT of the handshake to the listener, so the RTT is the one measured by the last connection from the same IP
+     * address. Peers that have not been connected before get the latency passed to startServer. As always in SRT, the
+     * connection uses the highest of the latencies proposed by the two peers. Must be called before startServer.
+     *
+     * @param rttMultiplier the latency in multiples of the RTT, 4 is a common choice, 0 disables adaptive latency
+     * @param minLatency the lowest latency (ms) to propose
+     * @param maxLatency the highest latency (ms) to propose
+     * @return true if the settings were accepted.
+     */
+    bool setAdaptiveLatency(double rttMultiplier, int32_t minLatency, int32_t maxLatency);
+
+    /**
+     *
+     * Set the DSCP marking, TTL and network interface of the connection, so that time critical streams can be put in
+     * priority queues by the network and be sent over a chosen network interface. In client mode they apply to the
+     * connection to the server, to select the local IP address as well use the startClient overload taking a local
+     * host. In server mode they apply to the server socket and are inherited by all accepted connections, since SRT
+     * sends the packets of all connections accepted by a server through the UDP socket of the server. Binding to an
+     * interface needs the CAP_NET_RAW capability. Must be called before startServer or startClient.
+     *
+     * @param options the options, fields left at their defaults keep the system defaults
+     * @return true if the options were accepted.
+     */
+    bool setNetworkOptions(const NetworkOptions& options);
+
+    /**
+     *
+     * Require the connections with a stream ID starting with \p streamIdPrefix to be carried with other network
+     * options than the ones of this server (A server method). As connections accepted by one server share its UDP
+     * socket, streams with different requirements are served by one server each, bound to a port of their own and set
+     * up with the same rules. A server rejects a stream whose rule does not match its own network options with
+     * SRT_REJX_UNACCEPTABLE, so that a critical feed is never carried in the wrong priority queue. Streams without a
+     * matching rule are accepted with the options of the server. The longest matching prefix wins. Must be called
+     * before startServer.
+     *
+     * @param streamIdPrefix the start of the stream IDs the rule applies to
+     * @param options the network options the streams must be carried with
+     * @return true if the rule was accepted.
+     */
+    bool setStreamNetworkOptions(const std::string& streamIdPrefix, const NetworkOptions& options);
+
+    /**
+     *
+     * Make this server a front door that accepts no connections, but redirects every caller to one of \p backends
+     * (A server method). SRT has no redirect of its own, so the caller is rejected with the reject reason
+     * kRejectRedirect + the index of the chosen backend, and a client set up with setRedirectBackends and the same
+     * list of backends connects to that backend instead. The backends can be SRTNet servers in this process, or
+     * servers in other processes or on other hosts. Must be called before startServer.
+     *
+     * @param backends the servers to redirect to, at most kMaxRedirectBackends
+     * @param policy how to pick the backend of a caller
+     * @return true if the settings were accepted.
+     */
+    bool setFrontDoor(const std::vector<Backend>& backends, RedirectPolicy policy);
+
+    /**
+     *
+     * Follow redirects from a front door set up with setFrontDoor (A client method). When the server rejects the
+     * client with a redirect, the client connects to the backend at once. The host and port passed to startClient
+     * are still the front door, so every reconnect asks the front door for a backend again. Must be called before
+     * startClient.
+     *
+     * @param backends the same list of servers, in the same order, as given to setFrontDoor of the front door
+     * @return true if the settings were accepted.
+     */
+    bool setRedirectBackends(const std::vector<Backend>& backends);
+
+    /**
+     *
+     * Keep counters of the messages and bytes received and sent on every connection, updated on the receive and send
+     * paths of this wrapper and readable without locks with getConnectionCounters. Unlike getStatistics, which takes
+     * the locks of SRT and fills in more than 100 fields, reading them is cheap enough to poll many connections at a
+     * high rate for live graphs. Must be called before startServer or startClient.
+     *
+     * @param maxConnections the max number of connections counted at the same time, connections beyond it are not
+     * counted, 0 to disable the counters
+     * @return true if the settings were accepted.
+     */
+    bool setConnectionCounters(size_t maxConnections);
+
+    /**
+     *
+     * Get the counters of a connection kept since setConnectionCounters, without taking any lock.
+     *
+     * @param counters filled in with the counters of the connection
+     * @param targetSystem The target connection to get the counters of (used in server mode only)
+     * @return true if the connection is counted.
+     */
+    bool getConnectionCounters(ConnectionCounters& counters, SRTSOCKET targetSystem = 0) const;
+
+    /**
+     *
+     * Get the counters of all connections kept since setConnectionCounters, without taking any lock, and without
+     * allocating as long as \p counters has enough capacity.
+     *
+     * @param counters cleared and then filled in with the socket and counters of every counted connection
+     */
+    void getAllConnectionCounters(std::vector<std::pair<SRTSOCKET, ConnectionCounters>>& counters) const;
+
+    /**
+     *
+     * Probe the capacity of the link from the client to the server right after connecting, so that an encoder can
+     * start at a bitrate the link can carry. The client sends a train of \p messages padding messages back to back.
+     * The server measures their dispersion from the times the packets arrive from the network, and the share of them
+     * lost, and sends the estimated available bandwidth and the RTT back to the client. Both ends pass the result to
+     * the capacityProbed callback. The probe messages never reach the other callbacks.
+     *
+     * Both ends must enable the probe. The server measures the trains of all new clients at the same time on a thread
+     * of its own, so neither accepting clients nor receiving from them waits for a probe, and clientConnected is called
+     * before the result is known. The client does not wait for the result either, it arrives like any message after the
+     * latency of the connection, and messages the server sends before it are delivered as usual. The estimate can't
+     * exceed the rate SRT sends the train at. Must be called before startServer or startClient.
+     *
+     * @param messages the number of messages in the train, 0 to disable the probe
+     * @return true if the settings were accepted.
+     */
+    bool setCapacityProbe(size_t messages);
+
+    /**
+     *
+     * Keep only the latest received message per connection and key instead of delivering every message to the
+     * callbacks, for feeds like tallies, meters and telemetry where only the newest value matters. The reading thread
+     * overwrites the kept message with every new one, and the consumer reads the freshest message with
+     * getLatestMessage at its own pace, without taking a lock. Messages overwritten before they were read are counted,
+     * see getConflatedMessages. Messages larger than \p maxMessageSize, or beyond \p maxKeys, are delivered to the
+     * callbacks as usual. Must be called before startServer or startClient.
+     *
+     * @param maxKeys the max number of keys, over all connections, kept at the same time, 0 to disable conflation
+     * @param key picks the key of every message and whether to conflate it at all, nullptr to conflate all messages
+     * of a connection under key 0
+     * @param maxMessageSize the max size of a conflated message
+     * @return true if the settings were accepted.
+     */
+    bool setConflation(size_t maxKeys, ConflationKey key = nullptr, size_t maxMessageSize = SRT_LIVE_MAX_PLSIZE);
+
+    /**
+     *
+     * Get the latest message received for a key since setConflation, unless it has already been read. Does not take
+     * any lock and does not allocate as long as \p message has enough capacity.
+     *
+     * @param message filled in with the message
+     * @param key the key of the message, 0 if conflating without a ConflationKey
+     * @param targetSystem The target connection to get the message of (used in server mode only)
+     * @return true if there was a message not read before.
+     */
+    bool getLatestMessage(std::vector<uint8_t>& message, uint64_t key = 0, SRTSOCKET targetSystem = 0) const;
+
+    /**
+     *
+     * Get the number of messages of a connection that were overwritten by a newer one before they were read with
+     * getLatestMessage.
+     *
+     * @param targetSystem The target connection to get the number of (used in server mode only)
+     * @return the number of conflated messages, 0 if the connection is unknown.
+     */
+    uint64_t getConflatedMessages(SRTSOCKET targetSystem = 0) const;
+
     /**
      *
      * Get connection statistics
@@ -218,6 +584,15 @@ public:
      */
     std::vector<std::pair<SRTSOCKET, std::shared_ptr<NetworkConnection>>> getActiveClients() const;
 
+    /**
+     *
+     * @brief Get all active clients (A server method) without allocating, as long as \p clients has enough capacity.
+     * @param clients Cleared and then filled with the SRTSocketHandle (SRTSOCKET) of all active clients and their
+     * associated NetworkConnection.
+     *
+     */
+    void getActiveClients(std::vector<std::pair<SRTSOCKET, std::shared_ptr<NetworkConnection>>>& clients) const;
+
     /**
      *
      * @brief Get the socket of all active clients (A server method)
@@ -226,6 +601,15 @@ public:
      */
     std::vector<SRTSOCKET> getActiveClientSockets() const;
 
+    /**
+     *
+     * @brief Get the socket of all active clients (A server method) without allocating, as long as \p clientSockets
+     * has enough capacity.
+     * @param clientSockets Cleared and then filled with the SRTSocketHandle (SRTSOCKET) of all active clients.
+     *
+     */
+    void getActiveClientSockets(std::vector<SRTSOCKET>& clientSockets) const;
+
     /**
      *
      * @brief Get the SRT socket and the network connection context object associated with the connected server. This
@@ -315,9 +699,26 @@ public:
                        SRTSOCKET socket)>
         receivedDataNoCopy = nullptr;
 
+    /// Callback called with the number of stale messages dropped before the next message of a client is passed on,
+    /// see setStaleMessageShedding (only server mode)
+    std::function<void(std::shared_ptr<NetworkConnection>& ctx, SRTSOCKET socket, uint64_t droppedMessages)>
+        staleMessagesDropped = nullptr;
+
+    /// Callback called when messages of a connection were lost, typically dropped by SRT since they arrived too late,
+    /// before the first message after the loss is passed on (server and client mode). \p firstMissing is the message
+    /// number (SRT_MSGCTRL::msgno) of the first lost message and \p count the number of lost messages, so a decoder can
+    /// skip to the next random access point instead of decoding corrupt data.
+    std::function<void(std::shared_ptr<NetworkConnection>& ctx, SRTSOCKET socket, int32_t firstMissing, int32_t count)>
+        lossGap = nullptr;
+
     /// Callback handling disconnecting clients (server and client mode)
     std::function<void(std::shared_ptr<NetworkConnection>& ctx, SRTSOCKET lSocket)> clientDisconnected = nullptr;
 
+    /// Callback called with the result of the capacity probe of a connection, see setCapacityProbe (server and client
+    /// mode). The server calls it on its probe thread, the client on the thread receiving from the server.
+    std::function<void(std::shared_ptr<NetworkConnection>& ctx, SRTSOCKET socket, const CapacityProbeResult& result)>
+        capacityProbed = nullptr;
+
     /// Callback called whenever the client gets connected to the server (client mode only)
     std::function<void(std::shared_ptr<NetworkConnection>& ctx,
                        SRTSOCKET lSocket,
@@ -331,6 +732,9 @@ public:
     SRTNet& operator=(SRTNet&&) = delete;      // Move assign
 
 private:
+    // Helper classes built on top of SRTNet share its log handler and log level
+    friend class SRTNetFailoverClient;
+
     // Internal struct for storing the incoming configuration to startClient/Server
     struct Configuration {
         std::string mLocalHost;
@@ -344,6 +748,19 @@ private:
         int32_t mPeerIdleTimeout;
         std::string mPsk;
         std::string mStreamId;
+        bool mSingleThread = false;
+        double mAdaptiveLatencyMultiplier = 0.0;
+        int32_t mAdaptiveLatencyMin = 0;
+        int32_t mAdaptiveLatencyMax = 0;
+        NetworkOptions mNetworkOptions;
+        std::map<std::string, NetworkOptions> mStreamNetworkOptions;
+        std::vector<Backend> mFrontDoorBackends;
+        RedirectPolicy mRedirectPolicy = RedirectPolicy::leastLoaded;
+        std::vector<Backend> mRedirectBackends;
+        size_t mProbeMessages = 0;
+        std::chrono::microseconds mSlowLaneThreshold{0};
+        std::chrono::milliseconds mSlowLaneCoolDown{0};
+        ConflationKey mConflationKey;
     };
 
     /** Internal variables and methods
@@ -364,6 +781,11 @@ private:
      * waitForSRTClient function will run in a thread and accept new clients, adding them to an epoll context, and in
      * parallel the serverEventHandler function will run in another thread polling events from all clients from the
      * epoll context. The server socket remains open for incoming clients until the server is stopped.
+     *
+     * If singleClient is false and singleThread is true, the server socket is made non-blocking and added to the same
+     * epoll context as the client sockets. The serverSingleThreadWorker function then accepts new clients and receives
+     * data from connected clients on one single thread. Since that thread is the only one modifying mClientList, it
+     * can look up clients without taking mClientListMtx, which is then only needed when modifying the list.
      */
 
     /**
@@ -386,8 +808,36 @@ private:
      * used as a normal function for handling events for one single client connection.
      * @param singleClient If set to true, the function will exit if the single accepted client disconnects, if
      * set to false the function will keep on polling for new events on client sockets until the server is stopped.
+     * @param slowLane If set to true, the function polls the clients in the slow lane, see setSlowLane.
+     */
+    void serverEventHandler(bool singleClient, bool slowLane = false);
+
+    /**
+     * @brief Move a client between the lanes depending on how long its last callback took, see setSlowLane.
+     * @param slowLane true if called by the slow lane
      */
-    void serverEventHandler(bool singleClient);
+    void updateSlowLane(SRTSOCKET socket, bool slowLane, std::chrono::steady_clock::duration callbackDuration);
+
+    /**
+     * @brief Server worker thread function when server accepts multiple clients and both accepts and receives on the
+     * same thread.
+     */
+    void serverSingleThreadWorker();
+
+    /**
+     * @brief Accept all pending clients on the non-blocking server socket and add them to the epoll context. Used by
+     * serverSingleThreadWorker.
+     */
+    void acceptPendingClients();
+
+    /**
+     * @brief Receive all pending messages on a non-blocking client socket and pass them to the user. Used by
+     * serverSingleThreadWorker.
+     * @param socket The client socket to read from
+     * @param ctx The network connection context of the client
+     * @return false if the connection to the client was broken and the client has been removed, true otherwise.
+     */
+    bool receiveFromClient(SRTSOCKET socket, std::shared_ptr<NetworkConnection>& ctx);
 
     /**
      * @brief Enum for the client connection status.
@@ -406,6 +856,83 @@ private:
      */
     ClientConnectStatus clientConnectToServer();
 
+    /**
+     * @brief Resolve a host and port and connect the client socket to it, used by clientConnectToServer.
+     * @return see clientConnectToServer
+     */
+    ClientConnectStatus clientConnectToHost(const std::string& host, uint16_t port);
+
+    // A probe train the server is measuring
+    struct CapacityProbe {
+        SRTSOCKET mSocket = SRT_INVALID_SOCK;
+        int64_t mReceived = 0;
+        int64_t mReceivedAtFirstArrival = 0;
+        std::chrono::steady_clock::time_point mFirstArrival;
+        std::chrono::steady_clock::time_point mLastArrival;
+        std::chrono::steady_clock::time_point mLastChange;
+    };
+
+    /**
+     * @brief Client side of the capacity probe, sends the probe train from the client worker once connected, without
+     * holding any lock. The result is picked up by receiveCapacityProbeResult.
+     */
+    void sendCapacityProbe();
+
+    /**
+     * @brief Client side of the capacity probe, check if a message received from the server is the probe result and
+     * pass it to capacityProbed.
+     * @return true if the message is the probe result that must be dropped.
+     */
+    bool receiveCapacityProbeResult(const uint8_t* data, size_t size);
+
+    /**
+     * @brief Server side of the capacity probe, start measuring the probe train of a newly accepted client on the probe
+     * thread.
+     */
+    void startCapacityProbe(SRTSOCKET socket);
+
+    /**
+     * @brief The probe thread of the server, measuring the probe trains of all new clients at the same time.
+     */
+    void capacityProbeWorker();
+
+    /**
+     * @brief Look at the number of packets received on a probed connection.
+     * @return true if the probe train is complete, timed out or the connection is gone.
+     */
+    bool updateCapacityProbe(CapacityProbe& probe, std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Estimate the capacity from a completed probe train, send the result to the client and pass it to
+     * capacityProbed.
+     */
+    void finishCapacityProbe(const CapacityProbe& probe);
+
+    /**
+     * @brief Check if a message received by a server is part of the probe train of its connection, called by the
+     * thread reading from the socket for every message while any connection may still have probe messages to read.
+     * @return true if the message is a probe message that must be dropped.
+     */
+    bool dropProbeMessage(SRTSOCKET socket, const uint8_t* data, size_t size);
+
+    /**
+     * @brief Start counting a connection if the connection counters are enabled.
+     */
+    void addConnectionCounters(SRTSOCKET socket);
+
+    /**
+     * @brief Keep a received message as the latest one of its key if conflation is enabled.
+     * @return true if the message was kept and must not be delivered to the callbacks.
+     */
+    bool conflateMessage(SRTSOCKET socket, const uint8_t* data, size_t size);
+
+    /**
+     * @brief Pick the backend a front door redirects a caller to.
+     * @param streamId the stream ID of the caller, or nullptr if it has none
+     * @return the index of the backend in mConfiguration.mFrontDoorBackends
+     */
+    size_t selectBackend(const char* streamId);
+
     /**
      * @brief Client worker thread function.
      */
@@ -423,6 +950,34 @@ private:
      */
     bool createServerSocket();
 
+    /**
+     * @brief Listen callback of the server socket, called by SRT for every incoming connection before it is accepted.
+     * @return 0 to let SRT accept the connection, -1 to reject it.
+     */
+    static int listenCallback(void* opaque,
+                              SRTSOCKET newSocket,
+                              int hsVersion,
+                              const sockaddr* peer,
+                              const char* streamId);
+
+    /**
+     * @brief Set the options of an incoming connection that depend on the peer, called from listenCallback.
+     * @return 0 to let SRT accept the connection, -1 to reject it.
+     */
+    int configureIncomingConnection(SRTSOCKET newSocket, const sockaddr* peer, const char* streamId);
+
+    /**
+     * @brief Set the network options of mConfiguration on a socket that is not bound yet.
+     * @return true if all options could be set, false otherwise.
+     */
+    bool applyNetworkOptions(SRTSOCKET socket);
+
+    /**
+     * @brief Store the RTT of a client connection that is about to be closed, to select the latency of the next
+     * connection from the same peer. Must be called before srt_close.
+     */
+    void rememberPeerRtt(SRTSOCKET socket);
+
     /**
      * @brief Util for configuring the client socket.
      * @return true if socket could be configured, false otherwise.
@@ -430,11 +985,58 @@ private:
     bool createClientSocket();
 
     /**
-     * @brief Fetch the connection information from the SRT socket.
+     * @brief Fetch the connection information from the SRT socket. The latency selected for an accepted socket is
+     * taken out of mSelectedLatency, so call this once per accepted socket.
      * @return a ConnectionInformation struct with all the connection information that could be fetched.
      */
     ConnectionInformation getConnectionInformation(SRTSOCKET socket);
 
+    /**
+     * @brief Get the socket to send to in the current mode.
+     * @param targetSystem the target passed to sendData (used in server mode only)
+     * @return the socket to send to, or SRT_INVALID_SOCK if sending is not possible right now.
+     */
+    SRTSOCKET getSendSocket(SRTSOCKET targetSystem) const;
+
+    /**
+     * @brief Send one message, that has already been encrypted if application layer encryption is enabled.
+     * @return true if the whole message was sent.
+     */
+    bool sendMessage(SRTSOCKET socket, const uint8_t* data, size_t size, SRT_MSGCTRL* msgCtrl);
+
+    /**
+     * @brief Track the message numbers received on a connection to find the messages missing before a message. Called
+     * on the reading thread for every received message, the caller passes a gap found to reportLossGap.
+     * @param firstMissing set to the message number of the first missing message
+     * @return the number of missing messages, 0 if none are missing or there is no lossGap callback.
+     */
+    int32_t checkForLossGap(SRTSOCKET socket, const SRT_MSGCTRL& msgCtrl, int32_t& firstMissing);
+
+    /**
+     * @brief Get the serial queue of a connection on the callback executor, opened on first use, so that posting to it
+     * needs no lookup in the executor. Called by the reading thread, like checkForLossGap.
+     */
+    std::shared_ptr<SRTNetCallbackConnection>& callbackConnection(SRTSOCKET socket,
+                                                                  const std::shared_ptr<NetworkConnection>& ctx);
+
+    /**
+     * @brief Raise the lossGap callback, in order with the received messages.
+     * @param viaCallbackExecutor true to call lossGap on the callback executor, in order with the messages posted to it
+     */
+    void reportLossGap(SRTSOCKET socket,
+                       std::shared_ptr<NetworkConnection>& ctx,
+                       int32_t firstMissing,
+                       int32_t count,
+                       bool viaCallbackExecutor);
+
+    /**
+     * @brief Decrypt a received message in place if application layer encryption is enabled.
+     * @param data pointer to the received message, moved to the start of the plaintext
+     * @param size the size of the received message, changed to the size of the plaintext
+     * @return false if the message could not be decrypted and should be dropped, true otherwise.
+     */
+    bool decryptReceivedMessage(uint8_t*& data, size_t& size);
+
     static SRT_LOG_HANDLER_FN* gLogHandler;
     static int gLogLevel;
 
@@ -447,19 +1049,87 @@ private:
 
     std::thread mWorkerThread;
     std::thread mEventThread;
+    std::thread mSlowLaneThread;
+    std::thread mProbeThread;
 
     SRTSOCKET mContext{SRT_INVALID_SOCK};
     int mPollID = 0;
+    int mSlowLanePollID = 0;
     mutable std::mutex mNetMtx;
     Mode mCurrentMode = Mode::unknown;
     std::map<SRTSOCKET, std::shared_ptr<NetworkConnection>> mClientList = {};
     mutable std::mutex mClientListMtx;
+    // The clients in the slow lane and the end of their last slow callback, guarded by mClientListMtx
+    std::map<SRTSOCKET, std::chrono::steady_clock::time_point> mSlowLaneSockets;
     std::shared_ptr<NetworkConnection> mClientContext = nullptr;
     std::shared_ptr<NetworkConnection> mConnectionContext = nullptr;
     std::atomic<bool> mClientConnected = false;
 
     Configuration mConfiguration;
 
+    // Adaptive latency, the last RTT (ms) measured to each peer IP address, and the latency selected for each incoming
+    // connection from the listen callback until it is accepted. Connections whose handshake fails after the listen
+    // callback are never accepted, so their entries expire kSelectedLatencyExpiry after they were made, in the order
+    // kept by mSelectedLatencyOrder.
+    struct SelectedLatency {
+        int32_t mLatency;
+        double mRtt;
+        std::chrono::steady_clock::time_point mSelected;
+    };
+    std::map<std::string, double> mPeerRtt;
+    std::map<SRTSOCKET, SelectedLatency> mSelectedLatency;
+    std::deque<std::pair<std::chrono::steady_clock::time_point, SRTSOCKET>> mSelectedLatencyOrder;
+    std::mutex mPeerRttMtx;
+    const size_t kMaxPeerRttEntries{4096};
+    const std::chrono::seconds kSelectedLatencyExpiry{30};
+
+    // The backend a front door starts looking at for the least loaded one, so backends with the same load take turns
+    std::atomic<size_t> mNextBackend{0};
+
+    // Application layer encryption, nullptr if disabled
+    std::unique_ptr<SRTNetAeadCipher> mCipher;
+    std::unique_ptr<SRTNetWorkerPool> mCryptoPool;
+
+    // The message number of the last message received on each connection. Guarded by mClientListMtx when a server
+    // reads with the event thread and the slow lane thread, only used by the reading thread otherwise.
+    std::map<SRTSOCKET, int32_t> mLastMsgNo;
+
+    // The number of probe messages each probed connection may still deliver, guarded by mClientListMtx and read by the
+    // reading thread
+    std::map<SRTSOCKET, size_t> mProbeMessagesToDrop;
+
+    // The probe trains the server is measuring, guarded by mProbeMtx
+    std::vector<CapacityProbe> mCapacityProbes;
+    std::mutex mProbeMtx;
+    std::condition_variable mProbeCondition;
+
+    // Set once connected until the client worker sent the probe train, and while the client waits for the probe result,
+    // only used by the thread connecting to and receiving from the server
+    bool mProbeTrainPending = false;
+    bool mAwaitingProbeResult = false;
+    std::chrono::steady_clock::time_point mProbeResultDeadline;
+
+    // Counters of every connection, nullptr if disabled
+    std::unique_ptr<SRTNetConnectionCounters> mConnectionCounters;
+
+    // The latest message of every conflated key, nullptr if conflation is disabled
+    std::unique_ptr<SRTNetConflation> mConflation;
+
+    // Worker threads running the callbacks of the server, nullptr to run them on the reading thread
+    std::unique_ptr<SRTNetCallbackExecutor> mCallbackExecutor;
+    // The serial queue of every connection on the callback executor, guarded like mLastMsgNo
+    std::map<SRTSOCKET, std::shared_ptr<SRTNetCallbackConnection>> mCallbackConnections;
+
     const std::chrono::milliseconds kConnectionTimeout{1000};
+    // Size of a message of the capacity probe train
+    static constexpr size_t kProbeMessageSize = 1316;
+    // Max time the server waits for the first, and for every next, packet of the probe train. The client waits for the
+    // result for the latency of the connection and kConnectionTimeout longer.
+    const std::chrono::milliseconds kProbeTimeout{200};
+    // Time between two looks at the number of packets received while measuring the probe train
+    const std::chrono::microseconds kProbePollInterval{50};
     const int64_t kEpollTimeoutMs{500};
+    // Max number of messages read from one client socket per epoll wakeup in single thread mode, so that one busy
+    // client can't starve the others
+    const int kMaxMessagesPerWakeup{64};
 };
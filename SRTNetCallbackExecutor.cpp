@@ -0,0 +1,331 @@
+//
+// Work-stealing executor running the user callbacks of a server off the SRT reader thread.
+//
+
+#include "SRTNetCallbackExecutor.h"
+
+#include <algorithm>
+
+struct SRTNetCallbackConnection {
+    SRTSOCKET mSocket;
+    std::shared_ptr<SRTNet::NetworkConnection> mCtx;
+    bool mRegistered = false; // In mConnections, so the map entry is removed once the connection is closed
+    int64_t mLatencyUs = 0;   // The receive latency of the connection, 0 if unknown
+    std::mutex mMtx;
+    std::deque<SRTNetCallbackExecutor::Entry> mQueue;
+    std::vector<std::vector<uint8_t>> mFreeBuffers; // Recycled message buffers
+    bool mScheduled = false; // In the deque of a worker or being run by one
+    bool mClosed = false;
+    uint64_t mShedPending = 0; // Messages dropped and not yet reported, only used by the running worker
+};
+
+SRTNetCallbackExecutor::SRTNetCallbackExecutor(size_t threads, size_t maxQueuedMessages, Handler handler)
+    : mMaxQueuedMessages(maxQueuedMessages)
+    , mHandler(std::move(handler)) {
+    for (size_t i = 0; i < std::max<size_t>(threads, 1); ++i) {
+        mWorkers.push_back(std::make_unique<Worker>());
+    }
+    for (size_t i = 0; i < mWorkers.size(); ++i) {
+        mWorkers[i]->mThread = std::thread(&SRTNetCallbackExecutor::workerThread, this, i);
+    }
+}
+
+SRTNetCallbackExecutor::~SRTNetCallbackExecutor() {
+    {
+        std::lock_guard<std::mutex> lock(mSleepMtx);
+        mStop = true;
+    }
+    mWakeCondition.notify_all();
+    for (auto& worker : mWorkers) {
+        worker->mThread.join();
+    }
+}
+
+std::shared_ptr<SRTNetCallbackExecutor::Connection>
+SRTNetCallbackExecutor::getConnection(SRTSOCKET socket, const std::shared_ptr<SRTNet::NetworkConnection>& ctx) {
+    std::lock_guard<std::mutex> lock(mConnectionsMtx);
+    std::shared_ptr<Connection>& connection = mConnections[socket];
+    if (!connection) {
+        connection = open(socket, ctx);
+        connection->mRegistered = true;
+    }
+    return connection;
+}
+
+SRTNetCallbackExecutor::ConnectionHandle SRTNetCallbackExecutor::open(
+    SRTSOCKET socket,
+    const std::shared_ptr<SRTNet::NetworkConnection>& ctx) {
+    auto connection = std::make_shared<Connection>();
+    connection->mSocket = socket;
+    connection->mCtx = ctx;
+    int32_t latency = 0;
+    int latencySize = sizeof(latency);
+    if (srt_getsockflag(socket, SRTO_RCVLATENCY, &latency, &latencySize) != SRT_ERROR) {
+        connection->mLatencyUs = static_cast<int64_t>(latency) * 1000;
+    }
+    return connection;
+}
+
+std::chrono::steady_clock::time_point SRTNetCallbackExecutor::deadlineOf(const Connection& connection,
+                                                                         const SRT_MSGCTRL& msgCtrl) const {
+    auto now = std::chrono::steady_clock::now();
+    if (msgCtrl.srctime <= 0) {
+        return now + mShedAfter;
+    }
+    // SRT delivers a message at its TSBPD time, the source time plus the latency. Counting from there rather than from
+    // when the message is posted leaves out the time it waited to be read from SRT. The source time is on the SRT
+    // clock, so the TSBPD time is moved to the steady clock by its distance from now.
+    int64_t tsbpdTimeUs = msgCtrl.srctime + connection.mLatencyUs;
+    return now + std::chrono::microseconds(tsbpdTimeUs - srt_time_now()) + mShedAfter;
+}
+
+bool SRTNetCallbackExecutor::post(SRTSOCKET socket,
+                                  const std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                  const uint8_t* data,
+                                  size_t size,
+                                  const SRT_MSGCTRL& msgCtrl) {
+    return post(getConnection(socket, ctx), data, size, msgCtrl);
+}
+
+bool SRTNetCallbackExecutor::post(const ConnectionHandle& connection,
+                                  const uint8_t* data,
+                                  size_t size,
+                                  const SRT_MSGCTRL& msgCtrl) {
+    auto deadline = mShedding ? deadlineOf(*connection, msgCtrl) : std::chrono::steady_clock::time_point::max();
+    bool wasScheduled;
+    {
+        std::lock_guard<std::mutex> lock(connection->mMtx);
+        if (connection->mClosed || connection->mQueue.size() >= mMaxQueuedMessages) {
+            mDroppedMessages++;
+            return false;
+        }
+        Entry& entry = connection->mQueue.emplace_back();
+        if (!connection->mFreeBuffers.empty()) {
+            entry.mData = std::move(connection->mFreeBuffers.back());
+            connection->mFreeBuffers.pop_back();
+        }
+        entry.mData.assign(data, data + size);
+        entry.mMsgCtrl = msgCtrl;
+        entry.mDeadline = deadline;
+        wasScheduled = connection->mScheduled;
+        connection->mScheduled = true;
+    }
+    if (!wasScheduled) {
+        schedule(connection, static_cast<size_t>(connection->mSocket) % mWorkers.size());
+    }
+    return true;
+}
+
+bool SRTNetCallbackExecutor::postTask(SRTSOCKET socket,
+                                      const std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                      std::function<void()> task) {
+    return postTask(getConnection(socket, ctx), std::move(task));
+}
+
+bool SRTNetCallbackExecutor::postTask(const ConnectionHandle& connection, std::function<void()> task) {
+    bool wasScheduled;
+    {
+        std::lock_guard<std::mutex> lock(connection->mMtx);
+        if (connection->mClosed) {
+            return false;
+        }
+        Entry& entry = connection->mQueue.emplace_back();
+        entry.mTask = std::move(task);
+        entry.mDeadline = std::chrono::steady_clock::time_point::max();
+        wasScheduled = connection->mScheduled;
+        connection->mScheduled = true;
+    }
+    if (!wasScheduled) {
+        schedule(connection, static_cast<size_t>(connection->mSocket) % mWorkers.size());
+    }
+    return true;
+}
+
+void SRTNetCallbackExecutor::setShedding(std::chrono::nanoseconds maxDelay,
+                                         std::chrono::nanoseconds handlerBudget,
+                                         GapHandler gapHandler) {
+    mShedding = true;
+    mShedAfter = maxDelay - handlerBudget;
+    mGapHandler = std::move(gapHandler);
+}
+
+void SRTNetCallbackExecutor::close(SRTSOCKET socket, std::function<void()> task) {
+    std::shared_ptr<Connection> connection;
+    {
+        std::lock_guard<std::mutex> lock(mConnectionsMtx);
+        auto iterator = mConnections.find(socket);
+        if (iterator == mConnections.end()) {
+            // Nothing was ever posted for the connection, so there is nothing to wait for
+            connection = std::make_shared<Connection>();
+            connection->mSocket = socket;
+        } else {
+            connection = iterator->second;
+        }
+    }
+    close(connection, std::move(task));
+}
+
+void SRTNetCallbackExecutor::close(const ConnectionHandle& connection, std::function<void()> task) {
+    bool wasScheduled;
+    {
+        std::lock_guard<std::mutex> lock(connection->mMtx);
+        connection->mClosed = true;
+        Entry& entry = connection->mQueue.emplace_back();
+        entry.mTask = std::move(task);
+        entry.mClose = true;
+        wasScheduled = connection->mScheduled;
+        connection->mScheduled = true;
+    }
+    if (!wasScheduled) {
+        schedule(connection, static_cast<size_t>(connection->mSocket) % mWorkers.size());
+    }
+}
+
+void SRTNetCallbackExecutor::drain() {
+    {
+        std::unique_lock<std::mutex> lock(mSleepMtx);
+        mIdleCondition.wait(lock, [&]() { return mScheduledConnections == 0; });
+    }
+    std::lock_guard<std::mutex> lock(mConnectionsMtx);
+    mConnections.clear();
+}
+
+void SRTNetCallbackExecutor::schedule(const std::shared_ptr<Connection>& connection, size_t worker) {
+    mScheduledConnections++;
+    {
+        std::lock_guard<std::mutex> lock(mWorkers[worker]->mMtx);
+        mWorkers[worker]->mDeque.push_back(connection);
+    }
+    mQueuedConnections++;
+    wakeWorker();
+}
+
+void SRTNetCallbackExecutor::wakeWorker() {
+    // A worker about to sleep either sees mQueuedConnections above zero or is seen here and woken up
+    if (mSleepingWorkers > 0) {
+        std::lock_guard<std::mutex> lock(mSleepMtx);
+        mWakeCondition.notify_one();
+    }
+}
+
+std::shared_ptr<SRTNetCallbackExecutor::Connection> SRTNetCallbackExecutor::take(size_t worker) {
+    // Own deque first, from the front, so connections are handled round robin
+    {
+        std::lock_guard<std::mutex> lock(mWorkers[worker]->mMtx);
+        auto& deque = mWorkers[worker]->mDeque;
+        if (!deque.empty()) {
+            std::shared_ptr<Connection> connection = std::move(deque.front());
+            deque.pop_front();
+            mQueuedConnections--;
+            return connection;
+        }
+    }
+
+    // Steal from the back of the other deques, the connection that its owner would have handled last
+    for (size_t i = 1; i < mWorkers.size(); ++i) {
+        Worker& victim = *mWorkers[(worker + i) % mWorkers.size()];
+        std::lock_guard<std::mutex> lock(victim.mMtx);
+        if (!victim.mDeque.empty()) {
+            std::shared_ptr<Connection> connection = std::move(victim.mDeque.back());
+            victim.mDeque.pop_back();
+            mQueuedConnections--;
+            mStolenConnections++;
+            return connection;
+        }
+    }
+    return nullptr;
+}
+
+void SRTNetCallbackExecutor::run(const std::shared_ptr<Connection>& connection, size_t worker) {
+    Entry entry;
+    for (size_t handled = 0;; ++handled) {
+        bool queueEmpty = false;
+        {
+            std::lock_guard<std::mutex> lock(connection->mMtx);
+            if (entry.mData.capacity() > 0) {
+                connection->mFreeBuffers.push_back(std::move(entry.mData));
+                entry.mData = {};
+            }
+            if (connection->mQueue.empty()) {
+                if (connection->mShedPending == 0) {
+                    connection->mScheduled = false;
+                    break;
+                }
+                // Report the dropped messages below, then check the queue again
+                queueEmpty = true;
+            } else if (handled == kBatchSize) {
+                // Still scheduled, give the other connections in the deque a turn first
+                {
+                    std::lock_guard<std::mutex> workerLock(mWorkers[worker]->mMtx);
+                    mWorkers[worker]->mDeque.push_back(connection);
+                }
+                mQueuedConnections++;
+                wakeWorker();
+                return;
+            } else {
+                entry = std::move(connection->mQueue.front());
+                connection->mQueue.pop_front();
+            }
+        }
+
+        if (queueEmpty) {
+            reportGap(*connection);
+            continue;
+        }
+
+        if (!entry.mTask && std::chrono::steady_clock::now() > entry.mDeadline) {
+            connection->mShedPending++;
+            mShedMessages++;
+            continue;
+        }
+        reportGap(*connection);
+
+        if (entry.mTask) {
+            entry.mTask();
+            entry.mTask = nullptr;
+            if (entry.mClose && connection->mRegistered) {
+                // Only connections looked up by socket are in the map, the others were never shared
+                std::lock_guard<std::mutex> lock(mConnectionsMtx);
+                auto iterator = mConnections.find(connection->mSocket);
+                if (iterator != mConnections.end() && iterator->second == connection) {
+                    mConnections.erase(iterator);
+                }
+            }
+        } else {
+            mHandler(entry.mData.data(), entry.mData.size(), entry.mMsgCtrl, connection->mCtx, connection->mSocket);
+        }
+    }
+
+    if (--mScheduledConnections == 0) {
+        std::lock_guard<std::mutex> lock(mSleepMtx);
+        mIdleCondition.notify_all();
+    }
+}
+
+void SRTNetCallbackExecutor::reportGap(Connection& connection) {
+    if (connection.mShedPending == 0) {
+        return;
+    }
+    if (mGapHandler) {
+        mGapHandler(connection.mCtx, connection.mSocket, connection.mShedPending);
+    }
+    connection.mShedPending = 0;
+}
+
+void SRTNetCallbackExecutor::workerThread(size_t worker) {
+    while (true) {
+        std::shared_ptr<Connection> connection = take(worker);
+        if (connection) {
+            run(connection, worker);
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(mSleepMtx);
+        mSleepingWorkers++;
+        mWakeCondition.wait(lock, [&]() { return mStop || mQueuedConnections > 0; });
+        mSleepingWorkers--;
+        if (mStop) {
+            return;
+        }
+    }
+}
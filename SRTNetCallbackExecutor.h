@@ -0,0 +1,219 @@
+//
+// Work-stealing executor running the user callbacks of a server off the SRT reader thread.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "SRTNet.h"
+
+/// The serial queue of one connection of an SRTNetCallbackExecutor
+struct SRTNetCallbackConnection;
+
+/**
+ * @brief Runs the receivedData callbacks of many connections on a pool of worker threads, so that the thread reading
+ * from SRT only copies each message and goes on reading. Every connection has a serial queue, the messages of one
+ * connection are handled one at a time and in the order they were posted, while different connections are handled in
+ * parallel.
+ *
+ * A connection with queued messages is scheduled on the deque of one worker, picked from the socket so a connection
+ * tends to stay on the same core. A worker runs up to kBatchSize messages of a connection before putting it back at
+ * the end of its deque, so one busy connection can't starve the others. A worker with an empty deque steals
+ * connections from the other workers, which spreads a few expensive connections over all cores.
+ *
+ * The thread posting the messages of a connection keeps the handle returned by open, so posting only takes the lock
+ * of the connection itself. The overloads taking a socket instead look the connection up in a map shared by all
+ * connections, for callers that don't keep the handle.
+ *
+ * When the handlers can't keep up, messages wait in the queues and are handled later and later. With shedding enabled,
+ * a message that has waited so long that it can't be handled within its deadline is dropped instead of handled, and
+ * the gap handler is told how many messages were dropped before the next one is handled, so the handlers catch up
+ * with live instead of lagging further behind.
+ */
+class SRTNetCallbackExecutor {
+public:
+    using Handler = std::function<void(const uint8_t* data,
+                                       size_t size,
+                                       SRT_MSGCTRL& msgCtrl,
+                                       std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                       SRTSOCKET socket)>;
+    using GapHandler = std::function<void(std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                          SRTSOCKET socket,
+                                          uint64_t droppedMessages)>;
+
+    using ConnectionHandle = std::shared_ptr<SRTNetCallbackConnection>;
+
+    /// Max number of messages of one connection handled before the worker moves on to the next connection
+    static constexpr size_t kBatchSize = 32;
+
+    /**
+     * @brief Constructor
+     * @param threads The number of worker threads, at least one
+     * @param maxQueuedMessages The max number of messages queued per connection, more messages are dropped
+     * @param handler Called on a worker thread for every message
+     */
+    SRTNetCallbackExecutor(size_t threads, size_t maxQueuedMessages, Handler handler);
+
+    virtual ~SRTNetCallbackExecutor();
+
+    /**
+     * @brief Create the serial queue of a connection, to post to without looking it up. The connection is not known
+     * by its socket, only the returned handle and close with the handle reach it.
+     * @param socket The connection
+     * @param ctx The context of the connection, passed to the handler
+     * @return The handle of the connection
+     */
+    ConnectionHandle open(SRTSOCKET socket, const std::shared_ptr<SRTNet::NetworkConnection>& ctx);
+
+    /**
+     * @brief Copy a message and queue it on the serial queue of a connection, taking only the lock of the connection
+     * @param connection The connection the message was received on, from open
+     * @return false if the queue of the connection is full or the connection is closed and the message was dropped
+     */
+    bool post(const ConnectionHandle& connection, const uint8_t* data, size_t size, const SRT_MSGCTRL& msgCtrl);
+
+    /**
+     * @brief Copy a message and queue it on the serial queue of its connection, looked up by socket
+     * @param socket The connection the message was received on
+     * @param ctx The context of the connection, passed to the handler
+     * @return false if the queue of the connection is full and the message was dropped
+     */
+    bool post(SRTSOCKET socket,
+              const std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+              const uint8_t* data,
+              size_t size,
+              const SRT_MSGCTRL& msgCtrl);
+
+    /**
+     * @brief Queue a task on the serial queue of a connection from open, see postTask below
+     */
+    bool postTask(const ConnectionHandle& connection, std::function<void()> task);
+
+    /**
+     * @brief Queue a task on the serial queue of a connection, run in order with the messages posted for it. Tasks are
+     * queued even when the queue of the connection is full, and never dropped by shedding.
+     * @param socket The connection the task belongs to
+     * @param ctx The context of the connection
+     * @param task Called on a worker thread
+     * @return false if the connection is closed and the task was dropped
+     */
+    bool postTask(SRTSOCKET socket, const std::shared_ptr<SRTNet::NetworkConnection>& ctx, std::function<void()> task);
+
+    /**
+     * @brief Drop messages that are too late instead of handling them. Must be called before the first post.
+     * @param maxDelay How late after its TSBPD time a message is still useful. The TSBPD time is the srctime of the
+     * message plus the receive latency of its connection, so the time a message waited to be read from SRT counts too.
+     * A message without srctime, or with a socket that has no latency, counts from when it is posted.
+     * @param handlerBudget The time the handler needs for one message. A message is dropped when the time left until
+     * its deadline is less than this.
+     * @param gapHandler Optional, called on the worker thread of the connection with the number of messages dropped,
+     * before the next message or the closing task of the connection is handled, or when the queue runs empty
+     */
+    void setShedding(std::chrono::nanoseconds maxDelay, std::chrono::nanoseconds handlerBudget, GapHandler gapHandler);
+
+    /**
+     * @brief Queue the last task of a connection from open, run after all messages already posted for it. Later posts
+     * to the connection are dropped.
+     * @param connection The connection that is closed
+     * @param task Called on a worker thread, typically to call clientDisconnected
+     */
+    void close(const ConnectionHandle& connection, std::function<void()> task);
+
+    /**
+     * @brief Queue the last task of a connection looked up by socket, run after all messages already posted for it.
+     * The connection is forgotten once the task has run.
+     * @param socket The connection that is closed
+     * @param task Called on a worker thread, typically to call clientDisconnected
+     */
+    void close(SRTSOCKET socket, std::function<void()> task);
+
+    /**
+     * @brief Wait until all queued messages and tasks have been handled, then forget all connections
+     */
+    void drain();
+
+    size_t getThreadCount() const {
+        return mWorkers.size();
+    }
+
+    /// Messages dropped since the queue of their connection was full
+    uint64_t getDroppedMessages() const {
+        return mDroppedMessages;
+    }
+
+    /// Messages dropped since they could not be handled before their deadline
+    uint64_t getShedMessages() const {
+        return mShedMessages;
+    }
+
+    /// Number of times a worker took a connection from the deque of another worker
+    uint64_t getStolenConnections() const {
+        return mStolenConnections;
+    }
+
+    SRTNetCallbackExecutor(SRTNetCallbackExecutor const&) = delete;
+    SRTNetCallbackExecutor& operator=(SRTNetCallbackExecutor const&) = delete;
+
+private:
+    friend struct SRTNetCallbackConnection;
+    using Connection = SRTNetCallbackConnection;
+
+    struct Entry {
+        std::vector<uint8_t> mData;
+        SRT_MSGCTRL mMsgCtrl;
+        std::chrono::steady_clock::time_point mDeadline; // Latest time to start handling the message
+        std::function<void()> mTask; // Set for a task instead of a message
+        bool mClose = false;         // Set for the closing task of the connection
+    };
+
+    struct Worker {
+        std::mutex mMtx;
+        std::deque<std::shared_ptr<Connection>> mDeque;
+        std::thread mThread;
+    };
+
+    std::shared_ptr<Connection> getConnection(SRTSOCKET socket, const std::shared_ptr<SRTNet::NetworkConnection>& ctx);
+    std::chrono::steady_clock::time_point deadlineOf(const Connection& connection, const SRT_MSGCTRL& msgCtrl) const;
+    void schedule(const std::shared_ptr<Connection>& connection, size_t worker);
+    void wakeWorker();
+    std::shared_ptr<Connection> take(size_t worker);
+    void run(const std::shared_ptr<Connection>& connection, size_t worker);
+    void reportGap(Connection& connection);
+    void workerThread(size_t worker);
+
+    const size_t mMaxQueuedMessages;
+    const Handler mHandler;
+
+    bool mShedding = false;
+    std::chrono::nanoseconds mShedAfter{0}; // maxDelay - handlerBudget
+    GapHandler mGapHandler;
+
+    std::vector<std::unique_ptr<Worker>> mWorkers;
+
+    std::mutex mConnectionsMtx;
+    std::unordered_map<SRTSOCKET, std::shared_ptr<Connection>> mConnections;
+
+    // Connections in the deque of a worker, and connections scheduled (queued or running)
+    std::atomic<size_t> mQueuedConnections{0};
+    std::atomic<size_t> mScheduledConnections{0};
+    std::atomic<size_t> mSleepingWorkers{0};
+    std::mutex mSleepMtx;
+    std::condition_variable mWakeCondition;
+    std::condition_variable mIdleCondition;
+    bool mStop = false;
+
+    std::atomic<uint64_t> mDroppedMessages{0};
+    std::atomic<uint64_t> mShedMessages{0};
+    std::atomic<uint64_t> mStolenConnections{0};
+};
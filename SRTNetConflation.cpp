@@ -0,0 +1,182 @@
+//
+// Lock-free latest-value slots SRTNet keeps received messages in when conflation is enabled.
+//
+
+#include "SRTNetConflation.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace {
+// The slot a probe sequence for a socket and key starts at, before masking
+size_t probeStart(SRTSOCKET socket, uint64_t key) {
+    uint64_t hash = static_cast<uint64_t>(static_cast<uint32_t>(socket) * 2654435761u);
+    hash ^= key * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(hash ^ (hash >> 32));
+}
+} // namespace
+
+SRTNetConflation::SRTNetConflation(size_t maxKeys, size_t maxMessageSize)
+    : mMaxKeys(maxKeys), mMaxMessageSize(maxMessageSize) {
+    // At most half of the slots are used, since claim stops at max keys, which keeps the probe sequences short
+    size_t slots = 1;
+    while (slots < maxKeys * 2) {
+        slots *= 2;
+    }
+    mSlots = std::make_unique<Slot[]>(slots);
+    mMask = slots - 1;
+    mWordsPerSlot = (maxMessageSize + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+    mWords = std::make_unique<std::atomic<uint64_t>[]>(slots * mWordsPerSlot);
+}
+
+std::atomic<uint64_t>* SRTNetConflation::words(const Slot& slot) const {
+    return &mWords[static_cast<size_t>(&slot - mSlots.get()) * mWordsPerSlot];
+}
+
+SRTNetConflation::Slot* SRTNetConflation::find(SRTSOCKET socket, uint64_t key) const {
+    size_t first = probeStart(socket, key);
+    for (size_t i = 0; i <= mMask; ++i) {
+        Slot& slot = mSlots[(first + i) & mMask];
+        SRTSOCKET slotSocket = slot.mSocket.load(std::memory_order_acquire);
+        if (slotSocket == socket && slot.mKey.load(std::memory_order_relaxed) == key) {
+            return &slot;
+        }
+        if (slotSocket == kEmpty) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+SRTNetConflation::Slot* SRTNetConflation::claim(SRTSOCKET socket, uint64_t key) {
+    std::lock_guard<std::mutex> lock(mSlotsMtx);
+    if (mKeys >= mMaxKeys) {
+        return nullptr;
+    }
+    size_t first = probeStart(socket, key);
+    for (size_t i = 0; i <= mMask; ++i) {
+        Slot& slot = mSlots[(first + i) & mMask];
+        SRTSOCKET slotSocket = slot.mSocket.load(std::memory_order_relaxed);
+        if (slotSocket == kEmpty || slotSocket == kRemoved) {
+            slot.mSocket.store(kClaimed, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.mKey.store(key, std::memory_order_relaxed);
+            slot.mSequence.store(0, std::memory_order_relaxed);
+            slot.mReadSequence.store(0, std::memory_order_relaxed);
+            slot.mConflated.store(0, std::memory_order_relaxed);
+            slot.mSize.store(0, std::memory_order_relaxed);
+            slot.mSocket.store(socket, std::memory_order_release);
+            ++mKeys;
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+bool SRTNetConflation::store(SRTSOCKET socket, uint64_t key, const uint8_t* data, size_t size) {
+    if (socket < 0 || size > mMaxMessageSize) {
+        return false;
+    }
+    Slot* slot = find(socket, key);
+    if (slot == nullptr) {
+        slot = claim(socket, key);
+        if (slot == nullptr) {
+            return false;
+        }
+    }
+
+    // Only this thread writes the slot, so the counters are updated with plain atomic stores
+    uint64_t sequence = slot->mSequence.load(std::memory_order_relaxed);
+    if (sequence != 0 && slot->mReadSequence.load(std::memory_order_relaxed) != sequence) {
+        slot->mConflated.store(slot->mConflated.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+    slot->mSequence.store(sequence + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    std::atomic<uint64_t>* slotWords = words(*slot);
+    for (size_t offset = 0; offset < size; offset += sizeof(uint64_t)) {
+        uint64_t word = 0;
+        memcpy(&word, data + offset, std::min(sizeof(uint64_t), size - offset));
+        slotWords[offset / sizeof(uint64_t)].store(word, std::memory_order_relaxed);
+    }
+    slot->mSize.store(size, std::memory_order_relaxed);
+    slot->mSequence.store(sequence + 2, std::memory_order_release);
+    return true;
+}
+
+bool SRTNetConflation::load(SRTSOCKET socket, uint64_t key, std::vector<uint8_t>& message) const {
+    Slot* slot = find(socket, key);
+    if (slot == nullptr) {
+        return false;
+    }
+    const std::atomic<uint64_t>* slotWords = words(*slot);
+    while (true) {
+        uint64_t sequence = slot->mSequence.load(std::memory_order_acquire);
+        if (sequence == 0 || slot->mReadSequence.load(std::memory_order_relaxed) == sequence) {
+            return false;
+        }
+        if (sequence & 1) {
+            continue;
+        }
+        size_t size = slot->mSize.load(std::memory_order_relaxed);
+        message.resize(size);
+        for (size_t offset = 0; offset < size; offset += sizeof(uint64_t)) {
+            uint64_t word = slotWords[offset / sizeof(uint64_t)].load(std::memory_order_relaxed);
+            memcpy(message.data() + offset, &word, std::min(sizeof(uint64_t), size - offset));
+        }
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot->mSequence.load(std::memory_order_relaxed) != sequence) {
+            // Overwritten while copied, take the newer message instead
+            continue;
+        }
+        if (slot->mSocket.load(std::memory_order_relaxed) != socket) {
+            // The slot was handed to another connection
+            return false;
+        }
+        // Another reader may have read a newer message meanwhile
+        uint64_t readSequence = slot->mReadSequence.load(std::memory_order_relaxed);
+        while (readSequence < sequence &&
+               !slot->mReadSequence.compare_exchange_weak(readSequence, sequence, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+}
+
+uint64_t SRTNetConflation::conflated(SRTSOCKET socket) const {
+    uint64_t conflated = 0;
+    for (size_t i = 0; i <= mMask; ++i) {
+        if (mSlots[i].mSocket.load(std::memory_order_acquire) == socket) {
+            conflated += mSlots[i].mConflated.load(std::memory_order_relaxed);
+        }
+    }
+    return conflated;
+}
+
+void SRTNetConflation::reclaim(size_t index) {
+    // No probe sequence runs past an empty slot, so removed slots right before one are not passed by any either
+    while (mSlots[index].mSocket.load(std::memory_order_relaxed) == kRemoved &&
+           mSlots[(index + 1) & mMask].mSocket.load(std::memory_order_relaxed) == kEmpty) {
+        mSlots[index].mSocket.store(kEmpty, std::memory_order_release);
+        index = (index - 1) & mMask;
+    }
+}
+
+void SRTNetConflation::remove(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mSlotsMtx);
+    for (size_t i = 0; i <= mMask; ++i) {
+        if (mSlots[i].mSocket.load(std::memory_order_relaxed) == socket) {
+            mSlots[i].mSocket.store(kRemoved, std::memory_order_release);
+            --mKeys;
+        }
+    }
+    for (size_t i = 0; i <= mMask; ++i) {
+        reclaim(i);
+    }
+}
+
+void SRTNetConflation::clear() {
+    std::lock_guard<std::mutex> lock(mSlotsMtx);
+    mKeys = 0;
+    for (size_t i = 0; i <= mMask; ++i) {
+        mSlots[i].mSocket.store(kEmpty, std::memory_order_release);
+    }
+}
@@ -0,0 +1,99 @@
+//
+// Lock-free latest-value slots SRTNet keeps received messages in when conflation is enabled.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief A fixed size table keeping only the latest message received per connection and key. The thread reading from
+ * SRT overwrites the slot of a key with every new message, and consumers on any thread copy out the latest message
+ * without taking a lock and without ever blocking the reading thread.
+ *
+ * Every slot is a sequence lock: the writer makes the sequence odd while it copies a message in and even again once
+ * done, and a reader retries when the sequence changed while it copied the message out. The sequence of the last
+ * message read is kept per slot, which tells readers whether there is anything new and tells the writer that it is
+ * overwriting a message no one has read, which is counted as a conflated message.
+ *
+ * Slots are found by open addressing on the socket and the key, and are only written by the thread reading from
+ * their socket. A slot is reused once its connection is removed. Taking a slot for a new key and removing connections
+ * is serialised by a mutex that storing to a known key and loading never take, so that removing a connection can turn
+ * the removed slots ending a probe sequence back into empty ones. Otherwise the removed slots left by connections
+ * coming and going would fill the table, and every lookup of a key not kept would probe all of it.
+ */
+class SRTNetConflation {
+public:
+    /**
+     * @brief Constructor
+     * @param maxKeys The max number of keys, over all connections, kept at the same time
+     * @param maxMessageSize The max size of a kept message
+     */
+    SRTNetConflation(size_t maxKeys, size_t maxMessageSize);
+
+    /**
+     * @brief Keep a message as the latest one of its connection and key, only called by the thread reading from the
+     * socket
+     * @return false if the message is larger than the max message size or a new key while max keys are kept.
+     */
+    bool store(SRTSOCKET socket, uint64_t key, const uint8_t* data, size_t size);
+
+    /**
+     * @brief Copy out the latest message of a connection and key, unless it has already been read
+     * @param message resized to and filled in with the message, allocates only if its capacity is too small
+     * @return true if there was a message not read before.
+     */
+    bool load(SRTSOCKET socket, uint64_t key, std::vector<uint8_t>& message) const;
+
+    /**
+     * @brief The number of messages of a connection overwritten before they were read
+     */
+    uint64_t conflated(SRTSOCKET socket) const;
+
+    /**
+     * @brief Forget the messages of a connection and free its slots
+     */
+    void remove(SRTSOCKET socket);
+
+    /**
+     * @brief Remove all connections
+     */
+    void clear();
+
+private:
+    // Slot states besides a socket
+    static constexpr SRTSOCKET kEmpty = SRT_INVALID_SOCK; // Never used, ends a probe sequence
+    static constexpr SRTSOCKET kRemoved = -2;             // Used before, does not end a probe sequence
+    static constexpr SRTSOCKET kClaimed = -3;             // Being set up by store
+
+    struct alignas(64) Slot {
+        std::atomic<SRTSOCKET> mSocket{kEmpty};
+        std::atomic<uint64_t> mKey{0};
+        std::atomic<uint64_t> mSequence{0};     // Odd while a message is written, 0 until the first message
+        std::atomic<uint64_t> mReadSequence{0}; // The sequence of the last message read
+        std::atomic<uint64_t> mConflated{0};
+        std::atomic<size_t> mSize{0};
+    };
+
+    Slot* find(SRTSOCKET socket, uint64_t key) const;
+    Slot* claim(SRTSOCKET socket, uint64_t key);
+    void reclaim(size_t index);
+    std::atomic<uint64_t>* words(const Slot& slot) const;
+
+    std::mutex mSlotsMtx; // Taken by claim, remove and clear
+    size_t mKeys = 0;     // The number of slots in use, guarded by mSlotsMtx
+    std::unique_ptr<Slot[]> mSlots;
+    size_t mMask = 0;
+    // The messages, mWordsPerSlot words for every slot. Kept in atomic words so a reader racing with the writer reads
+    // a torn message, which it then throws away, instead of a data race.
+    std::unique_ptr<std::atomic<uint64_t>[]> mWords;
+    size_t mWordsPerSlot = 0;
+    size_t mMaxKeys = 0;
+    size_t mMaxMessageSize = 0;
+};
@@ -0,0 +1,207 @@
+//
+// Lock-free per connection message, byte and bitrate counters kept by SRTNet on its receive and send paths.
+//
+
+#include "SRTNetConnectionCounters.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// The slot a probe sequence for a socket starts at, before masking
+size_t probeStart(SRTSOCKET socket) {
+    return static_cast<size_t>(static_cast<uint32_t>(socket) * 2654435761u);
+}
+
+// Fold the bytes of a window of elapsedUs into a moving average, weighing the window by its length
+double foldWindow(double average, uint64_t bytes, int64_t elapsedUs) {
+    double bitsPerSecond = static_cast<double>(bytes) * 8 * 1000000 / static_cast<double>(elapsedUs);
+    if (average < 0) {
+        // The first window
+        return bitsPerSecond;
+    }
+    double windows = static_cast<double>(elapsedUs) / SRTNetConnectionCounters::kWindowUs;
+    double weight = 1.0 - std::pow(1.0 - SRTNetConnectionCounters::kSmoothing, windows);
+    return average + weight * (bitsPerSecond - average);
+}
+
+// Fold a window that started elapsedUs ago into a moving average. The bytes were counted within the first kWindowUs,
+// the time after that was idle and pulls the average down as much as the same number of empty windows would.
+double foldEndedWindow(double average, uint64_t bytes, int64_t elapsedUs) {
+    average = foldWindow(average, bytes, SRTNetConnectionCounters::kWindowUs);
+    if (elapsedUs > SRTNetConnectionCounters::kWindowUs) {
+        average = foldWindow(average, 0, elapsedUs - SRTNetConnectionCounters::kWindowUs);
+    }
+    return average;
+}
+} // namespace
+
+void SRTNetConnectionCounters::Direction::reset() {
+    mMessages.store(0, std::memory_order_relaxed);
+    mBytes.store(0, std::memory_order_relaxed);
+    mLastActivity.store(0, std::memory_order_relaxed);
+    mWindowStart.store(0, std::memory_order_relaxed);
+    mWindowBytes.store(0, std::memory_order_relaxed);
+    mBitsPerSecond.store(-1, std::memory_order_relaxed);
+}
+
+void SRTNetConnectionCounters::Direction::count(size_t bytes, int64_t now, bool singleWriter) {
+    if (singleWriter) {
+        mMessages.store(mMessages.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        mBytes.store(mBytes.load(std::memory_order_relaxed) + bytes, std::memory_order_relaxed);
+    } else {
+        mMessages.fetch_add(1, std::memory_order_relaxed);
+        mBytes.fetch_add(bytes, std::memory_order_relaxed);
+    }
+    mLastActivity.store(now, std::memory_order_relaxed);
+
+    int64_t windowStart = mWindowStart.load(std::memory_order_relaxed);
+    if (windowStart != 0 && now - windowStart < kWindowUs) {
+        mWindowBytes.fetch_add(bytes, std::memory_order_relaxed);
+        return;
+    }
+    // Only the thread moving the window on folds the ended window into the average
+    if (!mWindowStart.compare_exchange_strong(windowStart, now, std::memory_order_relaxed)) {
+        mWindowBytes.fetch_add(bytes, std::memory_order_relaxed);
+        return;
+    }
+    uint64_t windowBytes = mWindowBytes.exchange(bytes, std::memory_order_relaxed);
+    if (windowStart != 0) {
+        double average = mBitsPerSecond.load(std::memory_order_relaxed);
+        mBitsPerSecond.store(foldEndedWindow(average, windowBytes, now - windowStart), std::memory_order_relaxed);
+    }
+}
+
+double SRTNetConnectionCounters::Direction::bitsPerSecond(int64_t now) const {
+    int64_t windowStart = mWindowStart.load(std::memory_order_relaxed);
+    double average = mBitsPerSecond.load(std::memory_order_relaxed);
+    if (windowStart != 0 && now - windowStart >= kWindowUs) {
+        // Nothing has been counted since the window ended, fold it in as if a message was counted now
+        average = foldEndedWindow(average, mWindowBytes.load(std::memory_order_relaxed), now - windowStart);
+    }
+    return std::max(average, 0.0);
+}
+
+SRTNetConnectionCounters::SRTNetConnectionCounters(size_t maxConnections) {
+    // At most half of the slots are used, which keeps the probe sequences short
+    size_t slots = 1;
+    while (slots < maxConnections * 2) {
+        slots *= 2;
+    }
+    mSlots = std::make_unique<Slot[]>(slots);
+    mMask = slots - 1;
+}
+
+SRTNetConnectionCounters::Slot* SRTNetConnectionCounters::find(SRTSOCKET socket) const {
+    size_t first = probeStart(socket);
+    for (size_t i = 0; i <= mMask; ++i) {
+        Slot& slot = mSlots[(first + i) & mMask];
+        SRTSOCKET slotSocket = slot.mSocket.load(std::memory_order_acquire);
+        if (slotSocket == socket) {
+            return &slot;
+        }
+        if (slotSocket == kEmpty) {
+            break;
+        }
+    }
+    return nullptr;
+}
+
+bool SRTNetConnectionCounters::add(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mSlotsMtx);
+    if (socket < 0 || find(socket) != nullptr) {
+        return false;
+    }
+    size_t first = probeStart(socket);
+    for (size_t i = 0; i <= mMask; ++i) {
+        Slot& slot = mSlots[(first + i) & mMask];
+        SRTSOCKET slotSocket = slot.mSocket.load(std::memory_order_relaxed);
+        if (slotSocket == kEmpty || slotSocket == kRemoved) {
+            slot.mSocket.store(kClaimed, std::memory_order_relaxed);
+            // A reader that saw the previous socket sees kClaimed when it checks the socket again after reading
+            std::atomic_thread_fence(std::memory_order_release);
+            slot.mReceive.reset();
+            slot.mSend.reset();
+            slot.mSocket.store(socket, std::memory_order_release);
+            return true;
+        }
+    }
+    return false;
+}
+
+void SRTNetConnectionCounters::reclaim(size_t index) {
+    // No probe sequence runs past an empty slot, so removed slots right before one are not passed by any either
+    while (mSlots[index].mSocket.load(std::memory_order_relaxed) == kRemoved &&
+           mSlots[(index + 1) & mMask].mSocket.load(std::memory_order_relaxed) == kEmpty) {
+        mSlots[index].mSocket.store(kEmpty, std::memory_order_release);
+        index = (index - 1) & mMask;
+    }
+}
+
+void SRTNetConnectionCounters::remove(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mSlotsMtx);
+    Slot* slot = find(socket);
+    if (slot != nullptr) {
+        slot->mSocket.store(kRemoved, std::memory_order_release);
+        reclaim(static_cast<size_t>(slot - mSlots.get()));
+    }
+}
+
+void SRTNetConnectionCounters::clear() {
+    std::lock_guard<std::mutex> lock(mSlotsMtx);
+    for (size_t i = 0; i <= mMask; ++i) {
+        mSlots[i].mSocket.store(kEmpty, std::memory_order_release);
+    }
+}
+
+void SRTNetConnectionCounters::countReceived(SRTSOCKET socket, size_t bytes, int64_t now) {
+    Slot* slot = find(socket);
+    if (slot != nullptr) {
+        slot->mReceive.count(bytes, now, true);
+    }
+}
+
+void SRTNetConnectionCounters::countSent(SRTSOCKET socket, size_t bytes, int64_t now) {
+    Slot* slot = find(socket);
+    if (slot != nullptr) {
+        slot->mSend.count(bytes, now, false);
+    }
+}
+
+bool SRTNetConnectionCounters::read(const Slot& slot,
+                                    SRTSOCKET socket,
+                                    SRTNet::ConnectionCounters& counters,
+                                    int64_t now) const {
+    counters.mMessagesReceived = slot.mReceive.mMessages.load(std::memory_order_relaxed);
+    counters.mBytesReceived = slot.mReceive.mBytes.load(std::memory_order_relaxed);
+    counters.mMessagesSent = slot.mSend.mMessages.load(std::memory_order_relaxed);
+    counters.mBytesSent = slot.mSend.mBytes.load(std::memory_order_relaxed);
+    counters.mLastActivity = std::max(slot.mReceive.mLastActivity.load(std::memory_order_relaxed),
+                                      slot.mSend.mLastActivity.load(std::memory_order_relaxed));
+    counters.mReceiveBitsPerSecond = slot.mReceive.bitsPerSecond(now);
+    counters.mSendBitsPerSecond = slot.mSend.bitsPerSecond(now);
+    // The slot may have been handed to another connection while it was read
+    std::atomic_thread_fence(std::memory_order_acquire);
+    return slot.mSocket.load(std::memory_order_relaxed) == socket;
+}
+
+bool SRTNetConnectionCounters::get(SRTSOCKET socket, SRTNet::ConnectionCounters& counters, int64_t now) const {
+    const Slot* slot = find(socket);
+    return slot != nullptr && read(*slot, socket, counters, now);
+}
+
+void SRTNetConnectionCounters::getAll(std::vector<std::pair<SRTSOCKET, SRTNet::ConnectionCounters>>& counters,
+                                      int64_t now) const {
+    counters.clear();
+    for (size_t i = 0; i <= mMask; ++i) {
+        const Slot& slot = mSlots[i];
+        SRTSOCKET socket = slot.mSocket.load(std::memory_order_acquire);
+        if (socket < 0) {
+            continue;
+        }
+        SRTNet::ConnectionCounters connectionCounters;
+        if (read(slot, socket, connectionCounters, now)) {
+            counters.emplace_back(socket, connectionCounters);
+        }
+    }
+}
@@ -0,0 +1,118 @@
+//
+// Lock-free per connection message, byte and bitrate counters kept by SRTNet on its receive and send paths.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief A fixed size table of per connection counters, updated for every message received and sent and readable
+ * from any thread without taking a lock, neither one of SRTNet nor one of SRT. Meant for live telemetry polled far
+ * more often than srt_bistats can be called across many connections.
+ *
+ * Every connection owns one slot, found by open addressing on its socket. The receive and send counters of a slot
+ * are kept in cache lines of their own, so the thread reading from SRT and the threads sending never write to the
+ * same cache line, and neighbouring connections never share one either. The receive counters have a single writer and
+ * are updated with plain atomic stores, the send counters are updated with atomic adds since sendData may be called
+ * from several threads.
+ *
+ * The bitrate is an exponentially weighted moving average of the bitrate over windows of kWindowUs, folded in by the
+ * first message after a window has ended. A reader ages the average of a connection that has been idle for longer.
+ *
+ * A slot is reused once its connection is removed. A reader racing with the removal may still get the counters of the
+ * old connection, and a message sent to the old connection while its slot is handed to a new one may be counted for
+ * the new one. Adding and removing connections is serialised by a mutex the counting and reading paths never take, so
+ * that removing a connection can turn the removed slots ending a probe sequence back into empty ones. Otherwise the
+ * removed slots left by connections coming and going would fill the table, and every lookup of a socket not counted
+ * would probe all of it.
+ */
+class SRTNetConnectionCounters {
+public:
+    static constexpr int64_t kWindowUs = 100000;
+    static constexpr double kSmoothing = 0.25; // Weight of the last window in the moving average
+
+    /**
+     * @brief Constructor
+     * @param maxConnections The max number of connections counted at the same time
+     */
+    explicit SRTNetConnectionCounters(size_t maxConnections);
+
+    /**
+     * @brief Start counting a connection, with all counters at zero
+     * @return false if the table is full or the socket is already counted
+     */
+    bool add(SRTSOCKET socket);
+
+    /**
+     * @brief Stop counting a connection and free its slot
+     */
+    void remove(SRTSOCKET socket);
+
+    /**
+     * @brief Remove all connections
+     */
+    void clear();
+
+    /**
+     * @brief Count a received message, only called by the thread reading from the socket
+     */
+    void countReceived(SRTSOCKET socket, size_t bytes, int64_t now);
+
+    /**
+     * @brief Count a sent message, may be called from several threads
+     */
+    void countSent(SRTSOCKET socket, size_t bytes, int64_t now);
+
+    /**
+     * @brief Read the counters of a connection
+     * @param now The current time, used to age the bitrates of an idle connection
+     * @return false if the connection is not counted
+     */
+    bool get(SRTSOCKET socket, SRTNet::ConnectionCounters& counters, int64_t now) const;
+
+    /**
+     * @brief Read the counters of all connections, without allocating as long as \p counters has enough capacity
+     */
+    void getAll(std::vector<std::pair<SRTSOCKET, SRTNet::ConnectionCounters>>& counters, int64_t now) const;
+
+private:
+    // Slot states besides a socket
+    static constexpr SRTSOCKET kEmpty = SRT_INVALID_SOCK; // Never used, ends a probe sequence
+    static constexpr SRTSOCKET kRemoved = -2;             // Used before, does not end a probe sequence
+    static constexpr SRTSOCKET kClaimed = -3;             // Being set up by add
+
+    struct alignas(64) Direction {
+        std::atomic<uint64_t> mMessages{0};
+        std::atomic<uint64_t> mBytes{0};
+        std::atomic<int64_t> mLastActivity{0};
+        std::atomic<int64_t> mWindowStart{0};
+        std::atomic<uint64_t> mWindowBytes{0};
+        std::atomic<double> mBitsPerSecond{0};
+
+        void reset();
+        void count(size_t bytes, int64_t now, bool singleWriter);
+        double bitsPerSecond(int64_t now) const;
+    };
+
+    struct alignas(64) Slot {
+        std::atomic<SRTSOCKET> mSocket{kEmpty};
+        Direction mReceive;
+        Direction mSend;
+    };
+
+    Slot* find(SRTSOCKET socket) const;
+    void reclaim(size_t index);
+    bool read(const Slot& slot, SRTSOCKET socket, SRTNet::ConnectionCounters& counters, int64_t now) const;
+
+    std::mutex mSlotsMtx; // Taken by add, remove and clear
+    std::unique_ptr<Slot[]> mSlots;
+    size_t mMask = 0;
+};
@@ -0,0 +1,279 @@
+//
+// Application layer AES-GCM encryption of SRT messages, parallelised over a worker pool.
+//
+
+#include "SRTNetCrypto.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <openssl/evp.h>
+#include <openssl/kdf.h>
+#include <openssl/rand.h>
+
+namespace {
+const char kSubkeyInfo[] = "SRTNet AES-GCM subkey";
+constexpr size_t kGcmNonceSize = 12;
+
+// The GCM nonce of a message, the counter of the message padded to 96 bits
+void gcmNonce(const uint8_t* counter, uint8_t* nonce) {
+    memset(nonce, 0, kGcmNonceSize - SRTNetAeadCipher::kCounterSize);
+    memcpy(nonce + kGcmNonceSize - SRTNetAeadCipher::kCounterSize, counter, SRTNetAeadCipher::kCounterSize);
+}
+} // namespace
+
+std::unique_ptr<SRTNetAeadCipher> SRTNetAeadCipher::create(const std::vector<uint8_t>& key) {
+    const EVP_CIPHER* cipher = nullptr;
+    if (key.size() == 16) {
+        cipher = EVP_aes_128_gcm();
+    } else if (key.size() == 32) {
+        cipher = EVP_aes_256_gcm();
+    } else {
+        return nullptr;
+    }
+
+    std::unique_ptr<SRTNetAeadCipher> aeadCipher(new SRTNetAeadCipher(cipher, key));
+    if (RAND_bytes(aeadCipher->mSalt, sizeof(aeadCipher->mSalt)) != 1 ||
+        !deriveKey(key, aeadCipher->mSalt, aeadCipher->mSubkey)) {
+        return nullptr;
+    }
+    return aeadCipher;
+}
+
+SRTNetAeadCipher::SRTNetAeadCipher(const EVP_CIPHER* cipher, const std::vector<uint8_t>& key)
+    : mCipher(cipher)
+    , mKey(key) {
+}
+
+SRTNetAeadCipher::~SRTNetAeadCipher() {
+    for (EVP_CIPHER_CTX* context : mEncryptContexts) {
+        EVP_CIPHER_CTX_free(context);
+    }
+    for (PeerKey& peerKey : mPeerKeys) {
+        for (EVP_CIPHER_CTX* context : peerKey.mContexts) {
+            EVP_CIPHER_CTX_free(context);
+        }
+    }
+}
+
+bool SRTNetAeadCipher::encrypt(const uint8_t* data, size_t size, uint8_t* out) {
+    EVP_CIPHER_CTX* context = acquireEncryptContext();
+    if (!context) {
+        return false;
+    }
+
+    uint64_t counter = mCounter.fetch_add(1, std::memory_order_relaxed);
+    memcpy(out, mSalt, kSaltSize);
+    memcpy(out + kSaltSize, &counter, kCounterSize);
+    uint8_t nonce[kGcmNonceSize];
+    gcmNonce(out + kSaltSize, nonce);
+
+    int length = 0;
+    int finalLength = 0;
+    bool success = EVP_EncryptInit_ex(context, nullptr, nullptr, nullptr, nonce) == 1 &&
+                   EVP_EncryptUpdate(context, out + kHeaderSize, &length, data, static_cast<int>(size)) == 1 &&
+                   EVP_EncryptFinal_ex(context, out + kHeaderSize + length, &finalLength) == 1 &&
+                   EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_GET_TAG, kTagSize, out + kHeaderSize + size) == 1;
+    releaseContext(context, nullptr);
+    return success;
+}
+
+bool SRTNetAeadCipher::decrypt(uint8_t* data, size_t size, size_t& plainSize) {
+    if (size < kOverhead) {
+        return false;
+    }
+    EVP_CIPHER_CTX* context = acquireDecryptContext(data);
+    if (!context) {
+        return false;
+    }
+
+    plainSize = size - kOverhead;
+    uint8_t nonce[kGcmNonceSize];
+    gcmNonce(data + kSaltSize, nonce);
+    uint8_t* cipherText = data + kHeaderSize;
+    int length = 0;
+    int finalLength = 0;
+    // GCM allows decrypting in place
+    bool success =
+        EVP_DecryptInit_ex(context, nullptr, nullptr, nullptr, nonce) == 1 &&
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_TAG, kTagSize, cipherText + plainSize) == 1 &&
+        EVP_DecryptUpdate(context, cipherText, &length, cipherText, static_cast<int>(plainSize)) == 1 &&
+        EVP_DecryptFinal_ex(context, cipherText + length, &finalLength) == 1;
+    releaseContext(context, data);
+    return success;
+}
+
+bool SRTNetAeadCipher::deriveKey(const std::vector<uint8_t>& key, const uint8_t* salt, std::vector<uint8_t>& subkey) {
+    subkey.resize(key.size());
+    size_t length = subkey.size();
+    EVP_PKEY_CTX* context = EVP_PKEY_CTX_new_id(EVP_PKEY_HKDF, nullptr);
+    bool success =
+        context && EVP_PKEY_derive_init(context) == 1 && EVP_PKEY_CTX_set_hkdf_md(context, EVP_sha256()) == 1 &&
+        EVP_PKEY_CTX_set1_hkdf_salt(context, salt, kSaltSize) == 1 &&
+        EVP_PKEY_CTX_set1_hkdf_key(context, key.data(), static_cast<int>(key.size())) == 1 &&
+        EVP_PKEY_CTX_add1_hkdf_info(context, reinterpret_cast<const unsigned char*>(kSubkeyInfo),
+                                    sizeof(kSubkeyInfo) - 1) == 1 &&
+        EVP_PKEY_derive(context, subkey.data(), &length) == 1 && length == subkey.size();
+    EVP_PKEY_CTX_free(context);
+    return success;
+}
+
+EVP_CIPHER_CTX* SRTNetAeadCipher::newContext(const std::vector<uint8_t>& key, bool encrypt) const {
+    // The key schedule is set up once per context, only the nonce is set per message
+    EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+    if (!context) {
+        return nullptr;
+    }
+    if (EVP_CipherInit_ex(context, mCipher, nullptr, nullptr, nullptr, encrypt ? 1 : 0) != 1 ||
+        EVP_CIPHER_CTX_ctrl(context, EVP_CTRL_GCM_SET_IVLEN, kGcmNonceSize, nullptr) != 1 ||
+        EVP_CipherInit_ex(context, nullptr, nullptr, key.data(), nullptr, encrypt ? 1 : 0) != 1) {
+        EVP_CIPHER_CTX_free(context);
+        return nullptr;
+    }
+    return context;
+}
+
+EVP_CIPHER_CTX* SRTNetAeadCipher::acquireEncryptContext() {
+    {
+        std::lock_guard<std::mutex> lock(mContextMtx);
+        if (!mEncryptContexts.empty()) {
+            EVP_CIPHER_CTX* context = mEncryptContexts.back();
+            mEncryptContexts.pop_back();
+            return context;
+        }
+    }
+    return newContext(mSubkey, true);
+}
+
+EVP_CIPHER_CTX* SRTNetAeadCipher::acquireDecryptContext(const uint8_t* salt) {
+    std::vector<uint8_t> subkey;
+    {
+        std::lock_guard<std::mutex> lock(mContextMtx);
+        auto peerKey = std::find_if(mPeerKeys.begin(), mPeerKeys.end(), [salt](const PeerKey& peerKey) {
+            return memcmp(peerKey.mSalt, salt, kSaltSize) == 0;
+        });
+        if (peerKey != mPeerKeys.end()) {
+            peerKey->mLastUse = ++mPeerKeyUses;
+            if (!peerKey->mContexts.empty()) {
+                EVP_CIPHER_CTX* context = peerKey->mContexts.back();
+                peerKey->mContexts.pop_back();
+                return context;
+            }
+            subkey = peerKey->mKey;
+        }
+    }
+
+    if (subkey.empty()) {
+        PeerKey peerKey;
+        memcpy(peerKey.mSalt, salt, kSaltSize);
+        if (!deriveKey(mKey, salt, peerKey.mKey)) {
+            return nullptr;
+        }
+        subkey = peerKey.mKey;
+
+        std::lock_guard<std::mutex> lock(mContextMtx);
+        if (mPeerKeys.size() == kMaxPeerKeys) {
+            // Forget the sender not heard from for the longest time
+            auto oldest = std::min_element(mPeerKeys.begin(), mPeerKeys.end(),
+                                           [](const PeerKey& a, const PeerKey& b) { return a.mLastUse < b.mLastUse; });
+            for (EVP_CIPHER_CTX* context : oldest->mContexts) {
+                EVP_CIPHER_CTX_free(context);
+            }
+            mPeerKeys.erase(oldest);
+        }
+        peerKey.mLastUse = ++mPeerKeyUses;
+        mPeerKeys.push_back(std::move(peerKey));
+    }
+    return newContext(subkey, false);
+}
+
+void SRTNetAeadCipher::releaseContext(EVP_CIPHER_CTX* context, const uint8_t* salt) {
+    std::lock_guard<std::mutex> lock(mContextMtx);
+    if (salt == nullptr) {
+        mEncryptContexts.push_back(context);
+        return;
+    }
+    for (PeerKey& peerKey : mPeerKeys) {
+        if (memcmp(peerKey.mSalt, salt, kSaltSize) == 0) {
+            peerKey.mContexts.push_back(context);
+            return;
+        }
+    }
+    // The subkey was forgotten while the context was in use
+    EVP_CIPHER_CTX_free(context);
+}
+
+SRTNetWorkerPool::SRTNetWorkerPool(size_t threads) {
+    for (size_t slot = 1; slot <= threads; ++slot) {
+        mThreads.emplace_back(&SRTNetWorkerPool::worker, this, slot);
+    }
+}
+
+SRTNetWorkerPool::~SRTNetWorkerPool() {
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        mStop = true;
+    }
+    mWorkCondition.notify_all();
+    for (auto& thread : mThreads) {
+        thread.join();
+    }
+}
+
+size_t SRTNetWorkerPool::size() const {
+    return mThreads.size() + 1;
+}
+
+void SRTNetWorkerPool::parallelFor(size_t count, const std::function<void(size_t index, size_t slot)>& job) {
+    const size_t stride = size();
+    if (count <= 1 || stride == 1) {
+        for (size_t index = 0; index < count; ++index) {
+            job(index, 0);
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> callerLock(mCallerMtx);
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        mJob = &job;
+        mCount = count;
+        mPending = mThreads.size();
+        mGeneration++;
+    }
+    mWorkCondition.notify_all();
+
+    for (size_t index = 0; index < count; index += stride) {
+        job(index, 0);
+    }
+
+    // Every worker has to check in, even the ones without any index to run, before the job can go out of scope
+    std::unique_lock<std::mutex> lock(mMtx);
+    mDoneCondition.wait(lock, [&]() { return mPending == 0; });
+    mJob = nullptr;
+}
+
+void SRTNetWorkerPool::worker(size_t slot) {
+    const size_t stride = size();
+    uint64_t handledGeneration = 0;
+    std::unique_lock<std::mutex> lock(mMtx);
+    while (true) {
+        mWorkCondition.wait(lock, [&]() { return mStop || mGeneration != handledGeneration; });
+        if (mStop) {
+            return;
+        }
+        handledGeneration = mGeneration;
+        const std::function<void(size_t, size_t)>* job = mJob;
+        size_t count = mCount;
+
+        lock.unlock();
+        for (size_t index = slot; index < count; index += stride) {
+            (*job)(index, slot);
+        }
+        lock.lock();
+
+        if (--mPending == 0) {
+            mDoneCondition.notify_one();
+        }
+    }
+}
@@ -0,0 +1,142 @@
+//
+// Application layer AES-GCM encryption of SRT messages, parallelised over a worker pool.
+//
+
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+typedef struct evp_cipher_ctx_st EVP_CIPHER_CTX;
+typedef struct evp_cipher_st EVP_CIPHER;
+
+/**
+ * @brief AES-GCM authenticated encryption of single messages. Every encrypted message is laid out as
+ * [12 byte session salt][8 byte counter][ciphertext][16 byte tag], so it is kOverhead bytes larger than the plaintext.
+ *
+ * The key given is never used to encrypt directly, since it is shared by both peers, every client and every restart.
+ * Each cipher instance picks a random 96 bit session salt when it is created and encrypts with a subkey derived from
+ * the key and the salt with HKDF-SHA256. The GCM nonce is the 64 bit message counter of the instance, so a nonce never
+ * repeats under one subkey, and two instances only share a subkey if they draw the same 96 bit salt. The receiver
+ * derives the subkey of every sender from the salt carried in the message and keeps the subkeys of the last
+ * kMaxPeerKeys senders. The cipher can be used from several threads at the same time, each call borrows an OpenSSL
+ * context from an internal free list.
+ */
+class SRTNetAeadCipher {
+public:
+    static constexpr size_t kSaltSize = 12;
+    static constexpr size_t kCounterSize = 8;
+    static constexpr size_t kHeaderSize = kSaltSize + kCounterSize;
+    static constexpr size_t kTagSize = 16;
+    static constexpr size_t kOverhead = kHeaderSize + kTagSize;
+    static constexpr size_t kMaxPeerKeys = 64;
+
+    /**
+     * @brief Create a cipher
+     * @param key 16 bytes for AES-128-GCM or 32 bytes for AES-256-GCM
+     * @return The cipher, or nullptr if the key length is not supported or OpenSSL failed to initialize
+     */
+    static std::unique_ptr<SRTNetAeadCipher> create(const std::vector<uint8_t>& key);
+
+    ~SRTNetAeadCipher();
+
+    /**
+     * @brief Encrypt a message
+     * @param data the plaintext
+     * @param size the size of the plaintext
+     * @param out buffer of at least size + kOverhead bytes receiving the encrypted message
+     * @return true if the message was encrypted
+     */
+    bool encrypt(const uint8_t* data, size_t size, uint8_t* out);
+
+    /**
+     * @brief Decrypt and authenticate a message in place. The plaintext is written to data + kHeaderSize.
+     * @param data the encrypted message
+     * @param size the size of the encrypted message
+     * @param plainSize set to the size of the plaintext
+     * @return false if the message is too short, or was not encrypted with the same key or has been tampered with
+     */
+    bool decrypt(uint8_t* data, size_t size, size_t& plainSize);
+
+    SRTNetAeadCipher(SRTNetAeadCipher const&) = delete;
+    SRTNetAeadCipher& operator=(SRTNetAeadCipher const&) = delete;
+
+private:
+    // The subkey of a sender, found by the session salt of its messages
+    struct PeerKey {
+        uint8_t mSalt[kSaltSize] = {};
+        std::vector<uint8_t> mKey;
+        std::vector<EVP_CIPHER_CTX*> mContexts;
+        uint64_t mLastUse = 0;
+    };
+
+    SRTNetAeadCipher(const EVP_CIPHER* cipher, const std::vector<uint8_t>& key);
+
+    static bool deriveKey(const std::vector<uint8_t>& key, const uint8_t* salt, std::vector<uint8_t>& subkey);
+    EVP_CIPHER_CTX* newContext(const std::vector<uint8_t>& key, bool encrypt) const;
+    EVP_CIPHER_CTX* acquireEncryptContext();
+    EVP_CIPHER_CTX* acquireDecryptContext(const uint8_t* salt);
+    // salt is nullptr for an encrypt context
+    void releaseContext(EVP_CIPHER_CTX* context, const uint8_t* salt);
+
+    const EVP_CIPHER* mCipher;
+    const std::vector<uint8_t> mKey;
+    uint8_t mSalt[kSaltSize] = {};
+    std::vector<uint8_t> mSubkey;
+    std::atomic<uint64_t> mCounter{0};
+
+    std::mutex mContextMtx;
+    std::vector<EVP_CIPHER_CTX*> mEncryptContexts;
+    std::vector<PeerKey> mPeerKeys;
+    uint64_t mPeerKeyUses = 0;
+};
+
+/**
+ * @brief A fixed pool of worker threads running the iterations of a loop in parallel. The calling thread takes part in
+ * the work, and iteration i is always run by slot i % size(), so a batch of equally sized jobs is spread evenly.
+ * Results written to per-index slots are complete, and can be consumed in order, when parallelFor returns.
+ */
+class SRTNetWorkerPool {
+public:
+    /**
+     * @brief Constructor
+     * @param threads The number of threads in addition to the calling thread
+     */
+    explicit SRTNetWorkerPool(size_t threads);
+
+    ~SRTNetWorkerPool();
+
+    /**
+     * @brief The number of slots, the worker threads plus the calling thread
+     */
+    size_t size() const;
+
+    /**
+     * @brief Run job(index, slot) for all indexes in [0, count) and wait for all of them to complete. Calls from
+     * different threads are serialised.
+     */
+    void parallelFor(size_t count, const std::function<void(size_t index, size_t slot)>& job);
+
+    SRTNetWorkerPool(SRTNetWorkerPool const&) = delete;
+    SRTNetWorkerPool& operator=(SRTNetWorkerPool const&) = delete;
+
+private:
+    void worker(size_t slot);
+
+    std::vector<std::thread> mThreads;
+    std::mutex mCallerMtx;
+    std::mutex mMtx;
+    std::condition_variable mWorkCondition;
+    std::condition_variable mDoneCondition;
+    const std::function<void(size_t, size_t)>* mJob = nullptr;
+    size_t mCount = 0;
+    size_t mPending = 0;
+    uint64_t mGeneration = 0;
+    bool mStop = false;
+};
@@ -0,0 +1,384 @@
+//
+// Seamless merge of two connections carrying the same stream over different network paths.
+//
+
+#include "SRTNetDualPathMerger.h"
+
+#include <algorithm>
+
+namespace {
+constexpr size_t kTsPacketSize = 188;
+constexpr uint8_t kTsSyncByte = 0x47;
+constexpr uint16_t kTsNullPid = 0x1fff;
+// Weight of a new sample in the moving average of the difference in delay of the paths
+constexpr double kPathDelayWeight = 1.0 / 16;
+
+uint64_t mixSequence(uint64_t sequence) {
+    sequence ^= sequence >> 33;
+    sequence *= 0xff51afd7ed558ccdull;
+    sequence ^= sequence >> 33;
+    return sequence;
+}
+} // namespace
+
+SRTNetDualPathMerger::Sequence SRTNetDualPathMerger::transportStream() {
+    SequenceFunction function = [](const uint8_t* data, size_t size, uint64_t& sequence) {
+        if (size == 0 || size % kTsPacketSize != 0) {
+            return false;
+        }
+        // FNV-1a over the whole message
+        uint64_t hash = 0xcbf29ce484222325ull;
+        bool nullPacketsOnly = true;
+        for (size_t packet = 0; packet < size; packet += kTsPacketSize) {
+            if (data[packet] != kTsSyncByte) {
+                return false;
+            }
+            const uint16_t pid = static_cast<uint16_t>(((data[packet + 1] & 0x1f) << 8) | data[packet + 2]);
+            nullPacketsOnly = nullPacketsOnly && pid == kTsNullPid;
+            for (size_t i = packet; i < packet + kTsPacketSize; ++i) {
+                hash = (hash ^ data[i]) * 0x100000001b3ull;
+            }
+        }
+        if (nullPacketsOnly) {
+            return false;
+        }
+        sequence = hash;
+        return true;
+    };
+    return {std::move(function), 0};
+}
+
+SRTNetDualPathMerger::Sequence SRTNetDualPathMerger::sequenceTag(size_t offset, size_t bytes) {
+    SequenceFunction function = [offset, bytes](const uint8_t* data, size_t size, uint64_t& sequence) {
+        if (bytes == 0 || bytes > sizeof(uint64_t) || size < offset + bytes) {
+            return false;
+        }
+        sequence = 0;
+        for (size_t i = offset; i < offset + bytes; ++i) {
+            sequence = (sequence << 8) | data[i];
+        }
+        return true;
+    };
+    return {std::move(function), std::min(bytes, sizeof(uint64_t)) * 8};
+}
+
+SRTNetDualPathMerger::SRTNetDualPathMerger(Sequence sequence,
+                                           std::chrono::milliseconds alignmentWindow,
+                                           size_t maxMessages)
+    : mSequence(std::move(sequence.mFunction))
+    , mKeyBits(sequence.mBits > 0 && sequence.mBits <= 64 ? sequence.mBits : 64)
+    , mOrderedSequence(sequence.mBits > 0)
+    , mAlignmentWindow(alignmentWindow)
+    , mEntries(std::max<size_t>(maxMessages, 1))
+    , mHeld(mEntries.size()) {
+    size_t indexSize = 1;
+    while (indexSize < mEntries.size() * 2) {
+        indexSize *= 2;
+    }
+    mIndex.assign(indexSize, kNoEntry);
+    mIndexMask = indexSize - 1;
+    mFreeHeld.reserve(mHeld.size());
+    for (size_t i = mHeld.size(); i > 0; --i) {
+        mFreeHeld.push_back(static_cast<int32_t>(i - 1));
+    }
+}
+
+bool SRTNetDualPathMerger::addPath(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mMtx);
+    size_t index;
+    if (findPath(socket, index)) {
+        return false;
+    }
+    for (auto& path : mPaths) {
+        if (!path.mUsed) {
+            path = Path();
+            path.mUsed = true;
+            path.mStatistics.mSocket = socket;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SRTNetDualPathMerger::removePath(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mMtx);
+    size_t index;
+    Path* path = findPath(socket, index);
+    if (!path) {
+        return false;
+    }
+    path->mUsed = false;
+    // A path added later in the same place must not be taken for having delivered the remembered messages
+    for (size_t i = 0; i < mCount; ++i) {
+        mEntries[(mOldest + i) % mEntries.size()].mPaths &= ~(1u << index);
+    }
+    releaseHeld(std::chrono::steady_clock::now());
+    return true;
+}
+
+bool SRTNetDualPathMerger::pushData(const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket) {
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    std::lock_guard<std::mutex> lock(mMtx);
+    size_t pathIndex;
+    Path* path = findPath(socket, pathIndex);
+    if (!path) {
+        return false;
+    }
+    PathStatistics& statistics = path->mStatistics;
+    statistics.mReceivedMessages++;
+    uint64_t sequence;
+    if (!mSequence(data, size, sequence)) {
+        statistics.mUnsequencedMessages++;
+        return false;
+    }
+
+    // Held messages leave before the window, so they are released before their entries are forgotten
+    releaseHeld(now);
+    leaveWindow(now);
+    const uint8_t pathBit = static_cast<uint8_t>(1u << pathIndex);
+    int32_t entry = findEntry(sequence);
+    if (entry != kNoEntry && !(mEntries[entry].mPaths & pathBit)) {
+        measurePathDelay(mEntries[entry], pathIndex, now);
+        mEntries[entry].mPaths |= pathBit;
+        statistics.mDuplicateMessages++;
+        path->mLastKey = orderKey(sequence, pathIndex, now);
+        path->mDelivered = true;
+        releaseHeld(now);
+        return false;
+    }
+
+    if (entry != kNoEntry) {
+        // The path delivers the same content a second time before the other path delivered its copy, so this is a
+        // new message with the same content as an earlier one. The earlier one is done with.
+        countRepair(mEntries[entry]);
+        mEntries[entry].mPaths = pathBit;
+        if (mEntries[entry].mHeld != kNoEntry) {
+            mHeld[mEntries[entry].mHeld].mEntry = kNoEntry;
+            mEntries[entry].mHeld = kNoEntry;
+        }
+    } else {
+        if (mCount == mEntries.size()) {
+            removeOldest();
+        }
+        size_t position = (mOldest + mCount) % mEntries.size();
+        mEntries[position] = {sequence, now, pathBit, kNoEntry};
+        mCount++;
+        size_t slot = indexStart(sequence);
+        while (mIndex[slot] != kNoEntry) {
+            slot = (slot + 1) & mIndexMask;
+        }
+        mIndex[slot] = static_cast<int32_t>(position);
+        entry = static_cast<int32_t>(position);
+    }
+
+    statistics.mForwardedMessages++;
+    const uint64_t key = orderKey(sequence, pathIndex, now);
+    path->mLastKey = key;
+    path->mDelivered = true;
+    if ((mFirstHeld == kNoEntry || keyLess(key, mHeld[mFirstHeld].mKey)) && passedByAllPaths(key)) {
+        // Nothing held comes before the message and no path can deliver anything that does, forward it right away
+        if (output) {
+            output(data, size, msgCtrl, socket);
+        }
+    } else {
+        hold(data, size, msgCtrl, socket, key, entry, now);
+    }
+    releaseHeld(now);
+    return true;
+}
+
+std::vector<SRTNetDualPathMerger::PathStatistics> SRTNetDualPathMerger::getPathStatistics() {
+    std::lock_guard<std::mutex> lock(mMtx);
+    const auto now = std::chrono::steady_clock::now();
+    releaseHeld(now);
+    leaveWindow(now);
+    std::vector<PathStatistics> statistics;
+    for (const auto& path : mPaths) {
+        if (path.mUsed) {
+            statistics.push_back(path.mStatistics);
+        }
+    }
+    return statistics;
+}
+
+SRTNetDualPathMerger::Path* SRTNetDualPathMerger::findPath(SRTSOCKET socket, size_t& index) {
+    for (index = 0; index < mPaths.size(); ++index) {
+        if (mPaths[index].mUsed && mPaths[index].mStatistics.mSocket == socket) {
+            return &mPaths[index];
+        }
+    }
+    return nullptr;
+}
+
+void SRTNetDualPathMerger::leaveWindow(std::chrono::steady_clock::time_point now) {
+    while (mCount > 0 && now - mEntries[mOldest].mFirstArrival > mAlignmentWindow) {
+        removeOldest();
+    }
+}
+
+void SRTNetDualPathMerger::countRepair(const Entry& entry) {
+    // A message that arrived on one path only was missed by the other, if there is one
+    if (mPaths[0].mUsed && mPaths[1].mUsed && (entry.mPaths == 1 || entry.mPaths == 2)) {
+        size_t repairing = entry.mPaths == 1 ? 0 : 1;
+        mPaths[repairing].mStatistics.mRepairedMessages++;
+        mPaths[1 - repairing].mStatistics.mMissedMessages++;
+    }
+}
+
+void SRTNetDualPathMerger::removeOldest() {
+    const Entry& oldest = mEntries[mOldest];
+    countRepair(oldest);
+    if (oldest.mHeld != kNoEntry) {
+        // Forgotten early since the window is full, the message itself is still forwarded in order
+        mHeld[oldest.mHeld].mEntry = kNoEntry;
+    }
+
+    // Remove the entry from the index, moving back the entries after it that would no longer be found
+    size_t slot = indexStart(oldest.mSequence);
+    while (mIndex[slot] != static_cast<int32_t>(mOldest)) {
+        slot = (slot + 1) & mIndexMask;
+    }
+    size_t next = slot;
+    while (true) {
+        next = (next + 1) & mIndexMask;
+        if (mIndex[next] == kNoEntry) {
+            break;
+        }
+        size_t start = indexStart(mEntries[mIndex[next]].mSequence);
+        // Move the entry if its start is not in the range (slot, next], taking the wrap around into account
+        bool inRange = slot <= next ? (slot < start && start <= next) : (slot < start || start <= next);
+        if (!inRange) {
+            mIndex[slot] = mIndex[next];
+            slot = next;
+        }
+    }
+    mIndex[slot] = kNoEntry;
+
+    mOldest = (mOldest + 1) % mEntries.size();
+    mCount--;
+}
+
+size_t SRTNetDualPathMerger::indexStart(uint64_t sequence) const {
+    return static_cast<size_t>(mixSequence(sequence)) & mIndexMask;
+}
+
+int32_t SRTNetDualPathMerger::findEntry(uint64_t sequence) const {
+    for (size_t slot = indexStart(sequence); mIndex[slot] != kNoEntry; slot = (slot + 1) & mIndexMask) {
+        if (mEntries[mIndex[slot]].mSequence == sequence) {
+            return mIndex[slot];
+        }
+    }
+    return kNoEntry;
+}
+
+uint64_t SRTNetDualPathMerger::orderKey(uint64_t sequence,
+                                        size_t pathIndex,
+                                        std::chrono::steady_clock::time_point now) const {
+    if (mOrderedSequence) {
+        return sequence;
+    }
+    // The arrival time on the faster path, which both copies of a message have in common
+    auto arrival = std::chrono::duration_cast<std::chrono::nanoseconds>(now.time_since_epoch()).count();
+    const double extraDelay = pathIndex == 1 ? mPathDelayDifference : -mPathDelayDifference;
+    if (extraDelay > 0) {
+        arrival -= static_cast<int64_t>(extraDelay);
+    }
+    return static_cast<uint64_t>(arrival);
+}
+
+bool SRTNetDualPathMerger::keyLess(uint64_t a, uint64_t b) const {
+    // Serial number arithmetic, so a wrapping sequence number stays in order
+    return static_cast<int64_t>((a - b) << (64 - mKeyBits)) < 0;
+}
+
+void SRTNetDualPathMerger::measurePathDelay(const Entry& entry,
+                                            size_t pathIndex,
+                                            std::chrono::steady_clock::time_point now) {
+    if (entry.mPaths != (1u << (1 - pathIndex))) {
+        return;
+    }
+    const double later = static_cast<double>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(now - entry.mFirstArrival).count());
+    const double sample = pathIndex == 1 ? later : -later;
+    mPathDelayDifference += (sample - mPathDelayDifference) * kPathDelayWeight;
+}
+
+bool SRTNetDualPathMerger::passedByAllPaths(uint64_t key) const {
+    // Every path delivers in order, so once it delivered the message or a later one nothing before it can follow
+    for (const auto& path : mPaths) {
+        if (path.mUsed && (!path.mDelivered || keyLess(path.mLastKey, key))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void SRTNetDualPathMerger::hold(const uint8_t* data,
+                                size_t size,
+                                const SRT_MSGCTRL& msgCtrl,
+                                SRTSOCKET socket,
+                                uint64_t key,
+                                int32_t entry,
+                                std::chrono::steady_clock::time_point now) {
+    if (mFreeHeld.empty()) {
+        releaseFirst();
+    }
+    const int32_t index = mFreeHeld.back();
+    mFreeHeld.pop_back();
+    HeldMessage& held = mHeld[index];
+    // Keeps the capacity of the buffer, so holding a message only allocates until every buffer has grown once
+    held.mData.assign(data, data + size);
+    held.mMsgCtrl = msgCtrl;
+    held.mSocket = socket;
+    held.mKey = key;
+    held.mFirstArrival = now;
+    held.mEntry = entry;
+    mEntries[entry].mHeld = index;
+
+    // Messages mostly arrive in order, so the place in the list is searched from the end
+    int32_t previous = mLastHeld;
+    while (previous != kNoEntry && keyLess(key, mHeld[previous].mKey)) {
+        previous = mHeld[previous].mPrevious;
+    }
+    held.mPrevious = previous;
+    held.mNext = previous == kNoEntry ? mFirstHeld : mHeld[previous].mNext;
+    if (previous == kNoEntry) {
+        mFirstHeld = index;
+    } else {
+        mHeld[previous].mNext = index;
+    }
+    if (held.mNext == kNoEntry) {
+        mLastHeld = index;
+    } else {
+        mHeld[held.mNext].mPrevious = index;
+    }
+}
+
+void SRTNetDualPathMerger::releaseHeld(std::chrono::steady_clock::time_point now) {
+    while (mFirstHeld != kNoEntry) {
+        const HeldMessage& first = mHeld[mFirstHeld];
+        if (now - first.mFirstArrival <= mAlignmentWindow && !passedByAllPaths(first.mKey)) {
+            break;
+        }
+        releaseFirst();
+    }
+}
+
+void SRTNetDualPathMerger::releaseFirst() {
+    const int32_t index = mFirstHeld;
+    HeldMessage& held = mHeld[index];
+    mFirstHeld = held.mNext;
+    if (mFirstHeld == kNoEntry) {
+        mLastHeld = kNoEntry;
+    } else {
+        mHeld[mFirstHeld].mPrevious = kNoEntry;
+    }
+    if (held.mEntry != kNoEntry) {
+        mEntries[held.mEntry].mHeld = kNoEntry;
+    }
+    mFreeHeld.push_back(index);
+    if (output) {
+        output(held.mData.data(), held.mData.size(), held.mMsgCtrl, held.mSocket);
+    }
+}
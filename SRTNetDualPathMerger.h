@@ -0,0 +1,208 @@
+//
+// Seamless merge of two connections carrying the same stream over different network paths.
+//
+
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief Merges two connections carrying identical content, for example two SRT streams sent by one encoder over two
+ * networks, into one output stream in the spirit of SMPTE 2022-7. Unlike SRT bonding, the sender needs no support for
+ * socket groups, the paths are plain connections to two SRTNet clients or two sockets of an SRTNet server.
+ *
+ * Every message is identified by a sequence taken from its content, see transportStream and sequenceTag. The first
+ * copy of a message to arrive, from either path, is forwarded to the output callback and the second copy is dropped,
+ * so a message lost on one path is hidden as long as the other path delivers it. A message is remembered for the
+ * alignment window after its first copy arrived, which must be longer than the difference in delay of the two paths.
+ * A copy arriving later than that is forwarded again. A path delivering the same content twice delivers two messages,
+ * but repeated content is only told apart from a copy of the other path when that copy arrives in between, so the
+ * sequence must be unique within the alignment window. When a message leaves the window having arrived on one path
+ * only, the other path missed it and the path that delivered it counts it as repaired.
+ *
+ * Since a message repaired from the slower path arrives after later messages of the faster path, first copies are
+ * held back and forwarded in order. Messages are ordered by their sequence number when the sequence is one, like with
+ * sequenceTag, and otherwise by their arrival time less the extra delay of the path they arrived on, which is measured
+ * from the copies arriving on both paths. A message is forwarded once every path has delivered it or a later message,
+ * so with two healthy paths the output runs behind the faster path by the difference in delay, or at the latest when
+ * it leaves the alignment window. Held messages are forwarded from the calls to pushData, removePath and
+ * getPathStatistics, so a stream stopping on both paths is flushed by removing the paths.
+ *
+ * The merger is fed from the receivedDataNoCopy callbacks of the connections. A held message is copied, one that can
+ * be forwarded right away, like every message while there is only one path, is forwarded from the very same buffer.
+ * The output callback is called with the lock of the merger held, so that the messages from two reading threads leave
+ * in order, and must not call the merger.
+ *
+ *     client.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl,
+ *                                     std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+ *         merger.pushData(data, size, msgCtrl, socket);
+ *     };
+ */
+class SRTNetDualPathMerger {
+public:
+    struct PathStatistics {
+        SRTSOCKET mSocket = SRT_INVALID_SOCK;
+        uint64_t mReceivedMessages = 0;    // Messages received on this path
+        uint64_t mForwardedMessages = 0;   // Messages that arrived on this path first and were forwarded
+        uint64_t mDuplicateMessages = 0;   // Messages that arrived on the other path first and were dropped
+        uint64_t mRepairedMessages = 0;    // Forwarded messages the other path missed
+        uint64_t mMissedMessages = 0;      // Messages this path missed and the other path repaired
+        uint64_t mUnsequencedMessages = 0; // Messages dropped since no sequence could be taken from them
+    };
+
+    /**
+     * @brief Takes the sequence identifying a message from its content
+     * @return false if the message carries no sequence
+     */
+    using SequenceFunction = std::function<bool(const uint8_t* data, size_t size, uint64_t& sequence)>;
+
+    /**
+     * @brief How messages are identified and ordered
+     */
+    struct Sequence {
+        SequenceFunction mFunction;
+        size_t mBits = 0; // The size of an increasing, wrapping sequence number, 0 if the sequence is not ordered
+    };
+
+    /**
+     * @brief Identify messages of MPEG-TS packets by a hash over all their packets, which includes the continuity
+     * counters, so that the copies from both paths match without the sender tagging them. Messages of null packets only
+     * recur constantly in constant bitrate streams and can't be told apart, so they carry no sequence and are dropped.
+     */
+    static Sequence transportStream();
+
+    /**
+     * @brief Identify and order messages by a big endian sequence number the sender put in them, like the sequence
+     * number of an RTP header at offset 2 with 2 bytes.
+     * @param offset The offset of the sequence number in the message
+     * @param bytes The size of the sequence number, 1 to 8 bytes
+     */
+    static Sequence sequenceTag(size_t offset, size_t bytes = 4);
+
+    /**
+     * @brief Constructor
+     * @param sequence Identifies and orders the messages
+     * @param alignmentWindow How long a message is remembered after its first copy arrived, and held at most
+     * @param maxMessages The max number of messages remembered, and held, older messages leave the window early when
+     * full
+     */
+    explicit SRTNetDualPathMerger(Sequence sequence = transportStream(),
+                                  std::chrono::milliseconds alignmentWindow = std::chrono::milliseconds(100),
+                                  size_t maxMessages = 8192);
+
+    /**
+     * @brief Add a path to the merger.
+     * @param socket The socket of the connection
+     * @return false if the socket already is a path or there already are two paths
+     */
+    bool addPath(SRTSOCKET socket);
+
+    /**
+     * @brief Remove a path from the merger, for example from the clientDisconnected callback. The messages it already
+     * delivered are still remembered, so their copies from the other path are dropped, and held messages no longer
+     * wait for it.
+     * @param socket The socket of the connection
+     * @return false if the socket is not a path
+     */
+    bool removePath(SRTSOCKET socket);
+
+    /**
+     * @brief Feed a received message to the merger. If it is the first copy of the message it is forwarded to the
+     * output callback, in order with the other messages, before this function returns or from a later call.
+     * @param data pointer to the data
+     * @param size size of the data
+     * @param msgCtrl the SRT_MSGCTRL of the message
+     * @param socket the socket the message was received on
+     * @return true if the message was the first copy and is forwarded.
+     */
+    bool pushData(const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket);
+
+    /**
+     * @brief Get statistics for the paths. Messages still in the alignment window are not yet counted as repaired or
+     * missed.
+     */
+    std::vector<PathStatistics> getPathStatistics();
+
+    /// Callback receiving the merged stream
+    std::function<void(const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket)> output = nullptr;
+
+private:
+    static constexpr int32_t kNoEntry = -1;
+
+    struct Path {
+        bool mUsed = false;
+        PathStatistics mStatistics;
+        bool mDelivered = false; // Set once the path delivered a message, and mLastKey is valid
+        uint64_t mLastKey = 0;   // The order key of the last message the path delivered
+    };
+
+    // A message in the alignment window
+    struct Entry {
+        uint64_t mSequence = 0;
+        std::chrono::steady_clock::time_point mFirstArrival;
+        uint8_t mPaths = 0; // Bit set of the paths the message arrived on
+        int32_t mHeld = kNoEntry;
+    };
+
+    // A first copy held back to be forwarded in order, in a list sorted by order key
+    struct HeldMessage {
+        std::vector<uint8_t> mData;
+        SRT_MSGCTRL mMsgCtrl{};
+        SRTSOCKET mSocket = SRT_INVALID_SOCK;
+        uint64_t mKey = 0;
+        std::chrono::steady_clock::time_point mFirstArrival;
+        int32_t mEntry = kNoEntry;
+        int32_t mPrevious = kNoEntry;
+        int32_t mNext = kNoEntry;
+    };
+
+    Path* findPath(SRTSOCKET socket, size_t& index);
+    void leaveWindow(std::chrono::steady_clock::time_point now);
+    void countRepair(const Entry& entry);
+    void removeOldest();
+    size_t indexStart(uint64_t sequence) const;
+    int32_t findEntry(uint64_t sequence) const;
+
+    uint64_t orderKey(uint64_t sequence, size_t pathIndex, std::chrono::steady_clock::time_point now) const;
+    bool keyLess(uint64_t a, uint64_t b) const;
+    void measurePathDelay(const Entry& entry, size_t pathIndex, std::chrono::steady_clock::time_point now);
+    bool passedByAllPaths(uint64_t key) const;
+    void hold(const uint8_t* data,
+              size_t size,
+              const SRT_MSGCTRL& msgCtrl,
+              SRTSOCKET socket,
+              uint64_t key,
+              int32_t entry,
+              std::chrono::steady_clock::time_point now);
+    void releaseHeld(std::chrono::steady_clock::time_point now);
+    void releaseFirst();
+
+    const SequenceFunction mSequence;
+    // The bits compared when ordering by key, the sequence bits or 64 for arrival times
+    const size_t mKeyBits;
+    const bool mOrderedSequence;
+    const std::chrono::steady_clock::duration mAlignmentWindow;
+
+    std::mutex mMtx;
+    std::array<Path, 2> mPaths;
+    // The messages in the window, oldest first, in a ring of fixed size
+    std::vector<Entry> mEntries;
+    size_t mOldest = 0;
+    size_t mCount = 0;
+    // Open addressed index from the sequence of a message to its entry, twice the size of the ring
+    std::vector<int32_t> mIndex;
+    size_t mIndexMask = 0;
+    // The held messages, in a pool of the size of the ring
+    std::vector<HeldMessage> mHeld;
+    std::vector<int32_t> mFreeHeld;
+    int32_t mFirstHeld = kNoEntry;
+    int32_t mLastHeld = kNoEntry;
+    // Moving average of how much later (ns) the second path delivers a message than the first path
+    double mPathDelayDifference = 0.0;
+};
@@ -0,0 +1,381 @@
+//
+// Hot-standby SRT client that fails over between an ordered list of servers.
+//
+
+#include "SRTNetFailoverClient.h"
+
+#include <algorithm>
+
+#include "SRTNetInternal.h"
+
+SRTNetFailoverClient::SRTNetFailoverClient(const std::string& logPrefix) : mLogPrefix(logPrefix) {}
+
+SRTNetFailoverClient::~SRTNetFailoverClient() {
+    stop();
+}
+
+bool SRTNetFailoverClient::start(const std::vector<Server>& servers,
+                                 int reorder,
+                                 int32_t latency,
+                                 int overhead,
+                                 std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                 int mtu,
+                                 int32_t peerIdleTimeout,
+                                 const std::string& psk,
+                                 const std::string& streamId) {
+    std::unique_lock<std::mutex> lock(mMtx);
+    if (mActive) {
+        SRT_LOGGER(true, LOGG_ERROR, "Failover client is already started");
+        return false;
+    }
+    if (servers.empty()) {
+        SRT_LOGGER(true, LOGG_ERROR, "No servers to connect to");
+        return false;
+    }
+
+    mServers = servers;
+    mReorder = reorder;
+    mLatency = latency;
+    mOverhead = overhead;
+    mCtx = ctx;
+    mMtu = mtu;
+    mPeerIdleTimeout = peerIdleTimeout;
+    mPsk = psk;
+    mStreamId = streamId;
+    mPrimaryLost = false;
+    mSwitchoverPending = false;
+    mSwitchoverCount = 0;
+    mLastSwitchoverTime = std::chrono::microseconds(0);
+    mLivenessSocket = SRT_INVALID_SOCK;
+
+    // Try the servers in order, starting "after" the last one so that the first server in the list is tried first
+    lock.unlock();
+    size_t primaryIndex = 0;
+    std::unique_ptr<SRTNet> primary = connectToNextServer(mServers.size() - 1, primaryIndex);
+    lock.lock();
+    if (!primary) {
+        SRT_LOGGER(true, LOGG_ERROR, "Failed to connect to any of the " << mServers.size() << " servers");
+        return false;
+    }
+
+    mPrimary = std::move(primary);
+    mPrimaryIndex = primaryIndex;
+    mActive = true;
+    mWorkerThread = std::thread(&SRTNetFailoverClient::failoverWorker, this);
+    return true;
+}
+
+bool SRTNetFailoverClient::setLivenessTimeout(std::chrono::milliseconds timeout) {
+    std::lock_guard<std::mutex> lock(mMtx);
+    if (mActive) {
+        SRT_LOGGER(true, LOGG_ERROR, "The liveness timeout must be set before the failover client is started");
+        return false;
+    }
+    if (timeout.count() < 0) {
+        SRT_LOGGER(true, LOGG_ERROR, "The liveness timeout can't be negative");
+        return false;
+    }
+    mLivenessTimeout = timeout;
+    return true;
+}
+
+bool SRTNetFailoverClient::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        mActive = false;
+    }
+    mCondition.notify_one();
+    if (mWorkerThread.joinable()) {
+        mWorkerThread.join();
+    }
+
+    std::unique_ptr<SRTNet> primary;
+    std::unique_ptr<SRTNet> standby;
+    std::vector<std::unique_ptr<SRTNet>> retired;
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        primary = std::move(mPrimary);
+        standby = std::move(mStandby);
+        retired = std::move(mRetired);
+        mRetired.clear();
+    }
+
+    // Stop outside the lock, since the SRTNet worker threads may call back into this class while being joined
+    bool success = true;
+    for (auto* client : {&primary, &standby}) {
+        if (*client && !(*client)->stop()) {
+            success = false;
+        }
+    }
+    for (auto& client : retired) {
+        client->stop();
+    }
+    return success;
+}
+
+bool SRTNetFailoverClient::sendData(const uint8_t* data, size_t size, SRT_MSGCTRL* msgCtrl) {
+    std::unique_lock<std::mutex> lock(mMtx);
+    if (!mPrimary) {
+        return false;
+    }
+
+    if (mPrimary->sendData(data, size, msgCtrl)) {
+        if (!mSwitchoverPending) {
+            return true;
+        }
+        size_t fromIndex = mSwitchedFromIndex;
+        size_t toIndex = mPrimaryIndex;
+        std::chrono::microseconds switchoverTime = completeSwitchover();
+        lock.unlock();
+        if (switchedOver) {
+            switchedOver(fromIndex, toIndex, switchoverTime);
+        }
+        return true;
+    }
+
+    // A failed send on a socket that is still connected is not a connection loss (it could be a too large message),
+    // so only switch over if the primary connection is actually gone.
+    SRT_SOCKSTATUS state = srt_getsockstate(mPrimary->getBoundSocket());
+    if (mPrimary->isConnectedToServer() && state == SRTS_CONNECTED) {
+        return false;
+    }
+
+    SRT_LOGGER(true, LOGG_WARN, "Send to primary server failed, switching to standby");
+    if (!switchToStandby(std::chrono::steady_clock::now())) {
+        return false;
+    }
+    mCondition.notify_one();
+
+    if (!mPrimary->sendData(data, size, msgCtrl)) {
+        return false;
+    }
+    size_t fromIndex = mSwitchedFromIndex;
+    size_t toIndex = mPrimaryIndex;
+    std::chrono::microseconds switchoverTime = completeSwitchover();
+    lock.unlock();
+    if (switchedOver) {
+        switchedOver(fromIndex, toIndex, switchoverTime);
+    }
+    return true;
+}
+
+bool SRTNetFailoverClient::isConnected() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mPrimary && mPrimary->isConnectedToServer();
+}
+
+bool SRTNetFailoverClient::hasStandby() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mStandby && mStandby->isConnectedToServer();
+}
+
+size_t SRTNetFailoverClient::getPrimaryServerIndex() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mPrimaryIndex;
+}
+
+uint64_t SRTNetFailoverClient::getSwitchoverCount() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mSwitchoverCount;
+}
+
+std::chrono::microseconds SRTNetFailoverClient::getLastSwitchoverTime() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mLastSwitchoverTime;
+}
+
+std::unique_ptr<SRTNet> SRTNetFailoverClient::connectToServer(size_t serverIndex) {
+    const Server& server = mServers[serverIndex];
+    auto client = std::make_unique<SRTNet>(mLogPrefix);
+    SRTNet* clientPointer = client.get();
+
+    // Only install the callbacks that are set, SRTNet copies every message into a vector for receivedData
+    if (receivedData) {
+        client->receivedData = [this](std::unique_ptr<std::vector<uint8_t>>& data, SRT_MSGCTRL& msgCtrl,
+                                      std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+            receivedData(data, msgCtrl, ctx, socket);
+        };
+    }
+    if (receivedDataNoCopy) {
+        client->receivedDataNoCopy = [this](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl,
+                                            std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+            receivedDataNoCopy(data, size, msgCtrl, ctx, socket);
+        };
+    }
+    client->clientDisconnected = [this, clientPointer](std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                                       SRTSOCKET socket) {
+        {
+            std::lock_guard<std::mutex> lock(mMtx);
+            if (mPrimary.get() != clientPointer || mPrimaryLost) {
+                // A standby or an already retired connection, the worker thread checks the standby health
+                return;
+            }
+            mPrimaryLost = true;
+            mPrimaryLostTime = std::chrono::steady_clock::now();
+        }
+        mCondition.notify_one();
+    };
+
+    if (!client->startClient(server.mHost, server.mPort, mReorder, mLatency, mOverhead, mCtx, mMtu, true,
+                             mPeerIdleTimeout, mPsk, mStreamId)) {
+        SRT_LOGGER(true, LOGG_WARN, "Failed to connect to server " << serverIndex << " at " << server.mHost << ":"
+                                                                   << server.mPort);
+        return nullptr;
+    }
+    return client;
+}
+
+std::unique_ptr<SRTNet> SRTNetFailoverClient::connectToNextServer(size_t afterIndex, size_t& connectedIndex) {
+    size_t primaryIndex;
+    bool hasPrimary;
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        primaryIndex = mPrimaryIndex;
+        hasPrimary = mPrimary != nullptr;
+    }
+
+    for (size_t step = 1; step <= mServers.size(); ++step) {
+        size_t index = (afterIndex + step) % mServers.size();
+        if (hasPrimary && index == primaryIndex) {
+            continue;
+        }
+        std::unique_ptr<SRTNet> client = connectToServer(index);
+        if (client) {
+            connectedIndex = index;
+            return client;
+        }
+    }
+    return nullptr;
+}
+
+bool SRTNetFailoverClient::switchToStandby(std::chrono::steady_clock::time_point lossDetected) {
+    if (!mStandby || !mStandby->isConnectedToServer()) {
+        SRT_LOGGER(true, LOGG_ERROR, "Lost connection to primary server but there is no standby to switch to");
+        return false;
+    }
+
+    if (!mSwitchoverPending) {
+        mSwitchedFromIndex = mPrimaryIndex;
+        mSwitchoverStart = lossDetected;
+    }
+    mRetired.push_back(std::move(mPrimary));
+    mPrimary = std::move(mStandby);
+    mPrimaryIndex = mStandbyIndex;
+    mPrimaryLost = false;
+    mSwitchoverPending = true;
+    SRT_LOGGER(true, LOGG_NOTIFY, "Switched over from server " << mSwitchedFromIndex << " to server "
+                                                               << mPrimaryIndex);
+    return true;
+}
+
+std::chrono::microseconds SRTNetFailoverClient::completeSwitchover() {
+    mSwitchoverPending = false;
+    mSwitchoverCount++;
+    mLastSwitchoverTime = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() -
+                                                                                mSwitchoverStart);
+    return mLastSwitchoverTime;
+}
+
+void SRTNetFailoverClient::checkPrimaryLiveness(std::chrono::steady_clock::time_point now) {
+    if (!mPrimary || mPrimaryLost) {
+        return;
+    }
+    SRTSOCKET socket = mPrimary->getBoundSocket();
+    SRT_TRACEBSTATS stats;
+    if (socket == SRT_INVALID_SOCK || srt_bistats(socket, &stats, 0, 1) == SRT_ERROR) {
+        return;
+    }
+
+    // ACKs and data from the server show that the path works. Keepalives don't count as received packets, so an idle
+    // connection shows no progress, which is only a stall if there is sent data the server should have acknowledged.
+    int64_t received = stats.pktRecvTotal + stats.pktRecvACKTotal;
+    if (socket != mLivenessSocket || received != mLivenessReceived || stats.pktSentTotal == mLivenessSent) {
+        mLivenessSocket = socket;
+        mLivenessReceived = received;
+        mLivenessSent = stats.pktSentTotal;
+        mLivenessProgress = now;
+        return;
+    }
+
+    auto timeout = mLivenessTimeout + std::chrono::microseconds(static_cast<int64_t>(stats.msRTT * 1000.0));
+    if (now - mLivenessProgress < timeout) {
+        return;
+    }
+    // Without a standby the primary SRTNet is left to detect the loss and reconnect by itself
+    if (!mStandby || !mStandby->isConnectedToServer()) {
+        return;
+    }
+    auto stalled = std::chrono::duration_cast<std::chrono::milliseconds>(now - mLivenessProgress);
+    SRT_LOGGER(true, LOGG_WARN, "No ACK or data from primary server " << mPrimaryIndex << " for " << stalled.count()
+                                                                      << " ms, switching to standby");
+    mPrimaryLost = true;
+    mPrimaryLostTime = now;
+}
+
+void SRTNetFailoverClient::failoverWorker() {
+    // Wake up often enough to notice a stalled primary a fraction of the liveness timeout after it stalled
+    std::chrono::milliseconds waitInterval = kStandbyRetryInterval;
+    if (mLivenessTimeout.count() > 0) {
+        waitInterval = std::min(waitInterval, std::max(kMinLivenessCheckInterval, mLivenessTimeout / 4));
+    }
+    auto nextStandbyCheck = std::chrono::steady_clock::now() + kStandbyRetryInterval;
+
+    std::unique_lock<std::mutex> lock(mMtx);
+    while (mActive) {
+        bool woken = mCondition.wait_for(lock, waitInterval,
+                                         [&]() { return !mActive || mPrimaryLost || !mRetired.empty(); });
+        if (!mActive) {
+            break;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (mLivenessTimeout.count() > 0) {
+            checkPrimaryLiveness(now);
+        }
+        if (!woken && !mPrimaryLost && now < nextStandbyCheck) {
+            continue;
+        }
+        nextStandbyCheck = now + kStandbyRetryInterval;
+
+        if (mPrimaryLost) {
+            // If there is no standby the primary SRTNet keeps trying to reconnect to its server by itself
+            switchToStandby(mPrimaryLostTime);
+            mPrimaryLost = false;
+        }
+
+        // A standby that lost its own connection is replaced with a connection to the next server
+        if (mStandby && !mStandby->isConnectedToServer()) {
+            mRetired.push_back(std::move(mStandby));
+        }
+
+        std::vector<std::unique_ptr<SRTNet>> retired = std::move(mRetired);
+        mRetired.clear();
+        bool needStandby = !mStandby && mServers.size() > 1;
+        size_t afterIndex = mPrimaryIndex;
+
+        // Stopping and connecting may block for a while, so don't hold the lock while doing it
+        lock.unlock();
+        for (auto& client : retired) {
+            client->stop();
+        }
+        retired.clear();
+
+        std::unique_ptr<SRTNet> standby;
+        size_t standbyIndex = 0;
+        if (needStandby) {
+            standby = connectToNextServer(afterIndex, standbyIndex);
+        }
+        lock.lock();
+
+        if (standby) {
+            if (mStandby || standbyIndex == mPrimaryIndex) {
+                // The situation changed while connecting, let the next iteration sort it out
+                mRetired.push_back(std::move(standby));
+                continue;
+            }
+            mStandby = std::move(standby);
+            mStandbyIndex = standbyIndex;
+            SRT_LOGGER(true, LOGG_NOTIFY, "Standby connection established to server " << mStandbyIndex);
+        }
+    }
+}
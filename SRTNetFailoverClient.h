@@ -0,0 +1,242 @@
+//
+// Hot-standby SRT client that fails over between an ordered list of servers.
+//
+
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief An SRT client that sends to the first reachable server in an ordered list of servers, while keeping an idle,
+ * already handshaked standby connection to the next server in the list. When the connection to the primary server is
+ * lost, sending is switched over to the standby connection immediately, without waiting for the peer idle timeout and
+ * the reconnect loop of a single SRTNet client. A new standby connection is then established in the background.
+ *
+ * Loss of the primary connection is detected when the primary SRTNet reports that it got disconnected, when sendData
+ * fails on a primary socket that is no longer connected, in which case the message is re-sent on the standby connection
+ * within the same sendData call, or when the primary connection stalls. The worker thread polls the SRT statistics of
+ * the primary socket and considers the connection stalled when data was sent but neither an ACK nor any data arrived
+ * for the liveness timeout plus the round trip time, see setLivenessTimeout. That detects a silently broken path long
+ * before the peer idle timeout runs out.
+ */
+class SRTNetFailoverClient {
+public:
+    struct Server {
+        std::string mHost;
+        uint16_t mPort;
+    };
+
+    /**
+     * @brief Constructor that can set a log prefix which will be added to the start of all log messages from this
+     * client and the SRTNet instances it creates.
+     * @param logPrefix The prefix to add to all log messages created by this client
+     */
+    explicit SRTNetFailoverClient(const std::string& logPrefix = "");
+
+    virtual ~SRTNetFailoverClient();
+
+    /**
+     *
+     * Connects to the first reachable server in \p servers and starts establishing a standby connection to the next
+     * server in the list.
+     *
+     * @param servers Ordered list of servers, the first reachable server becomes the primary server
+     * @param reorder number of packets in re-order window
+     * @param latency Max re-send window (ms) / also the delay of transmission
+     * @param overhead % extra of the BW that will be allowed for re-transmission packets
+     * @param ctx the context used in the receivedData and receivedDataNoCopy callback
+     * @param mtu sets the MTU
+     * @param peerIdleTimeout Optional Connection considered broken if no packet received before this timeout.
+     * Defaults to 5 seconds.
+     * @param psk Optional Pre Shared Key (AES-128)
+     * @param streamId Optional Stream ID
+     * @return true if a connection to one of the servers could be made, false otherwise.
+     */
+    bool start(const std::vector<Server>& servers,
+               int reorder,
+               int32_t latency,
+               int overhead,
+               std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+               int mtu,
+               int32_t peerIdleTimeout = 5000,
+               const std::string& psk = "",
+               const std::string& streamId = "");
+
+    /**
+     *
+     * Set how long the primary connection may go without an ACK or data from its server, while there is sent data to
+     * acknowledge, before it is considered lost and sending is switched over to the standby connection. The round trip
+     * time of the connection is added to the timeout. Must be called before start.
+     *
+     * @param timeout The liveness timeout, 0 to only detect the loss of the primary connection by disconnection.
+     * Defaults to 500 ms.
+     * @return true if the timeout was accepted.
+     */
+    bool setLivenessTimeout(std::chrono::milliseconds timeout);
+
+    /**
+     *
+     * Stops the primary and standby connections
+     *
+     * @return true if the client stopped successfully.
+     */
+    bool stop();
+
+    /**
+     *
+     * Send data to the primary server, switching over to the standby server if the primary connection is lost.
+     *
+     * @param data pointer to the data
+     * @param size size of the data
+     * @param msgCtrl pointer to a SRT_MSGCTRL struct.
+     * @return true if the data was sent to either the primary or the standby server.
+     */
+    bool sendData(const uint8_t* data, size_t size, SRT_MSGCTRL* msgCtrl);
+
+    /**
+     * @brief Check if the primary connection is connected
+     * @return True if the primary connection is connected to its server
+     */
+    bool isConnected() const;
+
+    /**
+     * @brief Check if there is a standby connection ready to take over
+     * @return True if the standby connection is connected to its server
+     */
+    bool hasStandby() const;
+
+    /**
+     * @brief Get the index in the server list of the server that data is currently sent to
+     * @return The index of the primary server
+     */
+    size_t getPrimaryServerIndex() const;
+
+    /**
+     * @brief Get the number of switchovers from a lost primary to the standby connection since start
+     * @return The number of switchovers
+     */
+    uint64_t getSwitchoverCount() const;
+
+    /**
+     * @brief Get the duration of the last switchover, measured from when the loss of the primary connection was
+     * detected until the first message was successfully sent on the new primary connection.
+     * @return The duration of the last switchover, zero if no switchover has been made
+     */
+    std::chrono::microseconds getLastSwitchoverTime() const;
+
+    /// Callback receiving data type vector from the primary or standby server
+    std::function<void(std::unique_ptr<std::vector<uint8_t>>& data,
+                       SRT_MSGCTRL& msgCtrl,
+                       std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                       SRTSOCKET socket)>
+        receivedData = nullptr;
+
+    /// Callback receiving data no copy from the primary or standby server
+    std::function<void(const uint8_t* data,
+                       size_t size,
+                       SRT_MSGCTRL& msgCtrl,
+                       std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                       SRTSOCKET socket)>
+        receivedDataNoCopy = nullptr;
+
+    /// Callback called when sending has been switched over to the standby server and the first message was sent on it
+    std::function<void(size_t fromServerIndex, size_t toServerIndex, std::chrono::microseconds switchoverTime)>
+        switchedOver = nullptr;
+
+    // delete copy and move constructors and assign operators
+    SRTNetFailoverClient(SRTNetFailoverClient const&) = delete;            // Copy construct
+    SRTNetFailoverClient(SRTNetFailoverClient&&) = delete;                 // Move construct
+    SRTNetFailoverClient& operator=(SRTNetFailoverClient const&) = delete; // Copy assign
+    SRTNetFailoverClient& operator=(SRTNetFailoverClient&&) = delete;      // Move assign
+
+private:
+    /**
+     * @brief Create an SRTNet client connected to the server at \p serverIndex.
+     * @return The connected client, or nullptr if the server could not be reached.
+     */
+    std::unique_ptr<SRTNet> connectToServer(size_t serverIndex);
+
+    /**
+     * @brief Try the servers after \p afterIndex in list order, skipping the primary server, until one of them
+     * accepts the connection.
+     * @param connectedIndex set to the index of the server connected to
+     * @return The connected client, or nullptr if no server could be reached.
+     */
+    std::unique_ptr<SRTNet> connectToNextServer(size_t afterIndex, size_t& connectedIndex);
+
+    /**
+     * @brief Make the standby connection the primary one and retire the old primary connection. Must be called with
+     * mMtx held.
+     * @param lossDetected The time when the loss of the primary connection was detected
+     * @return true if there was a connected standby to switch over to, false otherwise.
+     */
+    bool switchToStandby(std::chrono::steady_clock::time_point lossDetected);
+
+    /**
+     * @brief Record a completed switchover after the first successful send on the new primary. Must be called with
+     * mMtx held.
+     * @return The duration of the switchover
+     */
+    std::chrono::microseconds completeSwitchover();
+
+    /**
+     * @brief Check the SRT statistics of the primary connection for progress and mark it lost if it stalled. Must be
+     * called with mMtx held.
+     */
+    void checkPrimaryLiveness(std::chrono::steady_clock::time_point now);
+
+    /**
+     * @brief Worker thread that performs switchovers reported by the primary SRTNet, stops retired connections and
+     * (re-)establishes the standby connection.
+     */
+    void failoverWorker();
+
+    const std::string mLogPrefix;
+
+    std::vector<Server> mServers;
+    int mReorder = 0;
+    int32_t mLatency = 0;
+    int mOverhead = 0;
+    int mMtu = 0;
+    int32_t mPeerIdleTimeout = 0;
+    std::string mPsk;
+    std::string mStreamId;
+    std::shared_ptr<SRTNet::NetworkConnection> mCtx;
+
+    mutable std::mutex mMtx;
+    std::condition_variable mCondition;
+    bool mActive = false;
+    std::unique_ptr<SRTNet> mPrimary;
+    size_t mPrimaryIndex = 0;
+    std::unique_ptr<SRTNet> mStandby;
+    size_t mStandbyIndex = 0;
+    // Connections that have been replaced and are waiting to be stopped by the worker thread
+    std::vector<std::unique_ptr<SRTNet>> mRetired;
+    bool mPrimaryLost = false;
+    std::chrono::steady_clock::time_point mPrimaryLostTime;
+    bool mSwitchoverPending = false;
+    size_t mSwitchedFromIndex = 0;
+    std::chrono::steady_clock::time_point mSwitchoverStart;
+    uint64_t mSwitchoverCount = 0;
+    std::chrono::microseconds mLastSwitchoverTime{0};
+    std::chrono::milliseconds mLivenessTimeout{500};
+    // The primary socket the liveness counters belong to, and its packet counters at the last progress
+    SRTSOCKET mLivenessSocket = SRT_INVALID_SOCK;
+    int64_t mLivenessReceived = 0;
+    int64_t mLivenessSent = 0;
+    std::chrono::steady_clock::time_point mLivenessProgress;
+
+    std::thread mWorkerThread;
+
+    const std::chrono::milliseconds kStandbyRetryInterval{1000};
+    const std::chrono::milliseconds kMinLivenessCheckInterval{5};
+};
@@ -0,0 +1,143 @@
+//
+// Aggregate statistics queries over all connections of an SRTNet instance.
+//
+
+#include "SRTNetFleetStatistics.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+
+struct MetricDescriptor {
+    const char* mName;
+    double (*mGetter)(const SRT_TRACEBSTATS&);
+};
+
+// In the same order as SRTNetFleetStatistics::Metric
+const MetricDescriptor kMetrics[] = {
+    {"mbpsSendRate", [](const SRT_TRACEBSTATS& s) -> double { return s.mbpsSendRate; }},
+    {"mbpsRecvRate", [](const SRT_TRACEBSTATS& s) -> double { return s.mbpsRecvRate; }},
+    {"mbpsBandwidth", [](const SRT_TRACEBSTATS& s) -> double { return s.mbpsBandwidth; }},
+    {"msRTT", [](const SRT_TRACEBSTATS& s) -> double { return s.msRTT; }},
+    {"pktSentTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktSentTotal; }},
+    {"pktRecvTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktRecvTotal; }},
+    {"pktSndLossTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktSndLossTotal; }},
+    {"pktRcvLossTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktRcvLossTotal; }},
+    {"pktRetransTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktRetransTotal; }},
+    {"pktSndDropTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktSndDropTotal; }},
+    {"pktRcvDropTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.pktRcvDropTotal; }},
+    {"byteSentTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.byteSentTotal; }},
+    {"byteRecvTotal", [](const SRT_TRACEBSTATS& s) -> double { return s.byteRecvTotal; }},
+    {"pktFlightSize", [](const SRT_TRACEBSTATS& s) -> double { return s.pktFlightSize; }},
+    {"msSndBuf", [](const SRT_TRACEBSTATS& s) -> double { return s.msSndBuf; }},
+    {"msRcvBuf", [](const SRT_TRACEBSTATS& s) -> double { return s.msRcvBuf; }},
+};
+static_assert(sizeof(kMetrics) / sizeof(kMetrics[0]) == SRTNetFleetStatistics::kMetricCount,
+              "Every metric needs a descriptor");
+
+} // namespace
+
+const char* SRTNetFleetStatistics::metricName(Metric metric) {
+    return metric < Metric::count ? kMetrics[static_cast<size_t>(metric)].mName : "";
+}
+
+size_t SRTNetFleetStatistics::update(const SRTNet& net, bool instantaneous) {
+    clear();
+    if (net.getCurrentMode() == SRTNet::Mode::client) {
+        mActiveSockets.clear();
+        if (net.isConnectedToServer()) {
+            mActiveSockets.push_back(net.getBoundSocket());
+        }
+    } else {
+        net.getActiveClientSockets(mActiveSockets);
+    }
+
+    SRT_TRACEBSTATS stats;
+    for (SRTSOCKET socket : mActiveSockets) {
+        // The client may disconnect after the list was taken, it is then left out of the snapshot
+        if (srt_bistats(socket, &stats, 0, instantaneous ? 1 : 0) != SRT_ERROR) {
+            add(socket, stats);
+        }
+    }
+    return size();
+}
+
+void SRTNetFleetStatistics::clear() {
+    mSockets.clear();
+    for (auto& column : mColumns) {
+        column.clear();
+    }
+}
+
+void SRTNetFleetStatistics::add(SRTSOCKET socket, const SRT_TRACEBSTATS& stats) {
+    mSockets.push_back(socket);
+    for (size_t metric = 0; metric < kMetricCount; ++metric) {
+        mColumns[metric].push_back(kMetrics[metric].mGetter(stats));
+    }
+}
+
+double SRTNetFleetStatistics::sum(Metric metric) const {
+    const std::vector<double>& column = getColumn(metric);
+    const double* values = column.data();
+    const size_t count = column.size();
+
+    // Independent accumulators, the compiler may not reorder a single floating point sum into vector lanes by itself
+    double lanes[8] = {};
+    size_t i = 0;
+    for (; i + 8 <= count; i += 8) {
+        for (size_t lane = 0; lane < 8; ++lane) {
+            lanes[lane] += values[i + lane];
+        }
+    }
+    double total = 0;
+    for (; i < count; ++i) {
+        total += values[i];
+    }
+    for (double lane : lanes) {
+        total += lane;
+    }
+    return total;
+}
+
+double SRTNetFleetStatistics::mean(Metric metric) const {
+    return size() == 0 ? 0 : sum(metric) / static_cast<double>(size());
+}
+
+double SRTNetFleetStatistics::percentile(Metric metric, double percent) const {
+    if (size() == 0) {
+        return 0;
+    }
+    const std::vector<double>& column = getColumn(metric);
+    mScratchValues.assign(column.begin(), column.end());
+    percent = std::clamp(percent, 0.0, 100.0);
+    size_t rank = static_cast<size_t>(std::ceil(percent / 100.0 * static_cast<double>(size())));
+    size_t index = rank == 0 ? 0 : rank - 1;
+    std::nth_element(mScratchValues.begin(), mScratchValues.begin() + index, mScratchValues.end());
+    return mScratchValues[index];
+}
+
+void SRTNetFleetStatistics::topN(Metric metric,
+                                 size_t n,
+                                 std::vector<std::pair<SRTSOCKET, double>>& result,
+                                 bool highest) const {
+    result.clear();
+    n = std::min(n, size());
+    if (n == 0) {
+        return;
+    }
+    const std::vector<double>& column = getColumn(metric);
+    mScratchIndices.resize(size());
+    for (uint32_t i = 0; i < mScratchIndices.size(); ++i) {
+        mScratchIndices[i] = i;
+    }
+    auto before = [&](uint32_t a, uint32_t b) {
+        return highest ? column[a] > column[b] : column[a] < column[b];
+    };
+    // Select the n most extreme in linear time, then only sort those
+    std::nth_element(mScratchIndices.begin(), mScratchIndices.begin() + (n - 1), mScratchIndices.end(), before);
+    std::sort(mScratchIndices.begin(), mScratchIndices.begin() + n, before);
+    for (size_t i = 0; i < n; ++i) {
+        result.emplace_back(mSockets[mScratchIndices[i]], column[mScratchIndices[i]]);
+    }
+}
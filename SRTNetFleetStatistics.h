@@ -0,0 +1,123 @@
+//
+// Aggregate statistics queries over all connections of an SRTNet instance.
+//
+
+#pragma once
+
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief A snapshot of the statistics of many connections, stored as one array per metric (structure of arrays), so
+ * that the aggregate queries only touch the memory of the metric they are about and reduce it with vectorised loops.
+ *
+ * Taking a snapshot does not hold the SRTNet mutex used by getStatistics, and once the snapshot has grown to the
+ * number of connections, neither updates nor queries allocate memory. The object itself is not thread safe, update and
+ * query it from one thread, or guard it with a mutex.
+ */
+class SRTNetFleetStatistics {
+public:
+    enum class Metric : size_t {
+        mbpsSendRate,
+        mbpsRecvRate,
+        mbpsBandwidth,
+        msRTT,
+        pktSentTotal,
+        pktRecvTotal,
+        pktSndLossTotal,
+        pktRcvLossTotal,
+        pktRetransTotal,
+        pktSndDropTotal,
+        pktRcvDropTotal,
+        byteSentTotal,
+        byteRecvTotal,
+        pktFlightSize,
+        msSndBuf,
+        msRcvBuf,
+        count
+    };
+
+    static constexpr size_t kMetricCount = static_cast<size_t>(Metric::count);
+
+    /**
+     * @return The name of the metric, the same as the SRT_TRACEBSTATS member it is taken from
+     */
+    static const char* metricName(Metric metric);
+
+    SRTNetFleetStatistics() = default;
+
+    /**
+     * @brief Replace the snapshot with the current statistics of all connections of \p net. In server mode these are
+     * all active clients, in client mode the connection to the server.
+     * @param instantaneous Passed on to srt_bistats, see SRTNet::getStatistics
+     * @return The number of connections in the snapshot
+     */
+    size_t update(const SRTNet& net, bool instantaneous = true);
+
+    /**
+     * @brief Empty the snapshot, keeping the memory
+     */
+    void clear();
+
+    /**
+     * @brief Add the statistics of one connection to the snapshot
+     */
+    void add(SRTSOCKET socket, const SRT_TRACEBSTATS& stats);
+
+    /**
+     * @return The number of connections in the snapshot
+     */
+    size_t size() const {
+        return mSockets.size();
+    }
+
+    /**
+     * @return The sockets of the snapshot, the index of a socket is its index in every column
+     */
+    const std::vector<SRTSOCKET>& getSockets() const {
+        return mSockets;
+    }
+
+    /**
+     * @return The values of one metric for all connections of the snapshot
+     */
+    const std::vector<double>& getColumn(Metric metric) const {
+        return mColumns[static_cast<size_t>(metric)];
+    }
+
+    /**
+     * @return The sum of the metric over all connections, 0 for an empty snapshot
+     */
+    double sum(Metric metric) const;
+
+    /**
+     * @return The mean of the metric over all connections, 0 for an empty snapshot
+     */
+    double mean(Metric metric) const;
+
+    /**
+     * @brief The percentile of the metric using the nearest rank method, for example 95 for the p95 RTT
+     * @param percent Between 0 and 100
+     * @return The percentile, 0 for an empty snapshot
+     */
+    double percentile(Metric metric, double percent) const;
+
+    /**
+     * @brief The connections with the highest (or lowest) value of the metric
+     * @param result Cleared and filled with at most \p n socket and value pairs, the most extreme first
+     * @param highest true for the highest values, false for the lowest
+     */
+    void topN(Metric metric, size_t n, std::vector<std::pair<SRTSOCKET, double>>& result, bool highest = true) const;
+
+private:
+    std::vector<SRTSOCKET> mSockets;
+    std::vector<double> mColumns[kMetricCount];
+
+    // Reused by update and the queries, so they don't allocate once the snapshot has grown
+    std::vector<SRTSOCKET> mActiveSockets;
+    mutable std::vector<double> mScratchValues;
+    mutable std::vector<uint32_t> mScratchIndices;
+};
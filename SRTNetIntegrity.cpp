@@ -0,0 +1,230 @@
+//
+// Payload integrity and sequence gap checking for load tests.
+//
+
+#include "SRTNetIntegrity.h"
+
+#include <cstring>
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define SRTNET_CRC32C_SSE42
+#include <nmmintrin.h>
+#endif
+
+namespace {
+
+// Slicing by 8 tables for the reflected Castagnoli polynomial
+struct Crc32cTables {
+    uint32_t mTable[8][256];
+
+    Crc32cTables() {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t crc = i;
+            for (int bit = 0; bit < 8; ++bit) {
+                crc = (crc >> 1) ^ (0x82F63B78u & (0u - (crc & 1u)));
+            }
+            mTable[0][i] = crc;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int slice = 1; slice < 8; ++slice) {
+                mTable[slice][i] = (mTable[slice - 1][i] >> 8) ^ mTable[0][mTable[slice - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+const Crc32cTables& crc32cTables() {
+    static const Crc32cTables tables;
+    return tables;
+}
+
+#ifdef SRTNET_CRC32C_SSE42
+__attribute__((target("sse4.2"))) uint32_t crc32cHardware(const uint8_t* data, size_t size, uint32_t crc) {
+    uint64_t state = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint64_t value;
+        memcpy(&value, data, sizeof(value));
+        state = _mm_crc32_u64(state, value);
+    }
+    uint32_t state32 = static_cast<uint32_t>(state);
+    for (; size > 0; --size, ++data) {
+        state32 = _mm_crc32_u8(state32, *data);
+    }
+    return ~state32;
+}
+
+const bool kHasSse42 = __builtin_cpu_supports("sse4.2");
+#else
+const bool kHasSse42 = false;
+#endif
+
+// Pseudo random filler, so corruption of the payload is not hidden by a repeating pattern
+uint64_t nextFiller(uint64_t& state) {
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+struct MessageHeader {
+    uint32_t mCrc;
+    uint32_t mMagic;
+    uint32_t mSize;
+    uint32_t mReserved;
+    uint64_t mSequenceNumber;
+};
+static_assert(sizeof(MessageHeader) == SRTNetIntegritySender::kHeaderSize, "Unexpected header padding");
+
+} // namespace
+
+uint32_t SRTNetCrc32c::compute(const uint8_t* data, size_t size, uint32_t crc) {
+#ifdef SRTNET_CRC32C_SSE42
+    if (kHasSse42) {
+        return crc32cHardware(data, size, crc);
+    }
+#endif
+    return computeSoftware(data, size, crc);
+}
+
+uint32_t SRTNetCrc32c::computeSoftware(const uint8_t* data, size_t size, uint32_t crc) {
+    const auto& table = crc32cTables().mTable;
+    crc = ~crc;
+    for (; size >= 8; size -= 8, data += 8) {
+        uint32_t low;
+        uint32_t high;
+        memcpy(&low, data, sizeof(low));
+        memcpy(&high, data + 4, sizeof(high));
+        low ^= crc;
+        crc = table[7][low & 0xFF] ^ table[6][(low >> 8) & 0xFF] ^ table[5][(low >> 16) & 0xFF] ^ table[4][low >> 24] ^
+              table[3][high & 0xFF] ^ table[2][(high >> 8) & 0xFF] ^ table[1][(high >> 16) & 0xFF] ^
+              table[0][high >> 24];
+    }
+    for (; size > 0; --size, ++data) {
+        crc = (crc >> 8) ^ table[0][(crc ^ *data) & 0xFF];
+    }
+    return ~crc;
+}
+
+bool SRTNetCrc32c::hasHardwareSupport() {
+    return kHasSse42;
+}
+
+bool SRTNetIntegritySender::generate(uint8_t* buffer, size_t size) {
+    if (size < kHeaderSize) {
+        return false;
+    }
+    MessageHeader header{};
+    header.mMagic = kMagic;
+    header.mSize = static_cast<uint32_t>(size);
+    header.mSequenceNumber = mNextSequenceNumber++;
+
+    uint64_t state = header.mSequenceNumber * 0x9E3779B97F4A7C15ull + 1;
+    size_t offset = kHeaderSize;
+    for (; offset + 8 <= size; offset += 8) {
+        uint64_t value = nextFiller(state);
+        memcpy(buffer + offset, &value, sizeof(value));
+    }
+    uint64_t value = nextFiller(state);
+    memcpy(buffer + offset, &value, size - offset);
+
+    memcpy(buffer, &header, sizeof(header));
+    header.mCrc = SRTNetCrc32c::compute(buffer + sizeof(header.mCrc), size - sizeof(header.mCrc));
+    memcpy(buffer, &header.mCrc, sizeof(header.mCrc));
+    return true;
+}
+
+bool SRTNetIntegritySender::send(SRTNet& net, size_t size, SRTSOCKET targetSystem) {
+    uint8_t buffer[2048];
+    if (size > sizeof(buffer) || !generate(buffer, size)) {
+        return false;
+    }
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    return net.sendData(buffer, size, &msgCtrl, targetSystem);
+}
+
+bool SRTNetIntegrityReceiver::check(const uint8_t* data, size_t size) {
+    mMessages.fetch_add(1, std::memory_order_relaxed);
+    mBytes.fetch_add(size, std::memory_order_relaxed);
+
+    MessageHeader header;
+    if (size < sizeof(header)) {
+        mCorrupted.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    memcpy(&header, data, sizeof(header));
+    if (header.mMagic != SRTNetIntegritySender::kMagic || header.mSize != size ||
+        header.mCrc != SRTNetCrc32c::compute(data + sizeof(header.mCrc), size - sizeof(header.mCrc))) {
+        mCorrupted.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    if (!markSeen(header.mSequenceNumber)) {
+        return false;
+    }
+    mUnique.fetch_add(1, std::memory_order_relaxed);
+    mExpected.store(mHighestSequenceNumber - mFirstSequenceNumber + 1, std::memory_order_relaxed);
+    return true;
+}
+
+bool SRTNetIntegrityReceiver::markSeen(uint64_t sequenceNumber) {
+    auto bit = [&](uint64_t sequence) -> uint64_t& { return mSeen[(sequence % kWindowSize) / 64]; };
+    auto mask = [](uint64_t sequence) { return uint64_t(1) << (sequence % 64); };
+
+    if (!mStarted) {
+        mStarted = true;
+        mFirstSequenceNumber = sequenceNumber;
+        mHighestSequenceNumber = sequenceNumber;
+        bit(sequenceNumber) |= mask(sequenceNumber);
+        return true;
+    }
+
+    if (sequenceNumber > mHighestSequenceNumber) {
+        uint64_t advance = sequenceNumber - mHighestSequenceNumber;
+        if (advance > 1) {
+            mGaps.fetch_add(1, std::memory_order_relaxed);
+        }
+        // Forget the sequence numbers that fall out of the window
+        if (advance >= kWindowSize) {
+            memset(mSeen, 0, sizeof(mSeen));
+        } else {
+            for (uint64_t sequence = mHighestSequenceNumber + 1; sequence <= sequenceNumber; ++sequence) {
+                bit(sequence) &= ~mask(sequence);
+            }
+        }
+        mHighestSequenceNumber = sequenceNumber;
+        bit(sequenceNumber) |= mask(sequenceNumber);
+        return true;
+    }
+
+    if (mHighestSequenceNumber - sequenceNumber >= kWindowSize || (bit(sequenceNumber) & mask(sequenceNumber))) {
+        mDuplicates.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    bit(sequenceNumber) |= mask(sequenceNumber);
+    mReordered.fetch_add(1, std::memory_order_relaxed);
+    if (sequenceNumber < mFirstSequenceNumber) {
+        mFirstSequenceNumber = sequenceNumber;
+    }
+    return true;
+}
+
+SRTNetIntegrityReceiver::Report SRTNetIntegrityReceiver::getReport() const {
+    Report report;
+    report.mMessages = mMessages.load(std::memory_order_relaxed);
+    report.mBytes = mBytes.load(std::memory_order_relaxed);
+    uint64_t unique = mUnique.load(std::memory_order_relaxed);
+    uint64_t expected = mExpected.load(std::memory_order_relaxed);
+    report.mMissing = expected > unique ? expected - unique : 0;
+    report.mGaps = mGaps.load(std::memory_order_relaxed);
+    report.mReordered = mReordered.load(std::memory_order_relaxed);
+    report.mDuplicates = mDuplicates.load(std::memory_order_relaxed);
+    report.mCorrupted = mCorrupted.load(std::memory_order_relaxed);
+    return report;
+}
+
+void SRTNetIntegrityReceiver::writeReport(std::ostream& stream, const Report& report) {
+    stream << "integrity: " << (report.isClean() ? "OK" : "FAILED") << " messages=" << report.mMessages
+           << " bytes=" << report.mBytes << " missing=" << report.mMissing << " gaps=" << report.mGaps
+           << " reordered=" << report.mReordered << " duplicates=" << report.mDuplicates
+           << " corrupted=" << report.mCorrupted;
+}
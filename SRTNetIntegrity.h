@@ -0,0 +1,128 @@
+//
+// Payload integrity and sequence gap checking for load tests.
+//
+
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <ostream>
+
+#include "SRTNet.h"
+
+/**
+ * @brief CRC32C (Castagnoli), computed with the SSE4.2 crc32 instruction when the CPU has it, and with a table driven
+ * implementation otherwise.
+ */
+class SRTNetCrc32c {
+public:
+    /**
+     * @param crc The CRC of the preceding data when computing the CRC of data in pieces, 0 otherwise
+     */
+    static uint32_t compute(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+    /**
+     * @brief The table driven implementation, always available
+     */
+    static uint32_t computeSoftware(const uint8_t* data, size_t size, uint32_t crc = 0);
+
+    /**
+     * @return true if compute uses the SSE4.2 crc32 instruction
+     */
+    static bool hasHardwareSupport();
+};
+
+/**
+ * @brief Generates test payloads carrying a sequence number and a CRC32C of the whole message. A message is laid out as
+ * [crc32c][magic][size][reserved][sequence number][pseudo random filler], all in host byte order, where the CRC covers
+ * everything after itself.
+ */
+class SRTNetIntegritySender {
+public:
+    static constexpr size_t kHeaderSize = 24;
+    static constexpr uint32_t kMagic = 0x43494E53; // "SNIC"
+
+    /**
+     * @brief Fill \p buffer with the next test message
+     * @param size The size of the message, at least kHeaderSize
+     * @return false if size is too small
+     */
+    bool generate(uint8_t* buffer, size_t size);
+
+    /**
+     * @brief Generate the next test message and send it with SRTNet::sendData
+     * @param size The size of the message, between kHeaderSize and the maximum payload size of SRT
+     * @return false if the message could not be generated or sent. The sequence number is consumed anyway, so a
+     * failed send shows up as a gap at the receiver.
+     */
+    bool send(SRTNet& net, size_t size, SRTSOCKET targetSystem = 0);
+
+    /**
+     * @return The sequence number of the next message
+     */
+    uint64_t getNextSequenceNumber() const {
+        return mNextSequenceNumber;
+    }
+
+private:
+    uint64_t mNextSequenceNumber = 0;
+};
+
+/**
+ * @brief Verifies messages generated by SRTNetIntegritySender, meant to be called from receivedDataNoCopy. Keeps
+ * track of the messages seen within the last kWindowSize sequence numbers, to tell late (reordered) messages from
+ * duplicates. Messages more than kWindowSize behind the newest message can't be told apart and count as duplicates.
+ *
+ * check must be called from one thread at a time, the report can be read from any thread.
+ */
+class SRTNetIntegrityReceiver {
+public:
+    static constexpr uint64_t kWindowSize = 4096;
+
+    struct Report {
+        uint64_t mMessages = 0;   // Messages checked, including bad ones
+        uint64_t mBytes = 0;      // Bytes checked, including bad messages
+        uint64_t mMissing = 0;    // Messages not (yet) received, sequence numbers skipped and not filled in later
+        uint64_t mGaps = 0;       // Number of times the sequence number jumped forward by more than one
+        uint64_t mReordered = 0;  // Messages received after a message with a higher sequence number
+        uint64_t mDuplicates = 0; // Messages received more than once
+        uint64_t mCorrupted = 0;  // Messages with a bad header or CRC
+
+        bool isClean() const {
+            return mMissing == 0 && mReordered == 0 && mDuplicates == 0 && mCorrupted == 0;
+        }
+    };
+
+    /**
+     * @brief Check one received message
+     * @return true if the message is intact and was received for the first time
+     */
+    bool check(const uint8_t* data, size_t size);
+
+    /**
+     * @return A copy of the counters
+     */
+    Report getReport() const;
+
+    /**
+     * @brief Write the report as one line of key=value pairs, in the format of the benchmark output
+     */
+    static void writeReport(std::ostream& stream, const Report& report);
+
+private:
+    bool markSeen(uint64_t sequenceNumber);
+
+    bool mStarted = false;
+    uint64_t mHighestSequenceNumber = 0;
+    uint64_t mFirstSequenceNumber = 0;
+    uint64_t mSeen[kWindowSize / 64] = {};
+
+    std::atomic<uint64_t> mMessages{0};
+    std::atomic<uint64_t> mBytes{0};
+    std::atomic<uint64_t> mUnique{0};
+    std::atomic<uint64_t> mExpected{0};
+    std::atomic<uint64_t> mGaps{0};
+    std::atomic<uint64_t> mReordered{0};
+    std::atomic<uint64_t> mDuplicates{0};
+    std::atomic<uint64_t> mCorrupted{0};
+};
@@ -18,7 +18,7 @@
 #ifdef DEBUG
 #define SRT_LOGGER(l,g,f) \
 { \
-  if (g <= gLogLevel) { \
+  if (g <= SRTNet::gLogLevel) { \
     std::ostringstream a; \
     if (SRTNet::gLogHandler == SRTNet::defaultLogHandler) { \
       if (g == LOG_DEBUG) {a << "Debug: ";} \
@@ -0,0 +1,351 @@
+//
+// Declarative graph of processing stages between receiving and sending with SRTNet.
+//
+
+#include "SRTNetPipeline.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace {
+// Times a waiting thread yields before it goes to sleep on the condition variable
+constexpr int kSpinsBeforeSleep = 64;
+// Max time a waiting thread sleeps before checking the ring again
+constexpr std::chrono::milliseconds kMaxSleep(1);
+
+bool pinCurrentThread(int cpu) {
+#ifdef __linux__
+    cpu_set_t cpuSet;
+    CPU_ZERO(&cpuSet);
+    CPU_SET(cpu, &cpuSet);
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpuSet), &cpuSet) == 0;
+#else
+    return false;
+#endif
+}
+} // namespace
+
+SRTNetPipeline::Ring::Ring(size_t slots, size_t maxMessageSize)
+    : mStorage(std::max<size_t>(slots, 1) * maxMessageSize)
+    , mSlots(std::max<size_t>(slots, 1)) {
+    for (size_t i = 0; i < mSlots.size(); ++i) {
+        mSlots[i].mData = &mStorage[i * maxMessageSize];
+        mSlots[i].mCapacity = maxMessageSize;
+    }
+}
+
+bool SRTNetPipeline::Ring::push(const Message& message, bool& waited) {
+    const uint64_t tail = mTail.load(std::memory_order_relaxed);
+    auto hasRoom = [&]() { return tail - mHead.load() < mSlots.size(); };
+    for (int spins = 0; !hasRoom(); ++spins) {
+        if (mClosed) {
+            return false;
+        }
+        waited = true;
+        if (spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        // The consumer either sees mProducerWaiting set after it moved the head, or the head is seen moved here
+        std::unique_lock<std::mutex> lock(mWaitMtx);
+        mProducerWaiting = true;
+        mWaitCondition.wait_for(lock, kMaxSleep, [&]() { return hasRoom() || mClosed; });
+        mProducerWaiting = false;
+    }
+    if (mClosed.load(std::memory_order_relaxed)) {
+        return false;
+    }
+
+    Message& slot = mSlots[tail % mSlots.size()];
+    memcpy(slot.mData, message.mData, message.mSize);
+    slot.mSize = message.mSize;
+    slot.mMsgCtrl = message.mMsgCtrl;
+    slot.mSocket = message.mSocket;
+    mTail = tail + 1;
+    if (mConsumerWaiting) {
+        std::lock_guard<std::mutex> lock(mWaitMtx);
+        mWaitCondition.notify_all();
+    }
+    return true;
+}
+
+SRTNetPipeline::Message* SRTNetPipeline::Ring::front() {
+    const uint64_t head = mHead.load(std::memory_order_relaxed);
+    auto hasMessage = [&]() { return head != mTail.load(); };
+    for (int spins = 0; !hasMessage(); ++spins) {
+        if (mClosed) {
+            // The producer is done, but may have written a last message before the ring was closed
+            if (hasMessage()) {
+                break;
+            }
+            return nullptr;
+        }
+        if (spins < kSpinsBeforeSleep) {
+            std::this_thread::yield();
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(mWaitMtx);
+        mConsumerWaiting = true;
+        mWaitCondition.wait_for(lock, kMaxSleep, [&]() { return hasMessage() || mClosed; });
+        mConsumerWaiting = false;
+    }
+    return &mSlots[head % mSlots.size()];
+}
+
+void SRTNetPipeline::Ring::pop() {
+    mHead = mHead.load(std::memory_order_relaxed) + 1;
+    if (mProducerWaiting) {
+        std::lock_guard<std::mutex> lock(mWaitMtx);
+        mWaitCondition.notify_all();
+    }
+}
+
+void SRTNetPipeline::Ring::close() {
+    mClosed = true;
+    std::lock_guard<std::mutex> lock(mWaitMtx);
+    mWaitCondition.notify_all();
+}
+
+size_t SRTNetPipeline::Ring::size() const {
+    const uint64_t head = mHead.load();
+    return static_cast<size_t>(mTail.load() - head);
+}
+
+SRTNetPipeline::SRTNetPipeline(size_t slotsPerStage, size_t maxMessageSize)
+    : mSlotsPerStage(slotsPerStage)
+    , mMaxMessageSize(maxMessageSize) {
+}
+
+SRTNetPipeline::~SRTNetPipeline() {
+    stop();
+}
+
+size_t SRTNetPipeline::addStage(const std::string& name,
+                                size_t input,
+                                Type type,
+                                Transform transform,
+                                Sink sink,
+                                int cpu) {
+    if (mStarted) {
+        return kInvalidStage;
+    }
+    if (type != Type::source && (input >= mStages.size() || mStages[input]->mType == Type::sink)) {
+        return kInvalidStage;
+    }
+
+    auto stage = std::make_unique<Stage>();
+    stage->mName = name;
+    stage->mType = type;
+    stage->mTransform = std::move(transform);
+    stage->mSink = std::move(sink);
+    stage->mCpu = cpu;
+    if (type != Type::source) {
+        stage->mInput = std::make_unique<Ring>(mSlotsPerStage, mMaxMessageSize);
+        mStages[input]->mOutputs.push_back(stage->mInput.get());
+    }
+    mStages.push_back(std::move(stage));
+    return mStages.size() - 1;
+}
+
+size_t SRTNetPipeline::addSource(const std::string& name) {
+    return addStage(name, kInvalidStage, Type::source, nullptr, nullptr, -1);
+}
+
+size_t SRTNetPipeline::addSource(const std::string& name, SRTNet& net) {
+    // A source has a single producer
+    if (net.hasSlowLane()) {
+        return kInvalidStage;
+    }
+    size_t source = addSource(name);
+    if (source != kInvalidStage) {
+        net.receivedDataNoCopy = [this, source](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl,
+                                                std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket) {
+            push(source, data, size, msgCtrl, socket);
+        };
+    }
+    return source;
+}
+
+size_t SRTNetPipeline::addTransform(const std::string& name, size_t input, Transform transform, int cpu) {
+    if (!transform) {
+        return kInvalidStage;
+    }
+    return addStage(name, input, Type::transform, std::move(transform), nullptr, cpu);
+}
+
+size_t SRTNetPipeline::addSink(const std::string& name, size_t input, Sink sink, int cpu) {
+    if (!sink) {
+        return kInvalidStage;
+    }
+    return addStage(name, input, Type::sink, nullptr, std::move(sink), cpu);
+}
+
+size_t SRTNetPipeline::addSrtSink(const std::string& name,
+                                  size_t input,
+                                  SRTNet& net,
+                                  SRTSOCKET targetSystem,
+                                  int cpu) {
+    return addSink(
+        name, input,
+        [&net, targetSystem](const Message& message) {
+            // Sent with the current time as srctime, the srctime of a received message is in the clock of its sender
+            SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+            net.sendData(message.mData, message.mSize, &msgCtrl, targetSystem);
+        },
+        cpu);
+}
+
+size_t SRTNetPipeline::addFileSink(const std::string& name, size_t input, const std::string& path, int cpu) {
+    if (mStarted || input >= mStages.size() || mStages[input]->mType == Type::sink) {
+        return kInvalidStage;
+    }
+    std::shared_ptr<FILE> file(fopen(path.c_str(), "ab"), [](FILE* file) {
+        if (file != nullptr) {
+            fclose(file);
+        }
+    });
+    if (!file) {
+        return kInvalidStage;
+    }
+    return addSink(
+        name, input, [file](const Message& message) { fwrite(message.mData, 1, message.mSize, file.get()); }, cpu);
+}
+
+bool SRTNetPipeline::start() {
+    if (mStarted || mStages.empty()) {
+        return false;
+    }
+    mStarted = true;
+    mLastStatistics = std::chrono::steady_clock::now();
+    for (auto& stage : mStages) {
+        if (stage->mType == Type::source) {
+            stage->mSourceOpen = true;
+        } else {
+            stage->mThread = std::thread(&SRTNetPipeline::stageWorker, this, std::ref(*stage));
+        }
+    }
+    return true;
+}
+
+bool SRTNetPipeline::push(size_t source,
+                          const uint8_t* data,
+                          size_t size,
+                          const SRT_MSGCTRL& msgCtrl,
+                          SRTSOCKET socket) {
+    if (source >= mStages.size() || mStages[source]->mType != Type::source) {
+        return false;
+    }
+    Stage& stage = *mStages[source];
+    if (!stage.mSourceOpen || size > mMaxMessageSize) {
+        stage.mDroppedMessages++;
+        return false;
+    }
+    stage.mMessagesIn++;
+    stage.mBytesIn += size;
+
+    Message message;
+    message.mData = const_cast<uint8_t*>(data);
+    message.mSize = size;
+    message.mCapacity = size;
+    message.mMsgCtrl = msgCtrl;
+    message.mSocket = socket;
+    return forward(stage, message);
+}
+
+bool SRTNetPipeline::forward(Stage& stage, const Message& message) {
+    for (Ring* output : stage.mOutputs) {
+        bool waited = false;
+        if (!output->push(message, waited)) {
+            stage.mDroppedMessages++;
+            return false;
+        }
+        if (waited) {
+            stage.mBackpressureWaits++;
+        }
+    }
+    stage.mMessagesOut++;
+    return true;
+}
+
+void SRTNetPipeline::stageWorker(Stage& stage) {
+    if (stage.mCpu >= 0) {
+        stage.mPinned = pinCurrentThread(stage.mCpu);
+    }
+
+    Ring& input = *stage.mInput;
+    while (Message* message = input.front()) {
+        const size_t depth = input.size();
+        if (depth > stage.mMaxQueueDepth.load(std::memory_order_relaxed)) {
+            stage.mMaxQueueDepth.store(depth, std::memory_order_relaxed);
+        }
+        stage.mMessagesIn++;
+        stage.mBytesIn += message->mSize;
+
+        if (stage.mType == Type::sink) {
+            stage.mSink(*message);
+            stage.mMessagesOut++;
+        } else if (!stage.mTransform(*message) || message->mSize > message->mCapacity) {
+            stage.mDroppedMessages++;
+        } else {
+            forward(stage, *message);
+        }
+        input.pop();
+    }
+}
+
+void SRTNetPipeline::stop() {
+    if (!mStarted || mStopped) {
+        return;
+    }
+    mStopped = true;
+    // The stages are in order, so every stage is closed after all the stages writing to it have ended
+    for (auto& stage : mStages) {
+        if (stage->mType == Type::source) {
+            stage->mSourceOpen = false;
+        } else {
+            stage->mInput->close();
+            stage->mThread.join();
+            // Releases what the functions hold, such as the file of a file sink
+            stage->mTransform = nullptr;
+            stage->mSink = nullptr;
+        }
+    }
+}
+
+void SRTNetPipeline::getStatistics(std::vector<StageStatistics>& statistics) {
+    std::lock_guard<std::mutex> lock(mStatisticsMtx);
+    auto now = std::chrono::steady_clock::now();
+    double seconds = std::chrono::duration<double>(now - mLastStatistics).count();
+    mLastStatistics = now;
+
+    statistics.clear();
+    for (auto& stage : mStages) {
+        StageStatistics& stageStatistics = statistics.emplace_back();
+        stageStatistics.mName = stage->mName;
+        stageStatistics.mMessagesIn = stage->mMessagesIn;
+        stageStatistics.mMessagesOut = stage->mMessagesOut;
+        stageStatistics.mBytesIn = stage->mBytesIn;
+        stageStatistics.mDroppedMessages = stage->mDroppedMessages;
+        stageStatistics.mBackpressureWaits = stage->mBackpressureWaits;
+        stageStatistics.mMaxQueueDepth = stage->mMaxQueueDepth;
+        stageStatistics.mPinned = stage->mPinned;
+        if (stage->mInput) {
+            stageStatistics.mQueueDepth = stage->mInput->size();
+            stageStatistics.mQueueCapacity = stage->mInput->capacity();
+        }
+        if (mStarted && seconds > 0) {
+            stageStatistics.mMessagesPerSecond =
+                static_cast<double>(stageStatistics.mMessagesIn - stage->mLastMessagesIn) / seconds;
+            stageStatistics.mBitsPerSecond = static_cast<double>(stageStatistics.mBytesIn - stage->mLastBytesIn) * 8 /
+                                             seconds;
+        }
+        stage->mLastMessagesIn = stageStatistics.mMessagesIn;
+        stage->mLastBytesIn = stageStatistics.mBytesIn;
+    }
+}
@@ -0,0 +1,231 @@
+//
+// Declarative graph of processing stages between receiving and sending with SRTNet.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief A graph of processing stages, declared up front and then started, replacing the queues and threads otherwise
+ * written by hand to glue the receivedDataNoCopy callback to filters, analysers and sendData.
+ *
+ * Messages enter the graph at source stages, pass through transform stages and leave it at sink stages. Every stage
+ * except the sources runs on a thread of its own, optionally pinned to a CPU, and reads its messages from a bounded
+ * single producer, single consumer ring of preallocated slots, so no lock is taken and no memory is allocated per
+ * message. Several stages may read from the same stage, which then copies every message into the ring of each of them
+ * (fan-out). A stage writing to a full ring waits until there is room, so a slow stage holds up the stages before it
+ * rather than losing messages, back to the sources, where an SRTNet source holds up the reading of SRT.
+ *
+ *     SRTNetPipeline pipeline(256, SRT_LIVE_MAX_PLSIZE);
+ *     size_t source = pipeline.addSource("ingest", server);
+ *     size_t filter = pipeline.addTransform("filter", source, [](SRTNetPipeline::Message& message) { ... });
+ *     pipeline.addSrtSink("egress", filter, client);
+ *     pipeline.addFileSink("recorder", filter, "/tmp/recording.ts");
+ *     pipeline.start();
+ *
+ * The stages are added in order, each after the stage it reads from, and can't be changed once the pipeline is
+ * started.
+ */
+class SRTNetPipeline {
+public:
+    static constexpr size_t kInvalidStage = std::numeric_limits<size_t>::max();
+
+    /**
+     * @brief A message in a slot of a ring. A transform may change the data in place and its size, up to mCapacity.
+     */
+    struct Message {
+        uint8_t* mData = nullptr;
+        size_t mSize = 0;
+        size_t mCapacity = 0;
+        SRT_MSGCTRL mMsgCtrl{};
+        SRTSOCKET mSocket = SRT_INVALID_SOCK; // The socket the message was received from
+    };
+
+    /**
+     * @brief Called for every message of a transform stage
+     * @return false to drop the message
+     */
+    using Transform = std::function<bool(Message& message)>;
+
+    using Sink = std::function<void(const Message& message)>;
+
+    struct StageStatistics {
+        std::string mName;
+        uint64_t mMessagesIn = 0;        // Messages read from the input ring, or pushed to a source
+        uint64_t mMessagesOut = 0;       // Messages passed on to the next stages, or consumed by a sink
+        uint64_t mBytesIn = 0;
+        uint64_t mDroppedMessages = 0;   // Messages dropped by a transform, too large or pushed to a stopped source
+        uint64_t mBackpressureWaits = 0; // Times the stage waited for room in the ring of a following stage
+        size_t mQueueDepth = 0;          // Messages waiting in the input ring
+        size_t mMaxQueueDepth = 0;       // Largest number of messages seen waiting in the input ring
+        size_t mQueueCapacity = 0;
+        double mMessagesPerSecond = 0;   // Input rate since the previous call to getStatistics, or since start
+        double mBitsPerSecond = 0;
+        bool mPinned = false;            // true if the thread of the stage is pinned to its CPU
+    };
+
+    /**
+     * @brief Constructor
+     * @param slotsPerStage The number of messages the input ring of every stage holds
+     * @param maxMessageSize The largest message that can be held, larger messages are dropped by the sources
+     */
+    SRTNetPipeline(size_t slotsPerStage, size_t maxMessageSize);
+
+    /**
+     * @brief Destructor, stops the pipeline
+     */
+    virtual ~SRTNetPipeline();
+
+    /**
+     * @brief Add a source the application pushes messages to with push, from one thread at a time
+     * @return The stage, or kInvalidStage if the pipeline is started
+     */
+    size_t addSource(const std::string& name);
+
+    /**
+     * @brief Add a source receiving the messages of an SRTNet instance, by setting its receivedDataNoCopy callback.
+     * The messages of all clients of a server enter the pipeline through the same source, so neither the callback
+     * executor nor the slow lane of the server must be used since they call receivedDataNoCopy from several threads.
+     * @return The stage, or kInvalidStage if the pipeline is started or a slow lane is set on \p net
+     */
+    size_t addSource(const std::string& name, SRTNet& net);
+
+    /**
+     * @brief Add a stage calling a function on every message of its input stage
+     * @param cpu The CPU to pin the thread of the stage to, -1 to not pin it. Threads are only pinned on Linux.
+     * @return The stage, or kInvalidStage if the pipeline is started or the input stage is not a source or transform
+     */
+    size_t addTransform(const std::string& name, size_t input, Transform transform, int cpu = -1);
+
+    /**
+     * @brief Add a stage consuming every message of its input stage
+     * @param cpu The CPU to pin the thread of the stage to, -1 to not pin it
+     * @return The stage, or kInvalidStage if the pipeline is started or the input stage is not a source or transform
+     */
+    size_t addSink(const std::string& name, size_t input, Sink sink, int cpu = -1);
+
+    /**
+     * @brief Add a stage sending every message of its input stage with SRTNet::sendData
+     * @param net The SRTNet instance to send with, must outlive the pipeline
+     * @param targetSystem The client to send to in server mode, see SRTNet::sendData
+     * @return The stage, or kInvalidStage if the pipeline is started or the input stage is not a source or transform
+     */
+    size_t addSrtSink(const std::string& name, size_t input, SRTNet& net, SRTSOCKET targetSystem = 0, int cpu = -1);
+
+    /**
+     * @brief Add a stage appending every message of its input stage to a file
+     * @return The stage, or kInvalidStage if the pipeline is started, the input stage is not a source or transform or
+     * the file could not be opened
+     */
+    size_t addFileSink(const std::string& name, size_t input, const std::string& path, int cpu = -1);
+
+    /**
+     * @brief Start the threads of the stages
+     * @return false if the pipeline is already started or has no stages
+     */
+    bool start();
+
+    /**
+     * @brief Push a message to a source added with addSource(name), waits while the rings of the following stages are
+     * full
+     * @return false if the message was dropped since it is too large, or the pipeline is not running
+     */
+    bool push(size_t source,
+              const uint8_t* data,
+              size_t size,
+              const SRT_MSGCTRL& msgCtrl,
+              SRTSOCKET socket = SRT_INVALID_SOCK);
+
+    /**
+     * @brief Stop the pipeline. The sources stop taking messages, and every stage handles the messages in its ring
+     * before its thread ends. An SRTNet source should be stopped before the pipeline.
+     */
+    void stop();
+
+    /**
+     * @brief Get the statistics of all stages, in the order they were added
+     */
+    void getStatistics(std::vector<StageStatistics>& statistics);
+
+    SRTNetPipeline(SRTNetPipeline const&) = delete;
+    SRTNetPipeline& operator=(SRTNetPipeline const&) = delete;
+
+private:
+    // Single producer, single consumer ring of preallocated slots
+    class Ring {
+    public:
+        Ring(size_t slots, size_t maxMessageSize);
+        // Copy a message into the ring, waits while the ring is full, returns false if the ring was closed meanwhile
+        bool push(const Message& message, bool& waited);
+        // The next message to read, waits while the ring is empty, returns nullptr if the ring is closed and empty
+        Message* front();
+        void pop();
+        void close();
+        size_t size() const;
+        size_t capacity() const {
+            return mSlots.size();
+        }
+
+    private:
+        std::vector<uint8_t> mStorage;
+        std::vector<Message> mSlots;
+        alignas(64) std::atomic<uint64_t> mHead{0}; // Next slot to read, written by the consumer
+        alignas(64) std::atomic<uint64_t> mTail{0}; // Next slot to write, written by the producer
+        alignas(64) std::atomic<bool> mClosed{false};
+        std::atomic<bool> mProducerWaiting{false};
+        std::atomic<bool> mConsumerWaiting{false};
+        std::mutex mWaitMtx;
+        std::condition_variable mWaitCondition;
+    };
+
+    enum class Type { source, transform, sink };
+
+    struct Stage {
+        std::string mName;
+        Type mType = Type::source;
+        Transform mTransform;
+        Sink mSink;
+        int mCpu = -1;
+        std::unique_ptr<Ring> mInput;    // Not used by sources
+        std::vector<Ring*> mOutputs;     // The input rings of the stages reading from this stage
+        std::thread mThread;
+        std::atomic<bool> mSourceOpen{false};
+        std::atomic<bool> mPinned{false};
+
+        std::atomic<uint64_t> mMessagesIn{0};
+        std::atomic<uint64_t> mMessagesOut{0};
+        std::atomic<uint64_t> mBytesIn{0};
+        std::atomic<uint64_t> mDroppedMessages{0};
+        std::atomic<uint64_t> mBackpressureWaits{0};
+        std::atomic<size_t> mMaxQueueDepth{0};
+
+        // Used by getStatistics to compute the rates
+        uint64_t mLastMessagesIn = 0;
+        uint64_t mLastBytesIn = 0;
+    };
+
+    size_t addStage(const std::string& name, size_t input, Type type, Transform transform, Sink sink, int cpu);
+    bool forward(Stage& stage, const Message& message);
+    void stageWorker(Stage& stage);
+
+    const size_t mSlotsPerStage;
+    const size_t mMaxMessageSize;
+    std::vector<std::unique_ptr<Stage>> mStages;
+    bool mStarted = false;
+    bool mStopped = false;
+    std::mutex mStatisticsMtx;
+    std::chrono::steady_clock::time_point mLastStatistics;
+};
@@ -0,0 +1,201 @@
+//
+// Input failover switch between redundant publishers connected to an SRTNet server.
+//
+
+#include "SRTNetRedundancyGroup.h"
+
+#include <algorithm>
+
+SRTNetRedundancyGroup::SRTNetRedundancyGroup(std::chrono::milliseconds gapThreshold,
+                                             bool revertive,
+                                             std::chrono::milliseconds revertHoldTime)
+    : mGapThreshold(gapThreshold)
+    , mRevertive(revertive)
+    , mRevertHoldTime(revertHoldTime) {
+}
+
+bool SRTNetRedundancyGroup::addMember(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mMtx);
+    if (findMember(socket)) {
+        return false;
+    }
+    Member member;
+    member.mStatistics.mSocket = socket;
+    member.mStatistics.mPriority = mMembers.empty() ? 0 : mMembers.back().mStatistics.mPriority + 1;
+    mMembers.push_back(member);
+    return true;
+}
+
+bool SRTNetRedundancyGroup::removeMember(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mMtx);
+    auto iterator = std::find_if(mMembers.begin(), mMembers.end(),
+                                 [socket](const Member& member) { return member.mStatistics.mSocket == socket; });
+    if (iterator == mMembers.end()) {
+        return false;
+    }
+    mMembers.erase(iterator);
+    if (mActiveSocket == socket) {
+        mActiveSocket = SRT_INVALID_SOCK;
+    }
+    return true;
+}
+
+bool SRTNetRedundancyGroup::pushData(const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket) {
+    return pushData(data, size, msgCtrl, socket, std::chrono::steady_clock::now());
+}
+
+bool SRTNetRedundancyGroup::pushData(const uint8_t* data,
+                                     size_t size,
+                                     SRT_MSGCTRL& msgCtrl,
+                                     SRTSOCKET socket,
+                                     std::chrono::steady_clock::time_point now) {
+    std::unique_lock<std::mutex> lock(mMtx);
+    Member* member = findMember(socket);
+    if (!member) {
+        return false;
+    }
+
+    MemberStatistics& statistics = member->mStatistics;
+    if (statistics.mReceivedMessages > 0) {
+        auto gap = now - member->mLastArrival;
+        statistics.mLargestGap =
+            std::max(statistics.mLargestGap, std::chrono::duration_cast<std::chrono::microseconds>(gap));
+        if (gap > mGapThreshold) {
+            member->mHealthySince = now;
+        }
+    } else {
+        member->mHealthySince = now;
+    }
+    member->mLastArrival = now;
+    statistics.mReceivedMessages++;
+    statistics.mReceivedBytes += size;
+
+    bool switchToMember = false;
+    SRTSOCKET fromSocket = mActiveSocket;
+    std::chrono::microseconds activeGap{0};
+    if (mActiveSocket == SRT_INVALID_SOCK) {
+        switchToMember = true;
+    } else if (mActiveSocket != socket) {
+        Member* active = findMember(mActiveSocket);
+        auto silence = now - active->mLastArrival;
+        activeGap = std::chrono::duration_cast<std::chrono::microseconds>(silence);
+        if (silence > mGapThreshold) {
+            switchToMember = true;
+        } else if (active->mStatistics.mDegraded && !statistics.mDegraded) {
+            switchToMember = true;
+        } else if (mRevertive && !statistics.mDegraded && statistics.mPriority < active->mStatistics.mPriority &&
+                   now - member->mHealthySince >= mRevertHoldTime) {
+            switchToMember = true;
+        }
+    }
+
+    bool reportSwitch = false;
+    if (switchToMember) {
+        mActiveSocket = socket;
+        // The very first member to deliver payload is not counted as a switch
+        if (mHasBeenActive) {
+            mSwitchCount++;
+            reportSwitch = true;
+        }
+        mHasBeenActive = true;
+    }
+
+    if (mActiveSocket != socket) {
+        return false;
+    }
+    statistics.mForwardedMessages++;
+
+    // Call back outside the lock, so that a slow output does not block removeMember or the statistics getters
+    lock.unlock();
+    if (reportSwitch && switched) {
+        switched(fromSocket, socket, activeGap);
+    }
+    if (output) {
+        output(data, size, msgCtrl, socket);
+    }
+    return true;
+}
+
+bool SRTNetRedundancyGroup::setLossThreshold(double lossRatio) {
+    if (lossRatio < 0.0 || lossRatio > 1.0) {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(mMtx);
+    mLossThreshold = lossRatio;
+    return true;
+}
+
+void SRTNetRedundancyGroup::pollLinkStatistics() {
+    std::vector<SRTSOCKET> sockets;
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        for (const auto& member : mMembers) {
+            sockets.push_back(member.mStatistics.mSocket);
+        }
+    }
+    for (SRTSOCKET socket : sockets) {
+        SRT_TRACEBSTATS stats;
+        if (srt_bistats(socket, &stats, 0, 1) != SRT_ERROR) {
+            updateLinkStatistics(socket, stats);
+        }
+    }
+}
+
+bool SRTNetRedundancyGroup::updateLinkStatistics(SRTSOCKET socket,
+                                                 const SRT_TRACEBSTATS& stats,
+                                                 std::chrono::steady_clock::time_point now) {
+    std::lock_guard<std::mutex> lock(mMtx);
+    Member* member = findMember(socket);
+    if (!member) {
+        return false;
+    }
+    int64_t received = stats.pktRecvTotal;
+    int64_t lost = static_cast<int64_t>(stats.pktRcvLossTotal) + stats.pktRcvDropTotal;
+    if (member->mHasLinkStatistics) {
+        // Lost packets are not counted as received, so they are added to get the packets the peer sent. A loss SRT
+        // could not repair is also counted as a drop, which weighs the losses that reached the output twice.
+        int64_t newReceived = received - member->mReceivedPackets;
+        int64_t newLost = lost - member->mLostPackets;
+        int64_t sent = newReceived + newLost;
+        member->mStatistics.mLossRatio = sent > 0 ? static_cast<double>(newLost) / static_cast<double>(sent) : 0.0;
+    }
+    member->mHasLinkStatistics = true;
+    member->mReceivedPackets = received;
+    member->mLostPackets = lost;
+
+    member->mStatistics.mDegraded = mLossThreshold > 0.0 && member->mStatistics.mLossRatio > mLossThreshold;
+    if (member->mStatistics.mDegraded) {
+        member->mHealthySince = now;
+    }
+    return true;
+}
+
+SRTSOCKET SRTNetRedundancyGroup::getActiveMember() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mActiveSocket;
+}
+
+uint64_t SRTNetRedundancyGroup::getSwitchCount() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    return mSwitchCount;
+}
+
+std::vector<SRTNetRedundancyGroup::MemberStatistics> SRTNetRedundancyGroup::getMemberStatistics() const {
+    std::lock_guard<std::mutex> lock(mMtx);
+    std::vector<MemberStatistics> statistics;
+    statistics.reserve(mMembers.size());
+    for (const auto& member : mMembers) {
+        statistics.push_back(member.mStatistics);
+        statistics.back().mActive = member.mStatistics.mSocket == mActiveSocket;
+    }
+    return statistics;
+}
+
+SRTNetRedundancyGroup::Member* SRTNetRedundancyGroup::findMember(SRTSOCKET socket) {
+    for (auto& member : mMembers) {
+        if (member.mStatistics.mSocket == socket) {
+            return &member;
+        }
+    }
+    return nullptr;
+}
@@ -0,0 +1,166 @@
+//
+// Input failover switch between redundant publishers connected to an SRTNet server.
+//
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <mutex>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief A redundancy group binds two or more ingress connections carrying the same program, for example from two
+ * encoders over different network paths, and forwards the payload from one of them at the time. The members are ordered
+ * by priority, the first added member being the primary. When the active member has not delivered any payload for
+ * longer than the gap threshold, the output is switched to the member the next message arrives from. Optionally the
+ * group reverts to a higher priority member once it has delivered payload without gaps for a hold time.
+ *
+ * Besides gaps, the group can watch the SRT loss of its members. With a loss threshold set, pollLinkStatistics, called
+ * periodically, reads the SRT statistics of every member and marks a member degraded while the share of its packets
+ * lost or dropped since the previous poll is above the threshold. The output is switched away from a degraded active
+ * member to the next member that delivers payload without being degraded, and the group does not revert to a member
+ * until it has been free of gaps and degradation for the hold time.
+ *
+ * The group is fed from the receivedDataNoCopy callback of an SRTNet server and forwards the very same buffer to the
+ * output callback, so no payload is copied.
+ *
+ *     server.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl,
+ *                                     std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+ *         group.pushData(data, size, msgCtrl, socket);
+ *     };
+ */
+class SRTNetRedundancyGroup {
+public:
+    struct MemberStatistics {
+        SRTSOCKET mSocket = SRT_INVALID_SOCK;
+        size_t mPriority = 0;                     // 0 is the primary, higher numbers are backups
+        bool mActive = false;                     // True if this member is the one currently forwarded
+        uint64_t mReceivedMessages = 0;           // Messages received from this member
+        uint64_t mReceivedBytes = 0;              // Bytes received from this member
+        uint64_t mForwardedMessages = 0;          // Messages forwarded from this member to the output
+        std::chrono::microseconds mLargestGap{0}; // Largest gap between two messages from this member
+        double mLossRatio = 0.0;                  // Share of packets lost or dropped between the last two updates
+        bool mDegraded = false;                   // True while the loss ratio is above the loss threshold
+    };
+
+    /**
+     * @brief Constructor
+     * @param gapThreshold Switch away from the active member if it has not delivered any payload for this long
+     * @param revertive Set to true to switch back to a higher priority member once it is healthy again
+     * @param revertHoldTime Time a higher priority member must deliver payload without gaps before switching back to it
+     */
+    explicit SRTNetRedundancyGroup(std::chrono::milliseconds gapThreshold = std::chrono::milliseconds(50),
+                                   bool revertive = false,
+                                   std::chrono::milliseconds revertHoldTime = std::chrono::milliseconds(5000));
+
+    /**
+     * @brief Add a connection to the group, with lower priority than all connections already added.
+     * @param socket The socket of the connection
+     * @return false if the socket already is a member of the group
+     */
+    bool addMember(SRTSOCKET socket);
+
+    /**
+     * @brief Remove a connection from the group, for example from the clientDisconnected callback. If the removed
+     * member was the active one, the output is switched to the member the next message arrives from.
+     * @param socket The socket of the connection
+     * @return false if the socket is not a member of the group
+     */
+    bool removeMember(SRTSOCKET socket);
+
+    /**
+     * @brief Feed a received message to the group. If it comes from the active member it is forwarded to the output
+     * callback before this function returns.
+     * @param data pointer to the data
+     * @param size size of the data
+     * @param msgCtrl the SRT_MSGCTRL of the message
+     * @param socket the socket the message was received on
+     * @return true if the message was forwarded to the output callback.
+     */
+    bool pushData(const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket);
+
+    /**
+     * @brief Feed a received message to the group with its arrival time, see pushData above.
+     * @param arrival when the message was received
+     */
+    bool pushData(const uint8_t* data,
+                  size_t size,
+                  SRT_MSGCTRL& msgCtrl,
+                  SRTSOCKET socket,
+                  std::chrono::steady_clock::time_point arrival);
+
+    /**
+     * @brief Set the share of packets a member may lose or drop between two statistics updates before it is
+     * considered degraded.
+     * @param lossRatio The max loss ratio, 0 to 1, or 0 to ignore the SRT loss of the members which is the default
+     * @return false if the ratio is out of range
+     */
+    bool setLossThreshold(double lossRatio);
+
+    /**
+     * @brief Read the SRT statistics of all members and update them with updateLinkStatistics. Call periodically, for
+     * example once a second, when a loss threshold is set.
+     */
+    void pollLinkStatistics();
+
+    /**
+     * @brief Update the loss of a member from its SRT statistics
+     * @param socket The socket of the member
+     * @param stats The cumulative SRT statistics of the member
+     * @param now The current time, a degraded member is not reverted to for the hold time from now
+     * @return false if the socket is not a member of the group
+     */
+    bool updateLinkStatistics(SRTSOCKET socket,
+                              const SRT_TRACEBSTATS& stats,
+                              std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now());
+
+    /**
+     * @brief Get the socket of the member currently forwarded
+     * @return The active socket, SRT_INVALID_SOCK if no member has delivered any payload yet
+     */
+    SRTSOCKET getActiveMember() const;
+
+    /**
+     * @brief Get the number of switches between members since the group was created
+     */
+    uint64_t getSwitchCount() const;
+
+    /**
+     * @brief Get statistics for all members, ordered by priority
+     */
+    std::vector<MemberStatistics> getMemberStatistics() const;
+
+    /// Callback receiving the forwarded payload of the active member
+    std::function<void(const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket)> output = nullptr;
+
+    /// Callback called when the output is switched from one member to another. fromSocket is SRT_INVALID_SOCK if the
+    /// previously active member was removed. gap is how long the previously active member had been silent.
+    std::function<void(SRTSOCKET fromSocket, SRTSOCKET toSocket, std::chrono::microseconds gap)> switched = nullptr;
+
+private:
+    struct Member {
+        MemberStatistics mStatistics;
+        std::chrono::steady_clock::time_point mLastArrival;
+        std::chrono::steady_clock::time_point mHealthySince;
+        // The cumulative packet counters of the last statistics update
+        bool mHasLinkStatistics = false;
+        int64_t mReceivedPackets = 0;
+        int64_t mLostPackets = 0;
+    };
+
+    Member* findMember(SRTSOCKET socket);
+
+    const std::chrono::steady_clock::duration mGapThreshold;
+    const bool mRevertive;
+    const std::chrono::steady_clock::duration mRevertHoldTime;
+
+    mutable std::mutex mMtx;
+    std::vector<Member> mMembers;
+    SRTSOCKET mActiveSocket = SRT_INVALID_SOCK;
+    bool mHasBeenActive = false;
+    uint64_t mSwitchCount = 0;
+    double mLossThreshold = 0.0;
+};
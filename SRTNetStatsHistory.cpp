@@ -0,0 +1,421 @@
+//
+// Memory mapped, fixed size, per connection history of SRT statistics for post-mortem analysis.
+//
+
+#include "SRTNetStatsHistory.h"
+
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+using Int64Getter = int64_t (*)(const SRT_TRACEBSTATS&);
+using Float32Getter = float (*)(const SRT_TRACEBSTATS&);
+
+struct Column {
+    const char* mName;
+    SRTNetStatsHistory::ColumnType mType;
+    Int64Getter mInt64Getter;
+    Float32Getter mFloat32Getter;
+};
+
+// The first column is always the wall clock time of the sample, filled in by writeSample
+const Column kColumns[] = {
+    {"timestampUs", SRTNetStatsHistory::int64Column, nullptr, nullptr},
+    {"pktSentTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktSentTotal; }, nullptr},
+    {"pktRecvTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktRecvTotal; }, nullptr},
+    {"pktSndLossTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktSndLossTotal; }, nullptr},
+    {"pktRcvLossTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktRcvLossTotal; }, nullptr},
+    {"pktRetransTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktRetransTotal; }, nullptr},
+    {"pktSndDropTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktSndDropTotal; }, nullptr},
+    {"pktRcvDropTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.pktRcvDropTotal; }, nullptr},
+    {"byteSentTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.byteSentTotal; }, nullptr},
+    {"byteRecvTotal", SRTNetStatsHistory::int64Column,
+     [](const SRT_TRACEBSTATS& s) -> int64_t { return s.byteRecvTotal; }, nullptr},
+    {"mbpsSendRate", SRTNetStatsHistory::float32Column, nullptr,
+     [](const SRT_TRACEBSTATS& s) -> float { return s.mbpsSendRate; }},
+    {"mbpsRecvRate", SRTNetStatsHistory::float32Column, nullptr,
+     [](const SRT_TRACEBSTATS& s) -> float { return s.mbpsRecvRate; }},
+    {"msRTT", SRTNetStatsHistory::float32Column, nullptr, [](const SRT_TRACEBSTATS& s) -> float { return s.msRTT; }},
+    {"mbpsBandwidth", SRTNetStatsHistory::float32Column, nullptr,
+     [](const SRT_TRACEBSTATS& s) -> float { return s.mbpsBandwidth; }},
+    {"pktFlightSize", SRTNetStatsHistory::float32Column, nullptr,
+     [](const SRT_TRACEBSTATS& s) -> float { return s.pktFlightSize; }},
+    {"msSndBuf", SRTNetStatsHistory::float32Column, nullptr,
+     [](const SRT_TRACEBSTATS& s) -> float { return s.msSndBuf; }},
+    {"msRcvBuf", SRTNetStatsHistory::float32Column, nullptr,
+     [](const SRT_TRACEBSTATS& s) -> float { return s.msRcvBuf; }},
+};
+const size_t kColumnCount = sizeof(kColumns) / sizeof(kColumns[0]);
+static_assert(kColumnCount <= SRTNetStatsHistory::kMaxColumns, "Too many columns");
+static_assert(std::atomic<int64_t>::is_always_lock_free && std::atomic<uint64_t>::is_always_lock_free,
+              "The slot header atomics must be lock free to live in a shared mapping");
+
+size_t columnValueSize(uint32_t type) {
+    return type == SRTNetStatsHistory::int64Column ? sizeof(int64_t) : sizeof(float);
+}
+
+size_t alignUp(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+uint32_t hashSocket(SRTSOCKET socket) {
+    return static_cast<uint32_t>(socket) * 2654435761u;
+}
+
+// Check that everything the header points to lies within the file, so a corrupt file can't make readFile read out of
+// bounds or unaligned
+bool isValidHeader(const SRTNetStatsHistory::FileHeader& header, size_t fileSize) {
+    if (memcmp(header.mMagic, SRTNetStatsHistory::kMagic, sizeof(SRTNetStatsHistory::kMagic)) != 0 ||
+        header.mVersion != SRTNetStatsHistory::kVersion || header.mColumnCount > SRTNetStatsHistory::kMaxColumns ||
+        header.mSamplesPerConnection == 0 || header.mSlotSize < sizeof(SRTNetStatsHistory::SlotHeader) ||
+        header.mSlotSize % alignof(SRTNetStatsHistory::SlotHeader) != 0 ||
+        header.mFirstSlotOffset % alignof(SRTNetStatsHistory::SlotHeader) != 0 || header.mFirstSlotOffset > fileSize ||
+        static_cast<uint64_t>(header.mSlotSize) * header.mMaxConnections > fileSize - header.mFirstSlotOffset) {
+        return false;
+    }
+    for (uint32_t column = 0; column < header.mColumnCount; ++column) {
+        const SRTNetStatsHistory::ColumnDescriptor& descriptor = header.mColumns[column];
+        if (descriptor.mType != SRTNetStatsHistory::int64Column &&
+            descriptor.mType != SRTNetStatsHistory::float32Column) {
+            return false;
+        }
+        size_t valueSize = columnValueSize(descriptor.mType);
+        if (descriptor.mOffset < sizeof(SRTNetStatsHistory::SlotHeader) || descriptor.mOffset % valueSize != 0 ||
+            descriptor.mOffset + static_cast<uint64_t>(valueSize) * header.mSamplesPerConnection > header.mSlotSize) {
+            return false;
+        }
+    }
+    return true;
+}
+
+} // namespace
+
+SRTNetStatsHistory::~SRTNetStatsHistory() {
+    stop();
+}
+
+bool SRTNetStatsHistory::open(const std::string& path,
+                              size_t maxConnections,
+                              size_t samplesPerConnection,
+                              std::chrono::milliseconds interval) {
+#ifdef WIN32
+    return false;
+#else
+    if (mMapping || maxConnections == 0 || samplesPerConnection == 0) {
+        return false;
+    }
+
+    size_t slotSize = sizeof(SlotHeader);
+    uint32_t offsets[kMaxColumns];
+    for (size_t column = 0; column < kColumnCount; ++column) {
+        slotSize = alignUp(slotSize, sizeof(int64_t));
+        offsets[column] = static_cast<uint32_t>(slotSize);
+        slotSize += columnValueSize(kColumns[column].mType) * samplesPerConnection;
+    }
+    slotSize = alignUp(slotSize, 64);
+    size_t firstSlotOffset = alignUp(sizeof(FileHeader), 64);
+    size_t fileSize = firstSlotOffset + slotSize * maxConnections;
+
+    mFileDescriptor = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (mFileDescriptor < 0) {
+        return false;
+    }
+    // Reserve the whole file up front, so running out of disk can't turn into a SIGBUS later on
+    if (ftruncate(mFileDescriptor, static_cast<off_t>(fileSize)) != 0 ||
+        posix_fallocate(mFileDescriptor, 0, static_cast<off_t>(fileSize)) != 0) {
+        ::close(mFileDescriptor);
+        mFileDescriptor = -1;
+        return false;
+    }
+    void* mapping = mmap(nullptr, fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, mFileDescriptor, 0);
+    if (mapping == MAP_FAILED) {
+        ::close(mFileDescriptor);
+        mFileDescriptor = -1;
+        return false;
+    }
+    mMapping = static_cast<uint8_t*>(mapping);
+    mMappingSize = fileSize;
+    mInterval = interval;
+
+    mHeader = reinterpret_cast<FileHeader*>(mMapping);
+    mHeader->mVersion = kVersion;
+    mHeader->mColumnCount = static_cast<uint32_t>(kColumnCount);
+    mHeader->mMaxConnections = static_cast<uint32_t>(maxConnections);
+    mHeader->mSamplesPerConnection = static_cast<uint32_t>(samplesPerConnection);
+    mHeader->mIntervalMs = static_cast<uint32_t>(interval.count());
+    mHeader->mSlotSize = static_cast<uint32_t>(slotSize);
+    mHeader->mFirstSlotOffset = firstSlotOffset;
+    for (size_t column = 0; column < kColumnCount; ++column) {
+        ColumnDescriptor& descriptor = mHeader->mColumns[column];
+        strncpy(descriptor.mName, kColumns[column].mName, sizeof(descriptor.mName) - 1);
+        descriptor.mType = kColumns[column].mType;
+        descriptor.mOffset = offsets[column];
+    }
+    for (size_t slot = 0; slot < maxConnections; ++slot) {
+        SlotHeader* header = slotHeader(slot);
+        header->mSocket.store(SRT_INVALID_SOCK, std::memory_order_relaxed);
+        header->mWritten.store(0, std::memory_order_relaxed);
+    }
+    // The magic is written last, a reader never sees a half initialized file as valid
+    std::atomic_thread_fence(std::memory_order_release);
+    memcpy(mHeader->mMagic, kMagic, sizeof(kMagic));
+
+    size_t tableSize = 1;
+    while (tableSize < maxConnections * 2) {
+        tableSize <<= 1;
+    }
+    mSlotTable.assign(tableSize, -1);
+    mSlotRound.assign(maxConnections, 0);
+    mSockets.reserve(maxConnections);
+    mRound = 0;
+    mReuseCursor = 0;
+    return true;
+#endif
+}
+
+bool SRTNetStatsHistory::start(SRTNet& net) {
+    std::lock_guard<std::mutex> lock(mSamplingMtx);
+    if (!mMapping || mSampling) {
+        return false;
+    }
+    mSampling = true;
+    mSamplingThread = std::thread(&SRTNetStatsHistory::samplingWorker, this, &net);
+    return true;
+}
+
+void SRTNetStatsHistory::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mSamplingMtx);
+        mSampling = false;
+    }
+    mSamplingCondition.notify_one();
+    if (mSamplingThread.joinable()) {
+        mSamplingThread.join();
+    }
+
+#ifndef WIN32
+    if (mMapping) {
+        msync(mMapping, mMappingSize, MS_ASYNC);
+        munmap(mMapping, mMappingSize);
+        mMapping = nullptr;
+        mHeader = nullptr;
+    }
+    if (mFileDescriptor >= 0) {
+        ::close(mFileDescriptor);
+        mFileDescriptor = -1;
+    }
+#endif
+}
+
+void SRTNetStatsHistory::beginRound() {
+    if (!mHeader) {
+        return;
+    }
+    mRound++;
+    std::fill(mSlotTable.begin(), mSlotTable.end(), -1);
+    const size_t mask = mSlotTable.size() - 1;
+    for (size_t slot = 0; slot < mHeader->mMaxConnections; ++slot) {
+        int64_t socket = slotHeader(slot)->mSocket.load(std::memory_order_relaxed);
+        if (socket == SRT_INVALID_SOCK) {
+            continue;
+        }
+        size_t index = hashSocket(static_cast<SRTSOCKET>(socket)) & mask;
+        while (mSlotTable[index] != -1) {
+            index = (index + 1) & mask;
+        }
+        mSlotTable[index] = static_cast<int32_t>(slot);
+    }
+}
+
+bool SRTNetStatsHistory::writeSample(SRTSOCKET socket, const SRT_TRACEBSTATS& stats, int64_t timestampUs) {
+    if (!mHeader) {
+        return false;
+    }
+    int32_t slot = findSlot(socket);
+    if (slot < 0) {
+        slot = assignSlot(socket);
+        if (slot < 0) {
+            return false;
+        }
+    }
+    mSlotRound[slot] = mRound;
+
+    SlotHeader* header = slotHeader(slot);
+    uint8_t* slotBase = reinterpret_cast<uint8_t*>(header);
+    uint64_t written = header->mWritten.load(std::memory_order_relaxed);
+    size_t index = written % mHeader->mSamplesPerConnection;
+    for (size_t column = 0; column < kColumnCount; ++column) {
+        const ColumnDescriptor& descriptor = mHeader->mColumns[column];
+        if (descriptor.mType == int64Column) {
+            int64_t value = column == 0 ? timestampUs : kColumns[column].mInt64Getter(stats);
+            reinterpret_cast<int64_t*>(slotBase + descriptor.mOffset)[index] = value;
+        } else {
+            reinterpret_cast<float*>(slotBase + descriptor.mOffset)[index] = kColumns[column].mFloat32Getter(stats);
+        }
+    }
+    // Publish the sample only after all of its columns are written
+    header->mWritten.store(written + 1, std::memory_order_release);
+    return true;
+}
+
+SRTNetStatsHistory::SlotHeader* SRTNetStatsHistory::slotHeader(size_t slot) const {
+    return reinterpret_cast<SlotHeader*>(mMapping + mHeader->mFirstSlotOffset + slot * mHeader->mSlotSize);
+}
+
+int32_t SRTNetStatsHistory::findSlot(SRTSOCKET socket) {
+    const size_t mask = mSlotTable.size() - 1;
+    for (size_t index = hashSocket(socket) & mask; mSlotTable[index] != -1; index = (index + 1) & mask) {
+        int32_t slot = mSlotTable[index];
+        if (slotHeader(slot)->mSocket.load(std::memory_order_relaxed) == socket) {
+            return slot;
+        }
+    }
+    return -1;
+}
+
+int32_t SRTNetStatsHistory::assignSlot(SRTSOCKET socket) {
+    const size_t slots = mHeader->mMaxConnections;
+    int32_t chosen = -1;
+    // Prefer a slot that has never been used, then the one of the connection that was sampled the longest time ago
+    for (size_t step = 0; step < slots; ++step) {
+        size_t slot = (mReuseCursor + step) % slots;
+        if (slotHeader(slot)->mSocket.load(std::memory_order_relaxed) == SRT_INVALID_SOCK) {
+            chosen = static_cast<int32_t>(slot);
+            break;
+        }
+        if (mSlotRound[slot] != mRound && (chosen < 0 || mSlotRound[slot] < mSlotRound[chosen])) {
+            chosen = static_cast<int32_t>(slot);
+        }
+    }
+    if (chosen < 0) {
+        return -1;
+    }
+    mReuseCursor = (chosen + 1) % slots;
+
+    // Invalidate the slot before reusing it, so a reader never mixes samples of two connections
+    SlotHeader* header = slotHeader(chosen);
+    header->mWritten.store(0, std::memory_order_release);
+    header->mSocket.store(socket, std::memory_order_release);
+
+    const size_t mask = mSlotTable.size() - 1;
+    size_t index = hashSocket(socket) & mask;
+    while (mSlotTable[index] != -1 && mSlotTable[index] != chosen) {
+        index = (index + 1) & mask;
+    }
+    mSlotTable[index] = chosen;
+    return chosen;
+}
+
+void SRTNetStatsHistory::samplingWorker(SRTNet* net) {
+    std::unique_lock<std::mutex> lock(mSamplingMtx);
+    auto nextSample = std::chrono::steady_clock::now();
+    while (mSampling) {
+        lock.unlock();
+        beginRound();
+        if (net->getCurrentMode() == SRTNet::Mode::client) {
+            mSockets.clear();
+            if (net->isConnectedToServer()) {
+                mSockets.push_back(net->getConnectedServer().first);
+            }
+        } else {
+            net->getActiveClientSockets(mSockets);
+        }
+
+        int64_t timestampUs = std::chrono::duration_cast<std::chrono::microseconds>(
+                                  std::chrono::system_clock::now().time_since_epoch())
+                                  .count();
+        for (SRTSOCKET socket : mSockets) {
+            SRT_TRACEBSTATS stats;
+            // Don't clear, so the statistics seen by users of getStatistics are unaffected
+            if (srt_bistats(socket, &stats, 0, 1) != SRT_ERROR) {
+                writeSample(socket, stats, timestampUs);
+            }
+        }
+        lock.lock();
+
+        nextSample += mInterval;
+        mSamplingCondition.wait_until(lock, nextSample, [&]() { return !mSampling; });
+    }
+}
+
+bool SRTNetStatsHistory::readFile(
+    const std::string& path,
+    std::vector<std::string>& columns,
+    const std::function<void(SRTSOCKET socket, const std::vector<Sample>& samples)>& onConnection) {
+#ifdef WIN32
+    return false;
+#else
+    int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    struct stat fileStatus {};
+    if (fstat(fileDescriptor, &fileStatus) != 0 || static_cast<size_t>(fileStatus.st_size) < sizeof(FileHeader)) {
+        ::close(fileDescriptor);
+        return false;
+    }
+    size_t fileSize = fileStatus.st_size;
+    void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_SHARED, fileDescriptor, 0);
+    ::close(fileDescriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    const uint8_t* base = static_cast<const uint8_t*>(mapping);
+    const FileHeader* header = reinterpret_cast<const FileHeader*>(base);
+
+    bool valid = isValidHeader(*header, fileSize);
+    if (valid) {
+        columns.clear();
+        for (uint32_t column = 0; column < header->mColumnCount; ++column) {
+            columns.emplace_back(header->mColumns[column].mName,
+                                 strnlen(header->mColumns[column].mName, sizeof(header->mColumns[column].mName)));
+        }
+
+        std::vector<Sample> samples;
+        for (uint32_t slot = 0; slot < header->mMaxConnections; ++slot) {
+            const uint8_t* slotBase = base + header->mFirstSlotOffset + static_cast<size_t>(slot) * header->mSlotSize;
+            const SlotHeader* slotHeader = reinterpret_cast<const SlotHeader*>(slotBase);
+            int64_t socket = slotHeader->mSocket.load(std::memory_order_acquire);
+            uint64_t written = slotHeader->mWritten.load(std::memory_order_acquire);
+            if (socket == SRT_INVALID_SOCK || written == 0) {
+                continue;
+            }
+
+            uint64_t count = std::min<uint64_t>(written, header->mSamplesPerConnection);
+            samples.assign(count, Sample());
+            for (uint64_t sample = 0; sample < count; ++sample) {
+                size_t index = (written - count + sample) % header->mSamplesPerConnection;
+                std::vector<double>& values = samples[sample].mValues;
+                values.reserve(header->mColumnCount);
+                for (uint32_t column = 0; column < header->mColumnCount; ++column) {
+                    const ColumnDescriptor& descriptor = header->mColumns[column];
+                    if (descriptor.mType == int64Column) {
+                        values.push_back(reinterpret_cast<const int64_t*>(slotBase + descriptor.mOffset)[index]);
+                    } else {
+                        values.push_back(reinterpret_cast<const float*>(slotBase + descriptor.mOffset)[index]);
+                    }
+                }
+            }
+            onConnection(static_cast<SRTSOCKET>(socket), samples);
+        }
+    }
+
+    munmap(mapping, fileSize);
+    return valid;
+#endif
+}
@@ -0,0 +1,155 @@
+//
+// Memory mapped, fixed size, per connection history of SRT statistics for post-mortem analysis.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief Samples the statistics of every connection of an SRTNet instance at a fixed interval into a memory mapped
+ * file. The file has a fixed size and holds one slot per connection, each slot being a circular buffer of the last
+ * samplesPerConnection samples. Within a slot the samples are stored column by column, so an offline tool can read a
+ * single metric over time without touching the others. When there are more connections than slots, the slots of
+ * disconnected connections are reused, the oldest first.
+ *
+ * Since the file is a shared memory mapping, everything written is in the page cache as soon as it is written, and
+ * survives a crash of the process. A sample only becomes visible to readers once all of its columns are written.
+ *
+ * After open, sampling does not allocate any memory.
+ *
+ * File layout:
+ *   FileHeader
+ *   maxConnections x slot, each slotSize bytes:
+ *     SlotHeader
+ *     for each column: samplesPerConnection values of the column type
+ */
+class SRTNetStatsHistory {
+public:
+    static constexpr char kMagic[8] = {'S', 'R', 'T', 'N', 'S', 'T', 'A', 'T'};
+    static constexpr uint32_t kVersion = 1;
+    static constexpr size_t kMaxColumns = 32;
+
+    enum ColumnType : uint32_t { int64Column = 0, float32Column = 1 };
+
+    struct ColumnDescriptor {
+        char mName[24];
+        uint32_t mType;
+        uint32_t mOffset; // Offset of the first value of the column from the start of the slot
+    };
+
+    struct FileHeader {
+        char mMagic[8];
+        uint32_t mVersion;
+        uint32_t mColumnCount;
+        uint32_t mMaxConnections;
+        uint32_t mSamplesPerConnection;
+        uint32_t mIntervalMs;
+        uint32_t mSlotSize;
+        uint64_t mFirstSlotOffset;
+        ColumnDescriptor mColumns[kMaxColumns];
+    };
+
+    struct SlotHeader {
+        std::atomic<int64_t> mSocket;   // SRT_INVALID_SOCK if the slot has never been used
+        std::atomic<uint64_t> mWritten; // Total number of samples written to the slot since it was assigned
+        int64_t mReserved[2];
+    };
+
+    /// One sample as read back from the file, values in column order converted to double
+    struct Sample {
+        std::vector<double> mValues;
+    };
+
+    SRTNetStatsHistory() = default;
+
+    virtual ~SRTNetStatsHistory();
+
+    /**
+     * @brief Create (or truncate) and map the history file
+     * @param path Path of the file
+     * @param maxConnections Number of connection slots in the file
+     * @param samplesPerConnection Number of samples kept per connection
+     * @param interval Sampling interval, stored in the file header for the readers
+     * @return true if the file could be created and mapped
+     */
+    bool open(const std::string& path,
+              size_t maxConnections,
+              size_t samplesPerConnection,
+              std::chrono::milliseconds interval);
+
+    /**
+     * @brief Start sampling all connections of \p net every interval on a background thread. Works both in client and
+     * server mode. The SRTNet instance must outlive the sampling.
+     * @return true if sampling was started
+     */
+    bool start(SRTNet& net);
+
+    /**
+     * @brief Stop sampling, and unmap and close the file
+     */
+    void stop();
+
+    /**
+     * @brief Write one sample for \p socket. Used by the sampling thread, but can also be called directly when
+     * sampling is not started.
+     * @param socket The socket the statistics belongs to
+     * @param stats The statistics to write
+     * @param timestampUs The time of the sample, in microseconds since epoch
+     * @return false if the file is not open or all slots are taken by connections sampled in the current round
+     */
+    bool writeSample(SRTSOCKET socket, const SRT_TRACEBSTATS& stats, int64_t timestampUs);
+
+    /**
+     * @brief Mark the start of a new sampling round. Slots written since the previous round are protected from being
+     * reused for new connections in this round.
+     */
+    void beginRound();
+
+    /**
+     * @brief Read a history file, for example after a crash
+     * @param path Path of the file
+     * @param columns Set to the names of the columns
+     * @param onConnection Called once per used slot with the socket and its samples, oldest first
+     * @return false if the file could not be read or is not a history file
+     */
+    static bool readFile(const std::string& path,
+                         std::vector<std::string>& columns,
+                         const std::function<void(SRTSOCKET socket, const std::vector<Sample>& samples)>& onConnection);
+
+    SRTNetStatsHistory(SRTNetStatsHistory const&) = delete;
+    SRTNetStatsHistory& operator=(SRTNetStatsHistory const&) = delete;
+
+private:
+    SlotHeader* slotHeader(size_t slot) const;
+    int32_t findSlot(SRTSOCKET socket);
+    int32_t assignSlot(SRTSOCKET socket);
+    void samplingWorker(SRTNet* net);
+
+    uint8_t* mMapping = nullptr;
+    size_t mMappingSize = 0;
+    int mFileDescriptor = -1;
+    FileHeader* mHeader = nullptr;
+    std::chrono::milliseconds mInterval{1000};
+
+    // Socket to slot lookup, open addressing with linear probing, rebuilt every round
+    std::vector<int32_t> mSlotTable;
+    std::vector<uint64_t> mSlotRound;
+    uint64_t mRound = 0;
+    size_t mReuseCursor = 0;
+
+    std::vector<SRTSOCKET> mSockets;
+    std::thread mSamplingThread;
+    std::mutex mSamplingMtx;
+    std::condition_variable mSamplingCondition;
+    bool mSampling = false;
+};
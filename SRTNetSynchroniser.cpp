@@ -0,0 +1,238 @@
+//
+// Aligns the messages of several connections to an SRTNet server on their source time.
+//
+
+#include "SRTNetSynchroniser.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+namespace {
+// Weight of a new arrival delay in the smoothed arrival delay is 1 / kArrivalDelaySmoothing
+constexpr int64_t kArrivalDelaySmoothing = 16;
+// Max time the release thread sleeps, so the skew statistics are kept up to date when no messages are due
+constexpr int64_t kMaxSleepUs = 100000;
+} // namespace
+
+SRTNetSynchroniser::SRTNetSynchroniser(size_t maxMembers,
+                                       size_t slotsPerMember,
+                                       size_t maxMessageSize,
+                                       std::chrono::microseconds outputDelay,
+                                       Output output)
+    : mSlotsPerMember(std::max<size_t>(slotsPerMember, 1))
+    , mMaxMessageSize(maxMessageSize)
+    , mOutputDelayUs(outputDelay.count())
+    , mOutput(std::move(output)) {
+    for (size_t i = 0; i < maxMembers; ++i) {
+        auto member = std::make_unique<Member>();
+        member->mStorage.resize(mSlotsPerMember * mMaxMessageSize);
+        member->mSizes.resize(mSlotsPerMember);
+        member->mSrcTimes.resize(mSlotsPerMember);
+        mMembers.push_back(std::move(member));
+    }
+    mReleaseThread = std::thread(&SRTNetSynchroniser::releaseWorker, this);
+}
+
+SRTNetSynchroniser::~SRTNetSynchroniser() {
+    {
+        std::lock_guard<std::mutex> lock(mWakeMtx);
+        mStop = true;
+    }
+    mWakeCondition.notify_one();
+    mReleaseThread.join();
+}
+
+bool SRTNetSynchroniser::addMember(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mMembersMtx);
+    Member* freeMember = nullptr;
+    for (auto& member : mMembers) {
+        SRTSOCKET memberSocket = member->mSocket.load();
+        if (memberSocket == socket) {
+            return false;
+        }
+        if (memberSocket == SRT_INVALID_SOCK && freeMember == nullptr) {
+            freeMember = member.get();
+        }
+    }
+    if (freeMember == nullptr) {
+        return false;
+    }
+
+    freeMember->mHead = 0;
+    freeMember->mTail = 0;
+    freeMember->mLastPushedSrcTime = 0;
+    freeMember->mReleasedMessages = 0;
+    freeMember->mLateMessages = 0;
+    freeMember->mOverflowMessages = 0;
+    freeMember->mReorderedMessages = 0;
+    freeMember->mLastSrcTime = 0;
+    freeMember->mArrivalDelay = 0;
+    freeMember->mHasArrivalDelay = false;
+    // Publish the member to pushData last
+    freeMember->mSocket.store(socket, std::memory_order_release);
+    return true;
+}
+
+bool SRTNetSynchroniser::removeMember(SRTSOCKET socket) {
+    std::lock_guard<std::mutex> lock(mMembersMtx);
+    for (auto& member : mMembers) {
+        if (member->mSocket.load() == socket) {
+            member->mSocket = SRT_INVALID_SOCK;
+            member->mHead = member->mTail.load();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SRTNetSynchroniser::pushData(const uint8_t* data, size_t size, const SRT_MSGCTRL& msgCtrl, SRTSOCKET socket) {
+    Member* member = nullptr;
+    for (auto& candidate : mMembers) {
+        if (candidate->mSocket.load(std::memory_order_acquire) == socket) {
+            member = candidate.get();
+            break;
+        }
+    }
+    if (member == nullptr) {
+        return false;
+    }
+
+    const int64_t now = srt_time_now();
+    const int64_t srcTime = msgCtrl.srctime != 0 ? msgCtrl.srctime : now;
+
+    // Only this thread writes the arrival delay of the member, the atomic is for getStatistics
+    const int64_t arrivalDelay = now - srcTime;
+    if (!member->mHasArrivalDelay.load(std::memory_order_relaxed)) {
+        member->mArrivalDelay.store(arrivalDelay, std::memory_order_relaxed);
+        member->mHasArrivalDelay.store(true, std::memory_order_relaxed);
+    } else {
+        int64_t smoothed = member->mArrivalDelay.load(std::memory_order_relaxed);
+        member->mArrivalDelay.store(smoothed + (arrivalDelay - smoothed) / kArrivalDelaySmoothing,
+                                    std::memory_order_relaxed);
+    }
+
+    if (srcTime < member->mLastPushedSrcTime) {
+        member->mReorderedMessages++;
+        return false;
+    }
+    if (srcTime + mOutputDelayUs < now) {
+        member->mLateMessages++;
+        return false;
+    }
+    const uint64_t tail = member->mTail.load(std::memory_order_relaxed);
+    const uint64_t head = member->mHead.load(std::memory_order_acquire);
+    if (size > mMaxMessageSize || tail - head == mSlotsPerMember) {
+        member->mOverflowMessages++;
+        return false;
+    }
+
+    const size_t slot = tail % mSlotsPerMember;
+    memcpy(&member->mStorage[slot * mMaxMessageSize], data, size);
+    member->mSizes[slot] = static_cast<uint32_t>(size);
+    member->mSrcTimes[slot] = srcTime;
+    member->mTail.store(tail + 1, std::memory_order_release);
+    member->mLastPushedSrcTime = srcTime;
+
+    // The release thread only needs to wake up early when the member gets a new first message, later messages of the
+    // member are never due before it
+    if (tail == head) {
+        {
+            std::lock_guard<std::mutex> lock(mWakeMtx);
+            mWake = true;
+        }
+        mWakeCondition.notify_one();
+    }
+    return true;
+}
+
+void SRTNetSynchroniser::getStatistics(Statistics& statistics) const {
+    std::lock_guard<std::mutex> lock(mMembersMtx);
+    statistics.mMembers.clear();
+    int64_t minArrivalDelay = std::numeric_limits<int64_t>::max();
+    int64_t maxArrivalDelay = std::numeric_limits<int64_t>::min();
+    for (const auto& member : mMembers) {
+        SRTSOCKET socket = member->mSocket.load();
+        if (socket == SRT_INVALID_SOCK) {
+            continue;
+        }
+        MemberStatistics& memberStatistics = statistics.mMembers.emplace_back();
+        memberStatistics.mSocket = socket;
+        memberStatistics.mReleasedMessages = member->mReleasedMessages;
+        memberStatistics.mLateMessages = member->mLateMessages;
+        memberStatistics.mOverflowMessages = member->mOverflowMessages;
+        memberStatistics.mReorderedMessages = member->mReorderedMessages;
+        memberStatistics.mLastSrcTime = member->mLastSrcTime;
+        memberStatistics.mArrivalDelay = member->mArrivalDelay;
+        memberStatistics.mQueuedMessages = member->mTail - member->mHead;
+        if (member->mHasArrivalDelay) {
+            minArrivalDelay = std::min(minArrivalDelay, memberStatistics.mArrivalDelay);
+            maxArrivalDelay = std::max(maxArrivalDelay, memberStatistics.mArrivalDelay);
+        }
+    }
+    statistics.mSkew = maxArrivalDelay >= minArrivalDelay ? maxArrivalDelay - minArrivalDelay : 0;
+    statistics.mMaxSkew = std::max<int64_t>(mMaxSkew, statistics.mSkew);
+}
+
+void SRTNetSynchroniser::releaseWorker() {
+    while (true) {
+        int64_t sleepUs = kMaxSleepUs;
+        {
+            std::lock_guard<std::mutex> lock(mMembersMtx);
+            const int64_t now = srt_time_now();
+            // Release all due messages, the one with the lowest srctime of all members first
+            while (true) {
+                size_t first = mMembers.size();
+                int64_t firstSrcTime = std::numeric_limits<int64_t>::max();
+                for (size_t i = 0; i < mMembers.size(); ++i) {
+                    Member& member = *mMembers[i];
+                    const uint64_t head = member.mHead.load(std::memory_order_relaxed);
+                    if (member.mSocket.load(std::memory_order_relaxed) == SRT_INVALID_SOCK ||
+                        head == member.mTail.load(std::memory_order_acquire)) {
+                        continue;
+                    }
+                    const int64_t srcTime = member.mSrcTimes[head % mSlotsPerMember];
+                    if (srcTime < firstSrcTime) {
+                        first = i;
+                        firstSrcTime = srcTime;
+                    }
+                }
+                if (first == mMembers.size()) {
+                    break;
+                }
+                if (firstSrcTime + mOutputDelayUs > now) {
+                    sleepUs = std::min(sleepUs, firstSrcTime + mOutputDelayUs - now);
+                    break;
+                }
+
+                Member& member = *mMembers[first];
+                const uint64_t head = member.mHead.load(std::memory_order_relaxed);
+                const size_t slot = head % mSlotsPerMember;
+                mOutput(first, member.mSocket.load(std::memory_order_relaxed), &member.mStorage[slot * mMaxMessageSize],
+                        member.mSizes[slot], firstSrcTime);
+                member.mLastSrcTime = firstSrcTime;
+                member.mReleasedMessages++;
+                member.mHead.store(head + 1, std::memory_order_release);
+            }
+
+            int64_t minArrivalDelay = std::numeric_limits<int64_t>::max();
+            int64_t maxArrivalDelay = std::numeric_limits<int64_t>::min();
+            for (const auto& member : mMembers) {
+                if (member->mSocket.load(std::memory_order_relaxed) != SRT_INVALID_SOCK && member->mHasArrivalDelay) {
+                    minArrivalDelay = std::min(minArrivalDelay, member->mArrivalDelay.load());
+                    maxArrivalDelay = std::max(maxArrivalDelay, member->mArrivalDelay.load());
+                }
+            }
+            if (maxArrivalDelay >= minArrivalDelay && maxArrivalDelay - minArrivalDelay > mMaxSkew) {
+                mMaxSkew = maxArrivalDelay - minArrivalDelay;
+            }
+        }
+
+        std::unique_lock<std::mutex> lock(mWakeMtx);
+        mWakeCondition.wait_for(lock, std::chrono::microseconds(sleepUs), [&]() { return mWake || mStop; });
+        mWake = false;
+        if (mStop) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,142 @@
+//
+// Aligns the messages of several connections to an SRTNet server on their source time.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "SRTNet.h"
+
+/**
+ * @brief Holds the messages of a group of connections, for example the feeds of the cameras of a multi-camera
+ * production, and releases them in lockstep: every message is released at its srctime plus a common output delay, so
+ * messages with the same source time from different connections are released together, no matter how late each
+ * connection delivered them. The senders must set srctime from a common clock, such as the capture time of the frame.
+ *
+ * Every member has a ring of preallocated slots, so no memory is allocated per message. The rings are written from
+ * the receivedDataNoCopy callback of the server, without taking any lock, and read by the release thread of the
+ * synchroniser, which calls the output callback in srctime order across all members.
+ *
+ *     server.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl,
+ *                                     std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+ *         synchroniser.pushData(data, size, msgCtrl, socket);
+ *     };
+ *
+ * pushData must only be called for a member from one thread at a time, which is the case for the callbacks of an
+ * SRTNet server, and a member must be added before and removed after its connection delivers data, for example in the
+ * clientConnected and clientDisconnected callbacks.
+ */
+class SRTNetSynchroniser {
+public:
+    struct MemberStatistics {
+        SRTSOCKET mSocket = SRT_INVALID_SOCK;
+        uint64_t mReleasedMessages = 0;  // Messages passed to the output callback
+        uint64_t mLateMessages = 0;      // Messages dropped since they arrived after their release time
+        uint64_t mOverflowMessages = 0;  // Messages dropped since the ring of the member was full
+        uint64_t mReorderedMessages = 0; // Messages dropped since their srctime was before the previous one
+        int64_t mLastSrcTime = 0;        // srctime of the last released message
+        int64_t mArrivalDelay = 0;       // Smoothed time from srctime to the arrival of the messages (us)
+        size_t mQueuedMessages = 0;      // Messages waiting in the ring
+    };
+
+    using Output =
+        std::function<void(size_t member, SRTSOCKET socket, const uint8_t* data, size_t size, int64_t srcTime)>;
+
+    struct Statistics {
+        std::vector<MemberStatistics> mMembers;
+        int64_t mSkew = 0;    // Difference between the largest and smallest arrival delay of the members (us)
+        int64_t mMaxSkew = 0; // Largest skew seen since the synchroniser was created (us)
+    };
+
+    /**
+     * @brief Constructor
+     * @param maxMembers The max number of members, the rings of all of them are allocated up front
+     * @param slotsPerMember The number of messages each member can hold, must cover the output delay at the message
+     * rate of the member
+     * @param maxMessageSize The largest message that can be held, larger messages are dropped
+     * @param outputDelay The time from the srctime of a message until it is released
+     * @param output Called on the release thread for each released message, with the index of the member, its socket,
+     * the message and its srctime. Must not call addMember, removeMember or getStatistics.
+     */
+    SRTNetSynchroniser(size_t maxMembers,
+                       size_t slotsPerMember,
+                       size_t maxMessageSize,
+                       std::chrono::microseconds outputDelay,
+                       Output output);
+
+    virtual ~SRTNetSynchroniser();
+
+    /**
+     * @brief Add a connection to the group
+     * @return false if the socket already is a member or the group is full
+     */
+    bool addMember(SRTSOCKET socket);
+
+    /**
+     * @brief Remove a connection from the group, the messages it has in the ring are dropped
+     * @return false if the socket is not a member
+     */
+    bool removeMember(SRTSOCKET socket);
+
+    /**
+     * @brief Copy a received message into the ring of its member. Messages from sockets that are not members are
+     * ignored.
+     * @return false if the message was dropped
+     */
+    bool pushData(const uint8_t* data, size_t size, const SRT_MSGCTRL& msgCtrl, SRTSOCKET socket);
+
+    /**
+     * @brief Get the statistics of all members, and the skew between them
+     */
+    void getStatistics(Statistics& statistics) const;
+
+    SRTNetSynchroniser(SRTNetSynchroniser const&) = delete;
+    SRTNetSynchroniser& operator=(SRTNetSynchroniser const&) = delete;
+
+private:
+    // Single producer, single consumer ring of preallocated slots
+    struct Member {
+        std::atomic<SRTSOCKET> mSocket{SRT_INVALID_SOCK};
+        std::vector<uint8_t> mStorage;   // slotsPerMember * maxMessageSize bytes
+        std::vector<uint32_t> mSizes;
+        std::vector<int64_t> mSrcTimes;
+        std::atomic<uint64_t> mHead{0};  // Next slot to release, written by the release thread
+        std::atomic<uint64_t> mTail{0};  // Next slot to write, written by pushData
+        int64_t mLastPushedSrcTime = 0;  // Only used by pushData
+
+        std::atomic<uint64_t> mReleasedMessages{0};
+        std::atomic<uint64_t> mLateMessages{0};
+        std::atomic<uint64_t> mOverflowMessages{0};
+        std::atomic<uint64_t> mReorderedMessages{0};
+        std::atomic<int64_t> mLastSrcTime{0};
+        std::atomic<int64_t> mArrivalDelay{0};
+        std::atomic<bool> mHasArrivalDelay{false};
+    };
+
+    void releaseWorker();
+
+    const size_t mSlotsPerMember;
+    const size_t mMaxMessageSize;
+    const int64_t mOutputDelayUs;
+    const Output mOutput;
+
+    std::vector<std::unique_ptr<Member>> mMembers;
+    // Taken by addMember, removeMember and the release thread while releasing, never by pushData
+    mutable std::mutex mMembersMtx;
+
+    std::mutex mWakeMtx;
+    std::condition_variable mWakeCondition;
+    bool mWake = false;
+    bool mStop = false;
+    std::atomic<int64_t> mMaxSkew{0};
+    std::thread mReleaseThread;
+};
@@ -0,0 +1,291 @@
+//
+// Low overhead timeline tracing of the SRTNet threads, exported as Perfetto/Chrome JSON traces.
+//
+
+#include "SRTNetTrace.h"
+
+#include <algorithm>
+#include <condition_variable>
+#include <fstream>
+#include <mutex>
+#include <thread>
+
+struct SRTNetTrace::ThreadBuffer {
+    // An event kept in atomic fields, so a dump racing with the thread overwriting the event reads a torn event, which
+    // it then throws away, instead of a data race. The sequence of the event n is odd while it is written and 2n + 2
+    // once written.
+    struct Slot {
+        std::atomic<uint64_t> mSequence{0};
+        std::atomic<const char*> mName{nullptr};
+        std::atomic<uint64_t> mStartNs{0};
+        std::atomic<uint64_t> mDurationNs{0};
+        std::atomic<int64_t> mValue{0};
+        std::atomic<Phase> mPhase{Phase::complete};
+    };
+
+    uint32_t mThreadId = 0;
+    std::atomic<const char*> mThreadName{nullptr};
+    std::atomic<bool> mRetired{false};
+    uint64_t mRetiredAt = 0;
+    // Number of events ever written, the event n is stored at n % kEventsPerThread
+    std::atomic<uint64_t> mHead{0};
+    Slot mSlots[kEventsPerThread];
+};
+
+namespace {
+
+std::mutex gRegistryMtx;
+uint32_t gNextThreadId = 1;
+uint64_t gRetireCount = 0;
+
+std::atomic<uint64_t> gSlowCallbackThresholdNs{0};
+std::atomic<uint64_t> gTriggeredDumps{0};
+
+// The slow callback trigger and the thread writing its dumps. Never destroyed, since the detached dumper thread may
+// still wait on it while static objects are destroyed at exit.
+struct Trigger {
+    std::mutex mMtx;
+    std::condition_variable mCondition;
+    std::string mPath;
+    uint64_t mCooldownNs = 0;
+    uint64_t mLastTriggerNs = 0;
+    std::string mPendingPath; // The path of a dump the dumper thread is yet to write, empty if none
+    bool mDumperStarted = false;
+};
+
+Trigger& trigger() {
+    static auto* state = new Trigger();
+    return *state;
+}
+
+void writeEscaped(std::ostream& stream, const char* text) {
+    for (; *text; ++text) {
+        if (*text == '"' || *text == '\\') {
+            stream << '\\';
+        }
+        stream << *text;
+    }
+}
+
+} // namespace
+
+std::vector<std::unique_ptr<SRTNetTrace::ThreadBuffer>>& SRTNetTrace::registry() {
+    // Never destroyed, threads may still record events while static objects are destroyed at exit
+    static auto* buffers = new std::vector<std::unique_ptr<ThreadBuffer>>();
+    return *buffers;
+}
+
+SRTNetTrace::ThreadBuffer& SRTNetTrace::threadBuffer() {
+    // Marks the buffer as retired when the thread exits, it is reused by a later thread once enough threads exited
+    struct Owner {
+        ThreadBuffer* mBuffer = nullptr;
+        ~Owner() {
+            if (mBuffer) {
+                std::lock_guard<std::mutex> lock(gRegistryMtx);
+                mBuffer->mRetiredAt = ++gRetireCount;
+                mBuffer->mRetired = true;
+            }
+        }
+    };
+    thread_local Owner owner;
+    if (owner.mBuffer) {
+        return *owner.mBuffer;
+    }
+
+    std::lock_guard<std::mutex> lock(gRegistryMtx);
+    auto& buffers = registry();
+    std::vector<ThreadBuffer*> retired;
+    for (auto& buffer : buffers) {
+        if (buffer->mRetired) {
+            retired.push_back(buffer.get());
+        }
+    }
+    ThreadBuffer* buffer;
+    if (retired.size() >= kMaxRetiredThreads) {
+        buffer = *std::min_element(retired.begin(), retired.end(), [](ThreadBuffer* a, ThreadBuffer* b) {
+            return a->mRetiredAt < b->mRetiredAt;
+        });
+        // The events of the previous owner are discarded, readers skip buffers without events
+        buffer->mHead = 0;
+        for (auto& slot : buffer->mSlots) {
+            slot.mSequence.store(0, std::memory_order_relaxed);
+        }
+        buffer->mThreadName = nullptr;
+        buffer->mRetired = false;
+    } else {
+        buffers.push_back(std::make_unique<ThreadBuffer>());
+        buffer = buffers.back().get();
+    }
+    buffer->mThreadId = gNextThreadId++;
+    owner.mBuffer = buffer;
+    return *buffer;
+}
+
+void SRTNetTrace::setThreadName(const char* name) {
+    threadBuffer().mThreadName.store(name, std::memory_order_release);
+}
+
+void SRTNetTrace::record(const Event& event) {
+    ThreadBuffer& buffer = threadBuffer();
+    uint64_t head = buffer.mHead.load(std::memory_order_relaxed);
+    ThreadBuffer::Slot& slot = buffer.mSlots[head % kEventsPerThread];
+    slot.mSequence.store(2 * head + 1, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+    slot.mName.store(event.mName, std::memory_order_relaxed);
+    slot.mStartNs.store(event.mStartNs, std::memory_order_relaxed);
+    slot.mDurationNs.store(event.mDurationNs, std::memory_order_relaxed);
+    slot.mValue.store(event.mValue, std::memory_order_relaxed);
+    slot.mPhase.store(event.mPhase, std::memory_order_relaxed);
+    slot.mSequence.store(2 * head + 2, std::memory_order_release);
+    buffer.mHead.store(head + 1, std::memory_order_release);
+}
+
+void SRTNetTrace::complete(const char* name, uint64_t startNs, uint64_t durationNs, int64_t value, bool callback) {
+    record({name, startNs, durationNs, value, Phase::complete});
+    if (callback) {
+        uint64_t threshold = gSlowCallbackThresholdNs.load(std::memory_order_relaxed);
+        if (threshold != 0 && durationNs > threshold) {
+            slowCallback(durationNs);
+        }
+    }
+}
+
+void SRTNetTrace::instant(const char* name, int64_t value) {
+    record({name, nowNs(), 0, value, Phase::instant});
+}
+
+void SRTNetTrace::slowCallback(uint64_t durationNs) {
+    // Record the event before the dumper is woken, so that the dump includes it
+    instant("slowCallback", static_cast<int64_t>(durationNs));
+    Trigger& state = trigger();
+    {
+        std::lock_guard<std::mutex> lock(state.mMtx);
+        uint64_t now = nowNs();
+        if (state.mPath.empty() || (state.mLastTriggerNs != 0 && now - state.mLastTriggerNs < state.mCooldownNs)) {
+            return;
+        }
+        state.mLastTriggerNs = now;
+        state.mPendingPath = state.mPath;
+    }
+    state.mCondition.notify_one();
+}
+
+void SRTNetTrace::dumpWorker() {
+    Trigger& state = trigger();
+    std::unique_lock<std::mutex> lock(state.mMtx);
+    while (true) {
+        state.mCondition.wait(lock, [&]() { return !state.mPendingPath.empty(); });
+        std::string path = std::move(state.mPendingPath);
+        state.mPendingPath.clear();
+        lock.unlock();
+        if (dump(path)) {
+            gTriggeredDumps++;
+        }
+        lock.lock();
+    }
+}
+
+void SRTNetTrace::setSlowCallbackTrigger(std::chrono::milliseconds threshold,
+                                         const std::string& path,
+                                         std::chrono::seconds cooldown) {
+    Trigger& state = trigger();
+    std::lock_guard<std::mutex> lock(state.mMtx);
+    state.mPath = path;
+    state.mCooldownNs = std::chrono::duration_cast<std::chrono::nanoseconds>(cooldown).count();
+    state.mLastTriggerNs = 0;
+    if (threshold.count() > 0 && !state.mDumperStarted) {
+        // Started here rather than on the first slow callback, so the traced threads never start a thread
+        std::thread(&SRTNetTrace::dumpWorker).detach();
+        state.mDumperStarted = true;
+    }
+    gSlowCallbackThresholdNs = std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count();
+}
+
+uint64_t SRTNetTrace::getTriggeredDumpCount() {
+    return gTriggeredDumps;
+}
+
+void SRTNetTrace::writeTrace(std::ostream& stream) {
+    struct ThreadEvents {
+        uint32_t mThreadId;
+        const char* mThreadName;
+        std::vector<Event> mEvents;
+    };
+    std::vector<ThreadEvents> threads;
+
+    // Only copy the events with the registry locked, formatting and writing them, possibly to disk, is done without
+    // blocking the threads that start or exit meanwhile
+    {
+        std::lock_guard<std::mutex> lock(gRegistryMtx);
+        threads.reserve(registry().size());
+        for (const auto& buffer : registry()) {
+            uint64_t head = buffer->mHead.load(std::memory_order_acquire);
+            uint64_t begin = head > kEventsPerThread ? head - kEventsPerThread : 0;
+            std::vector<Event> events;
+            events.reserve(head - begin);
+            for (uint64_t index = begin; index < head; ++index) {
+                // The thread keeps on writing while the events are copied, drop the events overwritten meanwhile
+                const ThreadBuffer::Slot& slot = buffer->mSlots[index % kEventsPerThread];
+                uint64_t sequence = slot.mSequence.load(std::memory_order_acquire);
+                if (sequence != 2 * index + 2) {
+                    continue;
+                }
+                Event event{slot.mName.load(std::memory_order_relaxed), slot.mStartNs.load(std::memory_order_relaxed),
+                            slot.mDurationNs.load(std::memory_order_relaxed),
+                            slot.mValue.load(std::memory_order_relaxed), slot.mPhase.load(std::memory_order_relaxed)};
+                std::atomic_thread_fence(std::memory_order_acquire);
+                if (slot.mSequence.load(std::memory_order_relaxed) == sequence) {
+                    events.push_back(event);
+                }
+            }
+            if (events.empty()) {
+                continue;
+            }
+            threads.push_back(
+                {buffer->mThreadId, buffer->mThreadName.load(std::memory_order_acquire), std::move(events)});
+        }
+    }
+
+    stream << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    bool first = true;
+    auto separator = [&]() {
+        if (!first) {
+            stream << ",\n";
+        }
+        first = false;
+    };
+
+    for (const auto& thread : threads) {
+        if (thread.mThreadName) {
+            separator();
+            stream << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << thread.mThreadId
+                   << ",\"args\":{\"name\":\"";
+            writeEscaped(stream, thread.mThreadName);
+            stream << "\"}}";
+        }
+        for (const Event& event : thread.mEvents) {
+            separator();
+            stream << "{\"name\":\"";
+            writeEscaped(stream, event.mName);
+            stream << "\",\"pid\":1,\"tid\":" << thread.mThreadId << ",\"ts\":" << event.mStartNs / 1000 << "."
+                   << event.mStartNs % 1000 / 100 << event.mStartNs % 100 / 10 << event.mStartNs % 10;
+            if (event.mPhase == Phase::complete) {
+                stream << ",\"ph\":\"X\",\"dur\":" << event.mDurationNs / 1000 << "." << event.mDurationNs % 1000 / 100
+                       << event.mDurationNs % 100 / 10 << event.mDurationNs % 10;
+            } else {
+                stream << ",\"ph\":\"i\",\"s\":\"t\"";
+            }
+            stream << ",\"args\":{\"value\":" << event.mValue << "}}";
+        }
+    }
+    stream << "]}\n";
+}
+
+bool SRTNetTrace::dump(const std::string& path) {
+    std::ofstream file(path, std::ios::trunc);
+    if (!file) {
+        return false;
+    }
+    writeTrace(file);
+    return static_cast<bool>(file);
+}
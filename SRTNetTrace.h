@@ -0,0 +1,141 @@
+//
+// Low overhead timeline tracing of the SRTNet threads, exported as Perfetto/Chrome JSON traces.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Records compact events into one fixed size ring buffer per thread. Recording an event never takes a lock or
+ * allocates, the only lock is taken the first time a thread records an event, to register its buffer. When a ring is
+ * full the oldest events are overwritten, so a dump always holds the most recent kEventsPerThread events of each
+ * thread. Buffers of threads that have exited are kept, so their events are still part of later dumps, and are recycled
+ * when new threads start.
+ *
+ * The SRTNet threads are only instrumented when built with SRTNET_ENABLE_TRACE (the CMake option ENABLE_TRACE), without
+ * it the SRTNET_TRACE_ macros compile to nothing.
+ *
+ * Load a dump in https://ui.perfetto.dev or chrome://tracing.
+ */
+class SRTNetTrace {
+public:
+    static constexpr size_t kEventsPerThread = 16384;
+    static constexpr size_t kMaxRetiredThreads = 16;
+
+    enum class Phase : uint8_t { complete, instant };
+
+    struct Event {
+        const char* mName; // Must be a string literal, or live for as long as the process
+        uint64_t mStartNs;
+        uint64_t mDurationNs;
+        int64_t mValue;
+        Phase mPhase;
+    };
+
+    /**
+     * @brief Records a complete event spanning the lifetime of the scope object
+     */
+    class Scope {
+    public:
+        /**
+         * @param name The event name, must be a string literal
+         * @param callback true if the scope wraps a user callback, only those can fire the slow callback trigger
+         */
+        explicit Scope(const char* name, bool callback = false)
+            : mName(name)
+            , mCallback(callback)
+            , mStartNs(nowNs()) {
+        }
+
+        ~Scope() {
+            complete(mName, mStartNs, nowNs() - mStartNs, 0, mCallback);
+        }
+
+        Scope(Scope const&) = delete;
+        Scope& operator=(Scope const&) = delete;
+
+    private:
+        const char* mName;
+        bool mCallback;
+        uint64_t mStartNs;
+    };
+
+    /**
+     * @brief Name the calling thread in the trace, the name must be a string literal
+     */
+    static void setThreadName(const char* name);
+
+    /**
+     * @brief Record an event with a duration
+     * @param callback true if the event is a user callback, see setSlowCallbackTrigger
+     */
+    static void complete(const char* name, uint64_t startNs, uint64_t durationNs, int64_t value, bool callback = false);
+
+    /**
+     * @brief Record an event without a duration, such as an epoll wakeup
+     * @param value Shown as an argument of the event, for example the number of ready sockets
+     */
+    static void instant(const char* name, int64_t value = 0);
+
+    /**
+     * @brief Write all recorded events as a Chrome JSON trace. Can be called at any time from any thread, the threads
+     * being traced are not stopped.
+     */
+    static void writeTrace(std::ostream& stream);
+
+    /**
+     * @brief Write all recorded events as a Chrome JSON trace to a file
+     * @return false if the file could not be written
+     */
+    static bool dump(const std::string& path);
+
+    /**
+     * @brief Dump the trace to \p path when a callback runs for longer than \p threshold. The thread that ran the slow
+     * callback only records the event and wakes a background thread, which writes the dump, at most once per
+     * \p cooldown. A zero threshold disables the trigger.
+     */
+    static void setSlowCallbackTrigger(std::chrono::milliseconds threshold,
+                                       const std::string& path,
+                                       std::chrono::seconds cooldown = std::chrono::seconds(10));
+
+    /**
+     * @return The number of dumps the slow callback trigger has finished writing
+     */
+    static uint64_t getTriggeredDumpCount();
+
+    static uint64_t nowNs() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+private:
+    struct ThreadBuffer;
+
+    static std::vector<std::unique_ptr<ThreadBuffer>>& registry();
+    static ThreadBuffer& threadBuffer();
+    static void record(const Event& event);
+    static void slowCallback(uint64_t durationNs);
+    static void dumpWorker();
+};
+
+#ifdef SRTNET_ENABLE_TRACE
+#define SRTNET_TRACE_CONCAT_INNER(a, b) a##b
+#define SRTNET_TRACE_CONCAT(a, b) SRTNET_TRACE_CONCAT_INNER(a, b)
+#define SRTNET_TRACE_SCOPE(name) SRTNetTrace::Scope SRTNET_TRACE_CONCAT(srtNetTraceScope, __LINE__)(name)
+#define SRTNET_TRACE_CALLBACK_SCOPE(name) SRTNetTrace::Scope SRTNET_TRACE_CONCAT(srtNetTraceScope, __LINE__)(name, true)
+#define SRTNET_TRACE_INSTANT(name, value) SRTNetTrace::instant(name, value)
+#define SRTNET_TRACE_THREAD_NAME(name) SRTNetTrace::setThreadName(name)
+#else
+#define SRTNET_TRACE_SCOPE(name)
+#define SRTNET_TRACE_CALLBACK_SCOPE(name)
+#define SRTNET_TRACE_INSTANT(name, value)
+#define SRTNET_TRACE_THREAD_NAME(name)
+#endif
@@ -0,0 +1,341 @@
+//
+// Playout of MPEG-TS files into SRT, paced by the PCR of the file.
+//
+
+#include "SRTNetTsPlayout.h"
+
+#include <algorithm>
+#include <cstring>
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const uint8_t kSyncByte = 0x47;
+const size_t kPidCount = 8192;
+const uint8_t kNoContinuityAdvance = 0xFF;
+const uint64_t kPcrWrap = (uint64_t(1) << 33) * 300; // The PCR is a 33 bit 90 kHz base and a 300 step extension
+const uint64_t kPcrClock = 27000000;
+
+uint16_t pidOf(const uint8_t* packet) {
+    return static_cast<uint16_t>(((packet[1] & 0x1F) << 8) | packet[2]);
+}
+
+bool hasPayload(const uint8_t* packet) {
+    return (packet[3] & 0x10) != 0;
+}
+
+bool hasPcr(const uint8_t* packet) {
+    return (packet[3] & 0x20) && packet[4] >= 7 && (packet[5] & 0x10);
+}
+
+uint64_t readPcr(const uint8_t* packet) {
+    uint64_t base = (uint64_t(packet[6]) << 25) | (uint64_t(packet[7]) << 17) | (uint64_t(packet[8]) << 9) |
+                    (uint64_t(packet[9]) << 1) | (packet[10] >> 7);
+    uint64_t extension = (uint64_t(packet[10] & 0x01) << 8) | packet[11];
+    return base * 300 + extension;
+}
+
+void writePcr(uint8_t* packet, uint64_t pcr) {
+    uint64_t base = pcr / 300;
+    uint64_t extension = pcr % 300;
+    packet[6] = static_cast<uint8_t>(base >> 25);
+    packet[7] = static_cast<uint8_t>(base >> 17);
+    packet[8] = static_cast<uint8_t>(base >> 9);
+    packet[9] = static_cast<uint8_t>(base >> 1);
+    packet[10] = static_cast<uint8_t>(((base & 0x01) << 7) | 0x7E | (extension >> 8));
+    packet[11] = static_cast<uint8_t>(extension);
+}
+
+} // namespace
+
+SRTNetTsPlayout::~SRTNetTsPlayout() {
+    stop();
+    unmap();
+}
+
+bool SRTNetTsPlayout::open(const std::string& path) {
+#ifdef WIN32
+    return false;
+#else
+    if (mMapping || mPlaying) {
+        return false;
+    }
+    int fileDescriptor = ::open(path.c_str(), O_RDONLY);
+    if (fileDescriptor < 0) {
+        return false;
+    }
+    struct stat fileStatus {};
+    if (fstat(fileDescriptor, &fileStatus) != 0 || static_cast<size_t>(fileStatus.st_size) < kTsPacketSize) {
+        ::close(fileDescriptor);
+        return false;
+    }
+    mMappingSize = fileStatus.st_size;
+    void* mapping = mmap(nullptr, mMappingSize, PROT_READ, MAP_PRIVATE, fileDescriptor, 0);
+    ::close(fileDescriptor);
+    if (mapping == MAP_FAILED) {
+        return false;
+    }
+    mMapping = static_cast<const uint8_t*>(mapping);
+    madvise(mapping, mMappingSize, MADV_SEQUENTIAL);
+    mPacketCount = mMappingSize / kTsPacketSize;
+
+    // Find the PCRs of the first PID carrying a PCR, and the first and last continuity counter of every PID
+    int pcrPid = -1;
+    std::vector<std::pair<size_t, uint64_t>> pcrs; // Packet index and unwrapped PCR
+    std::vector<int> firstContinuity(kPidCount, -1);
+    std::vector<int> lastContinuity(kPidCount, -1);
+    for (size_t index = 0; index < mPacketCount; ++index) {
+        const uint8_t* packet = mMapping + index * kTsPacketSize;
+        if (packet[0] != kSyncByte) {
+            unmap();
+            return false;
+        }
+        uint16_t pid = pidOf(packet);
+        if (hasPayload(packet)) {
+            if (firstContinuity[pid] < 0) {
+                firstContinuity[pid] = packet[3] & 0x0F;
+            }
+            lastContinuity[pid] = packet[3] & 0x0F;
+        }
+        if (hasPcr(packet) && (pcrPid < 0 || pcrPid == pid)) {
+            pcrPid = pid;
+            uint64_t pcr = readPcr(packet);
+            if (!pcrs.empty()) {
+                // Unwrap, the PCR wraps around about every 26.5 hours
+                uint64_t previous = pcrs.back().second;
+                uint64_t wraps = previous / kPcrWrap;
+                pcr += wraps * kPcrWrap;
+                if (pcr + kPcrWrap / 2 < previous) {
+                    pcr += kPcrWrap;
+                }
+                if (pcr <= previous) {
+                    continue; // Not increasing, can't be used for pacing
+                }
+            }
+            pcrs.emplace_back(index, pcr);
+        }
+    }
+    if (pcrs.size() < 2) {
+        unmap();
+        return false;
+    }
+
+    // The time of every packet, interpolated between the PCRs around it and extrapolated before the first and after the
+    // last PCR, relative to the time of the first packet
+    auto packetTimePcr = [&](size_t index) -> double {
+        auto upper = std::upper_bound(
+            pcrs.begin(), pcrs.end(), index,
+            [](size_t value, const std::pair<size_t, uint64_t>& pcr) { return value < pcr.first; });
+        size_t segment = std::clamp<size_t>(upper - pcrs.begin(), 1, pcrs.size() - 1);
+        const auto& [fromIndex, fromPcr] = pcrs[segment - 1];
+        const auto& [toIndex, toPcr] = pcrs[segment];
+        double pcrPerPacket = static_cast<double>(toPcr - fromPcr) / static_cast<double>(toIndex - fromIndex);
+        return static_cast<double>(fromPcr) +
+               (static_cast<double>(index) - static_cast<double>(fromIndex)) * pcrPerPacket;
+    };
+    const double firstPacketPcr = packetTimePcr(0);
+    auto toNs = [&](double pcr) {
+        return static_cast<int64_t>((pcr - firstPacketPcr) * 1e9 / kPcrClock);
+    };
+
+    size_t messageCount = (mPacketCount + kPacketsPerMessage - 1) / kPacketsPerMessage;
+    mMessageOffsetsNs.resize(messageCount);
+    for (size_t message = 0; message < messageCount; ++message) {
+        mMessageOffsetsNs[message] = toNs(packetTimePcr(message * kPacketsPerMessage));
+    }
+    double loopEndPcr = packetTimePcr(mPacketCount);
+    mLoopDurationNs = toNs(loopEndPcr);
+    mLoopDurationPcr = static_cast<uint64_t>(loopEndPcr - firstPacketPcr);
+
+    mContinuityAdvance.assign(kPidCount, kNoContinuityAdvance);
+    for (size_t pid = 0; pid < kPidCount; ++pid) {
+        if (firstContinuity[pid] >= 0) {
+            // The first packet of the next loop must follow the last packet of this loop
+            mContinuityAdvance[pid] = static_cast<uint8_t>((lastContinuity[pid] + 1 - firstContinuity[pid]) & 0x0F);
+        }
+    }
+    return true;
+#endif
+}
+
+void SRTNetTsPlayout::unmap() {
+#ifndef WIN32
+    if (mMapping) {
+        munmap(const_cast<uint8_t*>(mMapping), mMappingSize);
+        mMapping = nullptr;
+        mMappingSize = 0;
+        mPacketCount = 0;
+        mMessageOffsetsNs.clear();
+    }
+#endif
+}
+
+bool SRTNetTsPlayout::start(SRTNet& net, SRTNetTsPlayoutScheduler& scheduler, bool loop, SRTSOCKET targetSystem) {
+    if (!mMapping || mPlaying) {
+        return false;
+    }
+    mNet = &net;
+    mScheduler = &scheduler;
+    mTargetSystem = targetSystem;
+    mLoop = loop;
+    mNextSequence = 0;
+    mSentMessages = 0;
+    mLateMessages = 0;
+    mFailedMessages = 0;
+
+    // Both clocks are sampled together, so a scheduled time on the steady clock maps to a srctime on the SRT clock. The
+    // SRT clock is sampled first, since SRT rejects messages with a srctime in the future.
+    mStartSrtTimeUs = srt_time_now();
+    mStartTime = std::chrono::steady_clock::now();
+    mPlaying = true;
+    scheduler.add(this, mStartTime);
+    return true;
+}
+
+void SRTNetTsPlayout::stop() {
+    if (mScheduler) {
+        mScheduler->remove(this);
+        mScheduler = nullptr;
+    }
+    mPlaying = false;
+}
+
+void SRTNetTsPlayout::buildMessage(uint64_t sequence, uint8_t* buffer, size_t& size, int64_t& offsetNs) const {
+    const size_t messageCount = mMessageOffsetsNs.size();
+    const uint64_t loop = sequence / messageCount;
+    const size_t message = sequence % messageCount;
+    const size_t firstPacket = message * kPacketsPerMessage;
+    const size_t packets = std::min(kPacketsPerMessage, mPacketCount - firstPacket);
+
+    size = packets * kTsPacketSize;
+    offsetNs = static_cast<int64_t>(loop) * mLoopDurationNs + mMessageOffsetsNs[message];
+    memcpy(buffer, mMapping + firstPacket * kTsPacketSize, size);
+    if (loop == 0) {
+        return;
+    }
+
+    const uint64_t pcrShift = (loop * mLoopDurationPcr) % kPcrWrap;
+    for (size_t packet = 0; packet < packets; ++packet) {
+        uint8_t* tsPacket = buffer + packet * kTsPacketSize;
+        uint8_t advance = mContinuityAdvance[pidOf(tsPacket)];
+        if (advance != kNoContinuityAdvance) {
+            uint8_t continuity = static_cast<uint8_t>(((tsPacket[3] & 0x0F) + loop * advance) & 0x0F);
+            tsPacket[3] = static_cast<uint8_t>((tsPacket[3] & 0xF0) | continuity);
+        }
+        if (hasPcr(tsPacket)) {
+            writePcr(tsPacket, (readPcr(tsPacket) + pcrShift) % kPcrWrap);
+        }
+    }
+}
+
+std::chrono::steady_clock::time_point SRTNetTsPlayout::sendDueMessages(std::chrono::steady_clock::time_point now) {
+    const uint64_t messageCount = mMessageOffsetsNs.size();
+    uint8_t buffer[kMessageSize];
+    while (mLoop || mNextSequence < messageCount) {
+        size_t size;
+        int64_t offsetNs;
+        buildMessage(mNextSequence, buffer, size, offsetNs);
+        auto due = mStartTime + std::chrono::nanoseconds(offsetNs);
+        if (due > now) {
+            return due;
+        }
+
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        msgCtrl.srctime = mStartSrtTimeUs + offsetNs / 1000;
+        if (mNet->sendData(buffer, size, &msgCtrl, mTargetSystem)) {
+            mSentMessages.fetch_add(1, std::memory_order_relaxed);
+            if (now - due > kLateThreshold) {
+                mLateMessages.fetch_add(1, std::memory_order_relaxed);
+            }
+        } else {
+            mFailedMessages.fetch_add(1, std::memory_order_relaxed);
+        }
+        mNextSequence++;
+    }
+    mPlaying = false;
+    return std::chrono::steady_clock::time_point::max();
+}
+
+SRTNetTsPlayoutScheduler::SRTNetTsPlayoutScheduler() {
+    mThread = std::thread(&SRTNetTsPlayoutScheduler::schedulerWorker, this);
+}
+
+SRTNetTsPlayoutScheduler::~SRTNetTsPlayoutScheduler() {
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        mRunning = false;
+    }
+    mCondition.notify_one();
+    mThread.join();
+}
+
+namespace {
+const auto kLaterDue = [](const auto& a, const auto& b) { return a.mDue > b.mDue; };
+} // namespace
+
+void SRTNetTsPlayoutScheduler::add(SRTNetTsPlayout* playout, std::chrono::steady_clock::time_point due) {
+    {
+        std::lock_guard<std::mutex> lock(mMtx);
+        mEntries.push_back({due, playout});
+        std::push_heap(mEntries.begin(), mEntries.end(), kLaterDue);
+    }
+    mCondition.notify_one();
+}
+
+void SRTNetTsPlayoutScheduler::remove(SRTNetTsPlayout* playout) {
+    std::unique_lock<std::mutex> lock(mMtx);
+    mEntries.erase(std::remove_if(mEntries.begin(), mEntries.end(),
+                                  [&](const Entry& entry) { return entry.mPlayout == playout; }),
+                   mEntries.end());
+    std::make_heap(mEntries.begin(), mEntries.end(), kLaterDue);
+    // The scheduler thread sends without the lock, wait for it to be done with the playout so it is not in use once
+    // this returns, and tell it not to schedule the playout again
+    if (mSending == playout) {
+        mSendingRemoved = true;
+        mSendDone.wait(lock, [&]() { return mSending != playout; });
+    }
+}
+
+void SRTNetTsPlayoutScheduler::schedulerWorker() {
+    std::unique_lock<std::mutex> lock(mMtx);
+    while (mRunning) {
+        if (mEntries.empty()) {
+            mCondition.wait(lock);
+            continue;
+        }
+        auto due = mEntries.front().mDue;
+        if (mCondition.wait_until(lock, due) != std::cv_status::timeout && std::chrono::steady_clock::now() < due) {
+            // Woken up by a change of the entries, start over since the first entry might have changed
+            continue;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        while (mRunning && !mEntries.empty() && mEntries.front().mDue <= now) {
+            std::pop_heap(mEntries.begin(), mEntries.end(), kLaterDue);
+            Entry entry = mEntries.back();
+            mEntries.pop_back();
+
+            // Sending may block on a congested connection, so don't hold the lock while sending, which would also
+            // block adding and removing any other playout
+            mSending = entry.mPlayout;
+            mSendingRemoved = false;
+            lock.unlock();
+            auto next = entry.mPlayout->sendDueMessages(now);
+            lock.lock();
+            bool removed = mSendingRemoved;
+            mSending = nullptr;
+            mSendDone.notify_all();
+
+            if (!removed && next != std::chrono::steady_clock::time_point::max()) {
+                mEntries.push_back({next, entry.mPlayout});
+                std::push_heap(mEntries.begin(), mEntries.end(), kLaterDue);
+            }
+        }
+    }
+}
@@ -0,0 +1,185 @@
+//
+// Playout of MPEG-TS files into SRT, paced by the PCR of the file.
+//
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SRTNet.h"
+
+class SRTNetTsPlayoutScheduler;
+
+/**
+ * @brief Sends a memory mapped TS file over an SRTNet connection in messages of up to 7 TS packets (1316 bytes), each
+ * message at the time given by the PCR of the file. The send time of every message is computed up front by linear
+ * interpolation between the PCRs. Each message is sent with srctime set to its scheduled time rather than the time it
+ * was actually sent, so SRT delivers the messages to the receiver with the pacing of the file, even if the sending
+ * thread wakes up late.
+ *
+ * When looping, the PCRs of the loops after the first one are moved forward by the duration of the file, and the
+ * continuity counters of every PID continue from the previous loop, so a receiver sees one continuous stream. Other
+ * timestamps, such as the PTS and DTS, are sent as they are in the file.
+ *
+ * The playouts are paced by an SRTNetTsPlayoutScheduler, one scheduler thread can pace many playouts.
+ */
+class SRTNetTsPlayout {
+public:
+    static constexpr size_t kTsPacketSize = 188;
+    static constexpr size_t kPacketsPerMessage = 7;
+    static constexpr size_t kMessageSize = kTsPacketSize * kPacketsPerMessage;
+
+    SRTNetTsPlayout() = default;
+
+    virtual ~SRTNetTsPlayout();
+
+    /**
+     * @brief Map a TS file and compute the send schedule from its PCRs
+     * @param path The file, must start with a TS packet and contain at least two PCRs on the same PID
+     * @return false if the file could not be mapped or has no usable PCRs
+     */
+    bool open(const std::string& path);
+
+    /**
+     * @brief Start sending the file
+     * @param net The SRTNet instance to send with, must outlive the playout
+     * @param scheduler The scheduler pacing the playout, must outlive the playout
+     * @param loop true to play the file over and over until stopped, false to play it once
+     * @param targetSystem The client to send to in server mode, see SRTNet::sendData
+     * @return false if no file is open or the playout is already started
+     */
+    bool start(SRTNet& net, SRTNetTsPlayoutScheduler& scheduler, bool loop, SRTSOCKET targetSystem = 0);
+
+    /**
+     * @brief Stop sending, returns when the playout is no longer used by the scheduler
+     */
+    void stop();
+
+    /**
+     * @brief Build a message of the playout
+     * @param sequence Message number counted from the start of the playout, including previous loops
+     * @param buffer Buffer of at least kMessageSize bytes receiving the message, with PCR and continuity counter fixups
+     * for the loop the message is in
+     * @param size Set to the size of the message
+     * @param offsetNs Set to the time of the message relative to the start of the playout
+     */
+    void buildMessage(uint64_t sequence, uint8_t* buffer, size_t& size, int64_t& offsetNs) const;
+
+    /**
+     * @return The number of messages in one loop of the file
+     */
+    size_t getMessageCount() const {
+        return mMessageOffsetsNs.size();
+    }
+
+    /**
+     * @return The duration of one loop of the file
+     */
+    std::chrono::nanoseconds getDuration() const {
+        return std::chrono::nanoseconds(mLoopDurationNs);
+    }
+
+    /**
+     * @return true while the playout is running, false after stop or when a non-looping playout has finished
+     */
+    bool isPlaying() const {
+        return mPlaying;
+    }
+
+    uint64_t getSentMessages() const {
+        return mSentMessages;
+    }
+
+    /// Messages sent more than kLateThreshold after their scheduled time
+    uint64_t getLateMessages() const {
+        return mLateMessages;
+    }
+
+    uint64_t getFailedMessages() const {
+        return mFailedMessages;
+    }
+
+    static constexpr std::chrono::milliseconds kLateThreshold{2};
+
+    SRTNetTsPlayout(SRTNetTsPlayout const&) = delete;
+    SRTNetTsPlayout& operator=(SRTNetTsPlayout const&) = delete;
+
+private:
+    friend class SRTNetTsPlayoutScheduler;
+
+    /**
+     * @brief Send all messages that are due, called from the scheduler thread
+     * @return The time the next message is due, or time_point::max() when the playout has finished
+     */
+    std::chrono::steady_clock::time_point sendDueMessages(std::chrono::steady_clock::time_point now);
+    void unmap();
+
+    const uint8_t* mMapping = nullptr;
+    size_t mMappingSize = 0;
+    size_t mPacketCount = 0;
+
+    std::vector<int64_t> mMessageOffsetsNs;
+    int64_t mLoopDurationNs = 0;
+    uint64_t mLoopDurationPcr = 0;
+    // Per PID continuity counter advance of one loop, 0xFF for PIDs not in the file
+    std::vector<uint8_t> mContinuityAdvance;
+
+    SRTNet* mNet = nullptr;
+    SRTNetTsPlayoutScheduler* mScheduler = nullptr;
+    SRTSOCKET mTargetSystem = 0;
+    bool mLoop = false;
+    std::chrono::steady_clock::time_point mStartTime;
+    int64_t mStartSrtTimeUs = 0;
+    uint64_t mNextSequence = 0;
+
+    std::atomic<bool> mPlaying{false};
+    std::atomic<uint64_t> mSentMessages{0};
+    std::atomic<uint64_t> mLateMessages{0};
+    std::atomic<uint64_t> mFailedMessages{0};
+};
+
+/**
+ * @brief A thread pacing any number of SRTNetTsPlayout instances. It sleeps until the next message of any playout is
+ * due, so its CPU usage is only the cost of sending. It sends without holding its lock, so starting and stopping
+ * playouts never waits for a send on a congested connection, except stopping the playout being sent. The playouts of
+ * one scheduler still share its thread, so a send blocking on a congested connection delays the other playouts, which
+ * is why playouts to connections that may congest independently are better paced by schedulers of their own.
+ */
+class SRTNetTsPlayoutScheduler {
+public:
+    SRTNetTsPlayoutScheduler();
+
+    virtual ~SRTNetTsPlayoutScheduler();
+
+    SRTNetTsPlayoutScheduler(SRTNetTsPlayoutScheduler const&) = delete;
+    SRTNetTsPlayoutScheduler& operator=(SRTNetTsPlayoutScheduler const&) = delete;
+
+private:
+    friend class SRTNetTsPlayout;
+
+    struct Entry {
+        std::chrono::steady_clock::time_point mDue;
+        SRTNetTsPlayout* mPlayout;
+    };
+
+    void add(SRTNetTsPlayout* playout, std::chrono::steady_clock::time_point due);
+    void remove(SRTNetTsPlayout* playout);
+    void schedulerWorker();
+
+    std::mutex mMtx;
+    std::condition_variable mCondition;
+    std::vector<Entry> mEntries; // Min heap on mDue
+    bool mRunning = true;
+    // The playout the scheduler thread is sending, nullptr if none, and whether it was removed meanwhile
+    SRTNetTsPlayout* mSending = nullptr;
+    bool mSendingRemoved = false;
+    std::condition_variable mSendDone;
+    std::thread mThread;
+};
@@ -0,0 +1,357 @@
+//
+// Measures how fast one SRTNet server handles clients connecting and disconnecting over and over, with and without
+// PSK, and whether the churn leaks threads or file descriptors over a long run.
+//
+// Every round connects a batch of clients from several threads at once, each client sends one message as soon as it
+// is connected, and then all clients are stopped again. A last phase restarts the server under clients that stay
+// started, which measures the reconnect loop of the clients.
+//
+// Usage: srtnet_churn_benchmark [clients per round] [rounds]
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/syslog.h>
+
+#ifdef __linux__
+#include <dirent.h>
+#endif
+
+#include "SRTNet.h"
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+const uint16_t kPort = 8060;
+const size_t kDefaultClients = 50;
+const size_t kDefaultRounds = 20;
+const size_t kConnectThreads = 8;
+const int32_t kLatencyMs = 20;
+const int32_t kPeerIdleTimeoutMs = 2000;
+const std::string kPsk = "ChurnBenchmarkPassphrase";
+const std::chrono::seconds kRoundTimeout(10);
+
+// Number of entries in a directory under /proc/self, -1 where there is no /proc
+int countProcEntries(const char* directory) {
+#ifdef __linux__
+    DIR* dir = opendir(directory);
+    if (dir == nullptr) {
+        return -1;
+    }
+    int entries = 0;
+    while (dirent* entry = readdir(dir)) {
+        if (entry->d_name[0] != '.') {
+            entries++;
+        }
+    }
+    closedir(dir);
+    return entries;
+#else
+    return -1;
+#endif
+}
+
+double toMs(Clock::duration duration) {
+    return std::chrono::duration<double, std::milli>(duration).count();
+}
+
+// Min, median, 99th percentile and max of a set of values
+std::string summarise(std::vector<double> values, const char* unit) {
+    if (values.empty()) {
+        return "n/a";
+    }
+    std::sort(values.begin(), values.end());
+    std::ostringstream summary;
+    summary << std::fixed << std::setprecision(2) << "min " << values.front() << unit << ", median "
+            << values[values.size() / 2] << unit << ", p99 "
+            << values[std::min(values.size() - 1, values.size() * 99 / 100)] << unit << ", max " << values.back()
+            << unit;
+    return summary.str();
+}
+
+bool waitFor(const std::function<bool()>& condition, Clock::duration timeout) {
+    auto deadline = Clock::now() + timeout;
+    while (!condition()) {
+        if (Clock::now() > deadline) {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    return true;
+}
+
+// Run a function for every client index, spread over kConnectThreads threads
+void forEachClient(size_t clients, const std::function<void(size_t)>& function) {
+    std::vector<std::thread> threads;
+    for (size_t thread = 0; thread < kConnectThreads; ++thread) {
+        threads.emplace_back([&, thread]() {
+            for (size_t client = thread; client < clients; client += kConnectThreads) {
+                function(client);
+            }
+        });
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+}
+
+// Times of one client in a round, as seen by the clients and by the server
+struct ClientTimes {
+    Clock::time_point mConnectStart;
+    Clock::time_point mConnected;
+    Clock::time_point mFirstByte;
+    Clock::time_point mStopped;
+    Clock::time_point mDisconnectDetected;
+};
+
+class ChurnServer {
+public:
+    explicit ChurnServer(size_t clients)
+        : mTimes(clients) {
+        mServer.clientConnected = [this](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                         const SRTNet::ConnectionInformation&) {
+            std::lock_guard<std::mutex> lock(mMtx);
+            mAccepted++;
+            mLastAccept = Clock::now();
+            return ctx;
+        };
+        mServer.receivedDataNoCopy = [this](const uint8_t* data, size_t size, SRT_MSGCTRL&,
+                                            std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket) {
+            uint32_t client;
+            if (size < sizeof(client)) {
+                return;
+            }
+            memcpy(&client, data, sizeof(client));
+            std::lock_guard<std::mutex> lock(mMtx);
+            if (client < mTimes.size() && mClients.emplace(socket, client).second) {
+                mTimes[client].mFirstByte = Clock::now();
+                mFirstBytes++;
+            }
+        };
+        mServer.clientDisconnected = [this](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket) {
+            std::lock_guard<std::mutex> lock(mMtx);
+            auto iterator = mClients.find(socket);
+            if (iterator != mClients.end()) {
+                mTimes[iterator->second].mDisconnectDetected = Clock::now();
+                mClients.erase(iterator);
+            }
+            mDisconnected++;
+        };
+    }
+
+    bool start(const std::string& psk) {
+        auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+        return mServer.startServer("127.0.0.1", kPort, 16, kLatencyMs, 100, SRT_LIVE_MAX_PLSIZE, kPeerIdleTimeoutMs,
+                                   psk, false, ctx);
+    }
+
+    void stop() {
+        mServer.stop();
+    }
+
+    void resetRound() {
+        std::lock_guard<std::mutex> lock(mMtx);
+        std::fill(mTimes.begin(), mTimes.end(), ClientTimes());
+        mClients.clear();
+        mAccepted = 0;
+        mFirstBytes = 0;
+        mDisconnected = 0;
+    }
+
+    size_t activeClients() const {
+        return mServer.getActiveClients().size();
+    }
+
+    SRTNet mServer;
+    std::mutex mMtx;
+    std::vector<ClientTimes> mTimes;
+    std::unordered_map<SRTSOCKET, uint32_t> mClients;
+    size_t mAccepted = 0;
+    size_t mFirstBytes = 0;
+    size_t mDisconnected = 0;
+    Clock::time_point mLastAccept;
+};
+
+bool connectClient(SRTNet& client, const std::string& psk, bool failOnConnectionError) {
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    return client.startClient("127.0.0.1", kPort, 16, kLatencyMs, 100, ctx, SRT_LIVE_MAX_PLSIZE,
+                              failOnConnectionError, kPeerIdleTimeoutMs, psk);
+}
+
+bool sendClientIndex(SRTNet& client, uint32_t index) {
+    uint8_t message[188] = {};
+    memcpy(message, &index, sizeof(index));
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    return client.sendData(message, sizeof(message), &msgCtrl);
+}
+
+void runChurn(size_t clients, size_t rounds, const std::string& psk) {
+    std::cout << std::endl << "Churn of " << clients << " clients x " << rounds << " rounds, "
+              << (psk.empty() ? "without PSK" : "with PSK") << std::endl;
+    ChurnServer server(clients);
+    if (!server.start(psk)) {
+        std::cout << "Failed to start the server" << std::endl;
+        return;
+    }
+
+    std::vector<double> connectTimes;
+    std::vector<double> timesToFirstByte;
+    std::vector<double> disconnectDetection;
+    std::vector<double> acceptRates;
+    size_t failedConnects = 0;
+    int baselineThreads = -1;
+    int baselineFds = -1;
+
+    for (size_t round = 0; round < rounds; ++round) {
+        server.resetRound();
+        std::vector<std::unique_ptr<SRTNet>> churnClients(clients);
+        std::atomic<size_t> failed = 0;
+
+        auto roundStart = Clock::now();
+        forEachClient(clients, [&](size_t client) {
+            churnClients[client] = std::make_unique<SRTNet>();
+            ClientTimes& times = server.mTimes[client];
+            times.mConnectStart = Clock::now();
+            if (!connectClient(*churnClients[client], psk, true)) {
+                failed++;
+                churnClients[client].reset();
+                return;
+            }
+            times.mConnected = Clock::now();
+            sendClientIndex(*churnClients[client], static_cast<uint32_t>(client));
+        });
+        const size_t connected = clients - failed;
+        failedConnects += failed;
+        waitFor(
+            [&]() {
+                std::lock_guard<std::mutex> lock(server.mMtx);
+                return server.mFirstBytes >= connected;
+            },
+            kRoundTimeout);
+        {
+            std::lock_guard<std::mutex> lock(server.mMtx);
+            if (server.mAccepted > 0) {
+                acceptRates.push_back(static_cast<double>(server.mAccepted) /
+                                      std::chrono::duration<double>(server.mLastAccept - roundStart).count());
+            }
+        }
+
+        forEachClient(clients, [&](size_t client) {
+            if (churnClients[client]) {
+                server.mTimes[client].mStopped = Clock::now();
+                churnClients[client]->stop();
+                churnClients[client].reset();
+            }
+        });
+        if (!waitFor([&]() { return server.activeClients() == 0; }, kRoundTimeout)) {
+            std::cout << "Round " << round << ": the server still has " << server.activeClients() << " clients"
+                      << std::endl;
+        }
+
+        std::lock_guard<std::mutex> lock(server.mMtx);
+        for (const ClientTimes& times : server.mTimes) {
+            if (times.mConnected != Clock::time_point()) {
+                connectTimes.push_back(toMs(times.mConnected - times.mConnectStart));
+            }
+            if (times.mFirstByte != Clock::time_point()) {
+                timesToFirstByte.push_back(toMs(times.mFirstByte - times.mConnectStart));
+            }
+            if (times.mDisconnectDetected != Clock::time_point() && times.mStopped != Clock::time_point()) {
+                disconnectDetection.push_back(toMs(times.mDisconnectDetected - times.mStopped));
+            }
+        }
+
+        // SRT starts its own threads on first use, so the baseline is taken after the first round
+        if (round == 0) {
+            baselineThreads = countProcEntries("/proc/self/task");
+            baselineFds = countProcEntries("/proc/self/fd");
+        }
+    }
+    server.stop();
+
+    std::cout << "Accepts per second:          " << summarise(acceptRates, "/s") << std::endl;
+    std::cout << "Connect (startClient):       " << summarise(connectTimes, " ms") << std::endl;
+    std::cout << "Time to first byte:          " << summarise(timesToFirstByte, " ms") << std::endl;
+    std::cout << "Disconnect detection:        " << summarise(disconnectDetection, " ms") << std::endl;
+    std::cout << "Failed connects:             " << failedConnects << std::endl;
+    std::cout << "Threads after first round:   " << baselineThreads << ", after last round: "
+              << countProcEntries("/proc/self/task") << std::endl;
+    std::cout << "Fds after first round:       " << baselineFds << ", after last round: "
+              << countProcEntries("/proc/self/fd") << std::endl;
+}
+
+void runReconnectStorm(size_t clients, const std::string& psk) {
+    std::cout << std::endl << "Reconnect storm of " << clients << " clients after a server restart, "
+              << (psk.empty() ? "without PSK" : "with PSK") << std::endl;
+    ChurnServer server(clients);
+    if (!server.start(psk)) {
+        std::cout << "Failed to start the server" << std::endl;
+        return;
+    }
+    std::vector<std::unique_ptr<SRTNet>> stormClients(clients);
+    forEachClient(clients, [&](size_t client) {
+        stormClients[client] = std::make_unique<SRTNet>();
+        connectClient(*stormClients[client], psk, false);
+    });
+    auto isConnected = [](const std::unique_ptr<SRTNet>& client) { return client->isConnectedToServer(); };
+    auto allConnected = [&]() { return std::all_of(stormClients.begin(), stormClients.end(), isConnected); };
+    auto noneConnected = [&]() { return std::none_of(stormClients.begin(), stormClients.end(), isConnected); };
+    if (!waitFor(allConnected, kRoundTimeout)) {
+        std::cout << "Not all clients connected" << std::endl;
+    }
+
+    server.stop();
+    auto serverStopped = Clock::now();
+    if (!waitFor(noneConnected, kRoundTimeout + std::chrono::milliseconds(kPeerIdleTimeoutMs))) {
+        std::cout << "Not all clients detected the server going away" << std::endl;
+    }
+    auto allDetected = Clock::now();
+
+    server.resetRound();
+    if (!server.start(psk)) {
+        std::cout << "Failed to restart the server" << std::endl;
+    }
+    auto serverRestarted = Clock::now();
+    bool reconnected = waitFor([&]() { return allConnected() && server.activeClients() == clients; },
+                               kRoundTimeout + std::chrono::milliseconds(kPeerIdleTimeoutMs));
+    auto allReconnected = Clock::now();
+
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Server loss detected by all: " << toMs(allDetected - serverStopped) << " ms" << std::endl;
+    std::cout << "All clients reconnected:     " << (reconnected ? "" : "not within the timeout, ")
+              << toMs(allReconnected - serverRestarted) << " ms after the restart, " << server.activeClients()
+              << " clients" << std::endl;
+
+    forEachClient(clients, [&](size_t client) { stormClients[client]->stop(); });
+    server.stop();
+}
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    size_t clients = argc > 1 ? std::stoul(argv[1]) : kDefaultClients;
+    size_t rounds = argc > 2 ? std::stoul(argv[2]) : kDefaultRounds;
+    if (clients == 0 || rounds == 0) {
+        std::cout << "Usage: " << argv[0] << " [clients per round] [rounds]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SRTNet::setLogHandler(SRTNet::defaultLogHandler, LOG_CRIT);
+    runChurn(clients, rounds, "");
+    runChurn(clients, rounds, kPsk);
+    runReconnectStorm(clients, "");
+    runReconnectStorm(clients, kPsk);
+    return EXIT_SUCCESS;
+}
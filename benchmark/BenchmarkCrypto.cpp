@@ -0,0 +1,84 @@
+//
+// Compares the throughput of the application layer AES-GCM encryption, spread over a growing number of cores, with a
+// single thread running bare AES-128-CTR. The latter is only a proxy for SRT's built-in encryption, which uses that
+// cipher on its single sending thread per connection, and does not measure SRT's real encrypted send path.
+//
+
+#include <chrono>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include <openssl/evp.h>
+
+#include "SRTNetCrypto.h"
+
+namespace {
+const size_t kMessageSize = 1316;
+const size_t kBatchSize = 256;
+const std::chrono::seconds kRunTime(2);
+
+double gbitPerSecond(size_t messages, std::chrono::steady_clock::duration duration) {
+    double seconds = std::chrono::duration<double>(duration).count();
+    return static_cast<double>(messages) * kMessageSize * 8 / seconds / 1e9;
+}
+
+double runSingleThreadCtrProxy() {
+    std::vector<uint8_t> key(16, 0x42);
+    std::vector<uint8_t> iv(16, 0);
+    std::vector<uint8_t> plain(kMessageSize, 0x47);
+    std::vector<uint8_t> encrypted(kMessageSize);
+    EVP_CIPHER_CTX* context = EVP_CIPHER_CTX_new();
+    EVP_EncryptInit_ex(context, EVP_aes_128_ctr(), nullptr, key.data(), nullptr);
+
+    size_t messages = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + kRunTime;
+    while (std::chrono::steady_clock::now() < end) {
+        for (size_t i = 0; i < kBatchSize; ++i) {
+            iv[15] = static_cast<uint8_t>(i);
+            int length = 0;
+            EVP_EncryptInit_ex(context, nullptr, nullptr, nullptr, iv.data());
+            EVP_EncryptUpdate(context, encrypted.data(), &length, plain.data(), static_cast<int>(kMessageSize));
+        }
+        messages += kBatchSize;
+    }
+    double result = gbitPerSecond(messages, std::chrono::steady_clock::now() - start);
+    EVP_CIPHER_CTX_free(context);
+    return result;
+}
+
+double runApplicationLayer(size_t workerThreads) {
+    auto cipher = SRTNetAeadCipher::create(std::vector<uint8_t>(16, 0x42));
+    SRTNetWorkerPool pool(workerThreads);
+    std::vector<uint8_t> plain(kMessageSize, 0x47);
+    std::vector<uint8_t> encrypted(kBatchSize * (kMessageSize + SRTNetAeadCipher::kOverhead));
+
+    size_t messages = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + kRunTime;
+    while (std::chrono::steady_clock::now() < end) {
+        pool.parallelFor(kBatchSize, [&](size_t index, size_t) {
+            cipher->encrypt(plain.data(), kMessageSize,
+                            &encrypted[index * (kMessageSize + SRTNetAeadCipher::kOverhead)]);
+        });
+        messages += kBatchSize;
+    }
+    return gbitPerSecond(messages, std::chrono::steady_clock::now() - start);
+}
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    size_t maxThreads = std::max(1u, std::thread::hardware_concurrency());
+    std::cout << "Message size " << kMessageSize << " bytes, batches of " << kBatchSize << " messages" << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "AES-128-CTR, 1 thread (proxy for SRT's built-in encryption, not SRT itself): "
+              << runSingleThreadCtrProxy() << " Gbit/s" << std::endl;
+
+    for (size_t threads = 1; threads <= maxThreads; threads *= 2) {
+        std::cout << "Application layer AES-128-GCM, " << std::setw(2) << threads
+                  << " thread(s): " << runApplicationLayer(threads - 1) << " Gbit/s" << std::endl;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,53 @@
+//
+// Measures the aggregate statistics queries of SRTNetFleetStatistics over a snapshot of 10k connections.
+//
+
+#include <chrono>
+#include <iostream>
+#include <random>
+
+#include "SRTNetFleetStatistics.h"
+
+namespace {
+const size_t kConnections = 10000;
+const size_t kIterations = 1000;
+
+template <typename Query>
+void measure(const char* name, Query query) {
+    double sink = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < kIterations; ++i) {
+        sink += query();
+    }
+    auto duration = std::chrono::steady_clock::now() - start;
+    double microseconds = std::chrono::duration<double, std::micro>(duration).count() / kIterations;
+    std::cout << name << ": " << microseconds << " us per query (" << sink / kIterations << ")" << std::endl;
+}
+} // namespace
+
+int main() {
+    SRTNetFleetStatistics fleet;
+    std::mt19937 generator(42);
+    std::uniform_real_distribution<double> rtt(1, 300);
+    std::uniform_int_distribution<int> loss(0, 10000);
+    for (size_t i = 0; i < kConnections; ++i) {
+        SRT_TRACEBSTATS stats{};
+        stats.msRTT = rtt(generator);
+        stats.pktRcvLossTotal = loss(generator);
+        stats.mbpsRecvRate = 5.0;
+        fleet.add(static_cast<SRTSOCKET>(i), stats);
+    }
+
+    std::cout << "Connections: " << fleet.size() << std::endl;
+    using Metric = SRTNetFleetStatistics::Metric;
+    measure("sum mbpsRecvRate", [&]() { return fleet.sum(Metric::mbpsRecvRate); });
+    measure("mean msRTT", [&]() { return fleet.mean(Metric::msRTT); });
+    measure("p95 msRTT", [&]() { return fleet.percentile(Metric::msRTT, 95); });
+    std::vector<std::pair<SRTSOCKET, double>> top;
+    top.reserve(10);
+    measure("top 10 pktRcvLossTotal", [&]() {
+        fleet.topN(Metric::pktRcvLossTotal, 10, top);
+        return top.front().second;
+    });
+    return 0;
+}
@@ -0,0 +1,103 @@
+//
+// Measures the CRC32C throughput of the integrity checker, then streams integrity checked messages through SRTNet over
+// the loopback interface and reports what arrived.
+//
+// Usage: srtnet_integrity_benchmark [bitrate in Mbit/s] [duration in seconds]
+//
+
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <thread>
+#include <vector>
+
+#include "SRTNetIntegrity.h"
+
+namespace {
+const size_t kMessageSize = 1316;
+const uint16_t kPort = 8040;
+
+template <typename Function>
+double measureCrc(Function crc) {
+    std::vector<uint8_t> data(kMessageSize * 1024, 0x47);
+    uint32_t result = 0;
+    size_t bytes = 0;
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(1);
+    while (std::chrono::steady_clock::now() < end) {
+        for (size_t offset = 0; offset < data.size(); offset += kMessageSize) {
+            result ^= crc(data.data() + offset, kMessageSize);
+        }
+        bytes += data.size();
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    // Use the result, so the loop is not optimised away
+    return result == 0x12345678 ? 0 : static_cast<double>(bytes) * 8 / seconds / 1e9;
+}
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    double bitrateMbps = argc > 1 ? std::atof(argv[1]) : 100;
+    int durationSeconds = argc > 2 ? std::atoi(argv[2]) : 5;
+    if (bitrateMbps <= 0 || durationSeconds <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [bitrate in Mbit/s] [duration in seconds]" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "CRC32C software: " << measureCrc([](const uint8_t* data, size_t size) {
+        return SRTNetCrc32c::computeSoftware(data, size);
+    }) << " Gbit/s" << std::endl;
+    if (SRTNetCrc32c::hasHardwareSupport()) {
+        std::cout << "CRC32C SSE4.2: " << measureCrc([](const uint8_t* data, size_t size) {
+            return SRTNetCrc32c::compute(data, size);
+        }) << " Gbit/s" << std::endl;
+    }
+
+    SRTNet server;
+    SRTNet client;
+    SRTNetIntegrityReceiver receiver;
+    server.clientConnected = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                const SRTNet::ConnectionInformation&) {
+        return std::make_shared<SRTNet::NetworkConnection>();
+    };
+    server.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL&,
+                                    std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+        receiver.check(data, size);
+    };
+
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    if (!server.startServer("127.0.0.1", kPort, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx) ||
+        !client.startClient("127.0.0.1", kPort, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true)) {
+        std::cerr << "Failed to set up the loopback connection" << std::endl;
+        return EXIT_FAILURE;
+    }
+
+    SRTNetIntegritySender sender;
+    auto interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(kMessageSize * 8 / (bitrateMbps * 1e6)));
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(durationSeconds);
+    auto next = start;
+    size_t sendFailures = 0;
+    while (next < end) {
+        if (!sender.send(client, kMessageSize)) {
+            sendFailures++;
+        }
+        next += interval;
+        std::this_thread::sleep_until(next);
+    }
+    // Let the last messages through the SRT latency window
+    std::this_thread::sleep_for(std::chrono::milliseconds(1500));
+
+    SRTNetIntegrityReceiver::Report report = receiver.getReport();
+    std::cout << "Loopback " << bitrateMbps << " Mbit/s for " << durationSeconds << " s, sent "
+              << sender.getNextSequenceNumber() << " messages (" << sendFailures << " failed)" << std::endl;
+    SRTNetIntegrityReceiver::writeReport(std::cout, report);
+    std::cout << std::endl;
+
+    client.stop();
+    server.stop();
+    return report.isClean() && sendFailures == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,198 @@
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "SRTNet.h"
+
+// Counts the heap allocations of the threads that have counting switched on. Replacing operator new catches the
+// allocations of C++ code, and with glibc malloc is replaced as well to catch the ones of C code. The sanitizers
+// replace malloc themselves, so with them only operator new is counted.
+namespace {
+std::atomic<uint64_t> gAllocations{0};
+thread_local bool tCounting = false;
+
+void countAllocation() {
+    if (tCounting) {
+        gAllocations.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+} // namespace
+
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t count, size_t size);
+void* __libc_realloc(void* pointer, size_t size);
+
+void* malloc(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+
+void* calloc(size_t count, size_t size) {
+    countAllocation();
+    return __libc_calloc(count, size);
+}
+
+void* realloc(void* pointer, size_t size) {
+    countAllocation();
+    return __libc_realloc(pointer, size);
+}
+}
+
+namespace {
+// Calls the allocator behind malloc directly, so an allocation made by operator new is not counted twice
+void* allocate(size_t size) {
+    countAllocation();
+    return __libc_malloc(size);
+}
+} // namespace
+#else
+namespace {
+void* allocate(size_t size) {
+    countAllocation();
+    return std::malloc(size);
+}
+} // namespace
+#endif
+
+void* operator new(size_t size) {
+    void* pointer = allocate(size == 0 ? 1 : size);
+    if (pointer == nullptr) {
+        throw std::bad_alloc();
+    }
+    return pointer;
+}
+
+void* operator new[](size_t size) {
+    return operator new(size);
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size == 0 ? 1 : size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size == 0 ? 1 : size);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept {
+    std::free(pointer);
+}
+
+TEST(TestAllocationFree, CountsAllocations) {
+    const uint64_t before = gAllocations;
+    tCounting = true;
+    auto* volatile allocated = new std::vector<int>(100);
+    delete allocated;
+    tCounting = false;
+    EXPECT_EQ(gAllocations - before, 2) << "Expected the vector and its elements to be counted";
+}
+
+// Messages are sent both ways and echoed by the server from its reading thread, while the sending thread and both
+// reading threads count their allocations. See "Allocation-free steady state" in the README for what is covered.
+TEST(TestAllocationFree, SteadyStateSendAndReceive) {
+    const int kWarmUpMessages = 1000;
+    const int kMessages = 10000;
+    const int kMessagesPerMs = 10;
+
+    SRTNet server;
+    SRTNet client;
+    ASSERT_TRUE(server.setConnectionCounters(16));
+    ASSERT_TRUE(client.setConnectionCounters(1));
+    std::atomic<bool> countOnReadingThreads{false};
+    std::atomic<int> serverReceived{0};
+    std::atomic<int> clientReceived{0};
+    server.clientConnected = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                const SRTNet::ConnectionInformation&) { return ctx; };
+    server.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL&,
+                                    std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket) {
+        tCounting = countOnReadingThreads;
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        server.sendData(data, size, &msgCtrl, socket);
+        serverReceived++;
+    };
+    client.receivedDataNoCopy = [&](const uint8_t*, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                    SRTSOCKET) {
+        tCounting = countOnReadingThreads;
+        clientReceived++;
+    };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8042, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8042, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+
+    std::vector<uint8_t> message(1316);
+    auto sendMessages = [&](int count) {
+        int failed = 0;
+        for (int i = 0; i < count; ++i) {
+            SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+            if (!client.sendData(message.data(), message.size(), &msgCtrl)) {
+                failed++;
+            }
+            if (i % kMessagesPerMs == kMessagesPerMs - 1) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        }
+        return failed;
+    };
+    auto waitForEchoes = [&](int count) {
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+        while (clientReceived < count && std::chrono::steady_clock::now() < deadline) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        return clientReceived == count;
+    };
+
+    // Let SRT and the wrapper grow their buffers and tables before counting
+    ASSERT_EQ(sendMessages(kWarmUpMessages), 0);
+    ASSERT_TRUE(waitForEchoes(kWarmUpMessages));
+
+    std::vector<std::pair<SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>>> clients;
+    std::vector<SRTSOCKET> clientSockets;
+    std::vector<std::pair<SRTSOCKET, SRTNet::ConnectionCounters>> allCounters;
+    clients.reserve(16);
+    clientSockets.reserve(16);
+    allCounters.reserve(16);
+
+    countOnReadingThreads = true;
+    const uint64_t before = gAllocations;
+    tCounting = true;
+    int failedSends = sendMessages(kMessages);
+    server.getActiveClients(clients);
+    server.getActiveClientSockets(clientSockets);
+    server.getAllConnectionCounters(allCounters);
+    SRTNet::ConnectionCounters counters;
+    bool gotCounters = client.getConnectionCounters(counters);
+    tCounting = false;
+    bool allEchoed = waitForEchoes(kWarmUpMessages + kMessages);
+    const uint64_t allocations = gAllocations - before;
+
+    // One more message both ways switches counting off on the reading threads again
+    countOnReadingThreads = false;
+    EXPECT_EQ(sendMessages(1), 0);
+    EXPECT_TRUE(waitForEchoes(kWarmUpMessages + kMessages + 1));
+
+    EXPECT_EQ(failedSends, 0);
+    EXPECT_TRUE(allEchoed);
+    EXPECT_TRUE(gotCounters);
+    EXPECT_EQ(clients.size(), 1);
+    EXPECT_EQ(allocations, 0) << "Expected no allocations on the sending and reading threads in steady state";
+
+    EXPECT_TRUE(client.stop());
+    EXPECT_TRUE(server.stop());
+}
@@ -0,0 +1,248 @@
+#include <chrono>
+#include <cstring>
+#include <future>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetCallbackExecutor.h"
+
+namespace {
+const SRT_MSGCTRL kMsgCtrl{};
+
+bool postSequenceNumber(SRTNetCallbackExecutor& executor, SRTSOCKET socket, uint32_t sequenceNumber) {
+    return executor.post(socket, nullptr, reinterpret_cast<const uint8_t*>(&sequenceNumber), sizeof(sequenceNumber),
+                         kMsgCtrl);
+}
+
+uint32_t sequenceNumberOf(const uint8_t* data) {
+    uint32_t sequenceNumber;
+    memcpy(&sequenceNumber, data, sizeof(sequenceNumber));
+    return sequenceNumber;
+}
+} // namespace
+
+TEST(TestCallbackExecutor, OrderedPerConnectionParallelAcrossConnections) {
+    const size_t kConnections = 16;
+    const uint32_t kMessages = 2000;
+    // Only touched by the worker running the connection, which is one at a time
+    std::vector<uint32_t> expected(kConnections, 0);
+    std::atomic<uint64_t> outOfOrder{0};
+    std::atomic<int> running{0};
+    std::atomic<int> maxRunning{0};
+
+    SRTNetCallbackExecutor executor(
+        4, kMessages, [&](const uint8_t* data, size_t size, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                          SRTSOCKET socket) {
+            int now = ++running;
+            int previous = maxRunning;
+            while (now > previous && !maxRunning.compare_exchange_weak(previous, now)) {
+            }
+            if (size != sizeof(uint32_t) || sequenceNumberOf(data) != expected[socket]) {
+                outOfOrder++;
+            }
+            expected[socket]++;
+            std::this_thread::sleep_for(std::chrono::microseconds(20));
+            running--;
+        });
+
+    for (uint32_t sequenceNumber = 0; sequenceNumber < kMessages; ++sequenceNumber) {
+        for (SRTSOCKET socket = 0; socket < static_cast<SRTSOCKET>(kConnections); ++socket) {
+            ASSERT_TRUE(postSequenceNumber(executor, socket, sequenceNumber));
+        }
+    }
+    executor.drain();
+
+    EXPECT_EQ(outOfOrder, 0);
+    for (uint32_t received : expected) {
+        EXPECT_EQ(received, kMessages);
+    }
+    EXPECT_GT(maxRunning, 1) << "Expected connections to be handled in parallel";
+    EXPECT_EQ(executor.getDroppedMessages(), 0);
+}
+
+TEST(TestCallbackExecutor, SlowConnectionDoesNotBlockOthers) {
+    std::atomic<uint32_t> fastHandled{0};
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    SRTNetCallbackExecutor executor(
+        2, 64,
+        [&](const uint8_t*, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket) {
+            if (socket == 1) {
+                released.wait();
+            } else {
+                fastHandled++;
+            }
+        });
+
+    // Both connections hash to the same worker, the other worker has to steal the fast one
+    ASSERT_TRUE(postSequenceNumber(executor, 1, 0));
+    ASSERT_TRUE(postSequenceNumber(executor, 1, 1));
+    for (uint32_t i = 0; i < 10; ++i) {
+        ASSERT_TRUE(postSequenceNumber(executor, 3, i));
+    }
+
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (fastHandled < 10 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    EXPECT_EQ(fastHandled, 10);
+    EXPECT_GE(executor.getStolenConnections(), 1);
+    release.set_value();
+    executor.drain();
+}
+
+TEST(TestCallbackExecutor, CloseAfterLastMessageAndDropWhenFull) {
+    std::mutex mutex;
+    std::vector<int64_t> events;
+    std::promise<void> release;
+    std::shared_future<void> released = release.get_future().share();
+
+    const size_t kMaxQueued = 4;
+    SRTNetCallbackExecutor executor(
+        2, kMaxQueued, [&](const uint8_t* data, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                           SRTSOCKET) {
+            released.wait();
+            std::lock_guard<std::mutex> lock(mutex);
+            events.push_back(sequenceNumberOf(data));
+        });
+
+    size_t posted = 0;
+    for (uint32_t i = 0; i < 10; ++i) {
+        posted += postSequenceNumber(executor, 7, i) ? 1 : 0;
+    }
+    executor.close(7, [&]() {
+        std::lock_guard<std::mutex> lock(mutex);
+        events.push_back(-1);
+    });
+    EXPECT_FALSE(postSequenceNumber(executor, 7, 10)) << "Expected messages after close to be dropped";
+
+    // At most one message is taken by the blocked worker, the rest of the queue is bounded
+    EXPECT_LE(posted, kMaxQueued + 1);
+    EXPECT_EQ(executor.getDroppedMessages(), 10 - posted + 1);
+
+    release.set_value();
+    executor.drain();
+
+    std::lock_guard<std::mutex> lock(mutex);
+    ASSERT_EQ(events.size(), posted + 1);
+    for (size_t i = 0; i < posted; ++i) {
+        EXPECT_EQ(events[i], static_cast<int64_t>(i));
+    }
+    EXPECT_EQ(events.back(), -1);
+}
+
+TEST(TestCallbackExecutor, ShedStaleMessages) {
+    std::vector<int64_t> delivered;
+    std::vector<std::pair<size_t, uint64_t>> gaps; // Number of messages delivered before the gap, and its size
+    SRTNetCallbackExecutor executor(
+        1, 1000,
+        [&](const uint8_t* data, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+            delivered.push_back(sequenceNumberOf(data));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        });
+    executor.setShedding(std::chrono::milliseconds(20), std::chrono::milliseconds(5),
+                         [&](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket, uint64_t droppedMessages) {
+                             EXPECT_EQ(socket, 5);
+                             gaps.emplace_back(delivered.size(), droppedMessages);
+                         });
+
+    // A burst far larger than the handler can take within the deadline, then a message posted when it has caught up
+    const uint32_t kBurst = 100;
+    for (uint32_t i = 0; i < kBurst; ++i) {
+        ASSERT_TRUE(postSequenceNumber(executor, 5, i));
+    }
+    executor.drain();
+    ASSERT_TRUE(postSequenceNumber(executor, 5, kBurst));
+    executor.drain();
+
+    ASSERT_FALSE(gaps.empty());
+    EXPECT_LT(delivered.size(), 10) << "Expected most of the burst to be dropped";
+    EXPECT_EQ(delivered.size() + executor.getShedMessages(), kBurst + 1);
+    EXPECT_EQ(delivered.back(), kBurst) << "Expected the message posted after catching up to be delivered";
+
+    // Every gap is reported before the next delivered message and matches the jump in sequence numbers
+    uint64_t reported = 0;
+    for (const auto& [deliveredBefore, droppedMessages] : gaps) {
+        reported += droppedMessages;
+        ASSERT_GT(deliveredBefore, 0);
+        if (deliveredBefore < delivered.size()) {
+            EXPECT_EQ(delivered[deliveredBefore] - delivered[deliveredBefore - 1] - 1,
+                      static_cast<int64_t>(droppedMessages));
+        }
+    }
+    EXPECT_EQ(reported, executor.getShedMessages());
+}
+
+TEST(TestCallbackExecutor, TasksRunInOrderWithMessages) {
+    std::vector<int64_t> events;
+    SRTNetCallbackExecutor executor(
+        2, 64, [&](const uint8_t* data, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+            events.push_back(sequenceNumberOf(data));
+        });
+
+    for (uint32_t i = 0; i < 4; ++i) {
+        ASSERT_TRUE(postSequenceNumber(executor, 9, i));
+        ASSERT_TRUE(
+            executor.postTask(9, nullptr, [&events, i]() { events.push_back(-100 - static_cast<int64_t>(i)); }));
+    }
+    executor.close(9, [&]() { events.push_back(-1); });
+    executor.drain();
+
+    std::vector<int64_t> expected{0, -100, 1, -101, 2, -102, 3, -103, -1};
+    EXPECT_EQ(events, expected);
+}
+
+TEST(TestCallbackExecutor, PostThroughConnectionHandle) {
+    std::vector<int64_t> events;
+    SRTNetCallbackExecutor executor(
+        2, 64, [&](const uint8_t* data, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                   SRTSOCKET socket) {
+            EXPECT_EQ(socket, 11);
+            events.push_back(sequenceNumberOf(data));
+        });
+
+    SRTNetCallbackExecutor::ConnectionHandle connection = executor.open(11, nullptr);
+    for (uint32_t i = 0; i < 3; ++i) {
+        ASSERT_TRUE(executor.post(connection, reinterpret_cast<const uint8_t*>(&i), sizeof(i), kMsgCtrl));
+    }
+    ASSERT_TRUE(executor.postTask(connection, [&]() { events.push_back(-100); }));
+    executor.close(connection, [&]() { events.push_back(-1); });
+    uint32_t late = 3;
+    EXPECT_FALSE(executor.post(connection, reinterpret_cast<const uint8_t*>(&late), sizeof(late), kMsgCtrl))
+        << "Expected messages after close to be dropped";
+    executor.drain();
+
+    std::vector<int64_t> expected{0, 1, 2, -100, -1};
+    EXPECT_EQ(events, expected);
+    EXPECT_EQ(executor.getDroppedMessages(), 1);
+}
+
+TEST(TestCallbackExecutor, ShedFromSourceTime) {
+    std::vector<int64_t> delivered;
+    uint64_t shed = 0;
+    SRTNetCallbackExecutor executor(
+        1, 64, [&](const uint8_t* data, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+            delivered.push_back(sequenceNumberOf(data));
+        });
+    executor.setShedding(std::chrono::milliseconds(100), std::chrono::milliseconds(0),
+                         [&](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET, uint64_t droppedMessages) {
+                             shed += droppedMessages;
+                         });
+
+    // The first message was due a second ago, so it is already too late when it is posted
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    msgCtrl.srctime = srt_time_now() - 1000000;
+    uint32_t sequenceNumber = 0;
+    ASSERT_TRUE(executor.post(3, nullptr, reinterpret_cast<const uint8_t*>(&sequenceNumber), sizeof(sequenceNumber),
+                              msgCtrl));
+    msgCtrl.srctime = srt_time_now();
+    sequenceNumber = 1;
+    ASSERT_TRUE(executor.post(3, nullptr, reinterpret_cast<const uint8_t*>(&sequenceNumber), sizeof(sequenceNumber),
+                              msgCtrl));
+    executor.drain();
+
+    EXPECT_EQ(delivered, std::vector<int64_t>({1}));
+    EXPECT_EQ(shed, 1);
+    EXPECT_EQ(executor.getShedMessages(), 1);
+}
@@ -0,0 +1,139 @@
+#include <random>
+#include <set>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetConflation.h"
+
+TEST(TestConflation, LatestValuePerKey) {
+    SRTNetConflation conflation(4, 16);
+    std::vector<uint8_t> message;
+    EXPECT_FALSE(conflation.load(100, 0, message));
+
+    const uint8_t first[] = {1, 2, 3};
+    const uint8_t second[] = {4, 5, 6, 7, 8, 9, 10, 11, 12, 13};
+    ASSERT_TRUE(conflation.store(100, 0, first, sizeof(first)));
+    ASSERT_TRUE(conflation.load(100, 0, message));
+    EXPECT_EQ(message, std::vector<uint8_t>(first, first + sizeof(first)));
+    EXPECT_FALSE(conflation.load(100, 0, message)) << "Expect a message to be read only once";
+
+    // Only the latest of the messages stored since the last read is kept, the others are counted as conflated
+    ASSERT_TRUE(conflation.store(100, 0, first, sizeof(first)));
+    ASSERT_TRUE(conflation.store(100, 0, first, sizeof(first)));
+    ASSERT_TRUE(conflation.store(100, 0, second, sizeof(second)));
+    ASSERT_TRUE(conflation.load(100, 0, message));
+    EXPECT_EQ(message, std::vector<uint8_t>(second, second + sizeof(second)));
+    EXPECT_EQ(conflation.conflated(100), 2);
+
+    // Keys and connections are kept apart
+    ASSERT_TRUE(conflation.store(100, 7, first, sizeof(first)));
+    ASSERT_TRUE(conflation.store(200, 0, second, sizeof(second)));
+    ASSERT_TRUE(conflation.load(100, 7, message));
+    EXPECT_EQ(message.size(), sizeof(first));
+    ASSERT_TRUE(conflation.load(200, 0, message));
+    EXPECT_EQ(message.size(), sizeof(second));
+    EXPECT_EQ(conflation.conflated(200), 0);
+
+    const uint8_t tooLarge[17] = {};
+    EXPECT_FALSE(conflation.store(100, 0, tooLarge, sizeof(tooLarge)));
+    EXPECT_FALSE(conflation.store(SRT_INVALID_SOCK, 0, first, sizeof(first)));
+}
+
+TEST(TestConflation, RemoveAndReuse) {
+    // The table has room for more than the max number of keys, but holds no more than that
+    const uint64_t kMaxKeys = 3;
+    SRTNetConflation conflation(kMaxKeys, 8);
+    const uint8_t data[] = {42};
+    for (uint64_t key = 0; key < kMaxKeys; ++key) {
+        EXPECT_TRUE(conflation.store(100, key, data, sizeof(data)));
+    }
+    EXPECT_FALSE(conflation.store(100, kMaxKeys, data, sizeof(data))) << "Expect at most max keys to be kept";
+    EXPECT_FALSE(conflation.store(200, 0, data, sizeof(data))) << "Expect the max to be over all connections";
+    ASSERT_TRUE(conflation.store(100, kMaxKeys - 1, data, sizeof(data)));
+    EXPECT_EQ(conflation.conflated(100), 1);
+
+    conflation.remove(100);
+    std::vector<uint8_t> message;
+    EXPECT_FALSE(conflation.load(100, 0, message));
+    EXPECT_EQ(conflation.conflated(100), 0);
+    ASSERT_TRUE(conflation.store(200, 0, data, sizeof(data)));
+    ASSERT_TRUE(conflation.load(200, 0, message));
+
+    conflation.clear();
+    EXPECT_FALSE(conflation.load(200, 0, message));
+}
+
+TEST(TestConflation, ConnectionsComingAndGoing) {
+    // Removed slots are turned back into empty ones, which must not cut off the probe sequence of a kept key
+    SRTNetConflation conflation(8, 8);
+    std::mt19937 random(7);
+    std::set<SRTSOCKET> kept;
+    std::vector<uint8_t> message;
+    for (int i = 0; i < 20000; ++i) {
+        SRTSOCKET socket = static_cast<SRTSOCKET>(random() % 32);
+        if (kept.count(socket) != 0) {
+            conflation.remove(socket);
+            kept.erase(socket);
+        } else if (kept.size() < 4) {
+            const uint8_t data[] = {static_cast<uint8_t>(socket)};
+            ASSERT_TRUE(conflation.store(socket, 0, data, sizeof(data)));
+            ASSERT_TRUE(conflation.store(socket, 1, data, sizeof(data)));
+            kept.insert(socket);
+        }
+        // Every kept connection has an unread message, stored again once read
+        for (SRTSOCKET other = 0; other < 32; ++other) {
+            ASSERT_EQ(conflation.load(other, 1, message), kept.count(other) != 0) << "Socket " << other;
+        }
+        for (SRTSOCKET other : kept) {
+            const uint8_t data[] = {static_cast<uint8_t>(other)};
+            ASSERT_TRUE(conflation.store(other, 1, data, sizeof(data)));
+        }
+    }
+}
+
+TEST(TestConflation, ConcurrentWriterAndReaders) {
+    const uint64_t kMessages = 50000;
+    const size_t kMessageSize = 1000;
+    SRTNetConflation conflation(4, kMessageSize);
+
+    // Every message is filled with its number, so a torn message would show up as mixed numbers
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> read{0};
+    auto reader = [&]() {
+        std::vector<uint8_t> message;
+        message.reserve(kMessageSize);
+        uint64_t last = 0;
+        while (!done) {
+            if (!conflation.load(1, 0, message)) {
+                continue;
+            }
+            ASSERT_EQ(message.size(), kMessageSize);
+            uint64_t number;
+            memcpy(&number, message.data(), sizeof(number));
+            for (size_t offset = 0; offset + sizeof(number) <= kMessageSize; offset += sizeof(number)) {
+                uint64_t other;
+                memcpy(&other, message.data() + offset, sizeof(other));
+                ASSERT_EQ(other, number);
+            }
+            EXPECT_GT(number, last) << "Expect only newer messages";
+            last = number;
+            read++;
+        }
+    };
+    std::thread firstReader(reader);
+    std::thread secondReader(reader);
+    std::vector<uint8_t> message(kMessageSize);
+    for (uint64_t number = 1; number <= kMessages; ++number) {
+        for (size_t offset = 0; offset + sizeof(number) <= kMessageSize; offset += sizeof(number)) {
+            memcpy(message.data() + offset, &number, sizeof(number));
+        }
+        ASSERT_TRUE(conflation.store(1, 0, message.data(), message.size()));
+    }
+    done = true;
+    firstReader.join();
+    secondReader.join();
+
+    EXPECT_GT(read, 0);
+    EXPECT_GT(conflation.conflated(1), 0);
+}
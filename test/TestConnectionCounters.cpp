@@ -0,0 +1,145 @@
+#include <random>
+#include <set>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetConnectionCounters.h"
+
+TEST(TestConnectionCounters, AddAndRemove) {
+    SRTNetConnectionCounters counters(2);
+    SRTNet::ConnectionCounters connection;
+    EXPECT_FALSE(counters.get(100, connection, 1));
+    EXPECT_TRUE(counters.add(100));
+    EXPECT_FALSE(counters.add(100)) << "Expect a socket to be added only once";
+    EXPECT_FALSE(counters.add(SRT_INVALID_SOCK));
+
+    counters.countReceived(100, 1000, 1);
+    counters.countSent(100, 500, 2);
+    counters.countReceived(200, 1000, 3); // Not counted
+    ASSERT_TRUE(counters.get(100, connection, 3));
+    EXPECT_EQ(connection.mMessagesReceived, 1);
+    EXPECT_EQ(connection.mBytesReceived, 1000);
+    EXPECT_EQ(connection.mMessagesSent, 1);
+    EXPECT_EQ(connection.mBytesSent, 500);
+    EXPECT_EQ(connection.mLastActivity, 2);
+
+    // The table holds twice the max number of connections, rounded up to a power of two
+    EXPECT_TRUE(counters.add(101));
+    EXPECT_TRUE(counters.add(102));
+    EXPECT_TRUE(counters.add(103));
+    EXPECT_FALSE(counters.add(104)) << "Expect the table to be full";
+
+    // A removed connection frees its slot, and a new connection starts from zero
+    counters.remove(100);
+    EXPECT_FALSE(counters.get(100, connection, 3));
+    EXPECT_TRUE(counters.get(103, connection, 3)) << "Expect connections after a removed one to still be found";
+    ASSERT_TRUE(counters.add(104));
+    ASSERT_TRUE(counters.get(104, connection, 3));
+    EXPECT_EQ(connection.mMessagesReceived, 0);
+    EXPECT_EQ(connection.mBytesSent, 0);
+
+    std::vector<std::pair<SRTSOCKET, SRTNet::ConnectionCounters>> all;
+    counters.getAll(all, 3);
+    EXPECT_EQ(all.size(), 4);
+    counters.clear();
+    counters.getAll(all, 3);
+    EXPECT_TRUE(all.empty());
+}
+
+TEST(TestConnectionCounters, ConnectionsComingAndGoing) {
+    // Removed slots are turned back into empty ones, which must not cut off the probe sequence of a counted connection
+    SRTNetConnectionCounters counters(8);
+    std::mt19937 random(7);
+    std::set<SRTSOCKET> counted;
+    SRTNet::ConnectionCounters connection;
+    for (int i = 0; i < 20000; ++i) {
+        SRTSOCKET socket = static_cast<SRTSOCKET>(random() % 64);
+        if (counted.count(socket) != 0) {
+            counters.remove(socket);
+            counted.erase(socket);
+        } else if (counted.size() < 8) {
+            ASSERT_TRUE(counters.add(socket));
+            counted.insert(socket);
+        }
+        for (SRTSOCKET other = 0; other < 64; ++other) {
+            ASSERT_EQ(counters.get(other, connection, 1), counted.count(other) != 0) << "Socket " << other;
+        }
+    }
+}
+
+TEST(TestConnectionCounters, MovingAverageBitrate) {
+    const int64_t kWindowUs = SRTNetConnectionCounters::kWindowUs;
+    SRTNetConnectionCounters counters(1);
+    ASSERT_TRUE(counters.add(7));
+
+    // 1250 bytes every ms is 10 Mbit/s
+    int64_t now = 1000000;
+    for (int i = 0; i < 2000; ++i, now += 1000) {
+        counters.countReceived(7, 1250, now);
+    }
+    SRTNet::ConnectionCounters connection;
+    ASSERT_TRUE(counters.get(7, connection, now));
+    EXPECT_NEAR(connection.mReceiveBitsPerSecond, 10000000, 200000);
+    EXPECT_EQ(connection.mSendBitsPerSecond, 0);
+
+    // Half the rate for a while pulls the average towards 5 Mbit/s
+    for (int i = 0; i < 2000; ++i, now += 2000) {
+        counters.countReceived(7, 1250, now);
+    }
+    ASSERT_TRUE(counters.get(7, connection, now));
+    EXPECT_NEAR(connection.mReceiveBitsPerSecond, 5000000, 200000);
+
+    // An idle connection is aged by the reader, without anything being counted
+    ASSERT_TRUE(counters.get(7, connection, now + 20 * kWindowUs));
+    EXPECT_LT(connection.mReceiveBitsPerSecond, 50000);
+    EXPECT_EQ(connection.mMessagesReceived, 4000);
+}
+
+TEST(TestConnectionCounters, ConcurrentSendersAndReaders) {
+    const int kSenders = 4;
+    const int kMessages = 100000;
+    SRTNetConnectionCounters counters(16);
+    ASSERT_TRUE(counters.add(1));
+    ASSERT_TRUE(counters.add(2));
+
+    std::atomic<bool> done{false};
+    std::thread reader([&]() {
+        SRTNet::ConnectionCounters connection;
+        uint64_t lastMessages = 0;
+        while (!done) {
+            ASSERT_TRUE(counters.get(1, connection, srt_time_now()));
+            EXPECT_GE(connection.mMessagesSent, lastMessages) << "Expect the counters to never go backwards";
+            lastMessages = connection.mMessagesSent;
+        }
+    });
+    std::thread receiver([&]() {
+        for (int i = 0; i < kMessages; ++i) {
+            counters.countReceived(1, 100, srt_time_now());
+        }
+    });
+    std::vector<std::thread> senders;
+    for (int sender = 0; sender < kSenders; ++sender) {
+        senders.emplace_back([&]() {
+            for (int i = 0; i < kMessages; ++i) {
+                counters.countSent(1, 10, srt_time_now());
+                counters.countSent(2, 10, srt_time_now());
+            }
+        });
+    }
+    for (auto& sender : senders) {
+        sender.join();
+    }
+    receiver.join();
+    done = true;
+    reader.join();
+
+    SRTNet::ConnectionCounters connection;
+    ASSERT_TRUE(counters.get(1, connection, srt_time_now()));
+    EXPECT_EQ(connection.mMessagesReceived, kMessages);
+    EXPECT_EQ(connection.mBytesReceived, kMessages * 100);
+    EXPECT_EQ(connection.mMessagesSent, kSenders * kMessages);
+    EXPECT_EQ(connection.mBytesSent, kSenders * kMessages * 10);
+    ASSERT_TRUE(counters.get(2, connection, srt_time_now()));
+    EXPECT_EQ(connection.mMessagesSent, kSenders * kMessages);
+}
@@ -0,0 +1,99 @@
+#include <numeric>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetCrypto.h"
+
+namespace {
+const std::vector<uint8_t> kKey128(16, 0x11);
+const std::vector<uint8_t> kKey256(32, 0x22);
+} // namespace
+
+TEST(TestCrypto, RejectUnsupportedKeyLength) {
+    EXPECT_EQ(SRTNetAeadCipher::create({}), nullptr);
+    EXPECT_EQ(SRTNetAeadCipher::create(std::vector<uint8_t>(24, 0)), nullptr);
+    EXPECT_NE(SRTNetAeadCipher::create(kKey128), nullptr);
+    EXPECT_NE(SRTNetAeadCipher::create(kKey256), nullptr);
+}
+
+TEST(TestCrypto, EncryptDecrypt) {
+    auto sender = SRTNetAeadCipher::create(kKey256);
+    auto receiver = SRTNetAeadCipher::create(kKey256);
+    ASSERT_NE(sender, nullptr);
+    ASSERT_NE(receiver, nullptr);
+
+    std::vector<uint8_t> plain(1316);
+    std::iota(plain.begin(), plain.end(), 0);
+    std::vector<uint8_t> encrypted(plain.size() + SRTNetAeadCipher::kOverhead);
+    ASSERT_TRUE(sender->encrypt(plain.data(), plain.size(), encrypted.data()));
+
+    // Same plaintext must never give the same ciphertext, since the nonce changes per message
+    std::vector<uint8_t> encryptedAgain(encrypted.size());
+    ASSERT_TRUE(sender->encrypt(plain.data(), plain.size(), encryptedAgain.data()));
+    EXPECT_NE(encrypted, encryptedAgain);
+
+    std::vector<uint8_t> tampered = encrypted;
+    tampered[100] ^= 1;
+    size_t plainSize = 0;
+    EXPECT_FALSE(receiver->decrypt(tampered.data(), tampered.size(), plainSize));
+
+    auto otherKey = SRTNetAeadCipher::create(kKey128);
+    std::vector<uint8_t> copy = encrypted;
+    EXPECT_FALSE(otherKey->decrypt(copy.data(), copy.size(), plainSize));
+
+    ASSERT_TRUE(receiver->decrypt(encrypted.data(), encrypted.size(), plainSize));
+    ASSERT_EQ(plainSize, plain.size());
+    EXPECT_TRUE(std::equal(plain.begin(), plain.end(), encrypted.begin() + SRTNetAeadCipher::kHeaderSize));
+
+    EXPECT_FALSE(receiver->decrypt(encrypted.data(), SRTNetAeadCipher::kOverhead - 1, plainSize));
+}
+
+TEST(TestCrypto, SubkeyPerSender) {
+    auto receiver = SRTNetAeadCipher::create(kKey128);
+    ASSERT_NE(receiver, nullptr);
+    const std::vector<uint8_t> plain(188, 0x47);
+
+    // More senders than the receiver keeps subkeys for, each of them sending twice
+    std::vector<std::unique_ptr<SRTNetAeadCipher>> senders;
+    for (size_t i = 0; i < SRTNetAeadCipher::kMaxPeerKeys + 8; ++i) {
+        senders.push_back(SRTNetAeadCipher::create(kKey128));
+        ASSERT_NE(senders.back(), nullptr);
+    }
+    std::vector<std::vector<uint8_t>> firstMessages;
+    for (int round = 0; round < 2; ++round) {
+        for (auto& sender : senders) {
+            std::vector<uint8_t> encrypted(plain.size() + SRTNetAeadCipher::kOverhead);
+            ASSERT_TRUE(sender->encrypt(plain.data(), plain.size(), encrypted.data()));
+            if (round == 0) {
+                firstMessages.push_back(encrypted);
+            }
+            size_t plainSize = 0;
+            ASSERT_TRUE(receiver->decrypt(encrypted.data(), encrypted.size(), plainSize));
+            EXPECT_TRUE(std::equal(plain.begin(), plain.end(), encrypted.begin() + SRTNetAeadCipher::kHeaderSize));
+        }
+    }
+
+    // Every sender starts its counter at 0, but with its own session salt and subkey, so the first messages of two
+    // senders never share a key stream
+    for (size_t i = 1; i < firstMessages.size(); ++i) {
+        EXPECT_FALSE(std::equal(firstMessages[0].begin(), firstMessages[0].begin() + SRTNetAeadCipher::kSaltSize,
+                                firstMessages[i].begin()));
+        EXPECT_FALSE(std::equal(firstMessages[0].begin() + SRTNetAeadCipher::kHeaderSize, firstMessages[0].end(),
+                                firstMessages[i].begin() + SRTNetAeadCipher::kHeaderSize));
+    }
+}
+
+TEST(TestCrypto, WorkerPoolRunsAllIndexes) {
+    SRTNetWorkerPool pool(3);
+    EXPECT_EQ(pool.size(), 4);
+    for (size_t count : {0, 1, 2, 7, 64}) {
+        std::vector<size_t> slots(count, SIZE_MAX);
+        pool.parallelFor(count, [&](size_t index, size_t slot) { slots[index] = slot; });
+        for (size_t index = 0; index < count; ++index) {
+            EXPECT_LT(slots[index], pool.size());
+            if (count > 1) {
+                EXPECT_EQ(slots[index], index % pool.size());
+            }
+        }
+    }
+}
@@ -0,0 +1,211 @@
+#include <numeric>
+#include <random>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetDualPathMerger.h"
+
+namespace {
+const SRTSOCKET kFirstPath = 1001;
+const SRTSOCKET kSecondPath = 1002;
+
+// A message of 7 TS packets, made unique by its number
+std::vector<uint8_t> tsMessage(uint32_t number) {
+    std::vector<uint8_t> message(7 * 188);
+    for (size_t packet = 0; packet < message.size(); packet += 188) {
+        message[packet] = 0x47;
+        memcpy(&message[packet + 4], &number, sizeof(number));
+    }
+    return message;
+}
+
+std::vector<uint8_t> taggedMessage(uint16_t tag) {
+    return {0x80, 0x21, static_cast<uint8_t>(tag >> 8), static_cast<uint8_t>(tag), 0xaa};
+}
+} // namespace
+
+TEST(TestDualPathMerger, ForwardFirstCopyOnly) {
+    SRTNetDualPathMerger merger;
+    ASSERT_TRUE(merger.addPath(kFirstPath));
+    ASSERT_TRUE(merger.addPath(kSecondPath));
+    EXPECT_FALSE(merger.addPath(kSecondPath));
+    EXPECT_FALSE(merger.addPath(1003)) << "Expect at most two paths";
+
+    std::vector<uint32_t> forwarded;
+    const uint8_t* forwardedData = nullptr;
+    merger.output = [&](const uint8_t* data, size_t, SRT_MSGCTRL&, SRTSOCKET) {
+        uint32_t number;
+        memcpy(&number, data + 4, sizeof(number));
+        forwarded.push_back(number);
+        forwardedData = data;
+    };
+
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    std::vector<std::vector<uint8_t>> messages;
+    for (uint32_t number = 0; number < 4; ++number) {
+        messages.push_back(tsMessage(number));
+    }
+    // The paths take turns being ahead, and the second path lost message 2
+    EXPECT_TRUE(merger.pushData(messages[0].data(), messages[0].size(), msgCtrl, kFirstPath));
+    EXPECT_FALSE(merger.pushData(messages[0].data(), messages[0].size(), msgCtrl, kSecondPath));
+    EXPECT_TRUE(merger.pushData(messages[1].data(), messages[1].size(), msgCtrl, kSecondPath));
+    EXPECT_FALSE(merger.pushData(messages[1].data(), messages[1].size(), msgCtrl, kFirstPath));
+    EXPECT_TRUE(merger.pushData(messages[2].data(), messages[2].size(), msgCtrl, kFirstPath));
+    EXPECT_TRUE(merger.pushData(messages[3].data(), messages[3].size(), msgCtrl, kSecondPath));
+    EXPECT_FALSE(merger.pushData(messages[3].data(), messages[3].size(), msgCtrl, kFirstPath));
+    EXPECT_FALSE(merger.pushData(messages[3].data(), 100, msgCtrl, kFirstPath)) << "Not TS packets";
+    EXPECT_FALSE(merger.pushData(messages[3].data(), messages[3].size(), msgCtrl, 1003)) << "Not a path";
+
+    EXPECT_EQ(forwarded, std::vector<uint32_t>({0, 1, 2, 3}));
+
+    auto statistics = merger.getPathStatistics();
+    ASSERT_EQ(statistics.size(), 2);
+    EXPECT_EQ(statistics[0].mSocket, kFirstPath);
+    EXPECT_EQ(statistics[0].mReceivedMessages, 5);
+    EXPECT_EQ(statistics[0].mForwardedMessages, 2);
+    EXPECT_EQ(statistics[0].mDuplicateMessages, 2);
+    EXPECT_EQ(statistics[0].mUnsequencedMessages, 1);
+    EXPECT_EQ(statistics[1].mForwardedMessages, 2);
+    EXPECT_EQ(statistics[1].mDuplicateMessages, 1);
+    EXPECT_EQ(statistics[0].mRepairedMessages, 0) << "Expect message 2 to still be in the window";
+
+    // With one path left nothing is held back, and the payload is forwarded without copying
+    EXPECT_TRUE(merger.removePath(kSecondPath));
+    std::vector<uint8_t> message = tsMessage(4);
+    EXPECT_TRUE(merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath));
+    EXPECT_EQ(forwarded.back(), 4);
+    EXPECT_EQ(forwardedData, message.data()) << "Expected the payload to be forwarded without copying";
+
+    // Messages of null packets only can't be told apart
+    std::vector<uint8_t> nullPackets = tsMessage(5);
+    for (size_t packet = 0; packet < nullPackets.size(); packet += 188) {
+        nullPackets[packet + 1] = 0x1f;
+        nullPackets[packet + 2] = 0xff;
+    }
+    EXPECT_FALSE(merger.pushData(nullPackets.data(), nullPackets.size(), msgCtrl, kFirstPath));
+    EXPECT_EQ(merger.getPathStatistics()[0].mUnsequencedMessages, 2);
+}
+
+TEST(TestDualPathMerger, CountRepairsWhenLeavingWindow) {
+    SRTNetDualPathMerger merger(SRTNetDualPathMerger::sequenceTag(2, 2), std::chrono::milliseconds(20));
+    ASSERT_TRUE(merger.addPath(kFirstPath));
+    ASSERT_TRUE(merger.addPath(kSecondPath));
+    std::vector<uint16_t> forwarded;
+    merger.output = [&](const uint8_t* data, size_t, SRT_MSGCTRL&, SRTSOCKET) {
+        forwarded.push_back(static_cast<uint16_t>((data[2] << 8) | data[3]));
+    };
+
+    // Every third message is lost on the first path and every fifth of the others on the second
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    for (uint16_t tag = 1; tag <= 30; ++tag) {
+        std::vector<uint8_t> message = taggedMessage(tag);
+        if (tag % 3 != 0) {
+            merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath);
+        }
+        if (tag % 5 != 0 || tag % 3 == 0) {
+            merger.pushData(message.data(), message.size(), msgCtrl, kSecondPath);
+        }
+    }
+    EXPECT_EQ(forwarded.size(), 29) << "Expect message 30 to wait for the first path";
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    auto statistics = merger.getPathStatistics();
+    std::vector<uint16_t> expected(30);
+    std::iota(expected.begin(), expected.end(), 1);
+    EXPECT_EQ(forwarded, expected) << "Expect the losses of either path to be hidden, in order";
+    ASSERT_EQ(statistics.size(), 2);
+    EXPECT_EQ(statistics[0].mRepairedMessages, 4);
+    EXPECT_EQ(statistics[0].mMissedMessages, 10);
+    EXPECT_EQ(statistics[1].mRepairedMessages, 10);
+    EXPECT_EQ(statistics[1].mMissedMessages, 4);
+
+    // A copy arriving after the window is taken for a new message
+    std::vector<uint8_t> message = taggedMessage(30);
+    EXPECT_TRUE(merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath));
+}
+
+TEST(TestDualPathMerger, BoundedWindowAndSameContent) {
+    SRTNetDualPathMerger merger(SRTNetDualPathMerger::sequenceTag(2, 2), std::chrono::seconds(10), 4);
+    ASSERT_TRUE(merger.addPath(kFirstPath));
+    ASSERT_TRUE(merger.addPath(kSecondPath));
+
+    // The window holds 4 messages, message 1 has left it when message 5 arrives
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    for (uint16_t tag = 1; tag <= 5; ++tag) {
+        std::vector<uint8_t> message = taggedMessage(tag);
+        EXPECT_TRUE(merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath));
+    }
+    std::vector<uint8_t> message = taggedMessage(2);
+    EXPECT_FALSE(merger.pushData(message.data(), message.size(), msgCtrl, kSecondPath));
+    message = taggedMessage(1);
+    EXPECT_TRUE(merger.pushData(message.data(), message.size(), msgCtrl, kSecondPath));
+
+    // The same content twice on one path is two messages, each dropped once from the other path
+    message = taggedMessage(4);
+    EXPECT_TRUE(merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath));
+    EXPECT_FALSE(merger.pushData(message.data(), message.size(), msgCtrl, kSecondPath));
+
+    // A removed path is forgotten, the messages it delivered are still dropped from the other path and from a path
+    // added in its place
+    message = taggedMessage(6);
+    EXPECT_TRUE(merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath));
+    EXPECT_TRUE(merger.removePath(kFirstPath));
+    EXPECT_FALSE(merger.removePath(kFirstPath));
+    message = taggedMessage(5);
+    EXPECT_FALSE(merger.pushData(message.data(), message.size(), msgCtrl, kSecondPath));
+    EXPECT_TRUE(merger.addPath(kFirstPath));
+    message = taggedMessage(6);
+    EXPECT_FALSE(merger.pushData(message.data(), message.size(), msgCtrl, kFirstPath))
+        << "Expect the copy of the new path not to be taken for a repeated message";
+    EXPECT_EQ(merger.getPathStatistics().size(), 2);
+}
+
+TEST(TestDualPathMerger, LongRunWithLosses) {
+    const uint32_t kMessages = 100000;
+    SRTNetDualPathMerger merger(SRTNetDualPathMerger::sequenceTag(0, 2), std::chrono::seconds(10), 64);
+    ASSERT_TRUE(merger.addPath(kFirstPath));
+    ASSERT_TRUE(merger.addPath(kSecondPath));
+    size_t forwarded = 0;
+    size_t outOfOrder = 0;
+    uint16_t lastTag = 0;
+    merger.output = [&](const uint8_t* data, size_t, SRT_MSGCTRL&, SRTSOCKET) {
+        uint16_t tag = static_cast<uint16_t>((data[0] << 8) | data[1]);
+        // The 16 bit tag wraps around many times
+        if (forwarded > 0 && static_cast<int16_t>(tag - lastTag) <= 0) {
+            outOfOrder++;
+        }
+        lastTag = tag;
+        forwarded++;
+    };
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    auto push = [&](uint32_t number, SRTSOCKET path) {
+        std::vector<uint8_t> message = taggedMessage(static_cast<uint16_t>(number));
+        message.erase(message.begin(), message.begin() + 2);
+        merger.pushData(message.data(), message.size(), msgCtrl, path);
+    };
+
+    // The second path runs 20 messages behind the first, and both lose messages at random
+    std::mt19937 random(1234);
+    std::vector<bool> firstLost(kMessages);
+    std::vector<bool> secondLost(kMessages);
+    size_t delivered = 0;
+    for (uint32_t i = 0; i < kMessages; ++i) {
+        firstLost[i] = random() % 10 == 0;
+        secondLost[i] = random() % 10 == 0;
+        delivered += !firstLost[i] || !secondLost[i];
+    }
+    for (uint32_t i = 0; i < kMessages + 20; ++i) {
+        if (i < kMessages && !firstLost[i]) {
+            push(i, kFirstPath);
+        }
+        if (i >= 20 && !secondLost[i - 20]) {
+            push(i - 20, kSecondPath);
+        }
+    }
+    // Removing the paths flushes the messages still waiting for a path
+    EXPECT_TRUE(merger.removePath(kSecondPath));
+    EXPECT_TRUE(merger.removePath(kFirstPath));
+    EXPECT_EQ(forwarded, delivered) << "Expect every message delivered by a path to be forwarded once";
+    EXPECT_EQ(outOfOrder, 0) << "Expect the messages repaired from the slower path to be forwarded in order";
+}
@@ -0,0 +1,184 @@
+#include <condition_variable>
+#include <thread>
+
+#ifndef WIN32
+#include <poll.h>
+#include <unistd.h>
+#endif
+
+#include <gtest/gtest.h>
+
+#include "SRTNetFailoverClient.h"
+#include "TestHelpers.h"
+
+namespace {
+class CountingServer {
+public:
+    bool start(uint16_t port) {
+        mServer.clientConnected = [&](struct sockaddr& sin, SRTSOCKET newSocket,
+                                      std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                      const SRTNet::ConnectionInformation&) { return mCtx; };
+        mServer.receivedData = [&](std::unique_ptr<std::vector<uint8_t>>& data, SRT_MSGCTRL& msgCtrl,
+                                   std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+            mReceivedMessages++;
+        };
+        return mServer.startServer("127.0.0.1", port, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, mCtx);
+    }
+
+    SRTNet mServer;
+    std::shared_ptr<SRTNet::NetworkConnection> mCtx = std::make_shared<SRTNet::NetworkConnection>();
+    std::atomic<size_t> mReceivedMessages = 0;
+};
+
+#ifndef WIN32
+// Relays UDP datagrams between one client and a server, and can silently drop them all like a broken network path
+class UdpRelay {
+public:
+    ~UdpRelay() {
+        mActive = false;
+        if (mThread.joinable()) {
+            mThread.join();
+        }
+        for (int fd : {mListenSocket, mServerSocket}) {
+            if (fd >= 0) {
+                close(fd);
+            }
+        }
+    }
+
+    bool start(uint16_t listenPort, uint16_t serverPort) {
+        mListenSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        mServerSocket = socket(AF_INET, SOCK_DGRAM, 0);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        address.sin_port = htons(listenPort);
+        if (bind(mListenSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return false;
+        }
+        address.sin_port = htons(serverPort);
+        if (connect(mServerSocket, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            return false;
+        }
+        mActive = true;
+        mThread = std::thread(&UdpRelay::relay, this);
+        return true;
+    }
+
+    std::atomic<bool> mDropping = false;
+
+private:
+    void relay() {
+        std::vector<uint8_t> buffer(2048);
+        sockaddr_in client{};
+        socklen_t clientSize = 0;
+        while (mActive) {
+            pollfd fds[2] = {{mListenSocket, POLLIN, 0}, {mServerSocket, POLLIN, 0}};
+            if (poll(fds, 2, 10) <= 0) {
+                continue;
+            }
+            if (fds[0].revents & POLLIN) {
+                clientSize = sizeof(client);
+                ssize_t size = recvfrom(mListenSocket, buffer.data(), buffer.size(), 0,
+                                        reinterpret_cast<sockaddr*>(&client), &clientSize);
+                if (size > 0 && !mDropping) {
+                    send(mServerSocket, buffer.data(), size, 0);
+                }
+            }
+            if (fds[1].revents & POLLIN) {
+                ssize_t size = recv(mServerSocket, buffer.data(), buffer.size(), 0);
+                if (size > 0 && !mDropping && clientSize > 0) {
+                    sendto(mListenSocket, buffer.data(), size, 0, reinterpret_cast<sockaddr*>(&client), clientSize);
+                }
+            }
+        }
+    }
+
+    int mListenSocket = -1;
+    int mServerSocket = -1;
+    std::atomic<bool> mActive = false;
+    std::thread mThread;
+};
+#endif
+} // namespace
+
+TEST(TestFailoverClient, SwitchToStandbyWhenPrimaryIsLost) {
+    CountingServer primary;
+    CountingServer standby;
+    ASSERT_TRUE(primary.start(8030));
+    ASSERT_TRUE(standby.start(8031));
+
+    SRTNetFailoverClient client;
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    std::atomic<size_t> switchovers = 0;
+    client.switchedOver = [&](size_t from, size_t to, std::chrono::microseconds switchoverTime) {
+        EXPECT_EQ(from, 0);
+        EXPECT_EQ(to, 1);
+        EXPECT_GT(switchoverTime.count(), 0);
+        switchovers++;
+    };
+    ASSERT_TRUE(client.start({{"127.0.0.1", 8030}, {"127.0.0.1", 8031}}, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE));
+    EXPECT_EQ(client.getPrimaryServerIndex(), 0);
+    ASSERT_TRUE(waitUntil([&]() { return client.hasStandby(); }, std::chrono::seconds(3)));
+    EXPECT_EQ(standby.mServer.getActiveClientSockets().size(), 1);
+
+    std::vector<uint8_t> sendBuffer(1000, 1);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    EXPECT_TRUE(client.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+    EXPECT_TRUE(waitUntil([&]() { return primary.mReceivedMessages == 1; }, std::chrono::seconds(2)));
+    EXPECT_EQ(standby.mReceivedMessages, 0);
+
+    ASSERT_TRUE(primary.mServer.stop());
+    ASSERT_TRUE(waitUntil([&]() { return client.getPrimaryServerIndex() == 1; }, std::chrono::seconds(3)));
+
+    EXPECT_TRUE(client.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+    EXPECT_TRUE(waitUntil([&]() { return standby.mReceivedMessages == 1; }, std::chrono::seconds(2)));
+    EXPECT_EQ(client.getSwitchoverCount(), 1);
+    EXPECT_EQ(switchovers, 1);
+    EXPECT_GT(client.getLastSwitchoverTime().count(), 0);
+    EXPECT_TRUE(client.stop());
+}
+
+TEST(TestFailoverClient, FailToStartWithoutReachableServer) {
+    SRTNetFailoverClient client;
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    EXPECT_FALSE(client.start({{"127.0.0.1", 8032}}, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE));
+    EXPECT_FALSE(client.isConnected());
+}
+
+#ifndef WIN32
+TEST(TestFailoverClient, SwitchToStandbyWhenPrimaryStalls) {
+    CountingServer primary;
+    CountingServer standby;
+    UdpRelay relay;
+    ASSERT_TRUE(primary.start(8047));
+    ASSERT_TRUE(standby.start(8048));
+    ASSERT_TRUE(relay.start(8049, 8047));
+
+    SRTNetFailoverClient client;
+    ASSERT_TRUE(client.setLivenessTimeout(std::chrono::milliseconds(200)));
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(client.start({{"127.0.0.1", 8049}, {"127.0.0.1", 8048}}, 16, 120, 100, ctx, SRT_LIVE_MAX_PLSIZE));
+    EXPECT_FALSE(client.setLivenessTimeout(std::chrono::milliseconds(100)));
+    ASSERT_TRUE(waitUntil([&]() { return client.hasStandby(); }, std::chrono::seconds(3)));
+
+    std::vector<uint8_t> sendBuffer(1000, 1);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    EXPECT_TRUE(client.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+    EXPECT_TRUE(waitUntil([&]() { return primary.mReceivedMessages == 1; }, std::chrono::seconds(2)));
+
+    // The path breaks without a disconnect, the failover must happen long before the 5 s peer idle timeout
+    relay.mDropping = true;
+    auto stalled = std::chrono::steady_clock::now();
+    EXPECT_TRUE(waitUntil(
+        [&]() {
+            client.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl);
+            return client.getPrimaryServerIndex() == 1;
+        },
+        std::chrono::seconds(2)));
+    EXPECT_LT(std::chrono::steady_clock::now() - stalled, std::chrono::seconds(2));
+    EXPECT_TRUE(waitUntil([&]() { return standby.mReceivedMessages > 0; }, std::chrono::seconds(2)));
+    EXPECT_EQ(client.getSwitchoverCount(), 1);
+    EXPECT_TRUE(client.stop());
+}
+#endif
@@ -0,0 +1,62 @@
+#include <gtest/gtest.h>
+
+#include "SRTNetFleetStatistics.h"
+
+namespace {
+using Metric = SRTNetFleetStatistics::Metric;
+
+SRT_TRACEBSTATS makeStats(double rtt, int loss, double sendRate) {
+    SRT_TRACEBSTATS stats{};
+    stats.msRTT = rtt;
+    stats.pktRcvLossTotal = loss;
+    stats.mbpsSendRate = sendRate;
+    return stats;
+}
+} // namespace
+
+TEST(TestFleetStatistics, EmptySnapshot) {
+    SRTNetFleetStatistics fleet;
+    EXPECT_EQ(fleet.size(), 0);
+    EXPECT_EQ(fleet.sum(Metric::mbpsSendRate), 0);
+    EXPECT_EQ(fleet.mean(Metric::msRTT), 0);
+    EXPECT_EQ(fleet.percentile(Metric::msRTT, 95), 0);
+    std::vector<std::pair<SRTSOCKET, double>> top;
+    fleet.topN(Metric::pktRcvLossTotal, 10, top);
+    EXPECT_TRUE(top.empty());
+}
+
+TEST(TestFleetStatistics, AggregateQueries) {
+    SRTNetFleetStatistics fleet;
+    // 101 connections, with RTT 0..100 ms in reverse order, loss equal to the socket id modulo 7
+    for (int i = 0; i <= 100; ++i) {
+        fleet.add(1000 + i, makeStats(100 - i, (1000 + i) % 7, 1.5));
+    }
+    ASSERT_EQ(fleet.size(), 101);
+    EXPECT_DOUBLE_EQ(fleet.sum(Metric::mbpsSendRate), 151.5);
+    EXPECT_DOUBLE_EQ(fleet.mean(Metric::msRTT), 50);
+    EXPECT_DOUBLE_EQ(fleet.percentile(Metric::msRTT, 95), 95);
+    EXPECT_DOUBLE_EQ(fleet.percentile(Metric::msRTT, 0), 0);
+    EXPECT_DOUBLE_EQ(fleet.percentile(Metric::msRTT, 100), 100);
+    EXPECT_DOUBLE_EQ(fleet.getColumn(Metric::msRTT)[0], 100) << "Expected the column order to be the order of add";
+
+    std::vector<std::pair<SRTSOCKET, double>> top;
+    fleet.topN(Metric::msRTT, 3, top);
+    ASSERT_EQ(top.size(), 3);
+    EXPECT_EQ(top[0], std::make_pair(SRTSOCKET(1000), 100.0));
+    EXPECT_EQ(top[1], std::make_pair(SRTSOCKET(1001), 99.0));
+    EXPECT_EQ(top[2], std::make_pair(SRTSOCKET(1002), 98.0));
+
+    fleet.topN(Metric::msRTT, 2, top, false);
+    ASSERT_EQ(top.size(), 2);
+    EXPECT_EQ(top[0].first, 1100);
+    EXPECT_EQ(top[1].first, 1099);
+
+    fleet.topN(Metric::pktRcvLossTotal, 500, top);
+    EXPECT_EQ(top.size(), 101) << "Expected at most one entry per connection";
+    EXPECT_DOUBLE_EQ(top.front().second, 6);
+    EXPECT_DOUBLE_EQ(top.back().second, 0);
+
+    fleet.clear();
+    EXPECT_EQ(fleet.size(), 0);
+    EXPECT_TRUE(fleet.getColumn(Metric::msRTT).empty());
+}
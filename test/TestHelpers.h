@@ -0,0 +1,30 @@
+//
+// Helpers shared by the unit tests.
+//
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <thread>
+
+///
+/// @brief Poll a condition until it holds or a timeout passes
+/// @param function The condition
+/// @param timeout How long to wait for the condition at most
+/// @param sleepFor How long to sleep between polls
+/// @return true if the condition held before the timeout
+inline bool waitUntil(const std::function<bool()>& function,
+                      std::chrono::milliseconds timeout,
+                      std::chrono::milliseconds sleepFor = std::chrono::milliseconds(10)) {
+    std::chrono::milliseconds timeLeft = timeout;
+    while (timeLeft > std::chrono::milliseconds(0)) {
+        if (function()) {
+            return true;
+        }
+
+        std::this_thread::sleep_for(sleepFor);
+        timeLeft -= sleepFor;
+    }
+    return function();
+}
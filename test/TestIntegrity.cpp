@@ -0,0 +1,84 @@
+#include <cstring>
+#include <random>
+#include <sstream>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetIntegrity.h"
+
+namespace {
+std::vector<std::vector<uint8_t>> generateMessages(SRTNetIntegritySender& sender, size_t count, size_t size) {
+    std::vector<std::vector<uint8_t>> messages(count, std::vector<uint8_t>(size));
+    for (auto& message : messages) {
+        EXPECT_TRUE(sender.generate(message.data(), message.size()));
+    }
+    return messages;
+}
+} // namespace
+
+TEST(TestIntegrity, Crc32c) {
+    const char* checkString = "123456789";
+    const auto* check = reinterpret_cast<const uint8_t*>(checkString);
+    EXPECT_EQ(SRTNetCrc32c::computeSoftware(check, 9), 0xE3069283);
+    EXPECT_EQ(SRTNetCrc32c::compute(check, 9), 0xE3069283);
+    EXPECT_EQ(SRTNetCrc32c::compute(check + 4, 5, SRTNetCrc32c::compute(check, 4)), 0xE3069283)
+        << "Expected the CRC to be computable in pieces";
+
+    std::mt19937 generator(1);
+    std::vector<uint8_t> data(1501);
+    for (auto& byte : data) {
+        byte = static_cast<uint8_t>(generator());
+    }
+    for (size_t size : {0, 1, 7, 8, 9, 1316, 1500}) {
+        // Unaligned on purpose
+        EXPECT_EQ(SRTNetCrc32c::compute(data.data() + 1, size), SRTNetCrc32c::computeSoftware(data.data() + 1, size))
+            << "Size " << size;
+    }
+}
+
+TEST(TestIntegrity, CleanStream) {
+    SRTNetIntegritySender sender;
+    SRTNetIntegrityReceiver receiver;
+    uint8_t tooSmall[SRTNetIntegritySender::kHeaderSize - 1];
+    EXPECT_FALSE(sender.generate(tooSmall, sizeof(tooSmall)));
+
+    for (const auto& message : generateMessages(sender, 100, 1316)) {
+        EXPECT_TRUE(receiver.check(message.data(), message.size()));
+    }
+    auto report = receiver.getReport();
+    EXPECT_TRUE(report.isClean());
+    EXPECT_EQ(report.mMessages, 100);
+    EXPECT_EQ(report.mBytes, 131600);
+
+    std::ostringstream stream;
+    SRTNetIntegrityReceiver::writeReport(stream, report);
+    EXPECT_EQ(stream.str(), "integrity: OK messages=100 bytes=131600 missing=0 gaps=0 reordered=0 duplicates=0 "
+                            "corrupted=0");
+}
+
+TEST(TestIntegrity, DetectGapsReorderingDuplicatesAndCorruption) {
+    SRTNetIntegritySender sender;
+    SRTNetIntegrityReceiver receiver;
+    auto messages = generateMessages(sender, 10, 188);
+
+    for (size_t index : {0, 1, 4, 5, 2, 2, 9}) {
+        receiver.check(messages[index].data(), messages[index].size());
+    }
+    auto report = receiver.getReport();
+    EXPECT_EQ(report.mGaps, 2);
+    EXPECT_EQ(report.mReordered, 1) << "Message 2 arrived after message 5";
+    EXPECT_EQ(report.mDuplicates, 1);
+    EXPECT_EQ(report.mMissing, 4) << "Messages 3, 6, 7 and 8";
+    EXPECT_FALSE(report.isClean());
+
+    messages[3][100] ^= 0x01;
+    EXPECT_FALSE(receiver.check(messages[3].data(), messages[3].size()));
+    EXPECT_FALSE(receiver.check(messages[6].data(), messages[6].size() - 1)) << "Truncated message";
+    EXPECT_FALSE(receiver.check(messages[6].data(), 10)) << "Shorter than the header";
+    report = receiver.getReport();
+    EXPECT_EQ(report.mCorrupted, 3);
+    EXPECT_EQ(report.mMissing, 4);
+
+    EXPECT_TRUE(receiver.check(messages[6].data(), messages[6].size()));
+    EXPECT_EQ(receiver.getReport().mMissing, 3);
+}
@@ -0,0 +1,214 @@
+#include <cstdio>
+#include <fstream>
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetPipeline.h"
+
+namespace {
+const SRT_MSGCTRL kMsgCtrl{};
+
+bool pushSequenceNumber(SRTNetPipeline& pipeline, size_t source, uint32_t sequenceNumber) {
+    uint8_t message[16] = {};
+    memcpy(message, &sequenceNumber, sizeof(sequenceNumber));
+    return pipeline.push(source, message, sizeof(message), kMsgCtrl, 42);
+}
+
+uint32_t sequenceNumberOf(const uint8_t* data) {
+    uint32_t sequenceNumber;
+    memcpy(&sequenceNumber, data, sizeof(sequenceNumber));
+    return sequenceNumber;
+}
+} // namespace
+
+TEST(TestPipeline, TransformAndFanOut) {
+    const uint32_t kMessages = 10000;
+    std::vector<uint32_t> first;
+    std::vector<uint32_t> second;
+
+    SRTNetPipeline pipeline(64, 1316);
+    size_t source = pipeline.addSource("source");
+    size_t evenOnly = pipeline.addTransform("evenOnly", source, [](SRTNetPipeline::Message& message) {
+        EXPECT_EQ(message.mSocket, 42);
+        EXPECT_EQ(message.mCapacity, 1316);
+        // Drop the odd messages and shorten the even ones to the sequence number
+        message.mSize = sizeof(uint32_t);
+        return sequenceNumberOf(message.mData) % 2 == 0;
+    });
+    size_t firstSink = pipeline.addSink("first", evenOnly, [&](const SRTNetPipeline::Message& message) {
+        EXPECT_EQ(message.mSize, sizeof(uint32_t));
+        first.push_back(sequenceNumberOf(message.mData));
+    });
+    size_t secondSink = pipeline.addSink("second", evenOnly, [&](const SRTNetPipeline::Message& message) {
+        second.push_back(sequenceNumberOf(message.mData));
+    });
+    ASSERT_NE(source, SRTNetPipeline::kInvalidStage);
+    ASSERT_NE(evenOnly, SRTNetPipeline::kInvalidStage);
+    ASSERT_NE(firstSink, SRTNetPipeline::kInvalidStage);
+    ASSERT_NE(secondSink, SRTNetPipeline::kInvalidStage);
+    EXPECT_EQ(pipeline.addSink("sinkOfSink", firstSink, [](const SRTNetPipeline::Message&) {}),
+              SRTNetPipeline::kInvalidStage);
+    EXPECT_EQ(pipeline.addTransform("noInput", 17, [](SRTNetPipeline::Message&) { return true; }),
+              SRTNetPipeline::kInvalidStage);
+
+    EXPECT_FALSE(pushSequenceNumber(pipeline, source, 0)) << "Expected pushes to be dropped until started";
+    ASSERT_TRUE(pipeline.start());
+    EXPECT_FALSE(pipeline.start());
+    EXPECT_EQ(pipeline.addSource("tooLate"), SRTNetPipeline::kInvalidStage);
+    for (uint32_t i = 0; i < kMessages; ++i) {
+        ASSERT_TRUE(pushSequenceNumber(pipeline, source, i));
+    }
+    std::vector<uint8_t> tooLarge(1317);
+    EXPECT_FALSE(pipeline.push(source, tooLarge.data(), tooLarge.size(), kMsgCtrl));
+    pipeline.stop();
+    EXPECT_FALSE(pushSequenceNumber(pipeline, source, 0)) << "Expected pushes to be dropped once stopped";
+
+    ASSERT_EQ(first.size(), kMessages / 2);
+    EXPECT_EQ(first, second);
+    for (size_t i = 0; i < first.size(); ++i) {
+        EXPECT_EQ(first[i], i * 2);
+    }
+
+    std::vector<SRTNetPipeline::StageStatistics> statistics;
+    pipeline.getStatistics(statistics);
+    ASSERT_EQ(statistics.size(), 4);
+    EXPECT_EQ(statistics[0].mName, "source");
+    EXPECT_EQ(statistics[0].mMessagesIn, kMessages);
+    EXPECT_EQ(statistics[0].mMessagesOut, kMessages);
+    EXPECT_EQ(statistics[0].mDroppedMessages, 3);
+    EXPECT_EQ(statistics[1].mMessagesIn, kMessages);
+    EXPECT_EQ(statistics[1].mMessagesOut, kMessages / 2);
+    EXPECT_EQ(statistics[1].mDroppedMessages, kMessages / 2);
+    EXPECT_EQ(statistics[1].mBytesIn, kMessages * 16);
+    EXPECT_EQ(statistics[1].mQueueCapacity, 64);
+    EXPECT_LE(statistics[1].mMaxQueueDepth, 64);
+    EXPECT_GT(statistics[1].mMessagesPerSecond, 0);
+    for (size_t sink = 2; sink < 4; ++sink) {
+        EXPECT_EQ(statistics[sink].mMessagesIn, kMessages / 2);
+        EXPECT_EQ(statistics[sink].mBytesIn, kMessages / 2 * sizeof(uint32_t));
+        EXPECT_EQ(statistics[sink].mQueueDepth, 0);
+    }
+}
+
+TEST(TestPipeline, BackpressureFromSlowStage) {
+    const uint32_t kMessages = 200;
+    const size_t kSlots = 4;
+    std::vector<uint32_t> received;
+
+    SRTNetPipeline pipeline(kSlots, 16);
+    size_t source = pipeline.addSource("source");
+    size_t forward = pipeline.addTransform("forward", source, [](SRTNetPipeline::Message&) { return true; }, 0);
+    pipeline.addSink("slow", forward, [&](const SRTNetPipeline::Message& message) {
+        received.push_back(sequenceNumberOf(message.mData));
+        std::this_thread::sleep_for(std::chrono::microseconds(200));
+    });
+    ASSERT_TRUE(pipeline.start());
+
+    // The source is far faster than the sink, so it is held up rather than losing messages
+    for (uint32_t i = 0; i < kMessages; ++i) {
+        ASSERT_TRUE(pushSequenceNumber(pipeline, source, i));
+    }
+    std::vector<SRTNetPipeline::StageStatistics> statistics;
+    pipeline.getStatistics(statistics);
+    EXPECT_GT(statistics[0].mBackpressureWaits, 0);
+    EXPECT_GT(statistics[1].mBackpressureWaits, 0);
+    EXPECT_EQ(statistics[2].mMaxQueueDepth, kSlots);
+#ifdef __linux__
+    EXPECT_TRUE(statistics[1].mPinned);
+#endif
+    pipeline.stop();
+
+    ASSERT_EQ(received.size(), kMessages);
+    for (uint32_t i = 0; i < kMessages; ++i) {
+        EXPECT_EQ(received[i], i);
+    }
+    pipeline.getStatistics(statistics);
+    for (const auto& stage : statistics) {
+        EXPECT_EQ(stage.mDroppedMessages, 0);
+    }
+}
+
+TEST(TestPipeline, FileSink) {
+    std::string path = testing::TempDir() + "TestPipelineFileSink.bin";
+    std::remove(path.c_str());
+
+    SRTNetPipeline pipeline(16, 16);
+    size_t source = pipeline.addSource("source");
+    ASSERT_NE(pipeline.addFileSink("file", source, path), SRTNetPipeline::kInvalidStage);
+    EXPECT_EQ(pipeline.addFileSink("noDirectory", source, "/no/such/directory/file.bin"),
+              SRTNetPipeline::kInvalidStage);
+    ASSERT_TRUE(pipeline.start());
+    for (uint32_t i = 0; i < 100; ++i) {
+        ASSERT_TRUE(pushSequenceNumber(pipeline, source, i));
+    }
+    pipeline.stop();
+
+    std::ifstream file(path, std::ios::binary);
+    std::vector<uint8_t> content((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ASSERT_EQ(content.size(), 100 * 16);
+    for (uint32_t i = 0; i < 100; ++i) {
+        EXPECT_EQ(sequenceNumberOf(&content[i * 16]), i);
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TestPipeline, SrtSourceToSrtSink) {
+    SRTNet server;
+    SRTNet client;
+    SRTNet relayServer;
+    SRTNet relayClient;
+    std::atomic<size_t> relayed = 0;
+    auto acceptAll = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                        const SRTNet::ConnectionInformation&) { return ctx; };
+    server.clientConnected = acceptAll;
+    relayServer.clientConnected = acceptAll;
+    relayServer.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL&,
+                                         std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+        EXPECT_EQ(size, 1000);
+        EXPECT_EQ(data[0], 0xAB);
+        relayed++;
+    };
+
+    // server -> pipeline -> relayClient -> relayServer
+    SRTNetPipeline pipeline(64, SRT_LIVE_MAX_PLSIZE);
+    size_t source = pipeline.addSource("ingest", server);
+    size_t mark = pipeline.addTransform("mark", source, [](SRTNetPipeline::Message& message) {
+        message.mData[0] = 0xAB;
+        return true;
+    });
+    ASSERT_NE(pipeline.addSrtSink("egress", mark, relayClient), SRTNetPipeline::kInvalidStage);
+    ASSERT_TRUE(pipeline.start());
+
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(relayServer.startServer("127.0.0.1", 8036, 16, 120, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(relayClient.startClient("127.0.0.1", 8036, 16, 120, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8035, 16, 120, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8035, 16, 120, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+
+    std::vector<uint8_t> message(1000);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    for (int i = 0; i < 100; ++i) {
+        ASSERT_TRUE(client.sendData(message.data(), message.size(), &msgCtrl));
+    }
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+    while (relayed < 100 && std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(relayed, 100);
+
+    client.stop();
+    server.stop();
+    pipeline.stop();
+    relayClient.stop();
+    relayServer.stop();
+}
+
+TEST(TestPipeline, RejectSrtSourceWithSlowLane) {
+    // The slow lane calls receivedDataNoCopy from two threads, but a source has a single producer
+    SRTNet server;
+    ASSERT_TRUE(server.setSlowLane(std::chrono::milliseconds(20)));
+    SRTNetPipeline pipeline(64, SRT_LIVE_MAX_PLSIZE);
+    EXPECT_EQ(pipeline.addSource("ingest", server), SRTNetPipeline::kInvalidStage);
+    EXPECT_FALSE(server.receivedDataNoCopy);
+}
@@ -0,0 +1,138 @@
+#include <gtest/gtest.h>
+
+#include "SRTNetRedundancyGroup.h"
+
+namespace {
+const SRTSOCKET kPrimary = 1001;
+const SRTSOCKET kBackup = 1002;
+} // namespace
+
+TEST(TestRedundancyGroup, ForwardOnlyActiveMember) {
+    SRTNetRedundancyGroup group(std::chrono::milliseconds(50));
+    ASSERT_TRUE(group.addMember(kPrimary));
+    ASSERT_TRUE(group.addMember(kBackup));
+    EXPECT_FALSE(group.addMember(kBackup));
+
+    std::vector<SRTSOCKET> forwarded;
+    const uint8_t* forwardedData = nullptr;
+    group.output = [&](const uint8_t* data, size_t size, SRT_MSGCTRL& msgCtrl, SRTSOCKET socket) {
+        forwarded.push_back(socket);
+        forwardedData = data;
+    };
+
+    std::vector<uint8_t> payload(1316, 0x47);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary));
+    EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup));
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary));
+    EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, 1003)) << "Not a member";
+
+    EXPECT_EQ(forwarded, std::vector<SRTSOCKET>({kPrimary, kPrimary}));
+    EXPECT_EQ(forwardedData, payload.data()) << "Expected the payload to be forwarded without copying";
+    EXPECT_EQ(group.getActiveMember(), kPrimary);
+    EXPECT_EQ(group.getSwitchCount(), 0);
+}
+
+TEST(TestRedundancyGroup, SwitchOnGapAndRevert) {
+    SRTNetRedundancyGroup group(std::chrono::milliseconds(50), true, std::chrono::milliseconds(100));
+    ASSERT_TRUE(group.addMember(kPrimary));
+    ASSERT_TRUE(group.addMember(kBackup));
+
+    std::vector<std::pair<SRTSOCKET, SRTSOCKET>> switches;
+    group.switched = [&](SRTSOCKET from, SRTSOCKET to, std::chrono::microseconds gap) {
+        switches.emplace_back(from, to);
+        if (from == kPrimary) {
+            EXPECT_EQ(gap, std::chrono::milliseconds(80));
+        }
+    };
+
+    std::vector<uint8_t> payload(1316);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    auto now = std::chrono::steady_clock::now();
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+    EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+
+    // Primary goes silent, the backup takes over on the first message after the gap threshold
+    now += std::chrono::milliseconds(40);
+    EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+    now += std::chrono::milliseconds(40);
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+    EXPECT_EQ(group.getActiveMember(), kBackup);
+
+    // Primary is back, but must be healthy for the hold time before the group reverts to it
+    EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+    for (int i = 0; i < 3; ++i) {
+        now += std::chrono::milliseconds(25);
+        EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+        EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+    }
+    now += std::chrono::milliseconds(25);
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now)) << "Healthy for 100 ms";
+    EXPECT_EQ(group.getActiveMember(), kPrimary);
+    EXPECT_EQ(group.getSwitchCount(), 2);
+    EXPECT_EQ(switches, (std::vector<std::pair<SRTSOCKET, SRTSOCKET>>({{kPrimary, kBackup}, {kBackup, kPrimary}})));
+
+    // Removing the active member hands over to whoever delivers next
+    EXPECT_TRUE(group.removeMember(kPrimary));
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+    EXPECT_EQ(switches.back(), std::make_pair(SRT_INVALID_SOCK, kBackup));
+
+    auto statistics = group.getMemberStatistics();
+    ASSERT_EQ(statistics.size(), 1);
+    EXPECT_EQ(statistics[0].mSocket, kBackup);
+    EXPECT_TRUE(statistics[0].mActive);
+    EXPECT_EQ(statistics[0].mLargestGap, std::chrono::milliseconds(40));
+}
+
+TEST(TestRedundancyGroup, SwitchAwayFromLossyMember) {
+    SRTNetRedundancyGroup group(std::chrono::milliseconds(50), true, std::chrono::milliseconds(100));
+    ASSERT_TRUE(group.addMember(kPrimary));
+    ASSERT_TRUE(group.addMember(kBackup));
+    EXPECT_FALSE(group.setLossThreshold(1.5));
+    ASSERT_TRUE(group.setLossThreshold(0.05));
+
+    std::vector<uint8_t> payload(1316);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    auto now = std::chrono::steady_clock::now();
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+
+    SRT_TRACEBSTATS primaryStats{};
+    SRT_TRACEBSTATS backupStats{};
+    EXPECT_TRUE(group.updateLinkStatistics(kPrimary, primaryStats, now));
+    EXPECT_TRUE(group.updateLinkStatistics(kBackup, backupStats, now));
+    EXPECT_FALSE(group.updateLinkStatistics(1003, backupStats, now)) << "Not a member";
+
+    // 10 of 100 packets of the primary are lost, the backup loses none
+    now += std::chrono::milliseconds(10);
+    primaryStats.pktRecvTotal = 90;
+    primaryStats.pktRcvLossTotal = 10;
+    backupStats.pktRecvTotal = 100;
+    EXPECT_TRUE(group.updateLinkStatistics(kPrimary, primaryStats, now));
+    EXPECT_TRUE(group.updateLinkStatistics(kBackup, backupStats, now));
+    auto statistics = group.getMemberStatistics();
+    ASSERT_EQ(statistics.size(), 2);
+    EXPECT_DOUBLE_EQ(statistics[0].mLossRatio, 0.1);
+    EXPECT_TRUE(statistics[0].mDegraded);
+    EXPECT_FALSE(statistics[1].mDegraded);
+
+    // The primary still delivers, but the next message of the healthy backup takes over
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+    EXPECT_EQ(group.getActiveMember(), kBackup);
+
+    // The primary recovers, and the group reverts once it was free of loss for the hold time
+    now += std::chrono::milliseconds(10);
+    primaryStats.pktRecvTotal = 190;
+    EXPECT_TRUE(group.updateLinkStatistics(kPrimary, primaryStats, now));
+    EXPECT_FALSE(group.getMemberStatistics()[0].mDegraded);
+    for (int i = 0; i < 4; ++i) {
+        now += std::chrono::milliseconds(20);
+        EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kBackup, now));
+        EXPECT_FALSE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+    }
+    now += std::chrono::milliseconds(20);
+    EXPECT_TRUE(group.pushData(payload.data(), payload.size(), msgCtrl, kPrimary, now));
+    EXPECT_EQ(group.getActiveMember(), kPrimary);
+    EXPECT_EQ(group.getSwitchCount(), 2);
+}
@@ -1,9 +1,12 @@
 #include <condition_variable>
+#include <numeric>
+#include <optional>
 #include <thread>
 
 #include <gtest/gtest.h>
 
 #include "SRTNet.h"
+#include "TestHelpers.h"
 
 std::string kValidPsk = "Th1$_is_4n_0pt10N4L_P$k";
 std::string kInvalidPsk = "Th1$_is_4_F4k3_P$k";
@@ -33,21 +36,6 @@ std::pair<std::string, uint16_t> getBindIpAndPortFromSRTSocket(SRTSOCKET socket)
     return {"Unsupported", 0};
 }
 
-bool waitUntil(const std::function<bool()>& function,
-               std::chrono::milliseconds timeout,
-               std::chrono::milliseconds sleepFor) {
-    std::chrono::milliseconds timeLeft = timeout;
-    while (timeLeft > std::chrono::milliseconds(0)) {
-        if (function()) {
-            return true;
-        }
-
-        std::this_thread::sleep_for(sleepFor);
-        timeLeft -= sleepFor;
-    }
-    return function();
-}
-
 ///
 /// @brief Get the remote peer IP address and port of an SRT socket
 /// @param socket The SRT socket to get the peer IP and Port from
@@ -719,3 +707,623 @@ TEST_F(TestSRTFixture, StreamId) {
     EXPECT_TRUE(waitForClientToConnect(std::chrono::seconds(2)));
     ASSERT_EQ(sentStreamId, std::string(receivedStreamId));
 }
+
+TEST_F(TestSRTFixture, SingleThreadServer) {
+    ASSERT_TRUE(mServer.startServer("127.0.0.1", 8026, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, kValidPsk, false,
+                                    mServerCtx, true));
+
+    std::mutex receiveMutex;
+    std::condition_variable receiveCondition;
+    std::map<SRTSOCKET, size_t> receivedMessages;
+    mServer.receivedData = [&](std::unique_ptr<std::vector<uint8_t>>& data, SRT_MSGCTRL& msgCtrl,
+                               std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+        EXPECT_EQ(ctx, mConnectionCtx);
+        {
+            std::lock_guard<std::mutex> lock(receiveMutex);
+            receivedMessages[socket]++;
+        }
+        receiveCondition.notify_one();
+    };
+
+    SRTNet client2;
+    ASSERT_TRUE(mClient.startClient("127.0.0.1", 8026, 16, 1000, 100, mClientCtx, SRT_LIVE_MAX_PLSIZE, true, 5000,
+                                    kValidPsk));
+    ASSERT_TRUE(client2.startClient("127.0.0.1", 8026, 16, 1000, 100, mClientCtx, SRT_LIVE_MAX_PLSIZE, true, 5000,
+                                    kValidPsk));
+    ASSERT_TRUE(waitUntil([&]() { return mServer.getActiveClientSockets().size() == 2; }, std::chrono::seconds(2),
+                          std::chrono::milliseconds(10)));
+
+    std::vector<uint8_t> sendBuffer(1000, 1);
+    for (int i = 0; i < 10; ++i) {
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        EXPECT_TRUE(mClient.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+        EXPECT_TRUE(client2.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+    }
+
+    {
+        std::unique_lock<std::mutex> lock(receiveMutex);
+        bool successfulWait = receiveCondition.wait_for(lock, std::chrono::seconds(2), [&]() {
+            return receivedMessages.size() == 2 && receivedMessages.begin()->second == 10 &&
+                   receivedMessages.rbegin()->second == 10;
+        });
+        EXPECT_TRUE(successfulWait) << "Timeout waiting for data from both clients";
+    }
+
+    ASSERT_TRUE(client2.stop());
+    EXPECT_TRUE(waitUntil([&]() { return mServer.getActiveClientSockets().size() == 1; }, std::chrono::seconds(7),
+                          std::chrono::milliseconds(10)));
+    EXPECT_TRUE(mServer.stop());
+}
+
+TEST_F(TestSRTFixture, ApplicationEncryption) {
+    const std::vector<uint8_t> key(32, 0x5a);
+    ASSERT_FALSE(mServer.setApplicationEncryption(std::vector<uint8_t>(10, 0), 2));
+    ASSERT_TRUE(mServer.setApplicationEncryption(key, 2));
+    ASSERT_TRUE(mClient.setApplicationEncryption(key, 0));
+    ASSERT_TRUE(
+        mServer.startServer("127.0.0.1", 8027, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, mServerCtx));
+    ASSERT_TRUE(mClient.startClient("127.0.0.1", 8027, 16, 1000, 100, mClientCtx, SRT_LIVE_MAX_PLSIZE, true, 5000, ""));
+    EXPECT_FALSE(mClient.setApplicationEncryption(key, 0)) << "Expect to fail when already started";
+
+    std::mutex receiveMutex;
+    std::condition_variable receiveCondition;
+    std::vector<std::vector<uint8_t>> received;
+    mServer.receivedData = [&](std::unique_ptr<std::vector<uint8_t>>& data, SRT_MSGCTRL& msgCtrl,
+                               std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+        {
+            std::lock_guard<std::mutex> lock(receiveMutex);
+            received.push_back(*data);
+        }
+        receiveCondition.notify_one();
+    };
+
+    std::vector<std::vector<uint8_t>> messages;
+    std::vector<const uint8_t*> pointers;
+    std::vector<size_t> sizes;
+    for (uint8_t i = 0; i < 8; ++i) {
+        messages.emplace_back(1000 + i, i);
+    }
+    for (const auto& message : messages) {
+        pointers.push_back(message.data());
+        sizes.push_back(message.size());
+    }
+    EXPECT_EQ(mClient.sendDataBatch(pointers.data(), sizes.data(), pointers.size(), nullptr), messages.size());
+
+    std::vector<uint8_t> tooLarge(SRT_LIVE_MAX_PLSIZE, 1);
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    EXPECT_FALSE(mClient.sendData(tooLarge.data(), tooLarge.size(), &msgCtrl))
+        << "Expect the encryption overhead to reduce the max message size";
+
+    {
+        std::unique_lock<std::mutex> lock(receiveMutex);
+        bool successfulWait =
+            receiveCondition.wait_for(lock, std::chrono::seconds(2), [&]() { return received.size() == 8; });
+        EXPECT_TRUE(successfulWait) << "Timeout waiting for the encrypted messages";
+        EXPECT_EQ(received, messages);
+    }
+
+    // A client with another key gets connected, but its messages are dropped by the server
+    SRTNet client2;
+    ASSERT_TRUE(client2.setApplicationEncryption(std::vector<uint8_t>(32, 0x00), 0));
+    ASSERT_TRUE(client2.startClient("127.0.0.1", 8027, 16, 1000, 100, mClientCtx, SRT_LIVE_MAX_PLSIZE, true, 5000, ""));
+    EXPECT_TRUE(client2.sendData(messages[0].data(), messages[0].size(), &msgCtrl));
+    {
+        std::unique_lock<std::mutex> lock(receiveMutex);
+        bool successfulWait =
+            receiveCondition.wait_for(lock, std::chrono::milliseconds(500), [&]() { return received.size() > 8; });
+        EXPECT_FALSE(successfulWait) << "Did not expect messages encrypted with another key to be delivered";
+    }
+}
+
+TEST(TestSrt, AdaptiveLatency) {
+    SRTNet server;
+    EXPECT_FALSE(server.setAdaptiveLatency(4.0, 100, 20)) << "Expect max latency below min latency to be rejected";
+    ASSERT_TRUE(server.setAdaptiveLatency(4.0, 20, 500));
+
+    std::mutex connectionMutex;
+    std::vector<SRTNet::ConnectionInformation> connections;
+    auto serverCtx = std::make_shared<SRTNet::NetworkConnection>();
+    server.clientConnected = [&](struct sockaddr& sin, SRTSOCKET newSocket,
+                                 std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                 const SRTNet::ConnectionInformation& connectionInformation) {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        connections.push_back(connectionInformation);
+        return serverCtx;
+    };
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8028, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, serverCtx));
+    EXPECT_FALSE(server.setAdaptiveLatency(4.0, 20, 500)) << "Expect to fail when already started";
+
+    auto clientCtx = std::make_shared<SRTNet::NetworkConnection>();
+    std::vector<uint8_t> sendBuffer(1000, 1);
+    for (int i = 0; i < 2; ++i) {
+        SRTNet client;
+        ASSERT_TRUE(client.startClient("127.0.0.1", 8028, 16, 20, 100, clientCtx, SRT_LIVE_MAX_PLSIZE, true));
+        ASSERT_TRUE(waitUntil([&]() { return server.getActiveClientSockets().size() == 1; }, std::chrono::seconds(2),
+                              std::chrono::milliseconds(10)));
+        // Send data so the connection measures the RTT
+        for (int j = 0; j < 50; ++j) {
+            SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+            EXPECT_TRUE(client.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+            std::this_thread::sleep_for(std::chrono::milliseconds(5));
+        }
+        ASSERT_TRUE(client.stop());
+        ASSERT_TRUE(waitUntil([&]() { return server.getActiveClientSockets().empty(); }, std::chrono::seconds(7),
+                              std::chrono::milliseconds(10)));
+    }
+    EXPECT_TRUE(server.stop());
+
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    ASSERT_EQ(connections.size(), 2);
+    // The first connection from the peer has no RTT to go on and gets the latency of the server
+    EXPECT_EQ(connections[0].mSelectedLatency, 1000);
+    EXPECT_EQ(connections[0].mEstimatedRtt, -1.0);
+    EXPECT_EQ(connections[0].mReceiveLatency, 1000);
+    // The second connection gets a latency from the RTT of the first one, which on localhost is clamped to the minimum
+    EXPECT_GE(connections[1].mEstimatedRtt, 0.0);
+    EXPECT_EQ(connections[1].mSelectedLatency, 20);
+    EXPECT_EQ(connections[1].mReceiveLatency, 20);
+}
+
+TEST(TestSrt, NetworkOptions) {
+    SRTNet::NetworkOptions expedited;
+    expedited.mDscp = 46;
+    expedited.mTtl = 32;
+    SRTNet::NetworkOptions assured;
+    assured.mDscp = 34;
+
+    SRTNet server;
+    EXPECT_FALSE(server.setNetworkOptions({64, -1, ""})) << "Expect a DSCP above 63 to be rejected";
+    ASSERT_TRUE(server.setNetworkOptions(expedited));
+    ASSERT_TRUE(server.setStreamNetworkOptions("critical/", expedited));
+    ASSERT_TRUE(server.setStreamNetworkOptions("bulk/", assured));
+
+    std::mutex connectionMutex;
+    std::vector<SRTNet::ConnectionInformation> connections;
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    server.clientConnected = [&](struct sockaddr& sin, SRTSOCKET newSocket,
+                                 std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                 const SRTNet::ConnectionInformation& connectionInformation) {
+        std::lock_guard<std::mutex> lock(connectionMutex);
+        connections.push_back(connectionInformation);
+        return ctx;
+    };
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8029, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+
+    // Streams with a matching rule, and without any rule, inherit the options of the server
+    SRTNet::ConnectionInformation clientInformation;
+    SRTNet critical;
+    critical.connectedToServer = [&](std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket,
+                                     const SRTNet::ConnectionInformation& connectionInformation) {
+        clientInformation = connectionInformation;
+    };
+    ASSERT_TRUE(critical.setNetworkOptions(expedited));
+    ASSERT_TRUE(critical.startClient("127.0.0.1", 8029, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true, 5000, "",
+                                     "critical/camera1"));
+    EXPECT_EQ(clientInformation.mDscp, 46);
+    EXPECT_EQ(clientInformation.mTtl, 32);
+    EXPECT_FALSE(critical.setNetworkOptions(assured)) << "Expect to fail when already started";
+
+    SRTNet other;
+    ASSERT_TRUE(other.startClient("127.0.0.1", 8029, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true, 5000, "",
+                                  "other"));
+
+    // A stream requiring other options than the ones of the server is rejected
+    SRTNet bulk;
+    EXPECT_FALSE(bulk.startClient("127.0.0.1", 8029, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true, 5000, "",
+                                  "bulk/archive"));
+
+    ASSERT_TRUE(waitUntil([&]() { return server.getActiveClientSockets().size() == 2; }, std::chrono::seconds(2),
+                          std::chrono::milliseconds(10)));
+    std::lock_guard<std::mutex> lock(connectionMutex);
+    ASSERT_EQ(connections.size(), 2);
+    for (const auto& connection : connections) {
+        EXPECT_EQ(connection.mDscp, 46);
+        EXPECT_EQ(connection.mTtl, 32);
+    }
+}
+
+TEST(TestSrt, MissingMessages) {
+    EXPECT_EQ(SRTNet::getMissingMessages(1, 2), 0);
+    EXPECT_EQ(SRTNet::getMissingMessages(1, 5), 3);
+    EXPECT_EQ(SRTNet::getMissingMessages(100, 100), 0) << "Expect a duplicate to not be a gap";
+    EXPECT_EQ(SRTNet::getMissingMessages(100, 90), 0) << "Expect an older message to not be a gap";
+
+    // The message number wraps from kMaxMsgNo to 1
+    EXPECT_EQ(SRTNet::getMissingMessages(SRTNet::kMaxMsgNo, 1), 0);
+    EXPECT_EQ(SRTNet::getMissingMessages(SRTNet::kMaxMsgNo - 1, 1), 1);
+    EXPECT_EQ(SRTNet::getMissingMessages(SRTNet::kMaxMsgNo - 2, 3), 4);
+    EXPECT_EQ(SRTNet::getMissingMessages(3, SRTNet::kMaxMsgNo), 0) << "Expect an older message before the wrap";
+
+    EXPECT_EQ(SRTNet::getMissingMessages(0, 5), 0) << "Expect unknown message numbers to be ignored";
+    EXPECT_EQ(SRTNet::getMissingMessages(5, -1), 0) << "Expect unknown message numbers to be ignored";
+}
+
+TEST_F(TestSRTFixture, CallbackExecutor) {
+    ASSERT_TRUE(mServer.setCallbackExecutor(2, 64));
+    ASSERT_TRUE(
+        mServer.startServer("127.0.0.1", 8034, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, mServerCtx));
+    EXPECT_FALSE(mServer.setCallbackExecutor(0)) << "Expect to fail when already started";
+
+    std::mutex receiveMutex;
+    std::condition_variable receiveCondition;
+    std::map<SRTSOCKET, std::vector<uint8_t>> received;
+    std::atomic<bool> disconnectedAfterData{false};
+    mServer.receivedData = [&](std::unique_ptr<std::vector<uint8_t>>& data, SRT_MSGCTRL& msgCtrl,
+                               std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+        EXPECT_EQ(ctx, mConnectionCtx);
+        {
+            std::lock_guard<std::mutex> lock(receiveMutex);
+            received[socket].push_back(data->at(0));
+        }
+        receiveCondition.notify_one();
+    };
+    mServer.clientDisconnected = [&](std::shared_ptr<SRTNet::NetworkConnection>& ctx, SRTSOCKET socket) {
+        std::lock_guard<std::mutex> lock(receiveMutex);
+        disconnectedAfterData = received[socket].size() == 100;
+        receiveCondition.notify_one();
+    };
+
+    SRTNet client2;
+    ASSERT_TRUE(mClient.startClient("127.0.0.1", 8034, 16, 1000, 100, mClientCtx, SRT_LIVE_MAX_PLSIZE, true));
+    ASSERT_TRUE(client2.startClient("127.0.0.1", 8034, 16, 1000, 100, mClientCtx, SRT_LIVE_MAX_PLSIZE, true));
+    std::vector<uint8_t> sendBuffer(1000);
+    for (uint8_t i = 0; i < 100; ++i) {
+        sendBuffer[0] = i;
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        EXPECT_TRUE(mClient.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+        EXPECT_TRUE(client2.sendData(sendBuffer.data(), sendBuffer.size(), &msgCtrl));
+    }
+
+    std::vector<uint8_t> expected(100);
+    std::iota(expected.begin(), expected.end(), 0);
+    {
+        std::unique_lock<std::mutex> lock(receiveMutex);
+        bool successfulWait = receiveCondition.wait_for(lock, std::chrono::seconds(2), [&]() {
+            return received.size() == 2 && received.begin()->second.size() == 100 &&
+                   received.rbegin()->second.size() == 100;
+        });
+        ASSERT_TRUE(successfulWait) << "Timeout waiting for data from both clients";
+        for (const auto& [socket, messages] : received) {
+            EXPECT_EQ(messages, expected) << "Expected the messages of each client in order";
+        }
+    }
+
+    ASSERT_TRUE(client2.stop());
+    {
+        std::unique_lock<std::mutex> lock(receiveMutex);
+        EXPECT_TRUE(receiveCondition.wait_for(lock, std::chrono::seconds(7),
+                                              [&]() { return disconnectedAfterData.load(); }))
+            << "Expected clientDisconnected after the last message of the client";
+    }
+    EXPECT_TRUE(mServer.stop());
+}
+
+TEST(TestSrt, FrontDoorRedirect) {
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    auto acceptAll = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                        const SRTNet::ConnectionInformation&) { return ctx; };
+    SRTNet firstBackend;
+    SRTNet secondBackend;
+    firstBackend.clientConnected = acceptAll;
+    secondBackend.clientConnected = acceptAll;
+    ASSERT_TRUE(firstBackend.startServer("127.0.0.1", 8037, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(secondBackend.startServer("127.0.0.1", 8038, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+
+    const std::vector<SRTNet::Backend> backends = {
+        {"127.0.0.1", 8037, [&]() { return firstBackend.getActiveClientSockets().size(); }},
+        {"127.0.0.1", 8038, [&]() { return secondBackend.getActiveClientSockets().size(); }}};
+    SRTNet frontDoor;
+    EXPECT_FALSE(frontDoor.setFrontDoor({}, SRTNet::RedirectPolicy::leastLoaded)) << "Expect backends to be required";
+    ASSERT_TRUE(frontDoor.setFrontDoor(backends, SRTNet::RedirectPolicy::leastLoaded));
+    ASSERT_TRUE(frontDoor.startServer("127.0.0.1", 8039, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    EXPECT_FALSE(frontDoor.setFrontDoor(backends, SRTNet::RedirectPolicy::leastLoaded))
+        << "Expect to fail when already started";
+
+    // The callers are spread over the backends, one at a time so that every caller sees the load of the previous ones
+    std::vector<std::unique_ptr<SRTNet>> clients;
+    for (size_t i = 0; i < 4; ++i) {
+        auto& client = clients.emplace_back(std::make_unique<SRTNet>());
+        ASSERT_TRUE(client->setRedirectBackends(backends));
+        ASSERT_TRUE(client->startClient("127.0.0.1", 8039, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+        ASSERT_TRUE(waitUntil(
+            [&]() {
+                return firstBackend.getActiveClientSockets().size() + secondBackend.getActiveClientSockets().size() ==
+                       i + 1;
+            },
+            std::chrono::seconds(2), std::chrono::milliseconds(10)));
+    }
+    EXPECT_EQ(firstBackend.getActiveClientSockets().size(), 2);
+    EXPECT_EQ(secondBackend.getActiveClientSockets().size(), 2);
+    EXPECT_TRUE(frontDoor.getActiveClientSockets().empty());
+
+    // A client that does not know the backends can't follow the redirect
+    SRTNet unaware;
+    EXPECT_FALSE(unaware.startClient("127.0.0.1", 8039, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+
+    // With a stream ID hash every caller of a stream is sent to the same backend
+    SRTNet hashFrontDoor;
+    ASSERT_TRUE(hashFrontDoor.setFrontDoor(backends, SRTNet::RedirectPolicy::streamIdHash));
+    ASSERT_TRUE(hashFrontDoor.startServer("127.0.0.1", 8040, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false,
+                                          ctx));
+    std::vector<uint16_t> connectedPorts;
+    for (int i = 0; i < 3; ++i) {
+        SRTNet client;
+        client.connectedToServer = [&](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET socket,
+                                       const SRTNet::ConnectionInformation&) {
+            sockaddr_storage address{};
+            int addressLength = sizeof(address);
+            ASSERT_NE(srt_getpeername(socket, reinterpret_cast<sockaddr*>(&address), &addressLength), SRT_ERROR);
+            connectedPorts.push_back(ntohs(reinterpret_cast<sockaddr_in*>(&address)->sin_port));
+        };
+        ASSERT_TRUE(client.setRedirectBackends(backends));
+        ASSERT_TRUE(client.startClient("127.0.0.1", 8040, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true, 5000, "",
+                                       "studio/camera1"));
+        EXPECT_TRUE(client.stop());
+    }
+    ASSERT_EQ(connectedPorts.size(), 3);
+    EXPECT_NE(connectedPorts[0], 8040);
+    EXPECT_EQ(connectedPorts[1], connectedPorts[0]);
+    EXPECT_EQ(connectedPorts[2], connectedPorts[0]);
+
+    for (auto& client : clients) {
+        EXPECT_TRUE(client->stop());
+    }
+    EXPECT_TRUE(hashFrontDoor.stop());
+    EXPECT_TRUE(frontDoor.stop());
+    EXPECT_TRUE(firstBackend.stop());
+    EXPECT_TRUE(secondBackend.stop());
+}
+
+TEST(TestSrt, ConnectionCounters) {
+    SRTNet server;
+    SRTNet client;
+    ASSERT_TRUE(server.setConnectionCounters(16));
+    ASSERT_TRUE(client.setConnectionCounters(1));
+    std::atomic<size_t> received{0};
+    server.clientConnected = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                const SRTNet::ConnectionInformation&) { return ctx; };
+    server.receivedDataNoCopy = [&](const uint8_t*, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                    SRTSOCKET) { received++; };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8041, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8041, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    EXPECT_FALSE(client.setConnectionCounters(0)) << "Expect to fail when already started";
+
+    std::vector<uint8_t> message(1000);
+    for (int i = 0; i < 100; ++i) {
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        ASSERT_TRUE(client.sendData(message.data(), message.size(), &msgCtrl));
+    }
+    ASSERT_TRUE(waitUntil([&]() { return received == 100; }, std::chrono::seconds(2), std::chrono::milliseconds(10)));
+
+    SRTNet::ConnectionCounters counters;
+    ASSERT_TRUE(client.getConnectionCounters(counters));
+    EXPECT_EQ(counters.mMessagesSent, 100);
+    EXPECT_EQ(counters.mBytesSent, 100 * 1000);
+    EXPECT_EQ(counters.mMessagesReceived, 0);
+    EXPECT_GT(counters.mLastActivity, 0);
+
+    std::vector<std::pair<SRTSOCKET, SRTNet::ConnectionCounters>> serverCounters;
+    server.getAllConnectionCounters(serverCounters);
+    ASSERT_EQ(serverCounters.size(), 1);
+    EXPECT_EQ(serverCounters[0].second.mMessagesReceived, 100);
+    EXPECT_EQ(serverCounters[0].second.mBytesReceived, 100 * 1000);
+    ASSERT_TRUE(server.getConnectionCounters(counters, serverCounters[0].first));
+    EXPECT_EQ(counters.mMessagesReceived, 100);
+    EXPECT_GT(counters.mReceiveBitsPerSecond, 0);
+
+    EXPECT_TRUE(client.stop());
+    EXPECT_FALSE(client.getConnectionCounters(counters)) << "Expect no counters once stopped";
+    EXPECT_TRUE(server.stop());
+}
+
+TEST(TestSrt, CapacityProbe) {
+    SRTNet server;
+    SRTNet client;
+    ASSERT_TRUE(server.setCapacityProbe(64));
+    ASSERT_TRUE(client.setCapacityProbe(64));
+    EXPECT_FALSE(client.setCapacityProbe(1)) << "Expect a train of one message to be rejected";
+    std::atomic<int64_t> serverBandwidth{-1};
+    std::atomic<int> received{0};
+    std::atomic<SRTSOCKET> clientSocket{SRT_INVALID_SOCK};
+    server.clientConnected = [&](struct sockaddr&, SRTSOCKET socket, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                 const SRTNet::ConnectionInformation&) {
+        clientSocket = socket;
+        return ctx;
+    };
+    server.capacityProbed = [&](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET,
+                                const SRTNet::CapacityProbeResult& result) { serverBandwidth = result.mBandwidth; };
+    server.receivedDataNoCopy = [&](const uint8_t*, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                    SRTSOCKET) { received++; };
+    std::mutex clientResultMtx;
+    std::optional<SRTNet::CapacityProbeResult> clientResult;
+    client.capacityProbed = [&](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET,
+                                const SRTNet::CapacityProbeResult& result) {
+        std::lock_guard<std::mutex> lock(clientResultMtx);
+        clientResult = result;
+    };
+    std::atomic<int> clientReceived{0};
+    client.receivedDataNoCopy = [&](const uint8_t*, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                    SRTSOCKET) { clientReceived++; };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8043, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8043, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    EXPECT_FALSE(client.setCapacityProbe(0)) << "Expect to fail when already started";
+
+    // Neither end waits for the probe, so the server can send right away
+    ASSERT_TRUE(waitUntil([&]() { return clientSocket != SRT_INVALID_SOCK; }, std::chrono::seconds(10)));
+    std::vector<uint8_t> reply(100);
+    SRT_MSGCTRL replyMsgCtrl = srt_msgctrl_default;
+    ASSERT_TRUE(server.sendData(reply.data(), reply.size(), &replyMsgCtrl, clientSocket));
+
+    ASSERT_TRUE(waitUntil(
+        [&]() {
+            std::lock_guard<std::mutex> lock(clientResultMtx);
+            return clientResult.has_value();
+        },
+        std::chrono::seconds(10)));
+    ASSERT_TRUE(waitUntil([&]() { return clientReceived == 1; }, std::chrono::seconds(10)))
+        << "Expect the message sent while waiting for the result to be delivered";
+    EXPECT_GT(clientResult->mBandwidth, 0);
+    EXPECT_EQ(clientResult->mBandwidth / 1000, serverBandwidth / 1000) << "Expect the server to send its result";
+    EXPECT_GE(clientResult->mRtt, 0);
+    EXPECT_GE(clientResult->mLoss, 0);
+
+    // The probe train is not delivered to the application
+    std::vector<uint8_t> message(1000);
+    for (int i = 0; i < 10; ++i) {
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        ASSERT_TRUE(client.sendData(message.data(), message.size(), &msgCtrl));
+    }
+    // The train was sent before the messages, so any probe message passed on would have arrived before the last one
+    ASSERT_TRUE(waitUntil([&]() { return received >= 10; }, std::chrono::seconds(10)));
+    EXPECT_EQ(received, 10);
+
+    EXPECT_TRUE(client.stop());
+    EXPECT_TRUE(server.stop());
+}
+
+TEST(TestSrt, Conflation) {
+    SRTNet server;
+    SRTNet client;
+    // The first byte is the key, messages starting with 0xff are not conflated
+    ASSERT_TRUE(server.setConflation(16, [](const uint8_t* data, size_t size, SRTSOCKET, uint64_t& key) {
+        if (size == 0 || data[0] == 0xff) {
+            return false;
+        }
+        key = data[0];
+        return true;
+    }));
+    std::atomic<SRTSOCKET> clientSocket{SRT_INVALID_SOCK};
+    std::atomic<int> delivered{0};
+    server.clientConnected = [&](struct sockaddr&, SRTSOCKET socket, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                 const SRTNet::ConnectionInformation&) {
+        clientSocket = socket;
+        return ctx;
+    };
+    server.receivedDataNoCopy = [&](const uint8_t*, size_t, SRT_MSGCTRL&, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                    SRTSOCKET) { delivered++; };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8044, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8044, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    EXPECT_FALSE(server.setConflation(0)) << "Expect to fail when already started";
+    ASSERT_TRUE(waitUntil([&]() { return clientSocket != SRT_INVALID_SOCK; }, std::chrono::seconds(2),
+                          std::chrono::milliseconds(10)));
+
+    // 10 updates for each of 2 keys, and one message that is not conflated
+    for (uint8_t value = 1; value <= 10; ++value) {
+        for (uint8_t key = 1; key <= 2; ++key) {
+            std::vector<uint8_t> message = {key, value};
+            SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+            ASSERT_TRUE(client.sendData(message.data(), message.size(), &msgCtrl));
+        }
+    }
+    std::vector<uint8_t> other = {0xff};
+    SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+    ASSERT_TRUE(client.sendData(other.data(), other.size(), &msgCtrl));
+    ASSERT_TRUE(waitUntil([&]() { return delivered == 1; }, std::chrono::seconds(2), std::chrono::milliseconds(10)));
+
+    std::vector<uint8_t> latest;
+    ASSERT_TRUE(server.getLatestMessage(latest, 1, clientSocket));
+    EXPECT_EQ(latest, std::vector<uint8_t>({1, 10}));
+    ASSERT_TRUE(server.getLatestMessage(latest, 2, clientSocket));
+    EXPECT_EQ(latest, std::vector<uint8_t>({2, 10}));
+    EXPECT_FALSE(server.getLatestMessage(latest, 1, clientSocket)) << "Expect no update since the last read";
+    EXPECT_FALSE(server.getLatestMessage(latest, 3, clientSocket));
+    EXPECT_EQ(server.getConflatedMessages(clientSocket), 18);
+    EXPECT_EQ(delivered, 1) << "Expect only the message that is not conflated to be delivered";
+
+    EXPECT_TRUE(client.stop());
+    EXPECT_TRUE(server.stop());
+}
+
+TEST(TestSrt, SlowLane) {
+    SRTNet server;
+    SRTNet slowClient;
+    SRTNet fastClient;
+    ASSERT_TRUE(server.setSlowLane(std::chrono::milliseconds(20), std::chrono::milliseconds(200)));
+    EXPECT_FALSE(server.setCallbackExecutor(2)) << "Expect the callback executor not to be used with the slow lane";
+    // The first byte of a message is how long the callback of the server takes, in ms, or kBlock to block it until
+    // released
+    const uint8_t kBlock = 0xff;
+    std::atomic<bool> released{false};
+    std::atomic<int> fastReceived{0};
+    std::atomic<int> slowReceived{0};
+    server.clientConnected = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                const SRTNet::ConnectionInformation&) { return ctx; };
+    server.receivedDataNoCopy = [&](const uint8_t* data, size_t, SRT_MSGCTRL&,
+                                    std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+        if (data[0] == 0) {
+            fastReceived++;
+            return;
+        }
+        if (data[0] == kBlock) {
+            while (!released) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+            }
+        } else {
+            std::this_thread::sleep_for(std::chrono::milliseconds(data[0]));
+        }
+        slowReceived++;
+    };
+    // A low latency, so that a delayed message stands out
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8045, 16, 20, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(slowClient.startClient("127.0.0.1", 8045, 16, 20, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    ASSERT_TRUE(fastClient.startClient("127.0.0.1", 8045, 16, 20, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    auto send = [](SRTNet& client, uint8_t callbackMs) {
+        SRT_MSGCTRL msgCtrl = srt_msgctrl_default;
+        return client.sendData(&callbackMs, 1, &msgCtrl);
+    };
+
+    // One slow callback moves the client to the slow lane
+    ASSERT_TRUE(send(slowClient, 50));
+    ASSERT_TRUE(waitUntil([&]() { return server.getSlowLaneSockets().size() == 1; }, std::chrono::seconds(2),
+                          std::chrono::milliseconds(5)));
+
+    // A callback of the slow client that doesn't return no longer holds up the messages of the fast client
+    ASSERT_TRUE(send(slowClient, kBlock));
+    ASSERT_TRUE(send(fastClient, 0));
+    EXPECT_TRUE(waitUntil([&]() { return fastReceived == 1; }, std::chrono::seconds(5)))
+        << "Expect the fast client to be served while the slow lane is blocked";
+    EXPECT_EQ(slowReceived, 1);
+    released = true;
+    ASSERT_TRUE(waitUntil([&]() { return slowReceived == 2; }, std::chrono::seconds(5)));
+    EXPECT_EQ(server.getSlowLaneSockets().size(), 1);
+
+    // Fast callbacks for longer than the cool-down move the client back
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+    while (!server.getSlowLaneSockets().empty() && std::chrono::steady_clock::now() < deadline) {
+        ASSERT_TRUE(send(slowClient, 0));
+        std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    }
+    EXPECT_TRUE(server.getSlowLaneSockets().empty());
+
+    EXPECT_TRUE(slowClient.stop());
+    EXPECT_TRUE(fastClient.stop());
+    EXPECT_TRUE(server.stop());
+}
+
+TEST(TestSrt, CallbacksMayCallGetActiveClients) {
+    SRTNet server;
+    SRTNet client;
+    std::atomic<bool> disconnected{false};
+    std::atomic<size_t> clientsWhenDisconnected{SIZE_MAX};
+    server.clientConnected = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                const SRTNet::ConnectionInformation&) { return ctx; };
+    server.clientDisconnected = [&](std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+        clientsWhenDisconnected = server.getActiveClients().size();
+        disconnected = true;
+    };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8046, 16, 1000, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8046, 16, 1000, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+    ASSERT_TRUE(waitUntil([&]() { return server.getActiveClients().size() == 1; }, std::chrono::seconds(2),
+                          std::chrono::milliseconds(5)));
+
+    EXPECT_TRUE(client.stop());
+    ASSERT_TRUE(waitUntil([&]() { return disconnected.load(); }, std::chrono::seconds(3),
+                          std::chrono::milliseconds(5)));
+    EXPECT_EQ(clientsWhenDisconnected, 0) << "Expect the client to be removed before clientDisconnected is called";
+    EXPECT_TRUE(server.stop());
+}
@@ -0,0 +1,154 @@
+#include <algorithm>
+#include <cstdio>
+#include <functional>
+#include <map>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetStatsHistory.h"
+
+namespace {
+std::string historyPath(const char* name) {
+    return std::string("/tmp/srtnet_") + name + "_" + std::to_string(getpid()) + ".stats";
+}
+
+SRT_TRACEBSTATS makeStats(int64_t packets, double rtt) {
+    SRT_TRACEBSTATS stats{};
+    stats.pktSentTotal = packets;
+    stats.byteSentTotal = packets * 1316;
+    stats.msRTT = rtt;
+    return stats;
+}
+
+struct ReadBack {
+    std::vector<std::string> mColumns;
+    std::map<SRTSOCKET, std::vector<SRTNetStatsHistory::Sample>> mConnections;
+};
+
+bool readBack(const std::string& path, ReadBack& result) {
+    return SRTNetStatsHistory::readFile(
+        path, result.mColumns, [&](SRTSOCKET socket, const std::vector<SRTNetStatsHistory::Sample>& samples) {
+            result.mConnections[socket] = samples;
+        });
+}
+
+size_t columnIndex(const ReadBack& result, const std::string& name) {
+    return std::find(result.mColumns.begin(), result.mColumns.end(), name) - result.mColumns.begin();
+}
+} // namespace
+
+TEST(TestStatsHistory, WriteAndReadBackWithWrapAround) {
+    const std::string path = historyPath("wrap");
+    {
+        SRTNetStatsHistory history;
+        ASSERT_TRUE(history.open(path, 4, 8, std::chrono::milliseconds(100)));
+        for (int64_t sample = 0; sample < 12; ++sample) {
+            history.beginRound();
+            EXPECT_TRUE(history.writeSample(100, makeStats(sample, 10.5), 1000 + sample));
+            EXPECT_TRUE(history.writeSample(200, makeStats(sample * 2, 20.0), 1000 + sample));
+        }
+        // The file is read while still mapped by the writer, as after a crash
+        ReadBack result;
+        ASSERT_TRUE(readBack(path, result));
+        EXPECT_EQ(result.mConnections.size(), 2);
+        history.stop();
+    }
+
+    ReadBack result;
+    ASSERT_TRUE(readBack(path, result));
+    ASSERT_EQ(result.mConnections.size(), 2);
+    size_t timestamp = columnIndex(result, "timestampUs");
+    size_t packets = columnIndex(result, "pktSentTotal");
+    size_t rtt = columnIndex(result, "msRTT");
+    ASSERT_LT(rtt, result.mColumns.size());
+
+    const auto& samples = result.mConnections[100];
+    ASSERT_EQ(samples.size(), 8) << "Only the last samplesPerConnection samples are kept";
+    for (size_t i = 0; i < samples.size(); ++i) {
+        EXPECT_EQ(samples[i].mValues[timestamp], 1004 + i) << "Expected the oldest sample first";
+        EXPECT_EQ(samples[i].mValues[packets], 4 + i);
+        EXPECT_FLOAT_EQ(samples[i].mValues[rtt], 10.5);
+    }
+    EXPECT_EQ(result.mConnections[200].back().mValues[packets], 22);
+    std::remove(path.c_str());
+}
+
+TEST(TestStatsHistory, ReuseSlotOfOldestConnection) {
+    const std::string path = historyPath("reuse");
+    SRTNetStatsHistory history;
+    ASSERT_TRUE(history.open(path, 2, 4, std::chrono::milliseconds(100)));
+
+    history.beginRound();
+    EXPECT_TRUE(history.writeSample(1, makeStats(1, 1), 1));
+    EXPECT_TRUE(history.writeSample(2, makeStats(2, 1), 1));
+    EXPECT_FALSE(history.writeSample(3, makeStats(3, 1), 1)) << "All slots are in use in this round";
+
+    // Socket 1 disconnected, 2 is still sampled
+    history.beginRound();
+    EXPECT_TRUE(history.writeSample(2, makeStats(2, 1), 2));
+    history.beginRound();
+    EXPECT_TRUE(history.writeSample(2, makeStats(2, 1), 3));
+    EXPECT_TRUE(history.writeSample(3, makeStats(3, 1), 3)) << "Expected the slot of socket 1 to be reused";
+    history.stop();
+
+    ReadBack result;
+    ASSERT_TRUE(readBack(path, result));
+    EXPECT_EQ(result.mConnections.count(1), 0);
+    ASSERT_EQ(result.mConnections.count(3), 1);
+    EXPECT_EQ(result.mConnections[3].size(), 1) << "Expected no samples of socket 1 to leak into the reused slot";
+    EXPECT_EQ(result.mConnections[2].size(), 3);
+    std::remove(path.c_str());
+}
+
+TEST(TestStatsHistory, RejectInvalidFile) {
+    const std::string path = historyPath("invalid");
+    FILE* file = fopen(path.c_str(), "w");
+    ASSERT_NE(file, nullptr);
+    std::vector<char> garbage(4096, 'x');
+    fwrite(garbage.data(), 1, garbage.size(), file);
+    fclose(file);
+
+    ReadBack result;
+    EXPECT_FALSE(readBack(path, result));
+    EXPECT_FALSE(readBack(path + ".missing", result));
+    std::remove(path.c_str());
+}
+
+TEST(TestStatsHistory, RejectCorruptHeader) {
+    const std::string path = historyPath("corrupt");
+    {
+        SRTNetStatsHistory history;
+        ASSERT_TRUE(history.open(path, 2, 4, std::chrono::milliseconds(100)));
+        history.beginRound();
+        EXPECT_TRUE(history.writeSample(100, makeStats(1, 1), 1000));
+        history.stop();
+    }
+    ReadBack result;
+    ASSERT_TRUE(readBack(path, result));
+
+    auto corrupt = [&](const std::function<void(SRTNetStatsHistory::FileHeader&)>& change) {
+        FILE* file = fopen(path.c_str(), "r+b");
+        EXPECT_NE(file, nullptr);
+        SRTNetStatsHistory::FileHeader original;
+        EXPECT_EQ(fread(&original, sizeof(original), 1, file), 1);
+        SRTNetStatsHistory::FileHeader header = original;
+        change(header);
+        rewind(file);
+        fwrite(&header, sizeof(header), 1, file);
+        fflush(file);
+        bool valid = readBack(path, result);
+        rewind(file);
+        fwrite(&original, sizeof(original), 1, file);
+        fclose(file);
+        return valid;
+    };
+    EXPECT_FALSE(corrupt([](auto& header) { header.mColumns[1].mOffset = header.mSlotSize; }));
+    EXPECT_FALSE(corrupt([](auto& header) { header.mColumns[1].mOffset += 1; })) << "Unaligned column";
+    EXPECT_FALSE(corrupt([](auto& header) { header.mColumns[1].mType = 7; }));
+    EXPECT_FALSE(corrupt([](auto& header) { header.mSamplesPerConnection *= 1000; }));
+    EXPECT_FALSE(corrupt([](auto& header) { header.mFirstSlotOffset = ~0ull - 7; }));
+    EXPECT_TRUE(readBack(path, result)) << "Expected the restored header to be valid";
+    std::remove(path.c_str());
+}
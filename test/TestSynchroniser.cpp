@@ -0,0 +1,125 @@
+#include <thread>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetSynchroniser.h"
+
+namespace {
+struct Released {
+    size_t mMember;
+    int64_t mSrcTime;
+    int64_t mReleaseTime;
+    uint8_t mFirstByte;
+};
+
+SRT_MSGCTRL msgCtrlWithSrcTime(int64_t srcTime) {
+    SRT_MSGCTRL msgCtrl{};
+    msgCtrl.srctime = srcTime;
+    return msgCtrl;
+}
+} // namespace
+
+TEST(TestSynchroniser, ReleaseInLockstep) {
+    const int64_t kOutputDelayUs = 60000;
+    const int64_t kFrameUs = 10000;
+    const int64_t kLateMemberUs = 25000;
+    const int kFrames = 10;
+
+    std::mutex mutex;
+    std::vector<Released> released;
+    SRTNetSynchroniser synchroniser(4, 16, 1316, std::chrono::microseconds(kOutputDelayUs),
+                                    [&](size_t member, SRTSOCKET socket, const uint8_t* data, size_t size,
+                                        int64_t srcTime) {
+                                        EXPECT_EQ(socket, static_cast<SRTSOCKET>(100 + member));
+                                        EXPECT_EQ(size, 1316);
+                                        std::lock_guard<std::mutex> lock(mutex);
+                                        released.push_back({member, srcTime, srt_time_now(), data[0]});
+                                    });
+    for (SRTSOCKET socket = 100; socket < 103; ++socket) {
+        ASSERT_TRUE(synchroniser.addMember(socket));
+    }
+    EXPECT_FALSE(synchroniser.addMember(100)) << "Expected a socket to be added only once";
+
+    // Three cameras capture frames at the same times, the third one is delivered kLateMemberUs later than the others
+    std::vector<uint8_t> frame(1316);
+    const int64_t start = srt_time_now();
+    for (int tick = 0; tick < kFrames + 3; ++tick) {
+        std::this_thread::sleep_until(std::chrono::steady_clock::now() +
+                                      std::chrono::microseconds(start + tick * kFrameUs - srt_time_now()));
+        frame[0] = static_cast<uint8_t>(tick);
+        if (tick < kFrames) {
+            SRT_MSGCTRL msgCtrl = msgCtrlWithSrcTime(start + tick * kFrameUs);
+            EXPECT_TRUE(synchroniser.pushData(frame.data(), frame.size(), msgCtrl, 100));
+            EXPECT_TRUE(synchroniser.pushData(frame.data(), frame.size(), msgCtrl, 101));
+        }
+        int lateTick = tick - static_cast<int>((kLateMemberUs + kFrameUs - 1) / kFrameUs);
+        if (lateTick >= 0 && lateTick < kFrames) {
+            frame[0] = static_cast<uint8_t>(lateTick);
+            SRT_MSGCTRL msgCtrl = msgCtrlWithSrcTime(start + lateTick * kFrameUs);
+            EXPECT_TRUE(synchroniser.pushData(frame.data(), frame.size(), msgCtrl, 102));
+        }
+    }
+    EXPECT_FALSE(synchroniser.pushData(frame.data(), frame.size(), msgCtrlWithSrcTime(srt_time_now()), 200))
+        << "Expected messages from other sockets to be ignored";
+    std::this_thread::sleep_for(std::chrono::microseconds(kOutputDelayUs + 20000));
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        ASSERT_EQ(released.size(), 3 * kFrames);
+        for (int frameIndex = 0; frameIndex < kFrames; ++frameIndex) {
+            const int64_t srcTime = start + frameIndex * kFrameUs;
+            for (size_t member = 0; member < 3; ++member) {
+                const Released& message = released[frameIndex * 3 + member];
+                // Released in srctime order, with the frames of all members together at srctime + output delay
+                EXPECT_EQ(message.mSrcTime, srcTime);
+                EXPECT_EQ(message.mFirstByte, frameIndex);
+                EXPECT_GE(message.mReleaseTime, srcTime + kOutputDelayUs);
+                EXPECT_LT(message.mReleaseTime, srcTime + kOutputDelayUs + 5000);
+            }
+        }
+    }
+
+    SRTNetSynchroniser::Statistics statistics;
+    synchroniser.getStatistics(statistics);
+    ASSERT_EQ(statistics.mMembers.size(), 3);
+    for (const auto& member : statistics.mMembers) {
+        EXPECT_EQ(member.mReleasedMessages, kFrames);
+        EXPECT_EQ(member.mLateMessages, 0);
+        EXPECT_EQ(member.mQueuedMessages, 0);
+    }
+    // The third member arrives kLateMemberUs rounded up to a whole frame after the others
+    EXPECT_NEAR(statistics.mSkew, 3 * kFrameUs, 5000);
+    EXPECT_GE(statistics.mMaxSkew, statistics.mSkew);
+}
+
+TEST(TestSynchroniser, DropLateReorderedAndOverflowingMessages) {
+    std::atomic<size_t> released{0};
+    SRTNetSynchroniser synchroniser(1, 2, 100, std::chrono::milliseconds(50),
+                                    [&](size_t, SRTSOCKET, const uint8_t*, size_t, int64_t) { released++; });
+    ASSERT_TRUE(synchroniser.addMember(7));
+    EXPECT_FALSE(synchroniser.addMember(8)) << "Expected the group to be full";
+
+    std::vector<uint8_t> message(100);
+    const int64_t now = srt_time_now();
+    EXPECT_FALSE(synchroniser.pushData(message.data(), message.size(), msgCtrlWithSrcTime(now - 60000), 7));
+    EXPECT_TRUE(synchroniser.pushData(message.data(), message.size(), msgCtrlWithSrcTime(now + 10000), 7));
+    EXPECT_FALSE(synchroniser.pushData(message.data(), message.size(), msgCtrlWithSrcTime(now), 7));
+    EXPECT_FALSE(synchroniser.pushData(message.data(), 101, msgCtrlWithSrcTime(now + 20000), 7));
+    EXPECT_TRUE(synchroniser.pushData(message.data(), message.size(), msgCtrlWithSrcTime(now + 20000), 7));
+    EXPECT_FALSE(synchroniser.pushData(message.data(), message.size(), msgCtrlWithSrcTime(now + 30000), 7));
+
+    SRTNetSynchroniser::Statistics statistics;
+    synchroniser.getStatistics(statistics);
+    ASSERT_EQ(statistics.mMembers.size(), 1);
+    EXPECT_EQ(statistics.mMembers[0].mLateMessages, 1);
+    EXPECT_EQ(statistics.mMembers[0].mReorderedMessages, 1);
+    EXPECT_EQ(statistics.mMembers[0].mOverflowMessages, 2);
+    EXPECT_EQ(statistics.mMembers[0].mQueuedMessages, 2);
+
+    // A removed member frees its place in the group and its queued messages are dropped
+    EXPECT_TRUE(synchroniser.removeMember(7));
+    EXPECT_FALSE(synchroniser.removeMember(7));
+    EXPECT_TRUE(synchroniser.addMember(8));
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    EXPECT_EQ(released, 0);
+}
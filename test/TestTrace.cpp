@@ -0,0 +1,119 @@
+#include <fstream>
+#include <sstream>
+#include <thread>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetTrace.h"
+#include "TestHelpers.h"
+
+namespace {
+size_t countOccurrences(const std::string& text, const std::string& pattern) {
+    size_t count = 0;
+    for (size_t position = text.find(pattern); position != std::string::npos;
+         position = text.find(pattern, position + pattern.size())) {
+        count++;
+    }
+    return count;
+}
+} // namespace
+
+TEST(TestTrace, RecordAndExportThreads) {
+    std::thread worker([]() {
+        SRTNetTrace::setThreadName("traceTestWorker");
+        SRTNetTrace::Scope scope("traceTestScope");
+        SRTNetTrace::instant("traceTestInstant", 42);
+    });
+    worker.join();
+
+    std::ostringstream stream;
+    SRTNetTrace::writeTrace(stream);
+    std::string trace = stream.str();
+    EXPECT_EQ(trace.rfind("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", 0), 0);
+    EXPECT_NE(trace.find("\"args\":{\"name\":\"traceTestWorker\"}"), std::string::npos)
+        << "Expected the events of an exited thread to be kept";
+    EXPECT_NE(trace.find("{\"name\":\"traceTestScope\""), std::string::npos);
+    EXPECT_NE(trace.find("\"ph\":\"i\",\"s\":\"t\",\"args\":{\"value\":42}"), std::string::npos);
+}
+
+TEST(TestTrace, RingKeepsMostRecentEvents) {
+    std::thread worker([]() {
+        SRTNetTrace::setThreadName("traceTestRing");
+        for (size_t i = 0; i < SRTNetTrace::kEventsPerThread; ++i) {
+            SRTNetTrace::instant("traceTestOld");
+        }
+        for (size_t i = 0; i < SRTNetTrace::kEventsPerThread / 2; ++i) {
+            SRTNetTrace::instant("traceTestNew");
+        }
+    });
+    worker.join();
+
+    std::ostringstream stream;
+    SRTNetTrace::writeTrace(stream);
+    std::string trace = stream.str();
+    EXPECT_EQ(countOccurrences(trace, "\"traceTestNew\""), SRTNetTrace::kEventsPerThread / 2);
+    EXPECT_EQ(countOccurrences(trace, "\"traceTestOld\""), SRTNetTrace::kEventsPerThread / 2);
+}
+
+TEST(TestTrace, WriteTraceWhileRecording) {
+    // The ring wraps many times while it is dumped, only events read whole may be exported
+    std::atomic<bool> done{false};
+    std::thread worker([&]() {
+        SRTNetTrace::setThreadName("traceTestRacing");
+        int64_t value = 0;
+        while (!done) {
+            SRTNetTrace::complete("traceTestRacingEvent", 7, 11, value++);
+        }
+    });
+    for (int i = 0; i < 3; ++i) {
+        std::ostringstream stream;
+        SRTNetTrace::writeTrace(stream);
+        std::string trace = stream.str();
+        EXPECT_EQ(countOccurrences(trace, "\"traceTestRacingEvent\""),
+                  countOccurrences(trace, "\"traceTestRacingEvent\",\"pid\":1,\"tid\""));
+        EXPECT_EQ(countOccurrences(trace, "\"traceTestRacingEvent\""),
+                  countOccurrences(trace, "\"ts\":0.007,\"ph\":\"X\",\"dur\":0.011"))
+            << "Expected no torn events";
+    }
+    done = true;
+    worker.join();
+}
+
+TEST(TestTrace, DumpOnSlowCallback) {
+    const std::string path = "/tmp/srtnet_trace_" + std::to_string(getpid()) + ".json";
+    uint64_t dumpsBefore = SRTNetTrace::getTriggeredDumpCount();
+    SRTNetTrace::setSlowCallbackTrigger(std::chrono::milliseconds(5), path);
+
+    {
+        SRTNetTrace::Scope fastCallback("traceTestFastCallback", true);
+    }
+    EXPECT_EQ(SRTNetTrace::getTriggeredDumpCount(), dumpsBefore);
+    {
+        SRTNetTrace::Scope notACallback("traceTestSlowScope");
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    EXPECT_EQ(SRTNetTrace::getTriggeredDumpCount(), dumpsBefore);
+    {
+        SRTNetTrace::Scope slowCallback("traceTestSlowCallback", true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    // The dump is written by a background thread
+    EXPECT_TRUE(waitUntil([&]() { return SRTNetTrace::getTriggeredDumpCount() == dumpsBefore + 1; },
+                          std::chrono::seconds(2)));
+    {
+        SRTNetTrace::Scope slowCallback("traceTestSlowCallback", true);
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    EXPECT_EQ(SRTNetTrace::getTriggeredDumpCount(), dumpsBefore + 1) << "Expected the cooldown to suppress the dump";
+    SRTNetTrace::setSlowCallbackTrigger(std::chrono::milliseconds(0), "");
+
+    std::ifstream file(path);
+    std::stringstream content;
+    content << file.rdbuf();
+    EXPECT_NE(content.str().find("\"traceTestSlowCallback\""), std::string::npos);
+    EXPECT_NE(content.str().find("\"slowCallback\""), std::string::npos);
+    std::remove(path.c_str());
+}
@@ -0,0 +1,145 @@
+#include <cstdio>
+#include <cstring>
+#include <thread>
+
+#include <unistd.h>
+
+#include <gtest/gtest.h>
+
+#include "SRTNetTsPlayout.h"
+
+namespace {
+const size_t kPackets = 700;
+const uint64_t kPcrPerPacket = 40608; // 188 bytes at 1 Mbit/s, 1.504 ms per packet
+const uint64_t kPcrWrap = (uint64_t(1) << 33) * 300;
+const uint64_t kFirstPcr = kPcrWrap - 300 * kPcrPerPacket; // Wraps around in the middle of the file
+
+uint64_t readPcr(const uint8_t* packet) {
+    uint64_t base = (uint64_t(packet[6]) << 25) | (uint64_t(packet[7]) << 17) | (uint64_t(packet[8]) << 9) |
+                    (uint64_t(packet[9]) << 1) | (packet[10] >> 7);
+    return base * 300 + ((uint64_t(packet[10] & 0x01) << 8) | packet[11]);
+}
+
+/// Writes a TS file alternating between PID 0x100, carrying a PCR every 70 packets, and PID 0x101
+std::string writeTsFile(const char* name, bool withPcr) {
+    std::string path = std::string("/tmp/srtnet_") + name + "_" + std::to_string(getpid()) + ".ts";
+    FILE* file = fopen(path.c_str(), "wb");
+    uint8_t continuity[2] = {0, 0};
+    for (size_t index = 0; index < kPackets; ++index) {
+        uint8_t packet[188];
+        memset(packet, 0xFF, sizeof(packet));
+        size_t stream = index % 2;
+        packet[0] = 0x47;
+        packet[1] = 0x01;
+        packet[2] = static_cast<uint8_t>(stream);
+        packet[3] = static_cast<uint8_t>(0x10 | (continuity[stream]++ & 0x0F));
+        if (withPcr && index % 70 == 0) {
+            uint64_t pcr = (kFirstPcr + index * kPcrPerPacket) % kPcrWrap;
+            uint64_t base = pcr / 300;
+            packet[3] |= 0x20;
+            packet[4] = 7;
+            packet[5] = 0x10;
+            packet[6] = static_cast<uint8_t>(base >> 25);
+            packet[7] = static_cast<uint8_t>(base >> 17);
+            packet[8] = static_cast<uint8_t>(base >> 9);
+            packet[9] = static_cast<uint8_t>(base >> 1);
+            packet[10] = static_cast<uint8_t>(((base & 0x01) << 7) | 0x7E | ((pcr % 300) >> 8));
+            packet[11] = static_cast<uint8_t>(pcr % 300);
+        }
+        fwrite(packet, 1, sizeof(packet), file);
+    }
+    fclose(file);
+    return path;
+}
+} // namespace
+
+TEST(TestTsPlayout, ScheduleFromPcr) {
+    std::string path = writeTsFile("schedule", true);
+    SRTNetTsPlayout playout;
+    ASSERT_TRUE(playout.open(path));
+    EXPECT_EQ(playout.getMessageCount(), kPackets / SRTNetTsPlayout::kPacketsPerMessage);
+    EXPECT_NEAR(playout.getDuration().count(), 1052800000, 1000);
+
+    uint8_t buffer[SRTNetTsPlayout::kMessageSize];
+    size_t size;
+    int64_t offsetNs;
+    for (uint64_t message : {0, 1, 50, 99}) {
+        playout.buildMessage(message, buffer, size, offsetNs);
+        EXPECT_EQ(size, SRTNetTsPlayout::kMessageSize);
+        EXPECT_NEAR(offsetNs, message * 7 * 1504000, 1000) << "Message " << message;
+    }
+    std::remove(path.c_str());
+}
+
+TEST(TestTsPlayout, LoopWithPcrAndContinuityFixups) {
+    std::string path = writeTsFile("loop", true);
+    SRTNetTsPlayout playout;
+    ASSERT_TRUE(playout.open(path));
+
+    uint8_t first[SRTNetTsPlayout::kMessageSize];
+    uint8_t lastOfLoop[SRTNetTsPlayout::kMessageSize];
+    uint8_t looped[SRTNetTsPlayout::kMessageSize];
+    size_t size;
+    int64_t offsetNs;
+    int64_t loopedOffsetNs;
+    playout.buildMessage(0, first, size, offsetNs);
+    playout.buildMessage(playout.getMessageCount() - 1, lastOfLoop, size, offsetNs);
+    playout.buildMessage(playout.getMessageCount(), looped, size, loopedOffsetNs);
+
+    EXPECT_EQ(loopedOffsetNs, playout.getDuration().count());
+    // The file ends with PID 0x101 and counter 349 % 16, the loop has to continue with PID 0x100 at 350 % 16
+    EXPECT_EQ(lastOfLoop[6 * 188 + 3] & 0x0F, 349 % 16);
+    EXPECT_EQ(looped[3] & 0x0F, 350 % 16);
+    EXPECT_EQ(looped[188 + 3] & 0x0F, 350 % 16);
+    EXPECT_EQ(looped[3] & 0xF0, first[3] & 0xF0) << "Expected only the continuity counter to change";
+    EXPECT_EQ(readPcr(looped), (readPcr(first) + kPackets * kPcrPerPacket) % kPcrWrap);
+    EXPECT_EQ(memcmp(looped + 12, first + 12, 188 - 12), 0) << "Expected the rest of the packet to be unchanged";
+    std::remove(path.c_str());
+}
+
+TEST(TestTsPlayout, RejectFileWithoutPcr) {
+    std::string path = writeTsFile("nopcr", false);
+    SRTNetTsPlayout playout;
+    EXPECT_FALSE(playout.open(path));
+    EXPECT_FALSE(playout.open(path + ".missing"));
+    std::remove(path.c_str());
+}
+
+TEST(TestTsPlayout, PlayOverSrt) {
+    std::string path = writeTsFile("play", true);
+    SRTNetTsPlayout playout;
+    ASSERT_TRUE(playout.open(path));
+
+    SRTNet server;
+    SRTNet client;
+    std::atomic<size_t> received = 0;
+    server.clientConnected = [&](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>& ctx,
+                                 const SRTNet::ConnectionInformation&) { return ctx; };
+    server.receivedDataNoCopy = [&](const uint8_t* data, size_t size, SRT_MSGCTRL&,
+                                    std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+        EXPECT_EQ(data[0], 0x47);
+        received++;
+    };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    ASSERT_TRUE(server.startServer("127.0.0.1", 8033, 16, 120, 100, SRT_LIVE_MAX_PLSIZE, 5000, "", false, ctx));
+    ASSERT_TRUE(client.startClient("127.0.0.1", 8033, 16, 120, 100, ctx, SRT_LIVE_MAX_PLSIZE, true));
+
+    SRTNetTsPlayoutScheduler scheduler;
+    auto start = std::chrono::steady_clock::now();
+    ASSERT_TRUE(playout.start(client, scheduler, false));
+    while (playout.isPlaying() && std::chrono::steady_clock::now() - start < std::chrono::seconds(5)) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    auto playTime = std::chrono::steady_clock::now() - start;
+    EXPECT_FALSE(playout.isPlaying());
+    EXPECT_GE(playTime, playout.getDuration() - std::chrono::milliseconds(20)) << "Expected the file to be paced";
+    EXPECT_EQ(playout.getSentMessages(), playout.getMessageCount());
+    EXPECT_EQ(playout.getFailedMessages(), 0);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(500));
+    EXPECT_EQ(received, playout.getMessageCount());
+    playout.stop();
+    client.stop();
+    server.stop();
+    std::remove(path.c_str());
+}
@@ -0,0 +1,662 @@
+//
+// Simulates an ingest fleet of thousands of SRT clients from one process, optionally also running the receiving server.
+//
+// The clients don't use one SRTNet instance each, since that would mean one worker thread per client. Instead the
+// clients are spread over a few sender threads that drive non-blocking SRT sockets, and all clients of a sender thread
+// bind to the same local UDP port, so they also share the SRT receive and send threads of that port.
+//
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <random>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#ifndef WIN32
+#include <netdb.h>
+#endif
+
+#include "SRTNet.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+const size_t kTsPacketSize = 188;
+const size_t kTsPacketsPerMessage = 7;
+const size_t kMessageSize = kTsPacketSize * kTsPacketsPerMessage;
+const uint16_t kPid = 0x100;
+const uint32_t kMagic = 0x4E474C53; // "SLGN"
+const std::chrono::milliseconds kGopDuration(500);
+const std::chrono::milliseconds kReconnectDelay(100);
+const std::chrono::milliseconds kRetryDelay(1000);
+const std::chrono::milliseconds kMaxSendLag(100);
+const int32_t kConnectTimeoutMs = 3000;
+const size_t kLatencyBuckets = 10000; // 1 ms per bucket, the last bucket holds everything slower
+
+struct Options {
+    std::string mHost = "127.0.0.1";
+    uint16_t mPort = 8050;
+    bool mSend = true;
+    bool mReceive = false;
+    size_t mClients = 1000;
+    size_t mThreads = 4;
+    double mBitrateKbps = 1000;
+    double mBitrateSpread = 0;
+    double mVbr = 0;
+    double mRampUpSeconds = 10;
+    double mChurnSeconds = 0;
+    double mDurationSeconds = 60;
+    double mReportIntervalSeconds = 1;
+    int32_t mLatencyMs = 120;
+    std::string mPsk;
+    bool mPerClient = false;
+};
+
+// Carried in the payload of the first TS packet of every message
+struct LoadHeader {
+    uint32_t mMagic;
+    uint32_t mClientId;
+    uint64_t mSequenceNumber;
+    int64_t mSendTimeUs; // Wall clock, so latency can be measured between hosts with synchronised clocks
+};
+
+int64_t wallClockUs() {
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::system_clock::now().time_since_epoch())
+        .count();
+}
+
+struct SenderStatistics {
+    std::atomic<uint64_t> mMessages{0};
+    std::atomic<uint64_t> mBytes{0};
+    std::atomic<uint64_t> mDrops{0};
+    std::atomic<uint64_t> mConnects{0};
+    std::atomic<uint64_t> mConnectFailures{0};
+    std::atomic<uint64_t> mDisconnects{0};
+    std::atomic<uint64_t> mConnectTimeUs{0};
+};
+
+struct ReceiverStatistics {
+    std::atomic<uint64_t> mMessages{0};
+    std::atomic<uint64_t> mBytes{0};
+    std::atomic<uint64_t> mLost{0};
+    std::atomic<uint64_t> mLatencySumUs{0};
+    std::atomic<uint64_t> mLatencyMaxUs{0};
+    uint64_t mExpectedSequenceNumber = 0; // Only used by the receiving thread
+};
+
+struct Client {
+    enum class State { waiting, connecting, connected };
+
+    uint32_t mId = 0;
+    State mState = State::waiting;
+    SRTSOCKET mSocket = SRT_INVALID_SOCK;
+    double mBitrate = 0; // bit/s
+    double mGopFactor = 1;
+    Clock::time_point mNextGop;
+    Clock::time_point mDisconnectAt = Clock::time_point::max();
+    Clock::time_point mConnectStarted;
+    uint64_t mSequenceNumber = 0;
+    uint8_t mContinuityCounter = 0;
+    SenderStatistics mStatistics;
+};
+
+class LoadGenerator {
+public:
+    explicit LoadGenerator(const Options& options)
+        : mOptions(options)
+        , mClients(options.mClients)
+        , mReceived(options.mClients)
+        , mLatencyHistogram(kLatencyBuckets) {
+    }
+
+    bool run();
+
+private:
+    bool resolveServer();
+    bool startReceiver();
+    void senderWorker(size_t threadIndex);
+    bool startConnect(Client& client, uint16_t& localPort, int pollId);
+    void closeClient(Client& client, int pollId);
+    bool sendMessage(Client& client, uint8_t* buffer);
+    void onReceived(const uint8_t* data, size_t size);
+    void report(double elapsedSeconds, double intervalSeconds);
+    void finalReport(double elapsedSeconds);
+
+    const Options mOptions;
+    sockaddr_storage mServerAddress{};
+    int mServerAddressLength = 0;
+
+    std::vector<Client> mClients;
+    std::vector<ReceiverStatistics> mReceived;
+    std::vector<std::atomic<uint64_t>> mLatencyHistogram;
+    std::atomic<size_t> mConnectedClients{0};
+    std::atomic<bool> mRunning{true};
+    SRTNet mServer;
+
+    // Previous totals, to report per interval rates
+    uint64_t mLastSentBytes = 0;
+    uint64_t mLastReceivedBytes = 0;
+    uint64_t mLastDrops = 0;
+    uint64_t mLastLost = 0;
+    std::vector<uint64_t> mLastHistogram = std::vector<uint64_t>(kLatencyBuckets);
+};
+
+bool LoadGenerator::resolveServer() {
+    addrinfo hints{};
+    hints.ai_socktype = SOCK_DGRAM;
+    addrinfo* resolved = nullptr;
+    if (getaddrinfo(mOptions.mHost.c_str(), std::to_string(mOptions.mPort).c_str(), &hints, &resolved) != 0 ||
+        !resolved) {
+        return false;
+    }
+    memcpy(&mServerAddress, resolved->ai_addr, resolved->ai_addrlen);
+    mServerAddressLength = static_cast<int>(resolved->ai_addrlen);
+    freeaddrinfo(resolved);
+    return true;
+}
+
+bool LoadGenerator::startReceiver() {
+    mServer.clientConnected = [](struct sockaddr&, SRTSOCKET, std::shared_ptr<SRTNet::NetworkConnection>&,
+                                 const SRTNet::ConnectionInformation&) {
+        return std::make_shared<SRTNet::NetworkConnection>();
+    };
+    mServer.receivedDataNoCopy = [this](const uint8_t* data, size_t size, SRT_MSGCTRL&,
+                                        std::shared_ptr<SRTNet::NetworkConnection>&, SRTSOCKET) {
+        onReceived(data, size);
+    };
+    auto ctx = std::make_shared<SRTNet::NetworkConnection>();
+    const std::string listenAddress = mServerAddress.ss_family == AF_INET6 ? "::" : "0.0.0.0";
+    return mServer.startServer(listenAddress, mOptions.mPort, 16, mOptions.mLatencyMs, 25, SRT_LIVE_MAX_PLSIZE, 5000,
+                               mOptions.mPsk, false, ctx, true);
+}
+
+bool LoadGenerator::startConnect(Client& client, uint16_t& localPort, int pollId) {
+    const int32_t yes = 1;
+    const int32_t no = 0;
+    client.mSocket = srt_create_socket();
+    if (client.mSocket == SRT_INVALID_SOCK) {
+        return false;
+    }
+    const std::string streamId = "loadgen-" + std::to_string(client.mId);
+    bool configured = srt_setsockflag(client.mSocket, SRTO_SENDER, &yes, sizeof(yes)) != SRT_ERROR &&
+                      srt_setsockflag(client.mSocket, SRTO_RCVSYN, &no, sizeof(no)) != SRT_ERROR &&
+                      srt_setsockflag(client.mSocket, SRTO_SNDSYN, &no, sizeof(no)) != SRT_ERROR &&
+                      srt_setsockflag(client.mSocket, SRTO_LATENCY, &mOptions.mLatencyMs, sizeof(int32_t)) !=
+                          SRT_ERROR &&
+                      srt_setsockflag(client.mSocket, SRTO_CONNTIMEO, &kConnectTimeoutMs, sizeof(int32_t)) !=
+                          SRT_ERROR &&
+                      srt_setsockflag(client.mSocket, SRTO_STREAMID, streamId.c_str(), streamId.size()) != SRT_ERROR;
+    if (configured && !mOptions.mPsk.empty()) {
+        const int32_t aes128 = 16;
+        configured = srt_setsockflag(client.mSocket, SRTO_PBKEYLEN, &aes128, sizeof(aes128)) != SRT_ERROR &&
+                     srt_setsockflag(client.mSocket, SRTO_PASSPHRASE, mOptions.mPsk.c_str(), mOptions.mPsk.size()) !=
+                         SRT_ERROR;
+    }
+
+    // All clients of a sender thread share one local port, and thereby one SRT multiplexer
+    sockaddr_storage localAddress{};
+    int localAddressLength;
+    if (mServerAddress.ss_family == AF_INET6) {
+        auto* address = reinterpret_cast<sockaddr_in6*>(&localAddress);
+        address->sin6_family = AF_INET6;
+        address->sin6_addr = in6addr_any;
+        address->sin6_port = htons(localPort);
+        localAddressLength = sizeof(sockaddr_in6);
+    } else {
+        auto* address = reinterpret_cast<sockaddr_in*>(&localAddress);
+        address->sin_family = AF_INET;
+        address->sin_addr.s_addr = INADDR_ANY;
+        address->sin_port = htons(localPort);
+        localAddressLength = sizeof(sockaddr_in);
+    }
+    configured = configured &&
+                 srt_bind(client.mSocket, reinterpret_cast<sockaddr*>(&localAddress), localAddressLength) != SRT_ERROR;
+    if (configured && localPort == 0) {
+        int length = sizeof(localAddress);
+        if (srt_getsockname(client.mSocket, reinterpret_cast<sockaddr*>(&localAddress), &length) != SRT_ERROR) {
+            localPort = ntohs(mServerAddress.ss_family == AF_INET6
+                                  ? reinterpret_cast<sockaddr_in6*>(&localAddress)->sin6_port
+                                  : reinterpret_cast<sockaddr_in*>(&localAddress)->sin_port);
+        }
+    }
+
+    const int events = SRT_EPOLL_OUT | SRT_EPOLL_ERR;
+    if (!configured || srt_epoll_add_usock(pollId, client.mSocket, &events) == SRT_ERROR ||
+        srt_connect(client.mSocket, reinterpret_cast<sockaddr*>(&mServerAddress), mServerAddressLength) == SRT_ERROR) {
+        closeClient(client, pollId);
+        return false;
+    }
+    client.mState = Client::State::connecting;
+    client.mConnectStarted = Clock::now();
+    return true;
+}
+
+void LoadGenerator::closeClient(Client& client, int pollId) {
+    if (client.mSocket != SRT_INVALID_SOCK) {
+        srt_epoll_remove_usock(pollId, client.mSocket);
+        srt_close(client.mSocket);
+        client.mSocket = SRT_INVALID_SOCK;
+    }
+    if (client.mState == Client::State::connected) {
+        mConnectedClients--;
+        client.mStatistics.mDisconnects++;
+    }
+    client.mState = Client::State::waiting;
+}
+
+bool LoadGenerator::sendMessage(Client& client, uint8_t* buffer) {
+    for (size_t packet = 0; packet < kTsPacketsPerMessage; ++packet) {
+        uint8_t* tsPacket = buffer + packet * kTsPacketSize;
+        tsPacket[0] = 0x47;
+        tsPacket[1] = static_cast<uint8_t>((packet == 0 ? 0x40 : 0x00) | (kPid >> 8));
+        tsPacket[2] = static_cast<uint8_t>(kPid & 0xFF);
+        tsPacket[3] = static_cast<uint8_t>(0x10 | (client.mContinuityCounter++ & 0x0F));
+    }
+    LoadHeader header{kMagic, client.mId, client.mSequenceNumber, wallClockUs()};
+    memcpy(buffer + 4, &header, sizeof(header));
+
+    int result = srt_sendmsg2(client.mSocket, reinterpret_cast<const char*>(buffer), kMessageSize, nullptr);
+    if (result == SRT_ERROR) {
+        if (srt_getlasterror(nullptr) == SRT_EASYNCSND) {
+            // The send buffer is full, the message is dropped but the sequence number is still consumed
+            client.mSequenceNumber++;
+            client.mStatistics.mDrops++;
+            return true;
+        }
+        // The connection is lost
+        return false;
+    }
+    client.mSequenceNumber++;
+    client.mStatistics.mMessages++;
+    client.mStatistics.mBytes += kMessageSize;
+    return true;
+}
+
+void LoadGenerator::senderWorker(size_t threadIndex) {
+    std::mt19937 generator(static_cast<uint32_t>(threadIndex + 1));
+    std::uniform_real_distribution<double> unit(0.0, 1.0);
+    auto lifetime = [&]() -> Clock::duration {
+        if (mOptions.mChurnSeconds <= 0) {
+            return std::chrono::hours(24 * 365);
+        }
+        std::exponential_distribution<double> distribution(1.0 / mOptions.mChurnSeconds);
+        return std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(distribution(generator)));
+    };
+
+    int pollId = srt_epoll_create();
+    srt_epoll_set(pollId, SRT_EPOLL_ENABLE_EMPTY);
+    uint16_t localPort = 0;
+    std::unordered_map<SRTSOCKET, Client*> connecting;
+
+    // One pending timer per client: when to connect, or when to send the next message
+    using Timer = std::pair<Clock::time_point, Client*>;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    const auto start = Clock::now();
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(mOptions.mDurationSeconds));
+    for (size_t index = threadIndex; index < mClients.size(); index += mOptions.mThreads) {
+        Client& client = mClients[index];
+        client.mId = static_cast<uint32_t>(index);
+        client.mBitrate = mOptions.mBitrateKbps * 1000 * (1 + mOptions.mBitrateSpread * (2 * unit(generator) - 1));
+        auto rampUpOffset = std::chrono::duration<double>(mOptions.mRampUpSeconds * index / mClients.size());
+        timers.emplace(start + std::chrono::duration_cast<Clock::duration>(rampUpOffset), &client);
+    }
+
+    SRT_EPOLL_EVENT ready[64];
+    uint8_t buffer[kMessageSize];
+    memset(buffer, 0xFF, sizeof(buffer));
+    while (mRunning && Clock::now() < end) {
+        auto now = Clock::now();
+        while (!timers.empty() && timers.top().first <= now) {
+            auto [due, client] = timers.top();
+            timers.pop();
+
+            if (client->mState == Client::State::waiting) {
+                if (startConnect(*client, localPort, pollId)) {
+                    connecting[client->mSocket] = client;
+                } else {
+                    client->mStatistics.mConnectFailures++;
+                    timers.emplace(now + kRetryDelay, client);
+                }
+                continue;
+            }
+            if (client->mState != Client::State::connected) {
+                continue;
+            }
+            if (now >= client->mDisconnectAt) {
+                closeClient(*client, pollId);
+                timers.emplace(now + kReconnectDelay, client);
+                continue;
+            }
+
+            if (now >= client->mNextGop) {
+                client->mGopFactor = 1 + mOptions.mVbr * (2 * unit(generator) - 1);
+                client->mNextGop = now + kGopDuration;
+            }
+            if (!sendMessage(*client, buffer)) {
+                closeClient(*client, pollId);
+                timers.emplace(now + kRetryDelay, client);
+                continue;
+            }
+            auto interval = std::chrono::duration_cast<Clock::duration>(
+                std::chrono::duration<double>(kMessageSize * 8 / (client->mBitrate * client->mGopFactor)));
+            // Don't try to catch up with a long stall by bursting, the messages are counted as lost by the receiver
+            auto next = due + interval;
+            timers.emplace(next < now - kMaxSendLag ? now + interval : next, client);
+        }
+
+        auto timeout = std::chrono::milliseconds(100);
+        if (!timers.empty()) {
+            timeout = std::min(timeout,
+                               std::chrono::duration_cast<std::chrono::milliseconds>(timers.top().first - now));
+        }
+        int count = srt_epoll_uwait(pollId, ready, 64, std::max<int64_t>(0, timeout.count()));
+        now = Clock::now();
+        for (int i = 0; i < count; ++i) {
+            auto iterator = connecting.find(ready[i].fd);
+            if (iterator == connecting.end()) {
+                continue;
+            }
+            Client* client = iterator->second;
+            connecting.erase(iterator);
+            if ((ready[i].events & SRT_EPOLL_ERR) || srt_getsockstate(client->mSocket) != SRTS_CONNECTED) {
+                client->mStatistics.mConnectFailures++;
+                closeClient(*client, pollId);
+                timers.emplace(now + kRetryDelay, client);
+                continue;
+            }
+            // Connected, the socket is only polled while connecting
+            srt_epoll_remove_usock(pollId, client->mSocket);
+            client->mState = Client::State::connected;
+            mConnectedClients++;
+            client->mStatistics.mConnects++;
+            client->mStatistics.mConnectTimeUs += std::chrono::duration_cast<std::chrono::microseconds>(
+                                                      now - client->mConnectStarted)
+                                                      .count();
+            client->mDisconnectAt = now + lifetime();
+            client->mNextGop = now;
+            timers.emplace(now, client);
+        }
+    }
+
+    for (size_t index = threadIndex; index < mClients.size(); index += mOptions.mThreads) {
+        closeClient(mClients[index], pollId);
+    }
+    srt_epoll_release(pollId);
+}
+
+void LoadGenerator::onReceived(const uint8_t* data, size_t size) {
+    LoadHeader header;
+    if (size < 4 + sizeof(header) || data[0] != 0x47) {
+        return;
+    }
+    memcpy(&header, data + 4, sizeof(header));
+    if (header.mMagic != kMagic || header.mClientId >= mReceived.size()) {
+        return;
+    }
+
+    ReceiverStatistics& statistics = mReceived[header.mClientId];
+    statistics.mMessages.fetch_add(1, std::memory_order_relaxed);
+    statistics.mBytes.fetch_add(size, std::memory_order_relaxed);
+    if (header.mSequenceNumber > statistics.mExpectedSequenceNumber) {
+        statistics.mLost.fetch_add(header.mSequenceNumber - statistics.mExpectedSequenceNumber,
+                                   std::memory_order_relaxed);
+    }
+    statistics.mExpectedSequenceNumber = std::max(statistics.mExpectedSequenceNumber, header.mSequenceNumber + 1);
+
+    uint64_t latencyUs = static_cast<uint64_t>(std::max<int64_t>(0, wallClockUs() - header.mSendTimeUs));
+    statistics.mLatencySumUs.fetch_add(latencyUs, std::memory_order_relaxed);
+    if (latencyUs > statistics.mLatencyMaxUs.load(std::memory_order_relaxed)) {
+        statistics.mLatencyMaxUs.store(latencyUs, std::memory_order_relaxed);
+    }
+    mLatencyHistogram[std::min<uint64_t>(latencyUs / 1000, kLatencyBuckets - 1)].fetch_add(1,
+                                                                                          std::memory_order_relaxed);
+}
+
+void LoadGenerator::report(double elapsedSeconds, double intervalSeconds) {
+    uint64_t sentBytes = 0;
+    uint64_t drops = 0;
+    for (const auto& client : mClients) {
+        sentBytes += client.mStatistics.mBytes;
+        drops += client.mStatistics.mDrops;
+    }
+    uint64_t receivedBytes = 0;
+    uint64_t lost = 0;
+    for (const auto& received : mReceived) {
+        receivedBytes += received.mBytes;
+        lost += received.mLost;
+    }
+
+    std::cout << std::fixed << std::setprecision(1) << "t=" << elapsedSeconds << "s connected=" << mConnectedClients
+              << " sent=" << (sentBytes - mLastSentBytes) * 8 / intervalSeconds / 1e6 << "Mbit/s"
+              << " drops=" << drops - mLastDrops;
+    if (mOptions.mReceive) {
+        // Percentiles of the latency of the messages received in this interval
+        uint64_t total = 0;
+        std::vector<uint64_t> interval(kLatencyBuckets);
+        for (size_t bucket = 0; bucket < kLatencyBuckets; ++bucket) {
+            uint64_t value = mLatencyHistogram[bucket].load(std::memory_order_relaxed);
+            interval[bucket] = value - mLastHistogram[bucket];
+            mLastHistogram[bucket] = value;
+            total += interval[bucket];
+        }
+        auto percentile = [&](double fraction) -> size_t {
+            uint64_t rank = static_cast<uint64_t>(std::ceil(fraction * total));
+            uint64_t accumulated = 0;
+            for (size_t bucket = 0; bucket < kLatencyBuckets; ++bucket) {
+                accumulated += interval[bucket];
+                if (accumulated >= rank && accumulated > 0) {
+                    return bucket;
+                }
+            }
+            return 0;
+        };
+        std::cout << " received=" << (receivedBytes - mLastReceivedBytes) * 8 / intervalSeconds / 1e6 << "Mbit/s"
+                  << " lost=" << lost - mLastLost << " latency p50=" << percentile(0.5)
+                  << "ms p99=" << percentile(0.99) << "ms";
+    }
+    std::cout << std::endl;
+
+    mLastSentBytes = sentBytes;
+    mLastReceivedBytes = receivedBytes;
+    mLastDrops = drops;
+    mLastLost = lost;
+}
+
+void LoadGenerator::finalReport(double elapsedSeconds) {
+    uint64_t totals[8] = {};
+    for (size_t id = 0; id < mClients.size(); ++id) {
+        const SenderStatistics& sent = mClients[id].mStatistics;
+        const ReceiverStatistics& received = mReceived[id];
+        totals[0] += sent.mConnects;
+        totals[1] += sent.mConnectFailures;
+        totals[2] += sent.mDisconnects;
+        totals[3] += sent.mMessages;
+        totals[4] += sent.mDrops;
+        totals[5] += received.mMessages;
+        totals[6] += received.mLost;
+        totals[7] += sent.mConnectTimeUs;
+    }
+
+    std::cout << "Summary: clients=" << mClients.size() << " duration=" << elapsedSeconds << "s connects=" << totals[0]
+              << " connectFailures=" << totals[1] << " disconnects=" << totals[2]
+              << " meanConnectTime=" << (totals[0] ? totals[7] / totals[0] / 1000.0 : 0) << "ms sentMessages="
+              << totals[3] << " sendDrops=" << totals[4];
+    if (mOptions.mReceive) {
+        std::cout << " receivedMessages=" << totals[5] << " lost=" << totals[6] << " delivery="
+                  << (totals[3] ? 100.0 * totals[5] / totals[3] : 0) << "%";
+    }
+    std::cout << std::endl;
+
+    if (!mOptions.mPerClient) {
+        return;
+    }
+    std::cout << "client,connects,connectFailures,disconnects,sentMessages,sendDrops";
+    if (mOptions.mReceive) {
+        std::cout << ",receivedMessages,lost,meanLatencyMs,maxLatencyMs";
+    }
+    std::cout << "\n";
+    for (size_t id = 0; id < mClients.size(); ++id) {
+        const SenderStatistics& sent = mClients[id].mStatistics;
+        std::cout << id << "," << sent.mConnects << "," << sent.mConnectFailures << "," << sent.mDisconnects << ","
+                  << sent.mMessages << "," << sent.mDrops;
+        if (mOptions.mReceive) {
+            const ReceiverStatistics& received = mReceived[id];
+            uint64_t messages = received.mMessages;
+            std::cout << "," << messages << "," << received.mLost << ","
+                      << (messages ? received.mLatencySumUs / messages / 1000.0 : 0) << ","
+                      << received.mLatencyMaxUs / 1000.0;
+        }
+        std::cout << "\n";
+    }
+    std::cout << std::flush;
+}
+
+bool LoadGenerator::run() {
+    if (!resolveServer()) {
+        std::cerr << "Failed to resolve " << mOptions.mHost << std::endl;
+        return false;
+    }
+    if (mOptions.mReceive && !startReceiver()) {
+        std::cerr << "Failed to start the receiving server on port " << mOptions.mPort << std::endl;
+        return false;
+    }
+
+    std::vector<std::thread> senders;
+    if (mOptions.mSend) {
+        for (size_t thread = 0; thread < mOptions.mThreads; ++thread) {
+            senders.emplace_back(&LoadGenerator::senderWorker, this, thread);
+        }
+    }
+
+    const auto start = Clock::now();
+    const auto interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(mOptions.mReportIntervalSeconds));
+    const auto end = start + std::chrono::duration_cast<Clock::duration>(
+                                 std::chrono::duration<double>(mOptions.mDurationSeconds));
+    auto nextReport = start + interval;
+    while (nextReport <= end) {
+        std::this_thread::sleep_until(nextReport);
+        report(std::chrono::duration<double>(Clock::now() - start).count(), mOptions.mReportIntervalSeconds);
+        nextReport += interval;
+    }
+    std::this_thread::sleep_until(end);
+
+    mRunning = false;
+    for (auto& sender : senders) {
+        sender.join();
+    }
+    if (mOptions.mReceive) {
+        // Let the last messages through the receiver latency window
+        std::this_thread::sleep_for(std::chrono::milliseconds(mOptions.mLatencyMs * 2));
+        mServer.stop();
+    }
+    finalReport(std::chrono::duration<double>(Clock::now() - start).count());
+    return true;
+}
+
+void printUsage(const char* name) {
+    std::cout << "Usage: " << name << " [options]\n"
+              << "  --host <address>        Server to connect to (default 127.0.0.1)\n"
+              << "  --port <port>           Server port (default 8050)\n"
+              << "  --mode <send|receive|both>\n"
+              << "                          Run the clients, the receiving server, or both (default send)\n"
+              << "  --clients <count>       Number of clients (default 1000)\n"
+              << "  --threads <count>       Number of sender threads shared by the clients (default 4)\n"
+              << "  --bitrate <kbit/s>      Mean bitrate per client (default 1000)\n"
+              << "  --bitrate-spread <0-1>  Spread of the client bitrates around the mean (default 0)\n"
+              << "  --vbr <0-1>             Bitrate variation per 500 ms GOP, 0 for CBR (default 0)\n"
+              << "  --ramp-up <seconds>     Time over which the client connections are started (default 10)\n"
+              << "  --churn <seconds>       Mean connection lifetime before a reconnect, 0 for none (default 0)\n"
+              << "  --duration <seconds>    Length of the test (default 60)\n"
+              << "  --report <seconds>      Report interval (default 1)\n"
+              << "  --latency <ms>          SRT latency (default 120)\n"
+              << "  --psk <passphrase>      Encrypt the connections\n"
+              << "  --per-client            Print per client statistics as CSV at the end\n"
+              << "Latency is measured from the wall clock of the sender to the wall clock of the receiver, it is only\n"
+              << "meaningful when both run on the same host or have synchronised clocks.\n";
+}
+
+bool parseOptions(int argc, const char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        std::string option = argv[i];
+        if (option == "--per-client") {
+            options.mPerClient = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            return false;
+        }
+        std::string value = argv[++i];
+        try {
+            if (option == "--host") {
+                options.mHost = value;
+            } else if (option == "--port") {
+                options.mPort = static_cast<uint16_t>(std::stoul(value));
+            } else if (option == "--mode") {
+                options.mSend = value == "send" || value == "both";
+                options.mReceive = value == "receive" || value == "both";
+                if (!options.mSend && !options.mReceive) {
+                    return false;
+                }
+            } else if (option == "--clients") {
+                options.mClients = std::stoul(value);
+            } else if (option == "--threads") {
+                options.mThreads = std::max<size_t>(1, std::stoul(value));
+            } else if (option == "--bitrate") {
+                options.mBitrateKbps = std::stod(value);
+            } else if (option == "--bitrate-spread") {
+                options.mBitrateSpread = std::clamp(std::stod(value), 0.0, 0.99);
+            } else if (option == "--vbr") {
+                options.mVbr = std::clamp(std::stod(value), 0.0, 0.99);
+            } else if (option == "--ramp-up") {
+                options.mRampUpSeconds = std::stod(value);
+            } else if (option == "--churn") {
+                options.mChurnSeconds = std::stod(value);
+            } else if (option == "--duration") {
+                options.mDurationSeconds = std::stod(value);
+            } else if (option == "--report") {
+                options.mReportIntervalSeconds = std::stod(value);
+            } else if (option == "--latency") {
+                options.mLatencyMs = std::stoi(value);
+            } else if (option == "--psk") {
+                options.mPsk = value;
+            } else {
+                return false;
+            }
+        } catch (const std::exception&) {
+            return false;
+        }
+    }
+    return options.mClients > 0 && options.mBitrateKbps > 0 && options.mDurationSeconds > 0 &&
+           options.mReportIntervalSeconds > 0;
+}
+
+} // namespace
+
+int main(int argc, const char* argv[]) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return EXIT_FAILURE;
+    }
+
+    // The sender threads use the SRT API directly, and share the library with the receiving SRTNet server
+    srt_startup();
+    bool success;
+    {
+        LoadGenerator loadGenerator(options);
+        success = loadGenerator.run();
+    }
+    srt_cleanup();
+    return success ? EXIT_SUCCESS : EXIT_FAILURE;
+}
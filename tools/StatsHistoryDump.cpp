@@ -0,0 +1,42 @@
+//
+// Dumps a statistics history file written by SRTNetStatsHistory as CSV, one row per sample.
+//
+
+#include <iomanip>
+#include <iostream>
+
+#include "SRTNetStatsHistory.h"
+
+int main(int argc, char* argv[]) {
+    if (argc != 2) {
+        std::cerr << "Usage: " << argv[0] << " <history file>" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::string> columns;
+    bool headerWritten = false;
+    std::cout << std::setprecision(15);
+    bool success = SRTNetStatsHistory::readFile(
+        argv[1], columns, [&](SRTSOCKET socket, const std::vector<SRTNetStatsHistory::Sample>& samples) {
+            if (!headerWritten) {
+                std::cout << "socket";
+                for (const auto& column : columns) {
+                    std::cout << "," << column;
+                }
+                std::cout << "\n";
+                headerWritten = true;
+            }
+            for (const auto& sample : samples) {
+                std::cout << socket;
+                for (double value : sample.mValues) {
+                    std::cout << "," << value;
+                }
+                std::cout << "\n";
+            }
+        });
+    if (!success) {
+        std::cerr << "Failed to read " << argv[1] << std::endl;
+        return 1;
+    }
+    return 0;
+}